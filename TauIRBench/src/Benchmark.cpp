@@ -0,0 +1,242 @@
+#include "Benchmark.hpp"
+#include <ConPrinter.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <thread>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+  #include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+  #include <cpuid.h>
+#endif
+
+#ifndef TAUIR_BENCH_BUILD_TYPE
+  #ifdef NDEBUG
+    #define TAUIR_BENCH_BUILD_TYPE "Release"
+  #else
+    #define TAUIR_BENCH_BUILD_TYPE "Debug"
+  #endif
+#endif
+
+#ifndef TAUIR_BENCH_BUILD_FLAGS
+  #define TAUIR_BENCH_BUILD_FLAGS ""
+#endif
+
+namespace tau::ir::bench {
+
+static ::std::string DetectCpu() noexcept
+{
+    u32 brand[12] { };
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    int registers[4];
+    __cpuid(registers, static_cast<int>(0x80000000));
+
+    if(static_cast<u32>(registers[0]) < 0x80000004)
+    {
+        return "unknown";
+    }
+
+    for(u32 i = 0; i < 3; ++i)
+    {
+        __cpuid(registers, static_cast<int>(0x80000002 + i));
+        (void) ::std::memcpy(brand + i * 4, registers, sizeof(registers));
+    }
+#elif defined(__x86_64__) || defined(__i386__)
+    if(__get_cpuid_max(0x80000000, nullptr) < 0x80000004)
+    {
+        return "unknown";
+    }
+
+    for(u32 i = 0; i < 3; ++i)
+    {
+        __get_cpuid(0x80000002 + i, brand + i * 4, brand + i * 4 + 1, brand + i * 4 + 2, brand + i * 4 + 3);
+    }
+#else
+    return "unknown";
+#endif
+
+    ::std::string ret(reinterpret_cast<const char*>(brand), ::strnlen(reinterpret_cast<const char*>(brand), sizeof(brand)));
+
+    // The brand string is padded with spaces on some processors.
+    const uSys begin = ret.find_first_not_of(' ');
+    const uSys end = ret.find_last_not_of(' ');
+
+    if(begin == ::std::string::npos)
+    {
+        return "unknown";
+    }
+
+    return ret.substr(begin, end - begin + 1);
+}
+
+static ::std::string DetectCompiler() noexcept
+{
+#if defined(__clang__)
+    return "Clang " __clang_version__;
+#elif defined(_MSC_VER)
+    return "MSVC " + ::std::to_string(_MSC_FULL_VER);
+#elif defined(__GNUC__)
+    return "GCC " __VERSION__;
+#else
+    return "unknown";
+#endif
+}
+
+static ::std::string DetectOs() noexcept
+{
+#if defined(_WIN32)
+    return "Windows";
+#elif defined(__APPLE__)
+    return "macOS";
+#elif defined(__linux__)
+    return "Linux";
+#else
+    return "unknown";
+#endif
+}
+
+BenchmarkEnvironment BenchmarkEnvironment::Detect() noexcept
+{
+    BenchmarkEnvironment environment;
+    environment.Cpu = DetectCpu();
+    environment.HardwareThreads = ::std::thread::hardware_concurrency();
+    environment.Os = DetectOs();
+    environment.Compiler = DetectCompiler();
+    environment.BuildType = TAUIR_BENCH_BUILD_TYPE;
+    environment.BuildFlags = TAUIR_BENCH_BUILD_FLAGS;
+    return environment;
+}
+
+f64 BenchmarkResult::Mean() const noexcept
+{
+    if(Samples.empty())
+    {
+        return 0.0;
+    }
+
+    f64 sum = 0.0;
+
+    for(const f64 sample : Samples)
+    {
+        sum += sample;
+    }
+
+    return sum / static_cast<f64>(Samples.size());
+}
+
+f64 BenchmarkResult::Median() const noexcept
+{
+    if(Samples.empty())
+    {
+        return 0.0;
+    }
+
+    ::std::vector<f64> sorted(Samples);
+    ::std::sort(sorted.begin(), sorted.end());
+
+    const uSys middle = sorted.size() / 2;
+
+    if(sorted.size() % 2 == 0)
+    {
+        return (sorted[middle - 1] + sorted[middle]) / 2.0;
+    }
+
+    return sorted[middle];
+}
+
+f64 BenchmarkResult::Min() const noexcept
+{
+    if(Samples.empty())
+    {
+        return 0.0;
+    }
+
+    return *::std::min_element(Samples.begin(), Samples.end());
+}
+
+f64 BenchmarkResult::StdDev() const noexcept
+{
+    if(Samples.size() < 2)
+    {
+        return 0.0;
+    }
+
+    const f64 mean = Mean();
+    f64 sumSquares = 0.0;
+
+    for(const f64 sample : Samples)
+    {
+        sumSquares += (sample - mean) * (sample - mean);
+    }
+
+    return ::std::sqrt(sumSquares / static_cast<f64>(Samples.size() - 1));
+}
+
+void BenchmarkRunner::Add(const char* const name, BenchmarkBody body) noexcept
+{
+    m_Benchmarks.push_back({ name, ::std::move(body) });
+}
+
+::std::vector<BenchmarkResult> BenchmarkRunner::Run(const char* const filter) const noexcept
+{
+    ::std::vector<BenchmarkResult> results;
+
+    for(const Benchmark& benchmark : m_Benchmarks)
+    {
+        if(filter && benchmark.Name.find(filter) == ::std::string::npos)
+        {
+            continue;
+        }
+
+        results.push_back(RunBenchmark(benchmark));
+
+        const BenchmarkResult& result = results.back();
+        ConPrinter::PrintLn("{}: {} ns (median {} ns, stddev {} ns, {} iterations/sample)", result.Name.c_str(), result.Mean(), result.Median(), result.StdDev(), result.IterationsPerSample);
+    }
+
+    return results;
+}
+
+static u64 TimeIterations(const BenchmarkRunner::BenchmarkBody& body, const u64 iterations) noexcept
+{
+    const auto begin = ::std::chrono::steady_clock::now();
+
+    for(u64 i = 0; i < iterations; ++i)
+    {
+        body();
+    }
+
+    const auto end = ::std::chrono::steady_clock::now();
+
+    return static_cast<u64>(::std::chrono::duration_cast<::std::chrono::nanoseconds>(end - begin).count());
+}
+
+BenchmarkResult BenchmarkRunner::RunBenchmark(const Benchmark& benchmark) const noexcept
+{
+    BenchmarkResult result;
+    result.Name = benchmark.Name;
+
+    // Warm up, and find how many iterations fill a sample.
+    u64 iterations = 1;
+
+    while(TimeIterations(benchmark.Body, iterations) < m_MinSampleTime && iterations < (u64{ 1 } << 40))
+    {
+        iterations *= 2;
+    }
+
+    result.IterationsPerSample = iterations;
+    result.Samples.reserve(m_SampleCount);
+
+    for(u32 i = 0; i < m_SampleCount; ++i)
+    {
+        const u64 elapsed = TimeIterations(benchmark.Body, iterations);
+        result.Samples.push_back(static_cast<f64>(elapsed) / static_cast<f64>(iterations));
+    }
+
+    return result;
+}
+
+}
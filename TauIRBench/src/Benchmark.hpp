@@ -0,0 +1,119 @@
+#pragma once
+
+#include <NumTypes.hpp>
+#include <Objects.hpp>
+#include <TUMaths.hpp>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace tau::ir::bench {
+
+/**
+ * The machine and build that a set of results was produced on.
+ */
+struct BenchmarkEnvironment final
+{
+    DEFAULT_CONSTRUCT_PU(BenchmarkEnvironment);
+    DEFAULT_DESTRUCT(BenchmarkEnvironment);
+    DEFAULT_CM_PU(BenchmarkEnvironment);
+public:
+    ::std::string Cpu;
+    u32 HardwareThreads;
+    ::std::string Os;
+    ::std::string Compiler;
+    ::std::string BuildType;
+    ::std::string BuildFlags;
+
+    /**
+     * Gets the environment of the running process.
+     */
+    [[nodiscard]] static BenchmarkEnvironment Detect() noexcept;
+};
+
+/**
+ *   The timings of a single benchmark. Each sample is the mean time of
+ * a single iteration in nanoseconds, measured over IterationsPerSample
+ * iterations.
+ */
+struct BenchmarkResult final
+{
+    DEFAULT_CONSTRUCT_PU(BenchmarkResult);
+    DEFAULT_DESTRUCT(BenchmarkResult);
+    DEFAULT_CM_PU(BenchmarkResult);
+public:
+    ::std::string Name;
+    u64 IterationsPerSample;
+    ::std::vector<f64> Samples;
+
+    [[nodiscard]] f64 Mean() const noexcept;
+    [[nodiscard]] f64 Median() const noexcept;
+    [[nodiscard]] f64 Min() const noexcept;
+    /**
+     * The sample standard deviation.
+     */
+    [[nodiscard]] f64 StdDev() const noexcept;
+};
+
+/**
+ *   Times a set of named benchmarks.
+ *
+ *   Each benchmark is warmed up, then the number of iterations per
+ * sample is doubled until a sample takes at least MinSampleTime. Any
+ * state a benchmark needs should be built before it is added, only the
+ * body is timed.
+ */
+class BenchmarkRunner final
+{
+    DEFAULT_DESTRUCT(BenchmarkRunner);
+    DEFAULT_CM_PU(BenchmarkRunner);
+public:
+    using BenchmarkBody = ::std::function<void()>;
+public:
+    BenchmarkRunner() noexcept
+        : m_Benchmarks()
+        , m_SampleCount(20)
+        , m_MinSampleTime(10'000'000)
+    { }
+
+    void Add(const char* name, BenchmarkBody body) noexcept;
+
+    BenchmarkRunner& SampleCount(const u32 sampleCount) noexcept
+    {
+        m_SampleCount = maxT(sampleCount, 2u);
+        return *this;
+    }
+
+    /**
+     * The minimum time of a single sample in nanoseconds.
+     */
+    BenchmarkRunner& MinSampleTime(const u64 minSampleTime) noexcept
+    {
+        m_MinSampleTime = minSampleTime;
+        return *this;
+    }
+
+    /**
+     * Runs every benchmark whose name contains filter, or every benchmark if filter is null.
+     */
+    [[nodiscard]] ::std::vector<BenchmarkResult> Run(const char* filter) const noexcept;
+private:
+    struct Benchmark final
+    {
+        ::std::string Name;
+        BenchmarkBody Body;
+    };
+
+    [[nodiscard]] BenchmarkResult RunBenchmark(const Benchmark& benchmark) const noexcept;
+private:
+    ::std::vector<Benchmark> m_Benchmarks;
+    u32 m_SampleCount;
+    u64 m_MinSampleTime;
+};
+
+/**
+ * Adds the standard benchmark suite.
+ */
+void RegisterBenchmarks(BenchmarkRunner& runner) noexcept;
+
+}
@@ -0,0 +1,124 @@
+#include "BenchmarkCompare.hpp"
+#include <cmath>
+
+namespace tau::ir::bench {
+
+/**
+ *   The two sided critical value of Student's t distribution at the 99%
+ * level, using the Cornish-Fisher expansion around the normal
+ * distribution. This is within 1% of the exact value for df >= 4.
+ */
+static f64 CriticalT99(const f64 df) noexcept
+{
+    constexpr f64 z = 2.5758293035489;
+    const f64 z3 = z * z * z;
+    const f64 z5 = z3 * z * z;
+
+    return z + (z3 + z) / (4.0 * df) + (5.0 * z5 + 16.0 * z3 + 3.0 * z) / (96.0 * df * df);
+}
+
+static BenchmarkComparison Compare(const BenchmarkResult& baseResult, const BenchmarkResult& newResult, const f64 threshold) noexcept
+{
+    BenchmarkComparison comparison;
+    comparison.Name = baseResult.Name;
+    comparison.BaseMean = baseResult.Mean();
+    comparison.NewMean = newResult.Mean();
+    comparison.Change = comparison.BaseMean == 0.0 ? 0.0 : (comparison.NewMean - comparison.BaseMean) / comparison.BaseMean;
+    comparison.T = 0.0;
+    comparison.Verdict = ComparisonVerdict::Unchanged;
+
+    const f64 baseCount = static_cast<f64>(baseResult.Samples.size());
+    const f64 newCount = static_cast<f64>(newResult.Samples.size());
+
+    if(baseCount < 2 || newCount < 2)
+    {
+        return comparison;
+    }
+
+    const f64 baseStdDev = baseResult.StdDev();
+    const f64 newStdDev = newResult.StdDev();
+    const f64 baseError = baseStdDev * baseStdDev / baseCount;
+    const f64 newError = newStdDev * newStdDev / newCount;
+    const f64 error = baseError + newError;
+
+    bool significant;
+
+    if(error == 0.0)
+    {
+        // Every sample was identical, any difference is real.
+        significant = comparison.NewMean != comparison.BaseMean;
+    }
+    else
+    {
+        comparison.T = (comparison.NewMean - comparison.BaseMean) / ::std::sqrt(error);
+
+        // Welch-Satterthwaite degrees of freedom.
+        const f64 df = (error * error) / ((baseError * baseError) / (baseCount - 1) + (newError * newError) / (newCount - 1));
+
+        significant = ::std::abs(comparison.T) > CriticalT99(df);
+    }
+
+    if(significant && ::std::abs(comparison.Change) > threshold)
+    {
+        comparison.Verdict = comparison.Change > 0.0 ? ComparisonVerdict::Regression : ComparisonVerdict::Improvement;
+    }
+
+    return comparison;
+}
+
+::std::vector<BenchmarkComparison> CompareResults(const ::std::vector<BenchmarkResult>& baseResults, const ::std::vector<BenchmarkResult>& newResults, const f64 threshold) noexcept
+{
+    ::std::vector<BenchmarkComparison> comparisons;
+    comparisons.reserve(baseResults.size());
+
+    const auto findResult = [](const ::std::vector<BenchmarkResult>& results, const ::std::string& name) -> const BenchmarkResult*
+    {
+        for(const BenchmarkResult& result : results)
+        {
+            if(result.Name == name)
+            {
+                return &result;
+            }
+        }
+
+        return nullptr;
+    };
+
+    const auto missing = [](const BenchmarkResult& result, const bool isBase)
+    {
+        BenchmarkComparison comparison;
+        comparison.Name = result.Name;
+        comparison.BaseMean = isBase ? result.Mean() : 0.0;
+        comparison.NewMean = isBase ? 0.0 : result.Mean();
+        comparison.Change = 0.0;
+        comparison.T = 0.0;
+        comparison.Verdict = ComparisonVerdict::Missing;
+        return comparison;
+    };
+
+    for(const BenchmarkResult& baseResult : baseResults)
+    {
+        const BenchmarkResult* const newResult = findResult(newResults, baseResult.Name);
+
+        if(newResult)
+        {
+            comparisons.push_back(Compare(baseResult, *newResult, threshold));
+        }
+        else
+        {
+            comparisons.push_back(missing(baseResult, true));
+        }
+    }
+
+    for(const BenchmarkResult& newResult : newResults)
+    {
+        if(!findResult(baseResults, newResult.Name))
+        {
+            comparisons.push_back(missing(newResult, false));
+        }
+    }
+
+    return comparisons;
+}
+
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <NumTypes.hpp>
+#include <Objects.hpp>
+#include <string>
+#include <vector>
+
+#include "Benchmark.hpp"
+
+namespace tau::ir::bench {
+
+enum class ComparisonVerdict : u8
+{
+    Unchanged = 0,
+    Improvement,
+    Regression,
+    /**
+     * The benchmark only exists in one of the two result sets.
+     */
+    Missing
+};
+
+struct BenchmarkComparison final
+{
+    DEFAULT_CONSTRUCT_PU(BenchmarkComparison);
+    DEFAULT_DESTRUCT(BenchmarkComparison);
+    DEFAULT_CM_PU(BenchmarkComparison);
+public:
+    ::std::string Name;
+    f64 BaseMean;
+    f64 NewMean;
+    /**
+     * The relative change of the mean, positive is slower.
+     */
+    f64 Change;
+    /**
+     * Welch's t statistic of the two sample sets.
+     */
+    f64 T;
+    ComparisonVerdict Verdict;
+};
+
+/**
+ *   Compares two result sets by name.
+ *
+ *   A benchmark is only flagged when the difference of the means is
+ * significant under Welch's t-test at the 99% level, and the relative
+ * change is greater than threshold. The threshold keeps tiny but
+ * consistent changes from gating a release.
+ */
+[[nodiscard]] ::std::vector<BenchmarkComparison> CompareResults(const ::std::vector<BenchmarkResult>& baseResults, const ::std::vector<BenchmarkResult>& newResults, f64 threshold) noexcept;
+
+}
@@ -0,0 +1,445 @@
+#include "BenchmarkJson.hpp"
+#include <ConPrinter.hpp>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace tau::ir::bench {
+
+static void WriteString(FILE* const file, const ::std::string& str) noexcept
+{
+    (void) fputc('"', file);
+
+    for(const char c : str)
+    {
+        switch(c)
+        {
+            case '"':  (void) fputs("\\\"", file); break;
+            case '\\': (void) fputs("\\\\", file); break;
+            case '\n': (void) fputs("\\n", file); break;
+            case '\r': (void) fputs("\\r", file); break;
+            case '\t': (void) fputs("\\t", file); break;
+            default:
+                if(static_cast<u8>(c) < 0x20)
+                {
+                    (void) fprintf(file, "\\u%04X", static_cast<u32>(static_cast<u8>(c)));
+                }
+                else
+                {
+                    (void) fputc(c, file);
+                }
+                break;
+        }
+    }
+
+    (void) fputc('"', file);
+}
+
+bool WriteResults(const char* const path, const BenchmarkEnvironment& environment, const ::std::vector<BenchmarkResult>& results) noexcept
+{
+    FILE* const file = fopen(path, "wb");
+
+    if(!file)
+    {
+        ConPrinter::PrintLn("[WriteResults]: Failed to open ''{}'' for writing.", path);
+        return false;
+    }
+
+    (void) fputs("{\n  \"version\": 1,\n  \"environment\": {\n    \"cpu\": ", file);
+    WriteString(file, environment.Cpu);
+    (void) fprintf(file, ",\n    \"hardwareThreads\": %u,\n    \"os\": ", environment.HardwareThreads);
+    WriteString(file, environment.Os);
+    (void) fputs(",\n    \"compiler\": ", file);
+    WriteString(file, environment.Compiler);
+    (void) fputs(",\n    \"buildType\": ", file);
+    WriteString(file, environment.BuildType);
+    (void) fputs(",\n    \"buildFlags\": ", file);
+    WriteString(file, environment.BuildFlags);
+    (void) fputs("\n  },\n  \"benchmarks\": [", file);
+
+    for(uSys i = 0; i < results.size(); ++i)
+    {
+        const BenchmarkResult& result = results[i];
+
+        (void) fputs(i == 0 ? "\n    {\n      \"name\": " : ",\n    {\n      \"name\": ", file);
+        WriteString(file, result.Name);
+        (void) fprintf(file, ",\n      \"iterationsPerSample\": %llu", static_cast<unsigned long long>(result.IterationsPerSample));
+        (void) fprintf(file, ",\n      \"mean\": %.17g", result.Mean());
+        (void) fprintf(file, ",\n      \"median\": %.17g", result.Median());
+        (void) fprintf(file, ",\n      \"min\": %.17g", result.Min());
+        (void) fprintf(file, ",\n      \"stdDev\": %.17g", result.StdDev());
+        (void) fputs(",\n      \"samples\": [", file);
+
+        for(uSys j = 0; j < result.Samples.size(); ++j)
+        {
+            (void) fprintf(file, j == 0 ? "%.17g" : ", %.17g", result.Samples[j]);
+        }
+
+        (void) fputs("]\n    }", file);
+    }
+
+    (void) fputs("\n  ]\n}\n", file);
+
+    const bool success = ferror(file) == 0;
+    (void) fclose(file);
+
+    return success;
+}
+
+namespace {
+
+/**
+ *   A reader for the subset of JSON that WriteResults produces, unknown
+ * keys are skipped so newer files can still be compared.
+ */
+class JsonReader final
+{
+    DEFAULT_DESTRUCT(JsonReader);
+    DELETE_CM(JsonReader);
+public:
+    JsonReader(const char* const begin, const char* const end) noexcept
+        : m_Curr(begin)
+        , m_End(end)
+    { }
+
+    [[nodiscard]] bool Expect(const char c) noexcept
+    {
+        SkipWhitespace();
+
+        if(m_Curr == m_End || *m_Curr != c)
+        {
+            return false;
+        }
+
+        ++m_Curr;
+        return true;
+    }
+
+    [[nodiscard]] bool Peek(const char c) noexcept
+    {
+        SkipWhitespace();
+        return m_Curr != m_End && *m_Curr == c;
+    }
+
+    [[nodiscard]] bool ReadString(::std::string& out) noexcept
+    {
+        if(!Expect('"'))
+        {
+            return false;
+        }
+
+        out.clear();
+
+        while(m_Curr != m_End && *m_Curr != '"')
+        {
+            char c = *m_Curr++;
+
+            if(c == '\\')
+            {
+                if(m_Curr == m_End)
+                {
+                    return false;
+                }
+
+                c = *m_Curr++;
+
+                switch(c)
+                {
+                    case 'n': c = '\n'; break;
+                    case 'r': c = '\r'; break;
+                    case 't': c = '\t'; break;
+                    case 'b': c = '\b'; break;
+                    case 'f': c = '\f'; break;
+                    case 'u':
+                    {
+                        if(m_End - m_Curr < 4)
+                        {
+                            return false;
+                        }
+
+                        const ::std::string hex(m_Curr, 4);
+                        m_Curr += 4;
+                        const u32 codePoint = static_cast<u32>(::std::strtoul(hex.c_str(), nullptr, 16));
+                        // Only the control characters that WriteString escapes need to round trip.
+                        c = codePoint < 0x80 ? static_cast<char>(codePoint) : '?';
+                        break;
+                    }
+                    default: break;
+                }
+            }
+
+            out.push_back(c);
+        }
+
+        return Expect('"');
+    }
+
+    [[nodiscard]] bool ReadNumber(f64& out) noexcept
+    {
+        SkipWhitespace();
+
+        const char* begin = m_Curr;
+
+        while(m_Curr != m_End && (::std::strchr("+-.eE", *m_Curr) || (*m_Curr >= '0' && *m_Curr <= '9')))
+        {
+            ++m_Curr;
+        }
+
+        if(begin == m_Curr)
+        {
+            return false;
+        }
+
+        out = ::std::strtod(::std::string(begin, m_Curr).c_str(), nullptr);
+        return true;
+    }
+
+    [[nodiscard]] bool SkipValue() noexcept
+    {
+        SkipWhitespace();
+
+        if(m_Curr == m_End)
+        {
+            return false;
+        }
+
+        if(*m_Curr == '"')
+        {
+            ::std::string ignored;
+            return ReadString(ignored);
+        }
+
+        if(*m_Curr == '{' || *m_Curr == '[')
+        {
+            const char close = *m_Curr == '{' ? '}' : ']';
+            ++m_Curr;
+
+            if(Expect(close))
+            {
+                return true;
+            }
+
+            do
+            {
+                if(close == '}')
+                {
+                    ::std::string ignored;
+
+                    if(!ReadString(ignored) || !Expect(':'))
+                    {
+                        return false;
+                    }
+                }
+
+                if(!SkipValue())
+                {
+                    return false;
+                }
+            } while(Expect(','));
+
+            return Expect(close);
+        }
+
+        // Numbers, true, false, and null.
+        while(m_Curr != m_End && !::std::strchr(",}] \t\r\n", *m_Curr))
+        {
+            ++m_Curr;
+        }
+
+        return true;
+    }
+private:
+    void SkipWhitespace() noexcept
+    {
+        while(m_Curr != m_End && (*m_Curr == ' ' || *m_Curr == '\t' || *m_Curr == '\r' || *m_Curr == '\n'))
+        {
+            ++m_Curr;
+        }
+    }
+private:
+    const char* m_Curr;
+    const char* m_End;
+};
+
+}
+
+/**
+ * Calls handler for each key of an object, handler reads the value.
+ */
+template<typename Handler>
+static bool ReadObject(JsonReader& reader, Handler&& handler) noexcept
+{
+    if(!reader.Expect('{'))
+    {
+        return false;
+    }
+
+    if(reader.Expect('}'))
+    {
+        return true;
+    }
+
+    do
+    {
+        ::std::string key;
+
+        if(!reader.ReadString(key) || !reader.Expect(':'))
+        {
+            return false;
+        }
+
+        if(!handler(key))
+        {
+            return false;
+        }
+    } while(reader.Expect(','));
+
+    return reader.Expect('}');
+}
+
+template<typename Handler>
+static bool ReadArray(JsonReader& reader, Handler&& handler) noexcept
+{
+    if(!reader.Expect('['))
+    {
+        return false;
+    }
+
+    if(reader.Expect(']'))
+    {
+        return true;
+    }
+
+    do
+    {
+        if(!handler())
+        {
+            return false;
+        }
+    } while(reader.Expect(','));
+
+    return reader.Expect(']');
+}
+
+static bool ReadEnvironment(JsonReader& reader, BenchmarkEnvironment& environment) noexcept
+{
+    return ReadObject(reader, [&](const ::std::string& key)
+    {
+        if(key == "cpu") { return reader.ReadString(environment.Cpu); }
+        if(key == "os") { return reader.ReadString(environment.Os); }
+        if(key == "compiler") { return reader.ReadString(environment.Compiler); }
+        if(key == "buildType") { return reader.ReadString(environment.BuildType); }
+        if(key == "buildFlags") { return reader.ReadString(environment.BuildFlags); }
+        if(key == "hardwareThreads")
+        {
+            f64 threads;
+
+            if(!reader.ReadNumber(threads))
+            {
+                return false;
+            }
+
+            environment.HardwareThreads = static_cast<u32>(threads);
+            return true;
+        }
+
+        return reader.SkipValue();
+    });
+}
+
+static bool ReadResult(JsonReader& reader, BenchmarkResult& result) noexcept
+{
+    return ReadObject(reader, [&](const ::std::string& key)
+    {
+        if(key == "name") { return reader.ReadString(result.Name); }
+        if(key == "iterationsPerSample")
+        {
+            f64 iterations;
+
+            if(!reader.ReadNumber(iterations))
+            {
+                return false;
+            }
+
+            result.IterationsPerSample = static_cast<u64>(iterations);
+            return true;
+        }
+        if(key == "samples")
+        {
+            return ReadArray(reader, [&]()
+            {
+                f64 sample;
+
+                if(!reader.ReadNumber(sample))
+                {
+                    return false;
+                }
+
+                result.Samples.push_back(sample);
+                return true;
+            });
+        }
+
+        return reader.SkipValue();
+    });
+}
+
+bool ReadResults(const char* const path, BenchmarkEnvironment& environment, ::std::vector<BenchmarkResult>& results) noexcept
+{
+    FILE* const file = fopen(path, "rb");
+
+    if(!file)
+    {
+        ConPrinter::PrintLn("[ReadResults]: Failed to open ''{}''.", path);
+        return false;
+    }
+
+    ::std::string contents;
+    char buffer[4096];
+    uSys readCount;
+
+    while((readCount = fread(buffer, 1, sizeof(buffer), file)) != 0)
+    {
+        contents.append(buffer, readCount);
+    }
+
+    (void) fclose(file);
+
+    JsonReader reader(contents.data(), contents.data() + contents.size());
+
+    const bool success = ReadObject(reader, [&](const ::std::string& key)
+    {
+        if(key == "environment")
+        {
+            return ReadEnvironment(reader, environment);
+        }
+
+        if(key == "benchmarks")
+        {
+            return ReadArray(reader, [&]()
+            {
+                BenchmarkResult result { };
+                result.IterationsPerSample = 0;
+
+                if(!ReadResult(reader, result))
+                {
+                    return false;
+                }
+
+                results.push_back(::std::move(result));
+                return true;
+            });
+        }
+
+        return reader.SkipValue();
+    });
+
+    if(!success)
+    {
+        ConPrinter::PrintLn("[ReadResults]: ''{}'' is not a valid result file.", path);
+    }
+
+    return success;
+}
+
+}
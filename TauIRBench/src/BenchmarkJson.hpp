@@ -0,0 +1,29 @@
+#pragma once
+
+#include <vector>
+
+#include "Benchmark.hpp"
+
+namespace tau::ir::bench {
+
+/**
+ *   Writes a result file. The schema is
+ *
+ * {
+ *   "version": 1,
+ *   "environment": { "cpu", "hardwareThreads", "os", "compiler", "buildType", "buildFlags" },
+ *   "benchmarks": [ { "name", "iterationsPerSample", "mean", "median", "min", "stdDev", "samples": [] } ]
+ * }
+ *
+ * with every time in nanoseconds.
+ */
+[[nodiscard]] bool WriteResults(const char* path, const BenchmarkEnvironment& environment, const ::std::vector<BenchmarkResult>& results) noexcept;
+
+/**
+ *   Reads a file written by WriteResults. Only the environment, names,
+ * iteration counts, and samples are read, the summary statistics are
+ * recomputed from the samples.
+ */
+[[nodiscard]] bool ReadResults(const char* path, BenchmarkEnvironment& environment, ::std::vector<BenchmarkResult>& results) noexcept;
+
+}
@@ -0,0 +1,217 @@
+#include "Benchmark.hpp"
+#include <ConPrinter.hpp>
+#include <cstring>
+#include <memory>
+
+#include "TauIR/Emulator.hpp"
+#include "TauIR/Function.hpp"
+#include "TauIR/IrGenerator.hpp"
+#include "TauIR/IrToSsa.hpp"
+#include "TauIR/Module.hpp"
+#include "TauIR/file/BinaryObject.hpp"
+#include "TauIR/ssa/SsaFunctionAttachment.hpp"
+#include "TauIR/ssa/SsaTypes.hpp"
+#include "TauIR/ssa/opto/ConstantProp.hpp"
+#include "TauIR/ssa/opto/DeadCodeElimination.hpp"
+
+namespace tau::ir::bench {
+
+static void StripSsa(Function* const function) noexcept
+{
+    function->RemoveAttachment<ssa::SsaWriterFunctionAttachment>();
+    function->RemoveAttachment<ssa::SsaFunctionAttachment>();
+    function->RemoveAttachment<ssa::opto::UsageAnalysisFunctionAttachment>();
+}
+
+static void RegisterEmulatorBenchmarks(BenchmarkRunner& runner) noexcept
+{
+    // A single function of nested counted loops, this measures the opcode dispatch loop.
+    {
+        ModuleRef module = IrGenerator()
+            .Seed(0xBE7C0)
+            .FunctionCount(1)
+            .StatementCount(48)
+            .LocalCount(8)
+            .BranchDensity(30)
+            .LoopNesting(3)
+            .LoopTripCount(8)
+            .Build();
+
+        ::std::shared_ptr<Emulator> emulator = ::std::make_shared<Emulator>(::std::move(module));
+        runner.Add("Emulator.OpcodeLoop", [emulator]() { emulator->Execute(); });
+    }
+
+    // Calls from within loops, this measures the call and return paths.
+    {
+        ModuleRef module = IrGenerator()
+            .Seed(0xBE7C1)
+            .FunctionCount(16)
+            .StatementCount(24)
+            .CallDepth(4)
+            .BranchDensity(20)
+            .LoopNesting(1)
+            .LoopTripCount(4)
+            .Build();
+
+        ::std::shared_ptr<Emulator> emulator = ::std::make_shared<Emulator>(::std::move(module));
+        runner.Add("Emulator.CallLoop", [emulator]() { emulator->Execute(); });
+    }
+}
+
+static ModuleRef BuildSsaModule() noexcept
+{
+    // Mostly straight line code, with enough branches and loops to exercise the phi placement.
+    return IrGenerator()
+        .Seed(0x55A)
+        .FunctionCount(32)
+        .StatementCount(64)
+        .LocalCount(8)
+        .BranchDensity(10)
+        .LoopNesting(1)
+        .LoopTripCount(2)
+        .ExpressionDepth(3)
+        .Build();
+}
+
+static void RegisterSsaBenchmarks(BenchmarkRunner& runner) noexcept
+{
+    {
+        ModuleRef module = BuildSsaModule();
+
+        runner.Add("IrToSsa.TransformModule", [module]()
+        {
+            (void) IrToSsa::TransformModule(module, 0, 1);
+
+            for(Function* function : module->Functions())
+            {
+                StripSsa(function);
+            }
+        });
+    }
+
+    {
+        ModuleRef module = BuildSsaModule();
+
+        runner.Add("IrToSsa.TransformModuleParallel", [module]()
+        {
+            (void) IrToSsa::TransformModule(module, 0);
+
+            for(Function* function : module->Functions())
+            {
+                StripSsa(function);
+            }
+        });
+    }
+
+    {
+        ModuleRef module = BuildSsaModule();
+        ::std::shared_ptr<ssa::SsaCustomTypeRegistry> registry = ::std::make_shared<ssa::SsaCustomTypeRegistry>();
+
+        // Includes the transformation to SSA, the passes need fresh SSA on each iteration.
+        runner.Add("Opto.ConstantPropDce", [module, registry]()
+        {
+            for(Function* function : module->Functions())
+            {
+                IrToSsa::TransformFunction(function, module, 0);
+
+                {
+                    ssa::opto::ConstantPropVisitor visitor(*registry);
+                    visitor.Traverse(function);
+                    visitor.UpdateAttachment(function);
+                }
+
+                {
+                    ssa::opto::UsageAnalyzerVisitor visitor(*registry);
+                    visitor.Traverse(function);
+                    visitor.UpdateAttachment(function);
+                }
+
+                {
+                    ssa::opto::DeadCodeEliminationVisitor visitor(*registry, function);
+                    visitor.Traverse(function);
+                    visitor.UpdateAttachment(function);
+                }
+
+                StripSsa(function);
+            }
+        });
+    }
+}
+
+static bool WriteLoadFile(FILE* const file) noexcept
+{
+    using namespace tau::ir::file;
+    using namespace tau::ir::file::v0_0;
+
+    const i64 zeroPointer = WriteFileHeader(file);
+
+    const C8DynString strings[] = {
+        StringSectionName,
+        ModuleInfoSectionName,
+        u8"Benchmark Module",
+        u8"A module for benchmarking the TIRE reader functions."
+    };
+
+    u64 stringPointers[::std::size(strings)];
+
+    const i64 stringSectionPointer = WriteStringSection(file, zeroPointer, strings, static_cast<u32>(::std::size(strings)), stringPointers);
+
+    const u64 sectionNames[] = { stringPointers[1] };
+    u64 sectionPointers[::std::size(sectionNames)];
+
+    (void) WriteSectionHeader(file, zeroPointer, stringSectionPointer, stringPointers[0], sectionNames, static_cast<u16>(::std::size(sectionNames)), sectionPointers);
+
+    ModuleInfoSection moduleInfo;
+    moduleInfo.ModuleVersion = MakeFileVersion(1, 0, 0);
+    moduleInfo.TauIRVersion = TauIRVersion0;
+    moduleInfo.NamePointer = stringPointers[2];
+    moduleInfo.DescriptionPointer = stringPointers[3];
+    moduleInfo.AuthorPointer = 0;
+    moduleInfo.WebsitePointer = 0;
+    (void) ::std::memset(moduleInfo.Reserved, 0, sizeof(moduleInfo.Reserved));
+
+    (void) WriteModuleInfoSection(file, zeroPointer, sectionPointers[0], moduleInfo);
+
+    WriteFinal(file, zeroPointer);
+
+    return fflush(file) == 0;
+}
+
+static void RegisterFileBenchmarks(BenchmarkRunner& runner) noexcept
+{
+    using namespace tau::ir::file;
+    using namespace tau::ir::file::v0_0;
+
+    ::std::shared_ptr<FILE> file(fopen("bench_load.tire", "w+b"), [](FILE* const f) { if(f) { (void) fclose(f); } });
+
+    if(!file || !WriteLoadFile(file.get()))
+    {
+        ConPrinter::PrintLn("Failed to write ''bench_load.tire'', skipping the file benchmarks.");
+        return;
+    }
+
+    // Reads every section the loader currently supports, including the checksum of the file.
+    runner.Add("File.Load", [file]()
+    {
+        (void) _fseeki64(file.get(), 0, SEEK_SET);
+
+        FileHeader* const fileHeader = ReadFileHeader(file.get());
+        SectionHeader* const sectionHeader = ReadSectionHeader(file.get(), fileHeader);
+        StringSection* const stringSection = ReadStringSection(file.get(), fileHeader, sectionHeader);
+        ModuleInfoSection* const moduleInfo = ReadModuleInfoSection(file.get(), fileHeader, sectionHeader, stringSection);
+
+        FreeFile(moduleInfo);
+        delete stringSection;
+        FreeFile(sectionHeader);
+        FreeFile(fileHeader);
+    });
+}
+
+void RegisterBenchmarks(BenchmarkRunner& runner) noexcept
+{
+    RegisterEmulatorBenchmarks(runner);
+    RegisterSsaBenchmarks(runner);
+    RegisterFileBenchmarks(runner);
+}
+
+}
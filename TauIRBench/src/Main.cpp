@@ -0,0 +1,166 @@
+#include <ConPrinter.hpp>
+#include <cstdlib>
+#include <cstring>
+
+#include "Benchmark.hpp"
+#include "BenchmarkCompare.hpp"
+#include "BenchmarkJson.hpp"
+
+using namespace tau::ir::bench;
+
+static int RunCommand(int argCount, char* args[]) noexcept;
+static int CompareCommand(int argCount, char* args[]) noexcept;
+static void PrintUsage() noexcept;
+
+int main(int argCount, char* args[])
+{
+    Console::Init();
+
+    if(argCount >= 2 && ::std::strcmp(args[1], "run") == 0)
+    {
+        return RunCommand(argCount - 2, args + 2);
+    }
+
+    if(argCount >= 2 && ::std::strcmp(args[1], "compare") == 0)
+    {
+        return CompareCommand(argCount - 2, args + 2);
+    }
+
+    PrintUsage();
+    return 2;
+}
+
+static void PrintUsage() noexcept
+{
+    ConPrinter::PrintLn("Usage:");
+    ConPrinter::PrintLn("  TauIRBench run [-o <results.json>] [-f <filter>] [-s <samples>]");
+    ConPrinter::PrintLn("  TauIRBench compare <base.json> <new.json> [-t <threshold %>]");
+    ConPrinter::PrintLn();
+    ConPrinter::PrintLn("compare exits with 1 if any benchmark regressed.");
+}
+
+static int RunCommand(const int argCount, char* args[]) noexcept
+{
+    const char* outputPath = "bench_results.json";
+    const char* filter = nullptr;
+    u32 sampleCount = 20;
+
+    for(int i = 0; i < argCount; ++i)
+    {
+        if(i + 1 >= argCount)
+        {
+            PrintUsage();
+            return 2;
+        }
+
+        if(::std::strcmp(args[i], "-o") == 0)
+        {
+            outputPath = args[++i];
+        }
+        else if(::std::strcmp(args[i], "-f") == 0)
+        {
+            filter = args[++i];
+        }
+        else if(::std::strcmp(args[i], "-s") == 0)
+        {
+            sampleCount = static_cast<u32>(::std::strtoul(args[++i], nullptr, 10));
+        }
+        else
+        {
+            PrintUsage();
+            return 2;
+        }
+    }
+
+    const BenchmarkEnvironment environment = BenchmarkEnvironment::Detect();
+
+    ConPrinter::PrintLn("CPU: {} ({} threads)", environment.Cpu.c_str(), environment.HardwareThreads);
+    ConPrinter::PrintLn("Compiler: {}", environment.Compiler.c_str());
+    ConPrinter::PrintLn("Build: {} {}", environment.BuildType.c_str(), environment.BuildFlags.c_str());
+
+    BenchmarkRunner runner;
+    runner.SampleCount(sampleCount);
+    RegisterBenchmarks(runner);
+
+    const ::std::vector<BenchmarkResult> results = runner.Run(filter);
+
+    if(!WriteResults(outputPath, environment, results))
+    {
+        return 1;
+    }
+
+    ConPrinter::PrintLn("Wrote {} results to ''{}''.", results.size(), outputPath);
+
+    return 0;
+}
+
+static void PrintEnvironmentDifference(const char* const name, const ::std::string& baseValue, const ::std::string& newValue) noexcept
+{
+    if(baseValue != newValue)
+    {
+        ConPrinter::PrintLn("  {} differs: ''{}'' vs ''{}''", name, baseValue.c_str(), newValue.c_str());
+    }
+}
+
+static int CompareCommand(const int argCount, char* args[]) noexcept
+{
+    if(argCount != 2 && argCount != 4)
+    {
+        PrintUsage();
+        return 2;
+    }
+
+    f64 threshold = 0.05;
+
+    if(argCount == 4)
+    {
+        if(::std::strcmp(args[2], "-t") != 0)
+        {
+            PrintUsage();
+            return 2;
+        }
+
+        threshold = ::std::strtod(args[3], nullptr) / 100.0;
+    }
+
+    BenchmarkEnvironment baseEnvironment;
+    BenchmarkEnvironment newEnvironment;
+    ::std::vector<BenchmarkResult> baseResults;
+    ::std::vector<BenchmarkResult> newResults;
+
+    if(!ReadResults(args[0], baseEnvironment, baseResults) || !ReadResults(args[1], newEnvironment, newResults))
+    {
+        return 2;
+    }
+
+    // Results from different machines or builds are still compared, but the reader should know.
+    PrintEnvironmentDifference("CPU", baseEnvironment.Cpu, newEnvironment.Cpu);
+    PrintEnvironmentDifference("OS", baseEnvironment.Os, newEnvironment.Os);
+    PrintEnvironmentDifference("Compiler", baseEnvironment.Compiler, newEnvironment.Compiler);
+    PrintEnvironmentDifference("Build type", baseEnvironment.BuildType, newEnvironment.BuildType);
+    PrintEnvironmentDifference("Build flags", baseEnvironment.BuildFlags, newEnvironment.BuildFlags);
+
+    const ::std::vector<BenchmarkComparison> comparisons = CompareResults(baseResults, newResults, threshold);
+
+    uSys regressionCount = 0;
+
+    for(const BenchmarkComparison& comparison : comparisons)
+    {
+        const char* verdict;
+
+        switch(comparison.Verdict)
+        {
+            case ComparisonVerdict::Improvement: verdict = "improvement"; break;
+            case ComparisonVerdict::Regression:  verdict = "REGRESSION"; ++regressionCount; break;
+            case ComparisonVerdict::Missing:     verdict = "missing"; break;
+            case ComparisonVerdict::Unchanged:
+            default:                             verdict = "unchanged"; break;
+        }
+
+        ConPrinter::PrintLn("{}: {} ns -> {} ns ({}%, t = {}) {}", comparison.Name.c_str(), comparison.BaseMean, comparison.NewMean, comparison.Change * 100.0, comparison.T, verdict);
+    }
+
+    ConPrinter::PrintLn("{} of {} benchmarks regressed.", regressionCount, comparisons.size());
+
+    return regressionCount == 0 ? 0 : 1;
+}
@@ -8,9 +8,16 @@
 namespace tau::ir {
 
 class Function;
+class ExecutionProfile;
 
 void DumpFunction(const tau::ir::Function* function, uSys functionIndex, const ModuleRef& module, u16 moduleIndex) noexcept;
 
+/**
+ *   Dumps a function with the hit count of every instruction, the
+ * targets of every call site, and the hottest basic blocks.
+ */
+void DumpFunction(const tau::ir::Function* function, uSys functionIndex, const ModuleRef& module, u16 moduleIndex, const ExecutionProfile& profile) noexcept;
+
 namespace ssa {
 
 class SsaCustomTypeRegistry;
@@ -0,0 +1,9 @@
+#pragma once
+
+namespace tau::ir {
+
+class MemoryReport;
+
+void DumpMemoryReport(const MemoryReport& report) noexcept;
+
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <vector>
+
+namespace tau::ir {
+
+struct TraceEvent;
+class TraceBuffer;
+
+/**
+ * Decodes a snapshot of trace events, oldest first.
+ */
+void DumpTrace(const ::std::vector<TraceEvent>& events) noexcept;
+void DumpTrace(const TraceBuffer& trace) noexcept;
+
+}
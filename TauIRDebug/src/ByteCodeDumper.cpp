@@ -1,11 +1,13 @@
 // ReSharper disable CppHidingFunction
 #include "TauIR/ByteCodeDumper.hpp"
 #include "TauIR/Function.hpp"
+#include "TauIR/ExecutionProfile.hpp"
 #include "TauIR/Opcodes.hpp"
 #include "TauIR/ssa/SsaOpcodes.hpp"
 #include "TauIR/ssa/SsaTypes.hpp"
 #include "TauIR/ssa/SsaFunctionAttachment.hpp"
 #include <ConPrinter.hpp>
+#include <algorithm>
 
 #include "TauIR/Common.hpp"
 #include "TauIR/Module.hpp"
@@ -48,6 +50,12 @@ namespace tau::ir {
         ConPrinter::PrintLn("    " #OPCODE ".i64" "." #OP0); \
     }
 
+static void PrintPercent(const u64 count, const u64 total) noexcept
+{
+    const u64 tenths = total == 0 ? 0 : (count * 1000) / total;
+    ConPrinter::Print("({}.{}%)", tenths / 10, tenths % 10);
+}
+
 class DumpVisitor final : public BaseIrVisitor<DumpVisitor>
 {
     DEFAULT_DESTRUCT(DumpVisitor);
@@ -58,6 +66,9 @@ public:
         , m_Module(module)
         , m_CurrCodePtr(nullptr)
         , m_CurrentModule(currentModule)
+        , m_Profile(nullptr)
+        , m_CodeBase(nullptr)
+        , m_TotalHits(0)
     { }
     
     DumpVisitor(DynArray<const u8*>&& labels, const ModuleRef& module, const u16 currentModule) noexcept
@@ -65,6 +76,9 @@ public:
         , m_Module(module)
         , m_CurrCodePtr(nullptr)
         , m_CurrentModule(currentModule)
+        , m_Profile(nullptr)
+        , m_CodeBase(nullptr)
+        , m_TotalHits(0)
     { }
 
     void Reset(const DynArray<const u8*>& labels, const ModuleRef& module, const u16 currentModule) noexcept
@@ -82,6 +96,18 @@ public:
         m_CurrCodePtr = nullptr;
         m_CurrentModule = currentModule;
     }
+
+    /**
+     *   Prefixes every instruction with its hit count, and lists the
+     * targets of every call site. codeBase is the start of the
+     * function's code, the profile is indexed relative to it.
+     */
+    void SetProfile(const FunctionProfile* const profile, const u8* const codeBase) noexcept
+    {
+        m_Profile = profile;
+        m_CodeBase = codeBase;
+        m_TotalHits = profile ? profile->TotalInstructionHits() : 0;
+    }
 public:
     void PreVisit(const u8* const codePtr) noexcept
     {
@@ -92,6 +118,13 @@ public:
         }
 
         m_CurrCodePtr = codePtr;
+
+        if(m_Profile)
+        {
+            const u64 hits = m_Profile->InstructionHits(static_cast<uSys>(codePtr - m_CodeBase));
+            ConPrinter::Print("{} ", hits);
+            PrintPercent(hits, m_TotalHits);
+        }
     }
 
     VISIT_PRINT_0(Nop);
@@ -233,6 +266,16 @@ public:
     VISIT_PRINT_0_I64(Mul);
     VISIT_PRINT_0_I32(Div);
     VISIT_PRINT_0_I64(Div);
+    VISIT_PRINT_0_I32(MulHigh);
+    VISIT_PRINT_0_I64(MulHigh);
+    VISIT_PRINT_0(MulHighU32);
+    VISIT_PRINT_0(MulHighU64);
+    VISIT_PRINT_0_I32(Shl);
+    VISIT_PRINT_0_I64(Shl);
+    VISIT_PRINT_0_I32(Shr);
+    VISIT_PRINT_0_I64(Shr);
+    VISIT_PRINT_0_I32(Sar);
+    VISIT_PRINT_0_I64(Sar);
 
     VISIT_PRINT_1_I32(Comp, Above);
     VISIT_PRINT_1_I32(Comp, AboveOrEqual);
@@ -259,6 +302,7 @@ public:
         ConPrinter::Print("    Call ");
         PrintFunction(functionIndex, m_CurrentModule);
         ConPrinter::PrintLn();
+        PrintCallTargets();
     }
 
     void VisitCallExt(const u32 functionIndex, const u16 moduleIndex) noexcept
@@ -268,16 +312,19 @@ public:
         ConPrinter::Print(':');
         PrintFunction(functionIndex, moduleIndex);
         ConPrinter::PrintLn();
+        PrintCallTargets();
     }
 
     void VisitCallInd(const u16 localIndex) noexcept
     {
         ConPrinter::PrintLn("    Call.Ind {}", localIndex);
+        PrintCallTargets();
     }
 
     void VisitCallIndExt(const u16 localIndex) noexcept
     {
         ConPrinter::PrintLn("    Call.Ind.Ext {}", localIndex);
+        PrintCallTargets();
     }
 
     VISIT_PRINT_0(Ret);
@@ -343,11 +390,53 @@ private:
 
         ConPrinter::Print("<Func{}>", functionIndex);
     }
+
+    void PrintCallTargets() noexcept
+    {
+        if(!m_Profile)
+        {
+            return;
+        }
+
+        const FunctionProfile::CallTargetList* const targets = m_Profile->FindCallSite(static_cast<uSys>(m_CurrCodePtr - m_CodeBase));
+
+        if(!targets)
+        {
+            return;
+        }
+
+        u64 totalCalls = 0;
+        for(const CallTargetCount& target : *targets)
+        {
+            totalCalls += target.Count;
+        }
+
+        for(const CallTargetCount& target : *targets)
+        {
+            ConPrinter::Print("            -> ");
+
+            if(target.Target && target.Target->Name().Length() != 0)
+            {
+                ConPrinter::Print(target.Target->Name());
+            }
+            else
+            {
+                ConPrinter::Print("0x{XP}", reinterpret_cast<uPtr>(target.Target));
+            }
+
+            ConPrinter::Print(" {} ", target.Count);
+            PrintPercent(target.Count, totalCalls);
+            ConPrinter::PrintLn();
+        }
+    }
 private:
     DynArray<const u8*> m_Labels;
     ModuleRef m_Module;
     const u8* m_CurrCodePtr;
     u16 m_CurrentModule;
+    const FunctionProfile* m_Profile;
+    const u8* m_CodeBase;
+    u64 m_TotalHits;
 };
 
 #undef VISIT_PRINT_1_I64
@@ -359,6 +448,7 @@ private:
 #undef VISIT_PRINT_0
 
 static DynArray<const u8*> PreProcessFunction(const Function* function) noexcept;
+static void DumpHottestBlocks(const Function* function, const FunctionProfile& profile, uSys maxBlocks) noexcept;
 
 void DumpFunction(const tau::ir::Function* function, const uSys functionIndex, const ModuleRef& module, const u16 moduleIndex) noexcept
 {
@@ -377,6 +467,36 @@ void DumpFunction(const tau::ir::Function* function, const uSys functionIndex, c
     dumpVisitor.Traverse(function->Address(), function->Address() + function->CodeSize());
 }
 
+void DumpFunction(const tau::ir::Function* function, const uSys functionIndex, const ModuleRef& module, const u16 moduleIndex, const ExecutionProfile& profile) noexcept
+{
+    const FunctionProfile* const functionProfile = profile.FindFunction(function);
+
+    if(function->Name().Length() != 0)
+    {
+        ConPrinter::Print("{}:", function->Name());
+    }
+    else
+    {
+        ConPrinter::Print("Func{}:", functionIndex);
+    }
+
+    if(!functionProfile)
+    {
+        ConPrinter::PrintLn(" never executed");
+        DumpVisitor dumpVisitor(PreProcessFunction(function), module, moduleIndex);
+        dumpVisitor.Traverse(function->Address(), function->Address() + function->CodeSize());
+        return;
+    }
+
+    ConPrinter::PrintLn(" {} instructions executed", functionProfile->TotalInstructionHits());
+
+    DumpVisitor dumpVisitor(PreProcessFunction(function), module, moduleIndex);
+    dumpVisitor.SetProfile(functionProfile, function->Address());
+    dumpVisitor.Traverse(function->Address(), function->Address() + function->CodeSize());
+
+    DumpHottestBlocks(function, *functionProfile, 5);
+}
+
 class VisitorJumpCount final : public BaseIrVisitor<VisitorJumpCount>
 {
     DEFAULT_DESTRUCT(VisitorJumpCount);
@@ -447,6 +567,116 @@ static DynArray<const u8*> PreProcessFunction(const Function* function) noexcept
     return labelerVisitor.Labels();
 }
 
+/**
+ *   Splits a function into basic blocks. A block starts at the entry,
+ * at every jump target, and after every jump or return.
+ */
+class VisitorBlockSplitter final : public BaseIrVisitor<VisitorBlockSplitter>
+{
+    DEFAULT_DESTRUCT(VisitorBlockSplitter);
+    DEFAULT_CM_PU(VisitorBlockSplitter);
+public:
+    VisitorBlockSplitter(const Function* const function) noexcept
+        : m_CodeBase(function->Address())
+        , m_Leaders(function->CodeSize() + 1)
+        , m_Instructions()
+        , m_CurrCodePtr(nullptr)
+        , m_SplitNext(true)
+    {
+        m_Leaders.MemSetAll(0);
+    }
+
+    [[nodiscard]] bool IsLeader(const uSys offset) const noexcept { return offset < m_Leaders.Count() && m_Leaders[offset]; }
+    [[nodiscard]] const ::std::vector<uSys>& Instructions() const noexcept { return m_Instructions; }
+
+    void PreVisit(const u8* const codePtr) noexcept
+    {
+        m_CurrCodePtr = codePtr;
+        const uSys offset = static_cast<uSys>(codePtr - m_CodeBase);
+        m_Instructions.push_back(offset);
+
+        if(m_SplitNext)
+        {
+            MarkLeader(offset);
+            m_SplitNext = false;
+        }
+    }
+
+    void VisitRet() noexcept
+    {
+        m_SplitNext = true;
+    }
+
+    void VisitJumpPoint(const i32 offset) noexcept
+    {
+        MarkLeader(static_cast<uSys>(m_CurrCodePtr + 5 + offset - m_CodeBase));
+        m_SplitNext = true;
+    }
+private:
+    void MarkLeader(const uSys offset) noexcept
+    {
+        if(offset < m_Leaders.Count())
+        {
+            m_Leaders[offset] = 1;
+        }
+    }
+private:
+    const u8* m_CodeBase;
+    DynArray<u8> m_Leaders;
+    ::std::vector<uSys> m_Instructions;
+    const u8* m_CurrCodePtr;
+    bool m_SplitNext;
+};
+
+struct BlockHits final
+{
+    uSys Begin;
+    uSys End;
+    u64 Hits;
+};
+
+static void DumpHottestBlocks(const Function* const function, const FunctionProfile& profile, const uSys maxBlocks) noexcept
+{
+    VisitorBlockSplitter splitter(function);
+    splitter.Traverse(function->Address(), function->Address() + function->CodeSize());
+
+    ::std::vector<BlockHits> blocks;
+
+    for(const uSys offset : splitter.Instructions())
+    {
+        if(blocks.empty() || splitter.IsLeader(offset))
+        {
+            if(!blocks.empty())
+            {
+                blocks.back().End = offset;
+            }
+
+            blocks.push_back({ offset, function->CodeSize(), 0 });
+        }
+
+        blocks.back().Hits += profile.InstructionHits(offset);
+    }
+
+    // Keep the original order for blocks with the same count so the output is stable.
+    ::std::stable_sort(blocks.begin(), blocks.end(), [](const BlockHits& a, const BlockHits& b) { return a.Hits > b.Hits; });
+
+    const u64 totalHits = profile.TotalInstructionHits();
+
+    ConPrinter::PrintLn("  Hottest Blocks:");
+
+    for(uSys i = 0; i < blocks.size() && i < maxBlocks; ++i)
+    {
+        if(blocks[i].Hits == 0)
+        {
+            break;
+        }
+
+        ConPrinter::Print("    [{}, {}) {} ", blocks[i].Begin, blocks[i].End, blocks[i].Hits);
+        PrintPercent(blocks[i].Hits, totalHits);
+        ConPrinter::PrintLn();
+    }
+}
+
 namespace ssa {
 
 template<typename T>
@@ -640,6 +870,9 @@ static void PrintBinaryOp(const SsaBinaryOperation op) noexcept
         case SsaBinaryOperation::BarrelShiftRight:
             ConPrinter::Print(">>>");
             break;
+        case SsaBinaryOperation::MulHigh:
+            ConPrinter::Print("*^");
+            break;
 	}
 }
 
@@ -823,9 +1056,16 @@ void DumpSsa(const u8* codePtr, const uSys length, const uSys functionIndex, con
             {
                 const SsaCustomType type = ReadType<SsaCustomType>(codePtr, i);
 
+                const VarId destination = ReadType<VarId>(codePtr, i);
+                const VarId source = ReadType<VarId>(codePtr, i);
+
                 ConPrinter::Print("  Store ");
                 PrintType(type);
-                ConPrinter::PrintLn(" %{}, %{}", ReadType<VarId>(codePtr, i), ReadType<VarId>(codePtr, i));
+                ConPrinter::Print(' ');
+                PrintVar(destination);
+                ConPrinter::Print(", ");
+                PrintVar(source);
+                ConPrinter::PrintLn();
 
                 break;
             }
@@ -848,7 +1088,10 @@ void DumpSsa(const u8* codePtr, const uSys length, const uSys functionIndex, con
                 PrintVar(ReadType<VarId>(codePtr, i));
                 ConPrinter::Print(" + ");
                 PrintVar(ReadType<VarId>(codePtr, i));
-                ConPrinter::PrintLn(" * {} + {}", ReadType<i8>(codePtr, i), ReadType<i16>(codePtr, i));
+                // Read in order, the arguments of a call aren't evaluated in order.
+                const i8 multiplier = ReadType<i8>(codePtr, i);
+                const i16 offset = ReadType<i16>(codePtr, i);
+                ConPrinter::PrintLn(" * {} + {}", multiplier, offset);
 
                 break;
             }
@@ -921,7 +1164,8 @@ void DumpSsa(const u8* codePtr, const uSys length, const uSys functionIndex, con
                     PrintType(ReadType<SsaCustomType>(codePtr, i));
                 }
 
-                ConPrinter::PrintLn(" ]");
+                ConPrinter::PrintLn(" ] -> %{}-{}", idIndex, n);
+                idIndex += n;
 
                 break;
             }
@@ -934,16 +1178,33 @@ void DumpSsa(const u8* codePtr, const uSys length, const uSys functionIndex, con
                 ConPrinter::Print(" %{} = Join [ ", idIndex++);
                 const u32 n = ReadType<u32>(codePtr, i);
 
+                // The types are written first, followed by the vars.
+                SsaCustomType types[32];
+
+                for(u32 j = 0; j < n; ++j)
+                {
+                    const SsaCustomType typeN = ReadType<SsaCustomType>(codePtr, i);
+
+                    if(j < 32)
+                    {
+                        types[j] = typeN;
+                    }
+                }
+
                 for(u32 j = 0; j < n; ++j)
                 {
                     if(j != 0)
                     {
                         ConPrinter::Print(", ");
                     }
-                    const SsaCustomType typeN = ReadType<SsaCustomType>(codePtr, i);
-                    PrintType(typeN);
-                    ConPrinter::Print(' ');
-                    PrintValue(typeN, codePtr, i, registry);
+
+                    if(j < 32)
+                    {
+                        PrintType(types[j]);
+                        ConPrinter::Print(' ');
+                    }
+
+                    PrintVar(ReadType<VarId>(codePtr, i));
                 }
                 
                 ConPrinter::PrintLn(" ]");
@@ -1009,7 +1270,10 @@ void DumpSsa(const u8* codePtr, const uSys length, const uSys functionIndex, con
             }
             case SsaOpcode::BranchCond:
             {
-                ConPrinter::Print("  Branch .{}, .{}, ", ReadType<VarId>(codePtr, i), ReadType<VarId>(codePtr, i));
+                const VarId labelTrue = ReadType<VarId>(codePtr, i);
+                const VarId labelFalse = ReadType<VarId>(codePtr, i);
+
+                ConPrinter::Print("  Branch .{}, .{}, ", labelTrue, labelFalse);
                 PrintVar(ReadType<VarId>(codePtr, i));
                 ConPrinter::PrintLn();
 
@@ -1067,6 +1331,36 @@ void DumpSsa(const u8* codePtr, const uSys length, const uSys functionIndex, con
 
                 break;
             }
+            case SsaOpcode::Phi:
+            {
+                const SsaCustomType type = ReadType<SsaCustomType>(codePtr, i);
+                const u32 n = ReadType<u32>(codePtr, i);
+                const uSys labelsBegin = i;
+                const uSys varsBegin = i + n * sizeof(VarId);
+
+                ConPrinter::Print("  ");
+                PrintType(type);
+                ConPrinter::Print(" %{} = Phi [ ", idIndex++);
+
+                for(u32 j = 0; j < n; ++j)
+                {
+                    if(j != 0)
+                    {
+                        ConPrinter::Print(", ");
+                    }
+
+                    uSys labelIndex = labelsBegin + j * sizeof(VarId);
+                    uSys varIndex = varsBegin + j * sizeof(VarId);
+
+                    ConPrinter::Print(".{}: ", ReadType<VarId>(codePtr, labelIndex));
+                    PrintVar(ReadType<VarId>(codePtr, varIndex));
+                }
+
+                ConPrinter::PrintLn(" ]");
+
+                i = varsBegin + n * sizeof(VarId);
+                break;
+            }
         }
     }
 }
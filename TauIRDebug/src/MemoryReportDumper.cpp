@@ -0,0 +1,65 @@
+#include "TauIR/MemoryReportDumper.hpp"
+#include "TauIR/MemoryReport.hpp"
+#include "TauIR/Function.hpp"
+#include "TauIR/Module.hpp"
+#include <ConPrinter.hpp>
+
+namespace tau::ir {
+
+static void PrintAllocator(const char* const name, const FixedBlockAllocatorStats& stats) noexcept
+{
+    ConPrinter::PrintLn("  {}: {} blocks * {} bytes = {} bytes", name, stats.LiveBlocks, stats.BlockSize, stats.LiveBytes());
+}
+
+void DumpMemoryReport(const MemoryReport& report) noexcept
+{
+    if(report.ReportedModule() && report.ReportedModule()->Name().Length() != 0)
+    {
+        ConPrinter::PrintLn("Memory Report ''{}'': {} bytes", report.ReportedModule()->Name(), report.Total());
+    }
+    else
+    {
+        ConPrinter::PrintLn("Memory Report: {} bytes", report.Total());
+    }
+
+    const FunctionMemoryReport totals = report.FunctionTotals();
+
+    ConPrinter::PrintLn("  Module: {}", report.ModuleBytes());
+    ConPrinter::PrintLn("  Functions: {}", totals.Object);
+    ConPrinter::PrintLn("  Code: {}", totals.Code);
+    ConPrinter::PrintLn("  Local Types: {}", totals.LocalTypes);
+    ConPrinter::PrintLn("  Local Offsets: {}", totals.LocalOffsets);
+    ConPrinter::PrintLn("  Arguments: {}", totals.Arguments);
+    ConPrinter::PrintLn("  Names: {}", totals.Name);
+    ConPrinter::PrintLn("  Attachments: {}", totals.Attachments);
+
+    ConPrinter::PrintLn("Attachments:");
+    for(const AttachmentMemoryReport& attachment : report.Attachments())
+    {
+        ConPrinter::PrintLn("  {}: {} bytes in {} attachments", attachment.Name, attachment.Bytes, attachment.Count);
+    }
+
+    ConPrinter::PrintLn("Functions:");
+    for(uSys i = 0; i < report.Functions().size(); ++i)
+    {
+        const FunctionMemoryReport& function = report.Functions()[i];
+
+        if(function.Function->Name().Length() != 0)
+        {
+            ConPrinter::Print("  {}: ", function.Function->Name());
+        }
+        else
+        {
+            ConPrinter::Print("  Func{}: ", i);
+        }
+
+        ConPrinter::PrintLn("{} bytes [Code: {}, Locals: {}, Arguments: {}, Attachments: {}]", function.Total(), function.Code, function.LocalTypes + function.LocalOffsets, function.Arguments, function.Attachments);
+    }
+
+    ConPrinter::PrintLn("Allocators:");
+    PrintAllocator("Function", report.FunctionAllocator());
+    PrintAllocator("Module", report.ModuleAllocator());
+    PrintAllocator("TypeInfo", report.TypeInfoAllocator());
+}
+
+}
@@ -0,0 +1,88 @@
+#include "TauIR/TraceDumper.hpp"
+#include "TauIR/TraceBuffer.hpp"
+#include "TauIR/Function.hpp"
+#include <ConPrinter.hpp>
+
+namespace tau::ir {
+
+static const char* EventName(const TraceEventType type) noexcept
+{
+    switch(type)
+    {
+        case TraceEventType::FunctionEnter:   return "Enter";
+        case TraceEventType::FunctionExit:    return "Exit";
+        case TraceEventType::BranchTaken:     return "Branch";
+        case TraceEventType::NativeCallBegin: return "Native.Begin";
+        case TraceEventType::NativeCallEnd:   return "Native.End";
+        case TraceEventType::StackOverflow:   return "Stack.Overflow";
+        default:                              return "Unknown";
+    }
+}
+
+static void PrintFunctionName(const Function* const function) noexcept
+{
+    if(function && function->Name().Length() != 0)
+    {
+        ConPrinter::Print(function->Name());
+    }
+    else
+    {
+        ConPrinter::Print("0x{XP}", reinterpret_cast<uPtr>(function));
+    }
+}
+
+void DumpTrace(const ::std::vector<TraceEvent>& events) noexcept
+{
+    // The time of the last begin event, used to print the duration of native calls.
+    u64 nativeCallBegin = 0;
+
+    for(const TraceEvent& event : events)
+    {
+        if(event.Type == TraceEventType::BranchTaken)
+        {
+            ConPrinter::Print("               ");
+        }
+        else
+        {
+            ConPrinter::Print("[{}ns] ", event.Timestamp);
+        }
+
+        for(uSys i = 0; i < event.CallDepth; ++i)
+        {
+            ConPrinter::Print("  ");
+        }
+
+        ConPrinter::Print("{} ", EventName(event.Type));
+        PrintFunctionName(event.Function);
+        ConPrinter::Print(" +{}", event.Offset);
+
+        if(event.Type == TraceEventType::NativeCallBegin)
+        {
+            nativeCallBegin = event.Timestamp;
+        }
+        else if(event.Type == TraceEventType::NativeCallEnd && nativeCallBegin != 0)
+        {
+            ConPrinter::Print(" ({}ns)", event.Timestamp - nativeCallBegin);
+            nativeCallBegin = 0;
+        }
+
+        ConPrinter::PrintLn();
+    }
+}
+
+void DumpTrace(const TraceBuffer& trace) noexcept
+{
+    const ::std::vector<TraceEvent> events = trace.Snapshot();
+    const u64 totalEvents = trace.TotalEvents();
+
+    ConPrinter::PrintLn("Trace: {} events, {} retained, capacity {}", totalEvents, events.size(), trace.Capacity());
+
+    if(totalEvents > events.size())
+    {
+        ConPrinter::PrintLn("  {} older events were overwritten.", totalEvents - events.size());
+    }
+
+    DumpTrace(events);
+}
+
+}
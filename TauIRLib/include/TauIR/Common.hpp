@@ -37,4 +37,15 @@ static inline constexpr uSys MaxArgumentRegisters = 64;
 namespace tau::ir {
 class Module;
 using ModuleRef = StrongRef<Module>;
+
+/**
+ * Live usage of one of the global fixed block allocators.
+ */
+struct FixedBlockAllocatorStats final
+{
+    uSys BlockSize;
+    uSys LiveBlocks;
+
+    [[nodiscard]] uSys LiveBytes() const noexcept { return BlockSize * LiveBlocks; }
+};
 }
@@ -8,6 +8,8 @@ namespace tau::ir {
 
 class Function;
 class Module;
+class ExecutionProfile;
+class TraceBuffer;
 
 class Emulator
 {
@@ -18,6 +20,11 @@ public:
     
     static inline constexpr uSys PointerSize = sizeof(void*);
 
+    /**
+     * The bytes pushed to the locals stack to save the caller's state on each call.
+     */
+    static inline constexpr uSys CallFrameSize = sizeof(uSys) * 2 + PointerSize * 3;
+
     template<typename T>
     static inline constexpr T ExecutionStackSize = T{ 16 } * T{ 1024 } * T{ 1024 };
 
@@ -37,6 +44,8 @@ public:
         , m_Arguments(MaxArgumentRegisters)
         , m_ExecutionStackPointer(0)
         , m_LocalsStackPointer(0)
+        , m_Profile(nullptr)
+        , m_Trace(nullptr)
     {
         (void) ::std::memset(m_ExecutionStack.arr(), 0, m_ExecutionStack.size());
         (void) ::std::memset(m_LocalsStack.arr(), 0, m_LocalsStack.size());
@@ -50,6 +59,8 @@ public:
         , m_Arguments(MaxArgumentRegisters)
         , m_ExecutionStackPointer(0)
         , m_LocalsStackPointer(0)
+        , m_Profile(nullptr)
+        , m_Trace(nullptr)
     {
         (void) ::std::memset(m_ExecutionStack.arr(), 0, m_ExecutionStack.size());
         (void) ::std::memset(m_LocalsStack.arr(), 0, m_LocalsStack.size());
@@ -59,6 +70,22 @@ public:
     void Execute() noexcept;
 
     [[nodiscard]] u64 ReturnVal() const noexcept { return m_Arguments[0]; }
+
+    /**
+     *   Sets the profile that instruction and call counts are recorded
+     * into, or nullptr to disable profiling. The profile is not owned by
+     * the emulator.
+     */
+    void Profile(ExecutionProfile* const profile) noexcept { m_Profile = profile; }
+    [[nodiscard]] ExecutionProfile* Profile() const noexcept { return m_Profile; }
+
+    /**
+     *   Sets the ring buffer that execution events are traced into, or
+     * nullptr to disable tracing. The buffer is not owned by the
+     * emulator.
+     */
+    void Trace(TraceBuffer* const trace) noexcept { m_Trace = trace; }
+    [[nodiscard]] TraceBuffer* Trace() const noexcept { return m_Trace; }
 private:
     void Executor(const Function* function, const Module* module) noexcept;
     void PushLocal(const Function* function, uSys localsHead, u16 local) noexcept;
@@ -135,6 +162,8 @@ private:
     DynArray<ArgumentRegisterType> m_Arguments;
     uSys m_ExecutionStackPointer;
     uSys m_LocalsStackPointer;
+    ExecutionProfile* m_Profile;
+    TraceBuffer* m_Trace;
 };
 
 }
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <NumTypes.hpp>
+#include <Objects.hpp>
+#include <DynArray.hpp>
+#include <unordered_map>
+#include <vector>
+
+namespace tau::ir {
+
+class Function;
+
+struct CallTargetCount final
+{
+    DEFAULT_CONSTRUCT_PU(CallTargetCount);
+    DEFAULT_DESTRUCT(CallTargetCount);
+    DEFAULT_CM_PU(CallTargetCount);
+public:
+    const Function* Target;
+    u64 Count;
+
+    CallTargetCount(const Function* const target, const u64 count) noexcept
+        : Target(target)
+        , Count(count)
+    { }
+};
+
+/**
+ * The execution counts of a single function.
+ *
+ *   Hit counts are indexed by the byte offset of each instruction from
+ * the start of the function's code, offsets within an instruction are
+ * always zero.
+ */
+class FunctionProfile final
+{
+    DEFAULT_CONSTRUCT_PU(FunctionProfile);
+    DEFAULT_DESTRUCT(FunctionProfile);
+    DEFAULT_CM_PU(FunctionProfile);
+public:
+    using CallTargetList = ::std::vector<CallTargetCount>;
+    using CallSiteMap = ::std::unordered_map<uSys, CallTargetList>;
+public:
+    FunctionProfile(uSys codeSize) noexcept;
+
+    void RecordInstruction(const uSys offset) noexcept
+    {
+        if(offset < m_InstructionHits.Count())
+        {
+            ++m_InstructionHits[offset];
+        }
+    }
+
+    void RecordCall(uSys offset, const Function* target) noexcept;
+
+    [[nodiscard]] u64 InstructionHits(const uSys offset) const noexcept
+    {
+        return offset < m_InstructionHits.Count() ? m_InstructionHits[offset] : 0;
+    }
+
+    [[nodiscard]] const DynArray<u64>& InstructionHits() const noexcept { return m_InstructionHits; }
+    [[nodiscard]] const CallSiteMap& CallSites() const noexcept { return m_CallSites; }
+
+    /**
+     * Gets the targets called from the call instruction at offset, or nullptr if it was never executed.
+     */
+    [[nodiscard]] const CallTargetList* FindCallSite(uSys offset) const noexcept;
+
+    [[nodiscard]] u64 TotalInstructionHits() const noexcept;
+private:
+    DynArray<u64> m_InstructionHits;
+    CallSiteMap m_CallSites;
+};
+
+/**
+ * A profile collected by the Emulator.
+ */
+class ExecutionProfile final
+{
+    DEFAULT_CONSTRUCT_PU(ExecutionProfile);
+    DEFAULT_DESTRUCT(ExecutionProfile);
+    DEFAULT_CM_PU(ExecutionProfile);
+public:
+    /**
+     * Gets the profile for a function, creating it if it does not yet exist.
+     */
+    [[nodiscard]] FunctionProfile& GetFunction(const Function* function) noexcept;
+    [[nodiscard]] const FunctionProfile* FindFunction(const Function* function) const noexcept;
+
+    [[nodiscard]] const ::std::unordered_map<const Function*, FunctionProfile>& Functions() const noexcept { return m_Functions; }
+
+    void Reset() noexcept { m_Functions.clear(); }
+private:
+    ::std::unordered_map<const Function*, FunctionProfile> m_Functions;
+};
+
+}
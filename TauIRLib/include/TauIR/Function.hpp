@@ -177,6 +177,17 @@ public:
 
     void Attach(FunctionAttachment* attachment) noexcept;
 
+    /**
+     * The name this attachment is grouped under in a MemoryReport.
+     */
+    [[nodiscard]] virtual const char* AttachmentName() const noexcept { return "FunctionAttachment"; }
+
+    /**
+     *   The number of bytes owned by this attachment, including the
+     * attachment itself, but excluding any chained attachments.
+     */
+    [[nodiscard]] virtual uSys MemoryUsage() const noexcept { return sizeof(FunctionAttachment); }
+
     [[nodiscard]] const FunctionAttachment*  Next() const noexcept { return m_Next; }
     [[nodiscard]]       FunctionAttachment*& Next()       noexcept { return m_Next; }
 private:
@@ -208,6 +219,13 @@ public:
     [[nodiscard]] uSys LocalSize() const noexcept { return m_LocalSize; }
     [[nodiscard]] const DynArray<const TypeInfo*>& LocalTypes() const noexcept { return m_LocalTypes; }
     [[nodiscard]] const DynArray<uSys>& LocalOffsets() const noexcept { return m_LocalOffsets; }
+
+    [[nodiscard]] const char* AttachmentName() const noexcept override { return "OptoFunctionCodeAttachment"; }
+
+    [[nodiscard]] uSys MemoryUsage() const noexcept override
+    {
+        return sizeof(*this) + m_CodeSize + m_LocalTypes.Count() * sizeof(const TypeInfo*) + m_LocalOffsets.Count() * sizeof(uSys);
+    }
 private:
     /**
      * The address of the IR code.
@@ -332,6 +350,11 @@ public:
      */
     [[nodiscard]] void* operator new(::std::size_t sz) noexcept;
     void operator delete(void* ptr) noexcept;
+
+    /**
+     * The number of functions currently allocated by the global allocator.
+     */
+    [[nodiscard]] static FixedBlockAllocatorStats AllocatorStats() noexcept;
 private:
     Function(
         const u8* const address, 
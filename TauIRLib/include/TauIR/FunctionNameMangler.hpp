@@ -1,5 +1,6 @@
 #pragma once
 
+#include <Objects.hpp>
 #include <DynArray.hpp>
 #include <String.hpp>
 
@@ -9,4 +10,32 @@ struct FunctionArgument;
 C8DynString MangleFunctionName(const DynArray<FunctionArgument>& arguments) noexcept;
 DynArray<FunctionArgument> DeMangleFunctionName(const C8DynString& mangledName) noexcept;
 
+/**
+ * \brief The demangled arguments of a function type.
+ *
+ *   These are interned, every function type with the same mangled name
+ * shares a single signature, and a signature is never destroyed.
+ */
+class FunctionSignature final
+{
+    DELETE_CM(FunctionSignature);
+public:
+    FunctionSignature(const C8DynString& mangledName) noexcept;
+    ~FunctionSignature() noexcept;
+
+    [[nodiscard]] const C8DynString& MangledName() const noexcept { return m_MangledName; }
+    [[nodiscard]] const DynArray<FunctionArgument>& Arguments() const noexcept { return m_Arguments; }
+private:
+    C8DynString m_MangledName;
+    DynArray<FunctionArgument> m_Arguments;
+};
+
+/**
+ *   Finds the signature for a mangled name, demangling it only the
+ * first time the name is seen. This is safe to call from any thread.
+ *
+ * @return The signature, or nullptr if it couldn't be allocated.
+ */
+[[nodiscard]] const FunctionSignature* InternFunctionSignature(const C8DynString& mangledName) noexcept;
+
 }
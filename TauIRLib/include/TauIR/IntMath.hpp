@@ -0,0 +1,63 @@
+#pragma once
+
+#include <NumTypes.hpp>
+#include <type_traits>
+
+namespace tau::ir {
+
+/**
+ * \brief The upper half of the double width product of two integers.
+ *
+ *   Signedness follows T. 64 bit products are built from 32 bit halves,
+ * there is no portable 128 bit integer.
+ */
+template<typename T>
+[[nodiscard]] constexpr T MulHigh(const T a, const T b) noexcept
+{
+    static_assert(::std::is_integral_v<T>, "MulHigh requires an integer type.");
+
+    constexpr u32 Bits = sizeof(T) * 8;
+
+    if constexpr(sizeof(T) < 8)
+    {
+        using Wide = ::std::conditional_t<::std::is_signed_v<T>, i64, u64>;
+        return static_cast<T>((static_cast<Wide>(a) * static_cast<Wide>(b)) >> Bits);
+    }
+    else
+    {
+        const u64 ua = static_cast<u64>(a);
+        const u64 ub = static_cast<u64>(b);
+
+        const u64 aLow = ua & 0xFFFFFFFF;
+        const u64 aHigh = ua >> 32;
+        const u64 bLow = ub & 0xFFFFFFFF;
+        const u64 bHigh = ub >> 32;
+
+        const u64 lowLow = aLow * bLow;
+        const u64 lowHigh = aLow * bHigh;
+        const u64 highLow = aHigh * bLow;
+        const u64 highHigh = aHigh * bHigh;
+
+        // The carry out of the middle 64 bits.
+        const u64 middle = (lowLow >> 32) + (lowHigh & 0xFFFFFFFF) + (highLow & 0xFFFFFFFF);
+        u64 high = highHigh + (lowHigh >> 32) + (highLow >> 32) + (middle >> 32);
+
+        if constexpr(::std::is_signed_v<T>)
+        {
+            // A negative operand was treated as 2^64 more than it is, subtract the other operand to undo it.
+            if(a < 0)
+            {
+                high -= ub;
+            }
+
+            if(b < 0)
+            {
+                high -= ua;
+            }
+        }
+
+        return static_cast<T>(high);
+    }
+}
+
+}
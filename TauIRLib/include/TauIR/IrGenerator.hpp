@@ -0,0 +1,190 @@
+#pragma once
+
+#include <NumTypes.hpp>
+#include <Objects.hpp>
+
+#include "TauIR/Common.hpp"
+#include "TauIR/Function.hpp"
+#include "TauIR/IrWriter.hpp"
+
+namespace tau::ir {
+
+/**
+ * Owns the code buffer of a function that was written with an IrWriter.
+ *
+ *   Function only stores a pointer to its code, generated functions
+ * have no static array backing them, so the writer is kept alive for
+ * as long as the function is.
+ */
+class IrWriterFunctionAttachment final : public FunctionAttachment
+{
+    DEFAULT_DESTRUCT(IrWriterFunctionAttachment);
+    DELETE_CM(IrWriterFunctionAttachment);
+    RTT_IMPL(IrWriterFunctionAttachment, FunctionAttachment);
+public:
+    IrWriterFunctionAttachment(IrWriter&& writer) noexcept
+        : m_Writer(::std::move(writer))
+    { }
+
+    [[nodiscard]] const IrWriter& Writer() const noexcept { return m_Writer; }
+
+    [[nodiscard]] const char* AttachmentName() const noexcept override { return "IrWriterFunctionAttachment"; }
+    [[nodiscard]] uSys MemoryUsage() const noexcept override { return sizeof(*this) + m_Writer.Capacity(); }
+private:
+    IrWriter m_Writer;
+};
+
+/**
+ * Generates random, well-formed IR modules for stress testing and
+ * scaling benchmarks.
+ *
+ *   Every generated function is stack balanced, only uses i32 locals,
+ * and terminates. Calls only ever target functions at a deeper level
+ * of the call graph, so there is no recursion, and every loop is
+ * driven by a dedicated counter local with a fixed trip count.
+ *
+ *   Function 0 is the entry point. Each function returns its first
+ * local in argument register 0, so the result of running a module in
+ * the Emulator can be compared between runs.
+ *
+ *   The same configuration and seed always produce the same module.
+ * The generator uses its own PRNG rather than the standard
+ * distributions, as those are not guaranteed to produce the same
+ * sequence across standard library implementations.
+ */
+class IrGenerator final
+{
+    DEFAULT_DESTRUCT(IrGenerator);
+    DEFAULT_CM_PU(IrGenerator);
+public:
+    IrGenerator() noexcept
+        : m_Seed(0)
+        , m_FunctionCount(1)
+        , m_StatementCount(32)
+        , m_CallDepth(0)
+        , m_LocalCount(4)
+        , m_BranchDensity(10)
+        , m_LoopNesting(0)
+        , m_LoopTripCount(4)
+        , m_ExpressionDepth(2)
+        , m_State(0)
+    { }
+
+    IrGenerator& Seed(const u64 seed) noexcept
+    {
+        m_Seed = seed;
+        return *this;
+    }
+
+    /**
+     * The number of functions in the generated module.
+     */
+    IrGenerator& FunctionCount(const u32 functionCount) noexcept
+    {
+        m_FunctionCount = maxT(functionCount, 1u);
+        return *this;
+    }
+
+    /**
+     *   The number of statements in each function. Statements nested
+     * within branches and loops count towards this.
+     */
+    IrGenerator& StatementCount(const u32 statementCount) noexcept
+    {
+        m_StatementCount = maxT(statementCount, 1u);
+        return *this;
+    }
+
+    /**
+     *   The maximum depth of the call graph, 0 produces no calls. This
+     * is clamped to the number of functions.
+     */
+    IrGenerator& CallDepth(const u32 callDepth) noexcept
+    {
+        m_CallDepth = callDepth;
+        return *this;
+    }
+
+    /**
+     *   The number of value locals in each function, the locals used
+     * for loop counters are added on top of this.
+     */
+    IrGenerator& LocalCount(const u16 localCount) noexcept
+    {
+        m_LocalCount = maxT<u16>(localCount, 1);
+        return *this;
+    }
+
+    /**
+     * The percentage [0, 100] of statements that are branches or loops.
+     */
+    IrGenerator& BranchDensity(const u32 branchDensity) noexcept
+    {
+        m_BranchDensity = minT(branchDensity, 100u);
+        return *this;
+    }
+
+    /**
+     * The maximum nesting of loops, 0 produces no loops.
+     */
+    IrGenerator& LoopNesting(const u32 loopNesting) noexcept
+    {
+        m_LoopNesting = loopNesting;
+        return *this;
+    }
+
+    /**
+     *   The number of iterations of every loop. Keep in mind that the
+     * amount of executed code grows exponentially with loop nesting
+     * and with calls from within loops.
+     */
+    IrGenerator& LoopTripCount(const u32 loopTripCount) noexcept
+    {
+        m_LoopTripCount = maxT(loopTripCount, 1u);
+        return *this;
+    }
+
+    /**
+     * The maximum depth of the expression tree of each statement.
+     */
+    IrGenerator& ExpressionDepth(const u32 expressionDepth) noexcept
+    {
+        m_ExpressionDepth = expressionDepth;
+        return *this;
+    }
+
+    [[nodiscard]] ModuleRef Build() noexcept;
+private:
+    struct FunctionState;
+
+    Function* GenerateFunction(u32 functionIndex) noexcept;
+
+    void GenerateBlock(FunctionState& state, u32 statementCount) noexcept;
+    void GenerateStatement(FunctionState& state) noexcept;
+    void GenerateAssignment(FunctionState& state) noexcept;
+    void GenerateCall(FunctionState& state) noexcept;
+    void GenerateIf(FunctionState& state) noexcept;
+    void GenerateLoop(FunctionState& state) noexcept;
+    void GenerateExpression(FunctionState& state, u32 depth) noexcept;
+    void GenerateLeaf(FunctionState& state) noexcept;
+
+    [[nodiscard]] u32 CallLevel(u32 functionIndex) const noexcept;
+    [[nodiscard]] u32 FirstFunctionBelowLevel(u32 level) const noexcept;
+
+    [[nodiscard]] u64 Next() noexcept;
+    [[nodiscard]] u32 NextBounded(u32 bound) noexcept;
+    [[nodiscard]] bool NextChance(u32 percent) noexcept;
+private:
+    u64 m_Seed;
+    u32 m_FunctionCount;
+    u32 m_StatementCount;
+    u32 m_CallDepth;
+    u16 m_LocalCount;
+    u32 m_BranchDensity;
+    u32 m_LoopNesting;
+    u32 m_LoopTripCount;
+    u32 m_ExpressionDepth;
+    u64 m_State;
+};
+
+}
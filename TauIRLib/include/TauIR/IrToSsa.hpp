@@ -20,9 +20,37 @@ public:
     using SsaFrameTracker = ssa::SsaFrameTracker;
     using VarId = ssa::VarId;
 public:
-    static void TransformFunction(Function* function, const ModuleRef& module, u16 currentModule) noexcept;
+    /**
+     *   Attaches the SSA form of the function. Returns false, and attaches
+     * nothing, if the function's control flow can't be translated.
+     */
+    static bool TransformFunction(Function* function, const ModuleRef& module, u16 currentModule) noexcept;
+
+    /**
+     *   Uses the arena for all of the scratch memory, the arena is reset
+     * before returning. Only the attached result is allocated on the heap.
+     *
+     * @param registry
+     *   Resolves locals of custom types, see SsaCustomTypeRegistry::RegisterTypeInfo.
+     *   Without a registry they have no custom type id.
+     */
+    static bool TransformFunction(Function* function, const ModuleRef& module, u16 currentModule, ssa::SsaArena& arena, const ssa::SsaCustomTypeRegistry* registry = nullptr) noexcept;
+
+    /**
+     *   Transforms every function in the module on a pool of worker
+     * threads, each with its own arena. The calling thread is one of the
+     * workers. The output is the same as transforming the functions one
+     * at a time, whatever the thread count.
+     *
+     * @param threadCount
+     *   The number of threads to use, 0 uses every hardware thread.
+     * @param registry
+     *   Shared by every worker, it must not be modified until this returns.
+     * @return False if any function failed to transform.
+     */
+    static bool TransformModule(const ModuleRef& module, u16 currentModule, u32 threadCount = 0, const ssa::SsaCustomTypeRegistry* registry = nullptr) noexcept;
 public:
-    static VarId PopRaw(SsaWriter& writer, SsaFrameTracker& frameTracker, uSys size, ssa::SsaType ssaType);
+    static VarId PopRaw(SsaWriter& writer, SsaFrameTracker& frameTracker, uSys size, ssa::SsaCustomType ssaType);
     static VarId PopLocal(const Function* function, SsaWriter& writer, SsaFrameTracker& frameTracker, VarId localIndex);
     static VarId PopArgument(const Function* function, SsaWriter& writer, SsaFrameTracker& frameTracker, VarId argIndex);
 };
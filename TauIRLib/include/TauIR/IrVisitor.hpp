@@ -177,6 +177,16 @@ protected:
     SIMPLE_VISIT_DECL(MulI64);
     SIMPLE_VISIT_DECL(DivI32);
     SIMPLE_VISIT_DECL(DivI64);
+    SIMPLE_VISIT_DECL(MulHighI32);
+    SIMPLE_VISIT_DECL(MulHighI64);
+    SIMPLE_VISIT_DECL(MulHighU32);
+    SIMPLE_VISIT_DECL(MulHighU64);
+    SIMPLE_VISIT_DECL(ShlI32);
+    SIMPLE_VISIT_DECL(ShlI64);
+    SIMPLE_VISIT_DECL(ShrI32);
+    SIMPLE_VISIT_DECL(ShrI64);
+    SIMPLE_VISIT_DECL(SarI32);
+    SIMPLE_VISIT_DECL(SarI64);
 
     void VisitCompI32(CompareCondition condition) noexcept { }
 
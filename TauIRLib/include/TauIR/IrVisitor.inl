@@ -235,6 +235,16 @@ void BaseIrVisitor<Derived>::Traverse(const u8* codePtr, const u8* const endPtr)
             SIMPLE_TRAVERSE(MulI64);
             SIMPLE_TRAVERSE(DivI32);
             SIMPLE_TRAVERSE(DivI64);
+            SIMPLE_TRAVERSE(MulHighI32);
+            SIMPLE_TRAVERSE(MulHighI64);
+            SIMPLE_TRAVERSE(MulHighU32);
+            SIMPLE_TRAVERSE(MulHighU64);
+            SIMPLE_TRAVERSE(ShlI32);
+            SIMPLE_TRAVERSE(ShlI64);
+            SIMPLE_TRAVERSE(ShrI32);
+            SIMPLE_TRAVERSE(ShrI64);
+            SIMPLE_TRAVERSE(SarI32);
+            SIMPLE_TRAVERSE(SarI64);
             SIMPLE_TRAVERSE(CompI32Above);
             SIMPLE_TRAVERSE(CompI32AboveOrEqual);
             SIMPLE_TRAVERSE(CompI32Below);
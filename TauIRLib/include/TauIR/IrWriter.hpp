@@ -33,6 +33,7 @@ public:
     void WritePopGlobalExt(u32 globalIndex, u16 moduleIndex) noexcept;
     void WritePopGlobalPtr(u32 globalIndex) noexcept;
     void WritePopGlobalExtPtr(u32 globalIndex, u16 moduleIndex) noexcept;
+    void WritePopCount(u16 byteCount) noexcept;
     void WriteDup(uSys byteCount) noexcept;
     void WriteExpandSX(uSys fromSize, uSys toSize) noexcept;
     void WriteExpandZX(uSys fromSize, uSys toSize) noexcept;
@@ -52,19 +53,46 @@ public:
     void WriteMulI64() noexcept;
     void WriteDivI32() noexcept;
     void WriteDivI64() noexcept;
+    void WriteMulHighI32() noexcept;
+    void WriteMulHighI64() noexcept;
+    void WriteMulHighU32() noexcept;
+    void WriteMulHighU64() noexcept;
+    void WriteShlI32() noexcept;
+    void WriteShlI64() noexcept;
+    void WriteShrI32() noexcept;
+    void WriteShrI64() noexcept;
+    void WriteSarI32() noexcept;
+    void WriteSarI64() noexcept;
     void WriteCompI32(CompareCondition cond) noexcept;
     void WriteCompI64(CompareCondition cond) noexcept;
     void WriteCall(u32 functionIndex) noexcept;
     void WriteCallExt(u32 functionIndex, u16 moduleIndex) noexcept;
-    void WriteCallInd(u32 functionPointerIndex) noexcept;
-    void WriteCallIndExt(u32 functionPointerIndex, u16 moduleIndex) noexcept;
+    void WriteCallInd(u16 functionPointerIndex) noexcept;
+    /**
+     * The module index is popped from the stack when the call is made.
+     */
+    void WriteCallIndExt(u16 functionPointerIndex) noexcept;
     void WriteRet() noexcept;
     void WriteJump(i32 offset) noexcept;
     void WriteJumpTrue(i32 offset) noexcept;
     void WriteJumpFalse(i32 offset) noexcept;
 
+    /**
+     *   Overwrites the offset of a Jump, JumpTrue, or JumpFalse that was
+     * previously written at jumpIndex. This allows forward jumps to be
+     * written before the location of their target is known.
+     */
+    void PatchJump(uSys jumpIndex, i32 offset) noexcept;
+
+    /**
+     *   Appends code that is already encoded, such as the body of another
+     * function.
+     */
+    void WriteCode(const u8* code, uSys size) noexcept;
+
     [[nodiscard]] const u8* Buffer() const noexcept { return m_Buffer; }
     [[nodiscard]] uSys Size() const noexcept { return m_WriteIndex; }
+    [[nodiscard]] uSys Capacity() const noexcept { return m_BufferSize; }
 private:
     void EnsureSize(uSys additionalSize) noexcept;
 
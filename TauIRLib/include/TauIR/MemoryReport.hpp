@@ -0,0 +1,124 @@
+#pragma once
+
+#include <NumTypes.hpp>
+#include <Objects.hpp>
+#include <vector>
+
+#include "TauIR/Common.hpp"
+
+namespace tau::ir {
+
+class Function;
+class Module;
+
+/**
+ * The bytes owned by a single function, broken down by category.
+ */
+struct FunctionMemoryReport final
+{
+    DEFAULT_CONSTRUCT_PU(FunctionMemoryReport);
+    DEFAULT_DESTRUCT(FunctionMemoryReport);
+    DEFAULT_CM_PU(FunctionMemoryReport);
+public:
+    const tau::ir::Function* Function;
+    /**
+     * The Function object itself, as allocated by its fixed block allocator.
+     */
+    uSys Object;
+    /**
+     *   The IR code. Functions don't own their code, so this may also be
+     * counted by an attachment or by whoever loaded the module.
+     */
+    uSys Code;
+    uSys LocalTypes;
+    uSys LocalOffsets;
+    uSys Arguments;
+    uSys Name;
+    /**
+     * The sum of every attachment chained on the function.
+     */
+    uSys Attachments;
+
+    [[nodiscard]] uSys Total() const noexcept
+    {
+        return Object + Code + LocalTypes + LocalOffsets + Arguments + Name + Attachments;
+    }
+};
+
+/**
+ * The bytes owned by every attachment of a single type.
+ */
+struct AttachmentMemoryReport final
+{
+    DEFAULT_CONSTRUCT_PU(AttachmentMemoryReport);
+    DEFAULT_DESTRUCT(AttachmentMemoryReport);
+    DEFAULT_CM_PU(AttachmentMemoryReport);
+public:
+    const char* Name;
+    uSys Count;
+    uSys Bytes;
+
+    AttachmentMemoryReport(const char* const name, const uSys count, const uSys bytes) noexcept
+        : Name(name)
+        , Count(count)
+        , Bytes(bytes)
+    { }
+};
+
+/**
+ * A breakdown of the memory used by a module.
+ *
+ *   Sizes are computed from the capacity of each container where it is
+ * available, allocator overhead is not included. Imported modules are
+ * not walked, build a separate report for each of them.
+ */
+class MemoryReport final
+{
+    DEFAULT_CONSTRUCT_PU(MemoryReport);
+    DEFAULT_DESTRUCT(MemoryReport);
+    DEFAULT_CM_PU(MemoryReport);
+public:
+    [[nodiscard]] static MemoryReport Build(const Module* module) noexcept;
+    [[nodiscard]] static MemoryReport Build(const ModuleRef& module) noexcept;
+
+    /**
+     * Builds the report for a single function.
+     */
+    [[nodiscard]] static FunctionMemoryReport BuildFunction(const Function* function) noexcept;
+
+    [[nodiscard]] const Module* ReportedModule() const noexcept { return m_Module; }
+    [[nodiscard]] const ::std::vector<FunctionMemoryReport>& Functions() const noexcept { return m_Functions; }
+    [[nodiscard]] const ::std::vector<AttachmentMemoryReport>& Attachments() const noexcept { return m_Attachments; }
+
+    /**
+     * The Module object, its function lists, imports, and name.
+     */
+    [[nodiscard]] uSys ModuleBytes() const noexcept { return m_ModuleBytes; }
+
+    /**
+     * The sum of a single category across all functions.
+     */
+    [[nodiscard]] FunctionMemoryReport FunctionTotals() const noexcept;
+
+    [[nodiscard]] uSys Total() const noexcept;
+
+    /**
+     *   The live blocks of the global fixed block allocators. These are
+     * process wide and include objects from every module.
+     */
+    [[nodiscard]] const FixedBlockAllocatorStats& FunctionAllocator() const noexcept { return m_FunctionAllocator; }
+    [[nodiscard]] const FixedBlockAllocatorStats&   ModuleAllocator() const noexcept { return m_ModuleAllocator;   }
+    [[nodiscard]] const FixedBlockAllocatorStats& TypeInfoAllocator() const noexcept { return m_TypeInfoAllocator; }
+private:
+    void AddAttachment(const char* name, uSys bytes) noexcept;
+private:
+    const Module* m_Module;
+    ::std::vector<FunctionMemoryReport> m_Functions;
+    ::std::vector<AttachmentMemoryReport> m_Attachments;
+    uSys m_ModuleBytes;
+    FixedBlockAllocatorStats m_FunctionAllocator;
+    FixedBlockAllocatorStats m_ModuleAllocator;
+    FixedBlockAllocatorStats m_TypeInfoAllocator;
+};
+
+}
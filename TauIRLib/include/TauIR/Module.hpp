@@ -64,6 +64,26 @@ public:
     [[nodiscard]]       C8DynString& Name()       noexcept { return m_Name; }
 
     void AttachModuleReference(const ModuleRef& module) noexcept;
+
+    /**
+     *   Deletes the functions whose new index is -1 and moves the rest to
+     * their new index, which must keep them in the same order. Exports of
+     * deleted functions are dropped. Calls to the moved functions aren't
+     * updated, that is up to whoever picked the indices.
+     *
+     * @param newIndices
+     *   The new index of every function.
+     */
+    void CompactFunctions(const u32* newIndices) noexcept;
+
+    /**
+     *   Adds functions after the last one, the module takes ownership of
+     * them. The module references of the functions aren't set. The list is
+     * rebuilt each time, so add functions in as few batches as possible.
+     *
+     * @return The index of the first added function.
+     */
+    u32 AddFunctions(Function* const* functions, uSys count) noexcept;
 private:
     static uSys GenerateId() noexcept;
 public:
@@ -76,6 +96,11 @@ public:
      */
     [[nodiscard]] void* operator new(::std::size_t sz) noexcept;
     void operator delete(void* ptr) noexcept;
+
+    /**
+     * The number of modules currently allocated by the global allocator.
+     */
+    [[nodiscard]] static FixedBlockAllocatorStats AllocatorStats() noexcept;
 private:
     uSys m_Id;
     FunctionList m_Functions;
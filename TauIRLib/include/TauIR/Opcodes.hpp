@@ -99,6 +99,16 @@ enum class Opcode : u16
     MulI64                = 0x0039,
     DivI32                = 0x003A,
     DivI64                = 0x003B,
+    MulHighI32            = 0x003C,
+    MulHighI64            = 0x003D,
+    MulHighU32            = 0x003E,
+    MulHighU64            = 0x003F,
+    ShlI32                = 0x004C,
+    ShlI64                = 0x004D,
+    ShrI32                = 0x004E,
+    ShrI64                = 0x004F,
+    SarI32                = 0x0050,
+    SarI64                = 0x0051,
     CompI32Above          = 0x8070,
     CompI32AboveOrEqual   = 0x8071,
     CompI32Below          = 0x8072,
@@ -4,21 +4,64 @@
 
 #include "Common.hpp"
 #include "TauIR/IrWriter.hpp"
-
-#include <vector>
+#include "TauIR/ssa/SsaArena.hpp"
+#include "TauIR/ssa/SsaTypes.hpp"
 
 namespace tau::ir {
 
 class Function;
-class TypeInfo;
 class Module;
-using ModuleList = ::std::vector<ModuleRef>;
 
-class IrToSsa
+/**
+ * \brief Lowers the SSA form of a function back to stack IR.
+ *
+ *   Values are scheduled onto the execution stack where possible. A
+ * value with a single use in the same block that is consumed in the
+ * order it was produced never leaves the stack, everything else is
+ * popped into a local. Locals are assigned with a linear scan over the
+ * live ranges of the values, locals of the same size are reused once
+ * their value is dead.
+ *
+ *   Loads and stores go through the IR Load and Store, which only
+ * address memory through locals, so their operands are always kept in
+ * locals. Computed pointers are plain 8 byte arithmetic.
+ *
+ *   Floating point arithmetic, barrel shifts, and indirect calls with
+ * parameters have no lowering yet, functions that use them aren't
+ * lowered.
+ */
+class SsaToIr
 {
-    DELETE_CM(IrToSsa);
+    DELETE_CM(SsaToIr);
 public:
-    static void TransformFunction(Function* function, const ModuleList& modules, u16 currentModule) noexcept;
+    /**
+     *   Lowers the SSA attached to the function. The new function has the
+     * same name, arguments and flags, its code is owned by an
+     * IrWriterFunctionAttachment.
+     *
+     * @param module
+     *   The module that the function belongs to, calls are resolved
+     *   against it to find the arguments of the callee.
+     * @return The lowered function, or nullptr if the function has no
+     *   SSA attached, or the SSA can't be lowered.
+     */
+    [[nodiscard]] static Function* TransformFunction(const Function* function, const ModuleRef& module, const ssa::SsaCustomTypeRegistry& registry) noexcept;
+
+    /**
+     *   Uses the arena for all of the scratch memory, the arena is reset
+     * before returning.
+     */
+    [[nodiscard]] static Function* TransformFunction(const Function* function, const ModuleRef& module, const ssa::SsaCustomTypeRegistry& registry, ssa::SsaArena& arena) noexcept;
+
+    /**
+     *   Lowers every function of the module into a new emulated module.
+     * The exports and imports refer to the same functions by index. A
+     * function that can't be lowered keeps a copy of its original IR.
+     *
+     * @return The new module, or nullptr if the module is native, or a
+     *   function can neither be lowered nor has any IR to copy.
+     */
+    [[nodiscard]] static ModuleRef TransformModule(const ModuleRef& module, const ssa::SsaCustomTypeRegistry& registry) noexcept;
 };
 
 }
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <NumTypes.hpp>
+#include <Objects.hpp>
+#include <DynArray.hpp>
+#include <atomic>
+#include <vector>
+
+namespace tau::ir {
+
+class Function;
+
+enum class TraceEventType : u8
+{
+    FunctionEnter = 0,
+    FunctionExit,
+    BranchTaken,
+    NativeCallBegin,
+    NativeCallEnd,
+    /**
+     * A call would have overflowed the locals stack, execution was stopped.
+     */
+    StackOverflow
+};
+
+/**
+ *   A single trace event.
+ *
+ *   Function is the function the event happened in, or the callee for
+ * enter and native call events. Offset is the byte offset of the
+ * instruction that produced the event from the start of the function
+ * that was executing it, for enter events this is the call site in the
+ * caller. CallDepth is the depth of the executing function, or of the
+ * callee for enter events, the entry point is at 0.
+ *
+ *   Branches are the most frequent event, so to keep them cheap they
+ * are not timestamped and have a Timestamp of 0.
+ */
+struct TraceEvent final
+{
+    /**
+     * Nanoseconds since the creation of the trace buffer.
+     */
+    u64 Timestamp;
+    const tau::ir::Function* Function;
+    u32 Offset;
+    u16 CallDepth;
+    TraceEventType Type;
+};
+
+/**
+ *   A bounded, lock-free ring buffer of trace events.
+ *
+ *   There may only be a single writer, the emulator that the buffer is
+ * attached to, but snapshots can be taken from any thread while it is
+ * running. Once the buffer is full the oldest events are overwritten.
+ */
+class TraceBuffer final
+{
+    DEFAULT_DESTRUCT(TraceBuffer);
+    DELETE_CM(TraceBuffer);
+public:
+    static inline constexpr uSys DefaultCapacity = 4096;
+public:
+    /**
+     * The capacity is rounded up to a power of two.
+     */
+    TraceBuffer(uSys capacity = DefaultCapacity) noexcept;
+
+    void Record(const TraceEventType type, const Function* const function, const uSys offset, const uSys callDepth, const u64 timestamp) noexcept
+    {
+        const u64 writeIndex = m_WriteIndex.load(::std::memory_order_relaxed);
+
+        TraceEvent& event = m_Events[static_cast<uSys>(writeIndex & m_Mask)];
+        event.Timestamp = timestamp;
+        event.Function = function;
+        event.Offset = static_cast<u32>(offset);
+        event.CallDepth = static_cast<u16>(callDepth);
+        event.Type = type;
+
+        m_WriteIndex.store(writeIndex + 1, ::std::memory_order_release);
+    }
+
+    void Record(const TraceEventType type, const Function* const function, const uSys offset, const uSys callDepth) noexcept
+    {
+        Record(type, function, offset, callDepth, Now());
+    }
+
+    /**
+     * The time since the creation of the buffer in nanoseconds.
+     */
+    [[nodiscard]] u64 Now() const noexcept;
+
+    [[nodiscard]] uSys Capacity() const noexcept { return m_Events.Count(); }
+
+    /**
+     * The number of events recorded since creation or the last reset, including those that have been overwritten.
+     */
+    [[nodiscard]] u64 TotalEvents() const noexcept { return m_WriteIndex.load(::std::memory_order_acquire); }
+
+    /**
+     *   Copies out the retained events, oldest first. Events that are
+     * overwritten by the writer while the copy is being made are
+     * dropped from the front of the snapshot. Once the buffer has
+     * wrapped the oldest slot is always dropped, the writer may be in
+     * the middle of overwriting it.
+     */
+    [[nodiscard]] ::std::vector<TraceEvent> Snapshot() const noexcept;
+
+    /**
+     * Discards every event. This must not be called while the emulator is running.
+     */
+    void Reset() noexcept { m_WriteIndex.store(0, ::std::memory_order_release); }
+private:
+    DynArray<TraceEvent> m_Events;
+    u64 m_Mask;
+    i64 m_Epoch;
+    ::std::atomic<u64> m_WriteIndex;
+};
+
+}
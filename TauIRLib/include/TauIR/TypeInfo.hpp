@@ -2,7 +2,9 @@
 
 #include <NumTypes.hpp>
 #include <String.hpp>
+#include <utility>
 #include "Common.hpp"
+#include "FunctionNameMangler.hpp"
 
 namespace tau::ir {
 
@@ -72,6 +74,28 @@ union TypeInfoFlags final
     [[nodiscard]] static constexpr TypeInfoFlags            Char() noexcept { return TypeInfoFlags( true, false, false,  true, false, false,  true, false, false, false, false, false); }
 };
 
+/**
+ *   Tags the builtin types, so they can be mapped with a table lookup
+ * instead of comparing against each of them. Every other type is None.
+ */
+enum class TypeInfoPrimitive : u8
+{
+    None = 0,
+    Void,
+    Bool,
+    I8,
+    I16,
+    I32,
+    I64,
+    U8,
+    U16,
+    U32,
+    U64,
+    F32,
+    F64,
+    Char
+};
+
 namespace TypeInfoExt {
 class TypeInfoBuilder;
 }
@@ -103,6 +127,8 @@ public:
         , m_Flags(flags)
         , m_Name(name)
         , m_ChainType(chainType)
+        , m_Signature(LookupSignature(m_Flags, m_Name))
+        , m_Primitive(TypeInfoPrimitive::None)
     { }
     
     TypeInfo(const uSys size, const TypeInfoFlags flags, C8DynString&& name, const TypeInfo* chainType = nullptr) noexcept
@@ -111,6 +137,8 @@ public:
         , m_Flags(flags)
         , m_Name(::std::move(name))
         , m_ChainType(chainType)
+        , m_Signature(LookupSignature(m_Flags, m_Name))
+        , m_Primitive(TypeInfoPrimitive::None)
     { }
 
     TypeInfo(const uSys size, const TypeInfoFlags flags, const c8* const name, const TypeInfo* chainType = nullptr) noexcept
@@ -119,6 +147,8 @@ public:
         , m_Flags(flags)
         , m_Name(name)
         , m_ChainType(chainType)
+        , m_Signature(LookupSignature(m_Flags, m_Name))
+        , m_Primitive(TypeInfoPrimitive::None)
     { }
 
     TypeInfo(const uSys size, const TypeInfoFlags flags, const char* const name, const TypeInfo* chainType = nullptr) noexcept
@@ -127,6 +157,8 @@ public:
         , m_Flags(flags)
         , m_Name(reinterpret_cast<const char8_t*>(name))
         , m_ChainType(chainType)
+        , m_Signature(LookupSignature(m_Flags, m_Name))
+        , m_Primitive(TypeInfoPrimitive::None)
     { }
 
     TypeInfo(const uSys size, const TypeInfoFlags flags, const TypeInfo* chainType = nullptr) noexcept
@@ -134,6 +166,8 @@ public:
         , m_Id(GenerateId())
         , m_Flags(flags)
         , m_ChainType(chainType)
+        , m_Signature(LookupSignature(m_Flags, m_Name))
+        , m_Primitive(TypeInfoPrimitive::None)
     { }
 
     [[nodiscard]] uSys Size() const noexcept { return m_Size; }
@@ -145,10 +179,23 @@ public:
     [[nodiscard]] operator const C8DynString&() const noexcept { return m_Name; }
 
     [[nodiscard]] const TypeInfo* ChainType() const noexcept { return m_ChainType; }
+
+    /**
+     * The interned signature of a function type, null for any other type.
+     */
+    [[nodiscard]] const FunctionSignature* Signature() const noexcept { return m_Signature; }
+
+    [[nodiscard]] TypeInfoPrimitive Primitive() const noexcept { return m_Primitive; }
 public:
     void* operator new(::std::size_t sz) noexcept;
     void operator delete(void* ptr) noexcept;
 
+    /**
+     *   The number of types currently allocated by the global allocator.
+     * This does not include the builtin types.
+     */
+    [[nodiscard]] static FixedBlockAllocatorStats AllocatorStats() noexcept;
+
     [[nodiscard]] static bool IsPointer(const TypeInfo* typeInfo) noexcept { return typeInfo->m_Flags.IsPointer; }
     
     [[nodiscard]] static       TypeInfo* StripPointer(      TypeInfo* typeInfo) noexcept { return UnTagPointer<7>(typeInfo); }
@@ -166,13 +213,34 @@ public:
     template<bool IsPointer>
     [[nodiscard]] static const TypeInfo* SetPointer(const TypeInfo* typeInfo) noexcept;
 private:
+    /**
+     * Only used for the builtin types.
+     */
+    template<typename... Args>
+    TypeInfo(const TypeInfoPrimitive primitive, Args&&... args) noexcept
+        : TypeInfo(::std::forward<Args>(args)...)
+    {
+        m_Primitive = primitive;
+    }
+
     static uSys GenerateId() noexcept;
+
+    /**
+     *   An unnamed function type has no mangled name to demangle, so it
+     * doesn't get a signature.
+     */
+    [[nodiscard]] static const FunctionSignature* LookupSignature(const TypeInfoFlags flags, const C8DynString& name) noexcept
+    {
+        return flags.IsFunction && name.Length() != 0 ? InternFunctionSignature(name) : nullptr;
+    }
 private:
     uSys m_Size;
     uSys m_Id;
     TypeInfoFlags m_Flags;
     C8DynString m_Name;
     const TypeInfo* m_ChainType;
+    const FunctionSignature* m_Signature;
+    TypeInfoPrimitive m_Primitive;
 };
 
 namespace TypeInfoExt {
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <Objects.hpp>
+#include <NumTypes.hpp>
+#include <cstddef>
+#include <new>
+#include <type_traits>
+
+namespace tau::ir::ssa {
+
+/**
+ * \brief A bump allocator for the scratch memory of a transformation.
+ *
+ *   Memory is carved out of large chunks and is only given back all at
+ * once by Reset. Reset keeps the memory around, if more than one chunk
+ * was needed they are merged into a single chunk. Converting function
+ * after function with the same arena stops touching the heap once the
+ * largest function has been seen.
+ */
+class SsaArena final
+{
+    DELETE_CM(SsaArena);
+public:
+    SsaArena(uSys initialChunkSize = 64 * 1024) noexcept;
+    ~SsaArena() noexcept;
+
+    [[nodiscard]] void* Allocate(uSys size, uSys alignment = alignof(::std::max_align_t)) noexcept;
+
+    /**
+     *   Resizes an allocation. The most recent allocation is resized in
+     * place if the chunk has room, otherwise the data is copied to a new
+     * allocation and the old one is abandoned until the next Reset.
+     */
+    [[nodiscard]] void* Reallocate(void* pointer, uSys oldSize, uSys newSize, uSys alignment = alignof(::std::max_align_t)) noexcept;
+
+    /**
+     * Only the most recent allocation can be given back before a Reset.
+     */
+    void Deallocate(void* pointer, uSys size) noexcept;
+
+    void Reset() noexcept;
+
+    [[nodiscard]] uSys BytesReserved() const noexcept { return m_BytesReserved; }
+    [[nodiscard]] uSys HeapAllocationCount() const noexcept { return m_HeapAllocationCount; }
+private:
+    struct Chunk final
+    {
+        Chunk* Previous;
+        uSys Size;
+    };
+private:
+    [[nodiscard]] bool NewChunk(uSys size) noexcept;
+    void FreeChunks() noexcept;
+private:
+    Chunk* m_Head;
+    uPtr m_Current;
+    uPtr m_End;
+    uPtr m_LastAllocation;
+    uSys m_ChunkSize;
+    uSys m_BytesReserved;
+    uSys m_HeapAllocationCount;
+};
+
+/**
+ *   Adapts SsaArena for the standard containers. Without an arena this
+ * falls back to the global heap, so containers that outlive the arena
+ * can share a type with the scratch ones.
+ */
+template<typename T>
+class SsaArenaAllocator
+{
+public:
+    using value_type = T;
+    using propagate_on_container_move_assignment = ::std::true_type;
+    using propagate_on_container_swap = ::std::true_type;
+    using is_always_equal = ::std::false_type;
+public:
+    SsaArenaAllocator(SsaArena* const arena = nullptr) noexcept
+        : m_Arena(arena)
+    { }
+
+    template<typename U>
+    SsaArenaAllocator(const SsaArenaAllocator<U>& other) noexcept
+        : m_Arena(other.Arena())
+    { }
+
+    [[nodiscard]] T* allocate(const uSys count) noexcept
+    {
+        if(m_Arena)
+        {
+            return static_cast<T*>(m_Arena->Allocate(count * sizeof(T), alignof(T)));
+        }
+
+        return static_cast<T*>(::operator new(count * sizeof(T), ::std::nothrow));
+    }
+
+    void deallocate(T* const pointer, const uSys count) noexcept
+    {
+        if(m_Arena)
+        {
+            m_Arena->Deallocate(pointer, count * sizeof(T));
+        }
+        else
+        {
+            ::operator delete(pointer);
+        }
+    }
+
+    [[nodiscard]] SsaArena* Arena() const noexcept { return m_Arena; }
+
+    template<typename U>
+    [[nodiscard]] bool operator==(const SsaArenaAllocator<U>& other) const noexcept { return m_Arena == other.Arena(); }
+
+    template<typename U>
+    [[nodiscard]] bool operator!=(const SsaArenaAllocator<U>& other) const noexcept { return m_Arena != other.Arena(); }
+private:
+    SsaArena* m_Arena;
+};
+
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <Objects.hpp>
+#include <NumTypes.hpp>
+#include <vector>
+
+#include "SsaTypes.hpp"
+#include "TauIR/Module.hpp"
+
+namespace tau::ir::ssa {
+
+/**
+ * \brief The calls between the functions of a module.
+ *
+ *   The callees of every function are read from its SSA and stored in
+ * compressed rows indexed by function, each callee once. Calls into
+ * other modules are not part of the graph.
+ *
+ *   Function pointers are plain function indices, so an indirect call
+ * could call any function of the module. Indirect calls are only flagged
+ * on the caller, they are left out of the rows and the components. A
+ * function without SSA is flagged the same way.
+ *
+ *   A function is reachable if it can be called, directly or indirectly,
+ * from the entry point, the first function, or from an export.
+ *
+ *   The functions are also grouped into strongly connected components,
+ * functions that can reach each other through calls share a component.
+ * BottomUpOrder lists every function with its callees before it, aside
+ * from those in its own component, this is the order to optimize in so
+ * that callees are done before they are inlined.
+ */
+class SsaCallGraph final
+{
+    DEFAULT_CONSTRUCT_PU(SsaCallGraph);
+    DEFAULT_DESTRUCT(SsaCallGraph);
+    DEFAULT_CM_PU(SsaCallGraph);
+public:
+    static constexpr u32 InvalidIndex = static_cast<u32>(-1);
+public:
+    void Build(const ModuleRef& module, const SsaCustomTypeRegistry& registry) noexcept;
+
+    [[nodiscard]] u32 FunctionCount() const noexcept { return static_cast<u32>(m_Components.size()); }
+    [[nodiscard]] u32 ComponentCount() const noexcept { return m_ComponentCount; }
+
+    [[nodiscard]] const u32* CalleesBegin(const u32 function) const noexcept { return m_Callees.data() + m_CalleeOffsets[function]; }
+    [[nodiscard]] const u32* CalleesEnd(const u32 function) const noexcept { return m_Callees.data() + m_CalleeOffsets[function + 1]; }
+    [[nodiscard]] u32 CalleeCount(const u32 function) const noexcept { return m_CalleeOffsets[function + 1] - m_CalleeOffsets[function]; }
+
+    /**
+     * The component of the function, components are numbered bottom up.
+     */
+    [[nodiscard]] u32 Component(const u32 function) const noexcept { return function < FunctionCount() ? m_Components[function] : InvalidIndex; }
+
+    /**
+     * Whether both functions can reach each other, a function is always in the same component as itself.
+     */
+    [[nodiscard]] bool IsSameComponent(const u32 a, const u32 b) const noexcept { return a < FunctionCount() && b < FunctionCount() && m_Components[a] == m_Components[b]; }
+
+    /**
+     * Whether the function can call itself, directly or through other functions.
+     */
+    [[nodiscard]] bool IsRecursive(u32 function) const noexcept;
+
+    [[nodiscard]] const ::std::vector<u32>& BottomUpOrder() const noexcept { return m_BottomUpOrder; }
+
+    /**
+     * Whether the function makes a CallInd or CallIndExt, or has no SSA to tell.
+     */
+    [[nodiscard]] bool CallsIndirectly(const u32 function) const noexcept { return function < FunctionCount() && m_CallsIndirectly[function] != 0; }
+
+    [[nodiscard]] bool IsReachable(const u32 function) const noexcept { return function < FunctionCount() && m_Reachable[function] != 0; }
+    [[nodiscard]] u32 ReachableCount() const noexcept { return m_ReachableCount; }
+
+    /**
+     *   The index of every function once the unreachable functions are
+     * removed, InvalidIndex for those that are. The order is kept.
+     */
+    [[nodiscard]] ::std::vector<u32> CompactedIndices() const noexcept;
+
+    [[nodiscard]] uSys MemoryUsage() const noexcept
+    {
+        return (m_CalleeOffsets.capacity() + m_Callees.capacity() + m_Components.capacity() + m_BottomUpOrder.capacity()) * sizeof(u32) + m_CallsIndirectly.capacity() + m_Reachable.capacity();
+    }
+private:
+    void ComputeComponents() noexcept;
+    void ComputeReachable(const ModuleRef& module) noexcept;
+private:
+    // FunctionCount + 1 entries, the callees of function are [m_CalleeOffsets[function], m_CalleeOffsets[function + 1]).
+    ::std::vector<u32> m_CalleeOffsets;
+    ::std::vector<u32> m_Callees;
+    ::std::vector<u32> m_Components;
+    ::std::vector<u32> m_BottomUpOrder;
+    ::std::vector<u8> m_CallsIndirectly;
+    ::std::vector<u8> m_Reachable;
+    u32 m_ComponentCount = 0;
+    u32 m_ReachableCount = 0;
+};
+
+}
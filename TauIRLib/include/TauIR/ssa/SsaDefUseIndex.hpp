@@ -0,0 +1,83 @@
+#pragma once
+
+#include <Objects.hpp>
+#include <NumTypes.hpp>
+#include <vector>
+
+#include "SsaTypes.hpp"
+
+namespace tau::ir::ssa {
+
+/**
+ * \brief The users of every var, stored in compressed sparse rows.
+ *
+ *   Uses are first collected as a flat list of pairs, Build then turns
+ * them into an offset array indexed by VarId and a single array of
+ * users. The users of a var are contiguous, in the order they were
+ * added. Uses of vars above the max id, and of arguments, are ignored.
+ *
+ *   An instruction that has to be kept no matter what, like a store or a
+ * call, is recorded as a use of a var by itself.
+ */
+class SsaDefUseIndex final
+{
+    DEFAULT_CONSTRUCT_PU(SsaDefUseIndex);
+    DEFAULT_DESTRUCT(SsaDefUseIndex);
+    DEFAULT_CM_PU(SsaDefUseIndex);
+public:
+    /**
+     * Clears the index, the capacity is kept.
+     */
+    void Reset(VarId maxId) noexcept;
+
+    void AddUse(VarId var, VarId user) noexcept;
+
+    /**
+     * Builds the rows from the uses added since the last Reset.
+     */
+    void Build() noexcept;
+
+    [[nodiscard]] VarId MaxVarId() const noexcept { return m_MaxVarId; }
+    [[nodiscard]] uSys UseCount() const noexcept { return m_Users.size(); }
+
+    [[nodiscard]] u32 UseCount(const VarId var) const noexcept
+    {
+        return var <= m_MaxVarId && !m_Offsets.empty() ? m_Offsets[var + 1] - m_Offsets[var] : 0;
+    }
+
+    [[nodiscard]] const VarId* UsersBegin(const VarId var) const noexcept
+    {
+        return var <= m_MaxVarId && !m_Offsets.empty() ? m_Users.data() + m_Offsets[var] : nullptr;
+    }
+
+    [[nodiscard]] const VarId* UsersEnd(const VarId var) const noexcept
+    {
+        return var <= m_MaxVarId && !m_Offsets.empty() ? m_Users.data() + m_Offsets[var + 1] : nullptr;
+    }
+
+    [[nodiscard]] bool IsUsed(const VarId var) const noexcept { return UseCount(var) != 0; }
+
+    /**
+     * Whether the var is used by itself, making it a root.
+     */
+    [[nodiscard]] bool IsRoot(VarId var) const noexcept;
+
+    [[nodiscard]] uSys MemoryUsage() const noexcept
+    {
+        return m_Offsets.capacity() * sizeof(u32) + m_Users.capacity() * sizeof(VarId) + m_PendingUses.capacity() * sizeof(PendingUse);
+    }
+private:
+    struct PendingUse final
+    {
+        VarId Var;
+        VarId User;
+    };
+private:
+    VarId m_MaxVarId = 0;
+    // maxId + 2 entries, the users of var are [m_Offsets[var], m_Offsets[var + 1]).
+    ::std::vector<u32> m_Offsets;
+    ::std::vector<VarId> m_Users;
+    ::std::vector<PendingUse> m_PendingUses;
+};
+
+}
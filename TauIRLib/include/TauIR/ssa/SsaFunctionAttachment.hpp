@@ -18,6 +18,13 @@ public:
 
     [[nodiscard]] const SsaWriter& Writer() const noexcept { return m_Writer; }
     [[nodiscard]]       SsaWriter& Writer()       noexcept { return m_Writer; }
+
+    [[nodiscard]] const char* AttachmentName() const noexcept override { return "SsaWriterFunctionAttachment"; }
+
+    [[nodiscard]] uSys MemoryUsage() const noexcept override
+    {
+        return sizeof(*this) + m_Writer.Capacity() + m_Writer.VarTypeMap().capacity() * sizeof(SsaCustomType);
+    }
 private:
     SsaWriter m_Writer;
 };
@@ -29,10 +36,11 @@ class SsaFunctionAttachment final : public FunctionAttachment
     DELETE_CM(SsaFunctionAttachment);
     RTT_IMPL(SsaFunctionAttachment, FunctionAttachment);
 public:
-    SsaFunctionAttachment(const u8* const buffer, const uSys bufferSize, const VarId maxVarId, const ::std::vector<SsaCustomType>& varTypeMap) noexcept
+    template<typename Allocator>
+    SsaFunctionAttachment(const u8* const buffer, const uSys bufferSize, const VarId maxVarId, const ::std::vector<SsaCustomType, Allocator>& varTypeMap) noexcept
         : m_Buffer(bufferSize)
         , m_MaxVarId(maxVarId)
-        , m_VarTypeMap(varTypeMap)
+        , m_VarTypeMap(varTypeMap.begin(), varTypeMap.end())
     {
         m_Buffer.MemCpyAll(buffer);
     }
@@ -41,6 +49,12 @@ public:
     [[nodiscard]] VarId MaxVarId() const noexcept { return m_MaxVarId; }
     [[nodiscard]] const ::std::vector<SsaCustomType>& VarTypeMap() const noexcept { return m_VarTypeMap; }
 
+    [[nodiscard]] const char* AttachmentName() const noexcept override { return "SsaFunctionAttachment"; }
+
+    [[nodiscard]] uSys MemoryUsage() const noexcept override
+    {
+        return sizeof(*this) + m_Buffer.Size() + m_VarTypeMap.capacity() * sizeof(SsaCustomType);
+    }
 private:
     DynArray<u8> m_Buffer;
     VarId m_MaxVarId;
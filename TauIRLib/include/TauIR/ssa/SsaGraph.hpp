@@ -0,0 +1,235 @@
+#pragma once
+
+#include <Objects.hpp>
+#include <NumTypes.hpp>
+#include <vector>
+
+#include "SsaOpcodes.hpp"
+#include "SsaTypes.hpp"
+#include "SsaWriter.hpp"
+#include "TauIR/Opcodes.hpp"
+
+namespace tau::ir {
+
+class Function;
+
+}
+
+namespace tau::ir::ssa {
+
+/**
+ * \brief The SSA of a function decoded into memory.
+ *
+ *   Instructions are stored as parallel arrays indexed by instruction,
+ * everything of variable length lives in shared pools that the
+ * instructions index into. The operands of an instruction are the vars
+ * it reads, in the order they are encoded:
+ *
+ *   AssignVariable, casts, Load, Ret: [var]
+ *   StoreV: [destination, source]
+ *   StoreI: [destination]
+ *   ComputePtr: [base, index]
+ *   BinOp/Comp VtoV: [a, b], VtoI: [b], ItoV: [a]
+ *   Split: [a]
+ *   Join: [vars...]
+ *   Branch: [label]
+ *   BranchCond: [labelTrue, labelFalse, condition]
+ *   Call, CallExt: [parameters...]
+ *   CallInd: [functionPointer, parameters...]
+ *   CallIndExt: [functionPointer, modulePointer, parameters...]
+ *   Phi: [labels..., vars...]
+ *
+ *   Immediates are stored in the immediate pool, as are the multiplier
+ * and offset of ComputePtr. The var ids are those of the buffer that was
+ * decoded. Removing an instruction leaves a Nop behind, Encode drops
+ * those and renumbers the vars that are left.
+ */
+class SsaGraph final
+{
+    DEFAULT_CONSTRUCT_PU(SsaGraph);
+    DEFAULT_DESTRUCT(SsaGraph);
+    DEFAULT_CM_PU(SsaGraph);
+public:
+    static constexpr u32 InvalidIndex = static_cast<u32>(-1);
+
+    struct Block final
+    {
+        u32 Begin;
+        u32 End;
+        // 0 if the block doesn't start with a label.
+        VarId Label;
+        u32 SuccessorBegin;
+        u32 SuccessorCount;
+        u32 PredecessorBegin;
+        u32 PredecessorCount;
+    };
+public:
+    [[nodiscard]] bool Decode(const u8* codePtr, uSys size, VarId maxId, const SsaCustomTypeRegistry& registry) noexcept;
+
+    /**
+     * Decodes the SSA attached to the function.
+     */
+    [[nodiscard]] bool Decode(const Function* function, const SsaCustomTypeRegistry& registry) noexcept;
+
+    /**
+     *   Writes the graph to the writer, vars are renumbered in order.
+     * Fails if an operand references a var that was removed, or if the
+     * parameters of a call are no longer consecutive.
+     */
+    [[nodiscard]] bool Encode(SsaWriter& writer) const noexcept;
+
+    /**
+     *   Writes the instructions in the given order, each instruction must
+     * appear at most once. Vars are renumbered in the new order, so every
+     * var has to be defined before an instruction other than a phi uses it.
+     */
+    [[nodiscard]] bool Encode(SsaWriter& writer, const ::std::vector<u32>& order) const noexcept;
+
+    /**
+     *   Recomputes the blocks and the definitions of the vars. Needed
+     * after changing branches, or the results of instructions.
+     */
+    void RebuildBlocks() noexcept;
+
+    void Clear() noexcept;
+
+    [[nodiscard]] u32 InstructionCount() const noexcept { return static_cast<u32>(m_Opcodes.size()); }
+    [[nodiscard]] VarId MaxVarId() const noexcept { return m_MaxVarId; }
+    [[nodiscard]] uSys EncodedSize() const noexcept { return m_EncodedSize; }
+
+    [[nodiscard]] SsaOpcode Opcode(const u32 inst) const noexcept { return m_Opcodes[inst]; }
+    [[nodiscard]] SsaBinaryOperation BinaryOperation(const u32 inst) const noexcept { return static_cast<SsaBinaryOperation>(m_Operations[inst]); }
+    [[nodiscard]] CompareCondition Condition(const u32 inst) const noexcept { return static_cast<CompareCondition>(m_Operations[inst]); }
+    [[nodiscard]] SsaCustomType Type(const u32 inst) const noexcept { return m_Types[inst]; }
+    /**
+     * The old type of a cast.
+     */
+    [[nodiscard]] SsaCustomType SourceType(const u32 inst) const noexcept { return m_SourceTypes[inst]; }
+    /**
+     * The first var defined by the instruction, or 0 if it defines none.
+     */
+    [[nodiscard]] VarId Result(const u32 inst) const noexcept { return m_Results[inst]; }
+    [[nodiscard]] u32 ResultCount(const u32 inst) const noexcept { return m_ResultCounts[inst]; }
+    [[nodiscard]] u32 OperandCount(const u32 inst) const noexcept { return m_OperandCounts[inst]; }
+    [[nodiscard]] const VarId* Operands(const u32 inst) const noexcept { return m_Operands.data() + m_OperandBegins[inst]; }
+    [[nodiscard]] VarId Operand(const u32 inst, const u32 index) const noexcept { return m_Operands[m_OperandBegins[inst] + index]; }
+    /**
+     * The part types of a Split or a Join.
+     */
+    [[nodiscard]] const SsaCustomType* TypeList(const u32 inst) const noexcept { return m_TypePool.data() + m_TypeListBegins[inst]; }
+    [[nodiscard]] const u8* Immediate(const u32 inst) const noexcept { return m_ImmediatePool.data() + m_ImmediateBegins[inst]; }
+    [[nodiscard]] u32 ImmediateSize(const u32 inst) const noexcept { return m_ImmediateSizes[inst]; }
+    /**
+     * The function index of a Call or CallExt.
+     */
+    [[nodiscard]] u32 FunctionIndex(const u32 inst) const noexcept { return m_FunctionIndices[inst]; }
+    [[nodiscard]] u16 ModuleIndex(const u32 inst) const noexcept { return m_ModuleIndices[inst]; }
+    [[nodiscard]] u32 InstructionBlock(const u32 inst) const noexcept { return m_InstBlocks[inst]; }
+
+    /**
+     * The index of the first parameter in the operands of a call.
+     */
+    [[nodiscard]] u32 ParameterOffset(const u32 inst) const noexcept
+    {
+        switch(m_Opcodes[inst])
+        {
+            case SsaOpcode::CallInd: return 1;
+            case SsaOpcode::CallIndExt: return 2;
+            default: return 0;
+        }
+    }
+
+    [[nodiscard]] u32 ParameterCount(const u32 inst) const noexcept { return m_OperandCounts[inst] - ParameterOffset(inst); }
+
+    /**
+     * The instruction that defines the var, or InvalidIndex for arguments and undefined vars.
+     */
+    [[nodiscard]] u32 Definition(const VarId var) const noexcept { return var < m_VarDefs.size() ? m_VarDefs[var] : InvalidIndex; }
+    [[nodiscard]] SsaCustomType VarType(VarId var) const noexcept;
+
+    [[nodiscard]] const ::std::vector<Block>& Blocks() const noexcept { return m_Blocks; }
+    [[nodiscard]] const u32* Successors(const u32 block) const noexcept { return m_Edges.data() + m_Blocks[block].SuccessorBegin; }
+    [[nodiscard]] const u32* Predecessors(const u32 block) const noexcept { return m_Edges.data() + m_Blocks[block].PredecessorBegin; }
+    [[nodiscard]] u32 LabelBlock(const VarId label) const noexcept { return label < m_LabelBlocks.size() ? m_LabelBlocks[label] : InvalidIndex; }
+
+    void SetOperand(const u32 inst, const u32 index, const VarId var) noexcept { m_Operands[m_OperandBegins[inst] + index] = var; }
+    void SetFunctionIndex(const u32 inst, const u32 functionIndex) noexcept { m_FunctionIndices[inst] = functionIndex; }
+
+    /**
+     *   Replaces the operands of an instruction. The old range is reused
+     * if the new operands fit.
+     */
+    void SetOperands(u32 inst, const VarId* vars, u32 count) noexcept;
+    void SetImmediate(u32 inst, const void* value, u32 size) noexcept;
+
+    /**
+     * @return The number of operands that were replaced.
+     */
+    u32 ReplaceAllUses(VarId from, VarId to) noexcept;
+
+    /**
+     *   Turns the instruction into a copy of a var, the result and its
+     * type are kept.
+     */
+    void MakeAssignVariable(u32 inst, VarId var) noexcept;
+
+    /**
+     *   Turns the instruction into an immediate, the result and its type
+     * are kept.
+     */
+    void MakeAssignImmediate(u32 inst, const void* value, u32 size) noexcept;
+
+    /**
+     *   Adds an AssignImmediate of a new var after the last instruction.
+     * It isn't part of any block, Encode with an order to place it.
+     *
+     * @return The new var.
+     */
+    VarId AppendAssignImmediate(SsaCustomType type, const void* value, u32 size) noexcept;
+
+    /**
+     *   Turns the instruction into a Nop. Anything still using its
+     * results will fail to encode.
+     */
+    void Remove(u32 inst) noexcept;
+private:
+    /**
+     * Without an order the instructions are written as they are stored.
+     */
+    [[nodiscard]] bool EncodeInOrder(SsaWriter& writer, const u32* order, u32 count) const noexcept;
+
+    u32 AddInstruction(SsaOpcode opcode, VarId result, u32 resultCount) noexcept;
+    void AddOperand(VarId var) noexcept;
+    void AddImmediate(const void* value, u32 size) noexcept;
+private:
+    ::std::vector<SsaOpcode> m_Opcodes;
+    ::std::vector<u8> m_Operations;
+    ::std::vector<SsaCustomType> m_Types;
+    ::std::vector<SsaCustomType> m_SourceTypes;
+    ::std::vector<VarId> m_Results;
+    ::std::vector<u32> m_ResultCounts;
+    ::std::vector<u32> m_OperandBegins;
+    ::std::vector<u32> m_OperandCounts;
+    ::std::vector<u32> m_TypeListBegins;
+    ::std::vector<u32> m_ImmediateBegins;
+    ::std::vector<u32> m_ImmediateSizes;
+    ::std::vector<u32> m_FunctionIndices;
+    ::std::vector<u16> m_ModuleIndices;
+    ::std::vector<u32> m_InstBlocks;
+
+    ::std::vector<VarId> m_Operands;
+    ::std::vector<SsaCustomType> m_TypePool;
+    ::std::vector<u8> m_ImmediatePool;
+
+    ::std::vector<Block> m_Blocks;
+    ::std::vector<u32> m_Edges;
+    ::std::vector<u32> m_LabelBlocks;
+    ::std::vector<u32> m_VarDefs;
+
+    VarId m_MaxVarId = 0;
+    uSys m_EncodedSize = 0;
+
+    friend class SsaGraphDecoder;
+};
+
+}
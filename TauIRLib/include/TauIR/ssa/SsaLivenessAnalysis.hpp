@@ -0,0 +1,376 @@
+#pragma once
+
+#include <Objects.hpp>
+#include <NumTypes.hpp>
+#include <vector>
+
+#include "TauIR/Function.hpp"
+#include "SsaTypes.hpp"
+#include "SsaVisitor.hpp"
+
+namespace tau::ir::ssa {
+
+/**
+ * \brief The live vars of every block, and the vars each instruction kills.
+ *
+ *   Blocks are numbered in code order. A block starts at a label, after a
+ * terminator, or at the first instruction. Instructions are numbered the
+ * way SsaWriter numbers them, every opcode including labels and nops.
+ *
+ *   The live sets are bit vectors of MaxVarId + 1 bits, bit n is var n,
+ * stored as WordCount() 64 bit words per block. Arguments are never in a
+ * set. The incoming vars of a phi are used on the edge from their
+ * predecessor, so they are live out of the predecessor but not live in to
+ * the block of the phi. A var used on a path that never defines it, like
+ * the incoming value of a local that was never written on that path, is
+ * live all the way back to the first block.
+ *
+ *   An instruction kills the vars it uses for the last time on its path,
+ * and the vars it defines that are never used. A var that is only used by
+ * a phi is never killed by an instruction.
+ */
+class SsaLivenessAnalysisAttachment final : public FunctionAttachment
+{
+    DEFAULT_CONSTRUCT_PU(SsaLivenessAnalysisAttachment);
+    DEFAULT_DESTRUCT(SsaLivenessAnalysisAttachment);
+    DELETE_CM(SsaLivenessAnalysisAttachment);
+    RTT_IMPL(SsaLivenessAnalysisAttachment, FunctionAttachment);
+public:
+    SsaLivenessAnalysisAttachment(const VarId maxVarId, ::std::vector<u32>&& blockStarts, ::std::vector<u64>&& liveIn, ::std::vector<u64>&& liveOut, ::std::vector<u32>&& killOffsets, ::std::vector<VarId>&& kills) noexcept
+        : m_MaxVarId(maxVarId)
+        , m_WordCount(WordCount(maxVarId))
+        , m_BlockStarts(::std::move(blockStarts))
+        , m_LiveIn(::std::move(liveIn))
+        , m_LiveOut(::std::move(liveOut))
+        , m_KillOffsets(::std::move(killOffsets))
+        , m_Kills(::std::move(kills))
+    { }
+
+    [[nodiscard]] static u32 WordCount(const VarId maxVarId) noexcept { return (maxVarId + 1 + 63) / 64; }
+
+    [[nodiscard]] VarId MaxVarId() const noexcept { return m_MaxVarId; }
+    [[nodiscard]] u32 WordCount() const noexcept { return m_WordCount; }
+    [[nodiscard]] u32 BlockCount() const noexcept { return static_cast<u32>(m_BlockStarts.size()); }
+    [[nodiscard]] u32 InstructionCount() const noexcept { return m_KillOffsets.empty() ? 0 : static_cast<u32>(m_KillOffsets.size() - 1); }
+
+    /**
+     * The index of the first instruction of the block.
+     */
+    [[nodiscard]] u32 BlockStart(const u32 block) const noexcept { return m_BlockStarts[block]; }
+    [[nodiscard]] u32 BlockEnd(const u32 block) const noexcept { return block + 1 < BlockCount() ? m_BlockStarts[block + 1] : InstructionCount(); }
+    [[nodiscard]] u32 BlockOf(u32 instruction) const noexcept;
+
+    [[nodiscard]] const u64* LiveIn(const u32 block) const noexcept { return m_LiveIn.data() + static_cast<uSys>(block) * m_WordCount; }
+    [[nodiscard]] const u64* LiveOut(const u32 block) const noexcept { return m_LiveOut.data() + static_cast<uSys>(block) * m_WordCount; }
+
+    [[nodiscard]] bool IsLiveIn(const u32 block, const VarId var) const noexcept { return Contains(LiveIn(block), var); }
+    [[nodiscard]] bool IsLiveOut(const u32 block, const VarId var) const noexcept { return Contains(LiveOut(block), var); }
+
+    [[nodiscard]] const VarId* KillsBegin(const u32 instruction) const noexcept { return m_Kills.data() + m_KillOffsets[instruction]; }
+    [[nodiscard]] const VarId* KillsEnd(const u32 instruction) const noexcept { return m_Kills.data() + m_KillOffsets[instruction + 1]; }
+    [[nodiscard]] bool IsKilled(u32 instruction, VarId var) const noexcept;
+
+    [[nodiscard]] const char* AttachmentName() const noexcept override { return "SsaLivenessAnalysisAttachment"; }
+
+    [[nodiscard]] uSys MemoryUsage() const noexcept override
+    {
+        return sizeof(*this) + m_BlockStarts.capacity() * sizeof(u32) + (m_LiveIn.capacity() + m_LiveOut.capacity()) * sizeof(u64) + m_KillOffsets.capacity() * sizeof(u32) + m_Kills.capacity() * sizeof(VarId);
+    }
+private:
+    [[nodiscard]] bool Contains(const u64* const set, const VarId var) const noexcept
+    {
+        return (var & 0x80000000) == 0 && var <= m_MaxVarId && (set[var / 64] & (1ull << (var % 64))) != 0;
+    }
+private:
+    VarId m_MaxVarId = 0;
+    u32 m_WordCount = 0;
+    ::std::vector<u32> m_BlockStarts;
+    ::std::vector<u64> m_LiveIn;
+    ::std::vector<u64> m_LiveOut;
+    // InstructionCount + 1 entries, the kills of instruction n are [m_KillOffsets[n], m_KillOffsets[n + 1]).
+    ::std::vector<u32> m_KillOffsets;
+    ::std::vector<VarId> m_Kills;
+};
+
+/**
+ * \brief Computes the live sets and kills of SsaLivenessAnalysisAttachment.
+ *
+ *   The traversal records the uses and definitions of every instruction
+ * and the edges between blocks. PostTraversal then solves the usual
+ * backwards data flow equations, visiting blocks in reverse until nothing
+ * changes, with whole words of the bit vectors combined at once. Finally
+ * each block is walked backwards from its live out set to find the kills.
+ */
+// ReSharper disable CppHidingFunction
+class SsaLivenessAnalysisVisitor final : public SsaVisitor<SsaLivenessAnalysisVisitor>
+{
+    DEFAULT_DESTRUCT(SsaLivenessAnalysisVisitor);
+    DELETE_CM(SsaLivenessAnalysisVisitor);
+public:
+    SsaLivenessAnalysisVisitor(const SsaCustomTypeRegistry& registry) noexcept
+        : SsaVisitor(registry)
+        , m_MaxVarId(0)
+        , m_WordCount(0)
+        , m_InstructionCount(0)
+        , m_Terminated(false)
+    { }
+
+    [[nodiscard]] VarId MaxVarId() const noexcept { return m_MaxVarId; }
+    [[nodiscard]] u32 WordCount() const noexcept { return m_WordCount; }
+    [[nodiscard]] u32 BlockCount() const noexcept { return static_cast<u32>(m_BlockStarts.size()); }
+    [[nodiscard]] u32 InstructionCount() const noexcept { return m_InstructionCount; }
+
+    /**
+     * The number of rounds over the blocks the data flow took to settle.
+     */
+    [[nodiscard]] u32 IterationCount() const noexcept { return m_IterationCount; }
+
+    void UpdateAttachment(Function* function) noexcept;
+public:
+    bool PreTraversal(const u8* codePtr, uSys size, VarId maxId) noexcept;
+    bool PostTraversal() noexcept;
+
+    bool VisitNop() noexcept
+    {
+        BeginInstruction();
+        return true;
+    }
+
+    bool VisitLabel(VarId label) noexcept;
+
+    bool VisitAssignImmediate(const VarId newVar, const SsaCustomType type, const void* const value, const uSys size) noexcept
+    {
+        BeginInstruction();
+        Define(newVar, 1);
+        return true;
+    }
+
+    bool VisitAssignVar(const VarId newVar, const SsaCustomType type, const VarId var) noexcept
+    {
+        BeginInstruction();
+        Use(var);
+        Define(newVar, 1);
+        return true;
+    }
+
+    bool VisitExpandSX(const VarId newVar, const SsaCustomType newType, const SsaCustomType oldType, const VarId var) noexcept
+    {
+        return VisitAssignVar(newVar, newType, var);
+    }
+
+    bool VisitExpandZX(const VarId newVar, const SsaCustomType newType, const SsaCustomType oldType, const VarId var) noexcept
+    {
+        return VisitAssignVar(newVar, newType, var);
+    }
+
+    bool VisitTrunc(const VarId newVar, const SsaCustomType newType, const SsaCustomType oldType, const VarId var) noexcept
+    {
+        return VisitAssignVar(newVar, newType, var);
+    }
+
+    bool VisitRCast(const VarId newVar, const SsaCustomType newType, const SsaCustomType oldType, const VarId var) noexcept
+    {
+        return VisitAssignVar(newVar, newType, var);
+    }
+
+    bool VisitBCast(const VarId newVar, const SsaCustomType newType, const SsaCustomType oldType, const VarId var) noexcept
+    {
+        return VisitAssignVar(newVar, newType, var);
+    }
+
+    bool VisitLoad(const VarId newVar, const SsaCustomType type, const VarId var) noexcept
+    {
+        return VisitAssignVar(newVar, type, var);
+    }
+
+    bool VisitStoreV(const SsaCustomType type, const VarId destination, const VarId source) noexcept
+    {
+        BeginInstruction();
+        Use(destination);
+        Use(source);
+        return true;
+    }
+
+    bool VisitStoreI(const SsaCustomType type, const VarId destination, const void* const value, const uSys size) noexcept
+    {
+        BeginInstruction();
+        Use(destination);
+        return true;
+    }
+
+    bool VisitComputePtr(const VarId newVar, const VarId base, const VarId index, const i8 multiplier, const i16 offset) noexcept
+    {
+        BeginInstruction();
+        Use(base);
+        Use(index);
+        Define(newVar, 1);
+        return true;
+    }
+
+    bool VisitBinOpVToV(const VarId newVar, const SsaBinaryOperation operation, const SsaCustomType type, const VarId a, const VarId b) noexcept
+    {
+        BeginInstruction();
+        Use(a);
+        Use(b);
+        Define(newVar, 1);
+        return true;
+    }
+
+    bool VisitBinOpVToI(const VarId newVar, const SsaBinaryOperation operation, const SsaCustomType type, const void* const a, const uSys aSize, const VarId b) noexcept
+    {
+        return VisitAssignVar(newVar, type, b);
+    }
+
+    bool VisitBinOpIToV(const VarId newVar, const SsaBinaryOperation operation, const SsaCustomType type, const VarId a, const void* const b, const uSys bSize) noexcept
+    {
+        return VisitAssignVar(newVar, type, a);
+    }
+
+    bool VisitSplit(const VarId baseIndex, const SsaCustomType aType, const VarId a, const uSys splitCount, const SsaCustomType* const splitTypes) noexcept
+    {
+        BeginInstruction();
+        Use(a);
+        Define(baseIndex, static_cast<u32>(splitCount));
+        return true;
+    }
+
+    bool VisitJoin(const VarId newVar, const SsaCustomType newType, const uSys joinCount, const SsaCustomType* const joinTypes, const VarId* const joinVars) noexcept
+    {
+        BeginInstruction();
+
+        for(uSys i = 0; i < joinCount; ++i)
+        {
+            Use(joinVars[i]);
+        }
+
+        Define(newVar, 1);
+        return true;
+    }
+
+    bool VisitCompVToV(const VarId newVar, const CompareCondition condition, const SsaCustomType type, const VarId a, const VarId b) noexcept
+    {
+        return VisitBinOpVToV(newVar, SsaBinaryOperation::Add, type, a, b);
+    }
+
+    bool VisitCompVToI(const VarId newVar, const CompareCondition condition, const SsaCustomType type, const void* const a, const uSys aSize, const VarId b) noexcept
+    {
+        return VisitAssignVar(newVar, type, b);
+    }
+
+    bool VisitCompIToV(const VarId newVar, const CompareCondition condition, const SsaCustomType type, const VarId a, const void* const b, const uSys bSize) noexcept
+    {
+        return VisitAssignVar(newVar, type, a);
+    }
+
+    bool VisitCall(const VarId newVar, const u32 functionIndex, const VarId baseIndex, const u32 parameterCount) noexcept
+    {
+        BeginInstruction();
+        UseParameters(baseIndex, parameterCount);
+        Define(newVar, 1);
+        return true;
+    }
+
+    bool VisitCallExt(const VarId newVar, const u32 functionIndex, const VarId baseIndex, const u32 parameterCount, const u16 moduleIndex) noexcept
+    {
+        return VisitCall(newVar, functionIndex, baseIndex, parameterCount);
+    }
+
+    bool VisitCallInd(const VarId newVar, const VarId functionPointer, const VarId baseIndex, const u32 parameterCount) noexcept
+    {
+        BeginInstruction();
+        Use(functionPointer);
+        UseParameters(baseIndex, parameterCount);
+        Define(newVar, 1);
+        return true;
+    }
+
+    bool VisitCallIndExt(const VarId newVar, const VarId functionPointer, const VarId baseIndex, const u32 parameterCount, const VarId modulePointer) noexcept
+    {
+        BeginInstruction();
+        Use(functionPointer);
+        Use(modulePointer);
+        UseParameters(baseIndex, parameterCount);
+        Define(newVar, 1);
+        return true;
+    }
+
+    bool VisitRet(const SsaCustomType returnType, const VarId var) noexcept
+    {
+        BeginInstruction();
+        Use(var);
+        m_Terminated = true;
+        return true;
+    }
+
+    bool VisitBranch(VarId label) noexcept;
+    bool VisitBranchCond(VarId labelTrue, VarId labelFalse, VarId conditionVar) noexcept;
+    bool VisitPhi(VarId newVar, SsaCustomType type, uSys incomingCount, const VarId* labels, const VarId* vars) noexcept;
+private:
+    struct Edge final
+    {
+        u32 Block;
+        VarId Label;
+    };
+
+    struct PhiUse final
+    {
+        VarId Label;
+        VarId Var;
+    };
+private:
+    [[nodiscard]] bool IsTracked(const VarId var) const noexcept { return (var & 0x80000000) == 0 && var != 0 && var <= m_MaxVarId; }
+
+    [[nodiscard]] static bool Contains(const u64* const set, const VarId var) noexcept { return (set[var / 64] & (1ull << (var % 64))) != 0; }
+    static void Insert(u64* const set, const VarId var) noexcept { set[var / 64] |= 1ull << (var % 64); }
+    static void Erase(u64* const set, const VarId var) noexcept { set[var / 64] &= ~(1ull << (var % 64)); }
+
+    [[nodiscard]] u64* Row(::std::vector<u64>& sets, const u32 block) const noexcept { return sets.data() + static_cast<uSys>(block) * m_WordCount; }
+
+    void BeginInstruction() noexcept;
+    void AddInstruction() noexcept;
+    void StartBlock() noexcept;
+    void Use(VarId var) noexcept;
+    void UseParameters(VarId baseIndex, u32 parameterCount) noexcept;
+    void Define(VarId firstVar, u32 count) noexcept;
+
+    void BuildSuccessors() noexcept;
+    void ComputeLocalSets() noexcept;
+    void SolveDataFlow() noexcept;
+    void ComputeKills() noexcept;
+private:
+    VarId m_MaxVarId;
+    u32 m_WordCount;
+    u32 m_InstructionCount;
+    u32 m_IterationCount = 0;
+    bool m_Terminated;
+
+    // The first instruction of each block, and the block each label starts.
+    ::std::vector<u32> m_BlockStarts;
+    ::std::vector<u32> m_LabelBlocks;
+    // Branches are recorded by label as the target may not have been seen yet.
+    ::std::vector<Edge> m_Edges;
+    ::std::vector<u8> m_FallsThrough;
+    // The successors of each block in compressed rows.
+    ::std::vector<u32> m_SuccessorOffsets;
+    ::std::vector<u32> m_Successors;
+
+    // The uses of each instruction in compressed rows, and the vars it defines.
+    ::std::vector<u32> m_UseOffsets;
+    ::std::vector<VarId> m_Uses;
+    ::std::vector<VarId> m_DefBegins;
+    ::std::vector<u32> m_DefCounts;
+    // The incoming vars of phis, used at the end of the block of their label.
+    ::std::vector<PhiUse> m_PhiUses;
+
+    // One row of m_WordCount words per block.
+    ::std::vector<u64> m_UpwardUses;
+    ::std::vector<u64> m_Defs;
+    ::std::vector<u64> m_PhiOuts;
+    ::std::vector<u64> m_LiveIn;
+    ::std::vector<u64> m_LiveOut;
+
+    ::std::vector<u32> m_KillOffsets;
+    ::std::vector<VarId> m_Kills;
+};
+
+}
@@ -14,7 +14,12 @@ enum class SsaBinaryOperation : u8
     BitShiftLeft       = 0x05,
     BitShiftRight      = 0x06,
     BarrelShiftLeft    = 0x07,
-    BarrelShiftRight   = 0x08
+    BarrelShiftRight   = 0x08,
+    /**
+     *   The upper half of the double width product, signed or unsigned
+     * depending on the type.
+     */
+    MulHigh            = 0x09
 };
 
 enum class SsaOpcode : u16
@@ -47,6 +52,7 @@ enum class SsaOpcode : u16
     CallInd         = 0x0044,
     CallIndExt      = 0x0045,
     Ret             = 0x0046,
+    Phi             = 0x0047,
 };
 
 }
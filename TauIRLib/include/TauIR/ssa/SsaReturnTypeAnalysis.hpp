@@ -18,6 +18,9 @@ public:
     { }
 
     [[nodiscard]] const SsaCustomType& ReturnType() const noexcept { return m_ReturnType; }
+
+    [[nodiscard]] const char* AttachmentName() const noexcept override { return "SsaReturnTypeAnalysisAttachment"; }
+    [[nodiscard]] uSys MemoryUsage() const noexcept override { return sizeof(*this); }
 private:
     SsaCustomType m_ReturnType;
 };
@@ -214,6 +214,31 @@ public:
         return ret;
     }
 
+    /**
+     *   Registers a custom type for a TypeInfo. Converting to SSA finds it
+     * by the TypeInfo's id, which is a direct index rather than a search.
+     */
+    u32 RegisterTypeInfo(const uSys typeInfoId, const u32 size) noexcept
+    {
+        const u32 ret = RegisterType(size);
+
+        if(typeInfoId >= m_TypeInfoMap.size())
+        {
+            m_TypeInfoMap.resize(typeInfoId + 1, InvalidType);
+        }
+
+        m_TypeInfoMap[typeInfoId] = ret;
+        return ret;
+    }
+
+    /**
+     * @return The custom type registered for the TypeInfo id, or InvalidType.
+     */
+    [[nodiscard]] u32 FindTypeInfo(const uSys typeInfoId) const noexcept
+    {
+        return typeInfoId < m_TypeInfoMap.size() ? m_TypeInfoMap[typeInfoId] : InvalidType;
+    }
+
     [[nodiscard]] SsaCustomTypeDescriptor operator[](const u32 typeId) const noexcept
     {
         return m_TypeMap[typeId];
@@ -248,8 +273,12 @@ public:
         }
     }
 #endif
+public:
+    static inline constexpr u32 InvalidType = static_cast<u32>(-1);
 private:
     ::std::vector<TypeEntry> m_TypeMap;
+    // Indexed by TypeInfo id, TypeInfo ids are handed out densely.
+    ::std::vector<u32> m_TypeInfoMap;
 };
 
 }
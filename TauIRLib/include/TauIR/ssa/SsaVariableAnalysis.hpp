@@ -3,8 +3,13 @@
 #include "TauIR/Function.hpp"
 #include "SsaTypes.hpp"
 #include "SsaVisitor.hpp"
-#include "SsaReturnTypeAnalysis.hpp"
 #include <DynArray.hpp>
+#include <TUMaths.hpp>
+#include <algorithm>
+#include <functional>
+#include <queue>
+#include <utility>
+#include <vector>
 
 namespace tau::ir::ssa {
 
@@ -30,33 +35,65 @@ class SsaVariableAnalysisAttachment final : public FunctionAttachment
     DELETE_CM(SsaVariableAnalysisAttachment);
     RTT_IMPL(SsaVariableAnalysisAttachment, FunctionAttachment);
 public:
-    SsaVariableAnalysisAttachment(const DynArray<SsaVariableTypeAndOffset>& variables) noexcept
+    SsaVariableAnalysisAttachment(const DynArray<SsaVariableTypeAndOffset>& variables, const uSys frameSize) noexcept
         : m_Variables(variables)
+        , m_FrameSize(frameSize)
     { }
 
-    SsaVariableAnalysisAttachment(DynArray<SsaVariableTypeAndOffset>&& variables) noexcept
+    SsaVariableAnalysisAttachment(DynArray<SsaVariableTypeAndOffset>&& variables, const uSys frameSize) noexcept
         : m_Variables(::std::move(variables))
+        , m_FrameSize(frameSize)
     { }
 
     [[nodiscard]] const DynArray<SsaVariableTypeAndOffset>& Variables() const noexcept { return m_Variables; }
+
+    /**
+     * The size of the frame holding every variable, with the slots of variables that are never live at the same time shared.
+     */
+    [[nodiscard]] uSys FrameSize() const noexcept { return m_FrameSize; }
+
+    [[nodiscard]] const char* AttachmentName() const noexcept override { return "SsaVariableAnalysisAttachment"; }
+    [[nodiscard]] uSys MemoryUsage() const noexcept override { return sizeof(*this) + m_Variables.Count() * sizeof(SsaVariableTypeAndOffset); }
 private:
     DynArray<SsaVariableTypeAndOffset> m_Variables;
+    uSys m_FrameSize;
 };
 
+/**
+ * \brief Assigns every variable an offset in the function's frame.
+ *
+ *   Each variable is live from its definition to its last use, counted
+ * in instructions. A variable that is live into a loop, defined before
+ * the target of a back edge and used at or after it, stays live until
+ * the back edge. The incoming values of a phi are written at the end of
+ * the predecessor, so both the phi and its incoming var are live there.
+ *
+ *   Slots are assigned in order of the start of each live range, a slot
+ * whose variable is dead is reused by the next variable of the same size.
+ * Slots are aligned to the largest power of two dividing their size, up
+ * to 8 bytes. Labels have no value and are given no slot.
+ */
 // ReSharper disable CppHidingFunction
 class SsaVariableAnalysisVisitor final : public SsaVisitor<SsaVariableAnalysisVisitor>
 {
     DEFAULT_DESTRUCT(SsaVariableAnalysisVisitor);
     DELETE_CM(SsaVariableAnalysisVisitor);
 public:
-    SsaVariableAnalysisVisitor(const SsaCustomTypeRegistry& registry, const ModuleRef& module) noexcept
+    SsaVariableAnalysisVisitor(const SsaCustomTypeRegistry& registry) noexcept
         : SsaVisitor(registry)
-        , m_Module(module)
         , m_Variables()
-        , m_CurrentOffset(0)
+        , m_FrameSize(0)
+        , m_UncompactedFrameSize(0)
+        , m_Position(0)
     { }
 
     [[nodiscard]] const DynArray<SsaVariableTypeAndOffset>& Variables() const noexcept { return m_Variables; }
+    [[nodiscard]] uSys FrameSize() const noexcept { return m_FrameSize; }
+
+    /**
+     * The frame size if every variable had its own slot.
+     */
+    [[nodiscard]] uSys UncompactedFrameSize() const noexcept { return m_UncompactedFrameSize; }
 
     void UpdateAttachment(Function* const function) noexcept
     {
@@ -65,188 +102,530 @@ public:
             function->RemoveAttachment<SsaVariableAnalysisAttachment>();
         }
 
-        function->Attach<SsaVariableAnalysisAttachment>(::std::move(m_Variables));
+        function->Attach<SsaVariableAnalysisAttachment>(::std::move(m_Variables), m_FrameSize);
     }
 public:
     bool PreTraversal(const u8* const codePtr, const uSys size, const VarId maxId) noexcept
     {
         m_Variables = DynArray<SsaVariableTypeAndOffset>(maxId);
-        m_CurrentOffset = 0;
+        m_FrameSize = 0;
+        m_UncompactedFrameSize = 0;
+        m_Position = 0;
+
+        m_Starts.assign(maxId, static_cast<u32>(-1));
+        m_Ends.assign(maxId, 0);
+        m_Sizes.assign(maxId, 0);
+        m_LabelPositions.assign(maxId, static_cast<u32>(-1));
+        m_Labels.clear();
+        m_Terminators.clear();
+        m_Branches.clear();
+        m_PhiIncoming.clear();
+
+        for(uSys i = 0; i < m_Variables.Count(); ++i)
+        {
+            m_Variables[i] = SsaVariableTypeAndOffset(SsaCustomType(SsaType::Void), 0);
+        }
+
+        return true;
+    }
+
+    bool PostTraversal() noexcept
+    {
+        ExtendPhis();
+        ExtendLoops();
+        AssignSlots();
         return true;
     }
 
     bool VisitLabel(const VarId label) noexcept
     {
-        m_Variables[label - 1] = SsaVariableTypeAndOffset(SsaCustomType(SsaType::Label), m_CurrentOffset);
-        m_CurrentOffset += TypeValueSize(SsaType::Label);
+        m_Variables[label - 1] = SsaVariableTypeAndOffset(SsaCustomType(SsaType::Label), 0);
+        m_LabelPositions[label - 1] = m_Position;
+        m_Labels.push_back(label);
+        ++m_Position;
         return true;
     }
 
     bool VisitAssignImmediate(const VarId newVar, const SsaCustomType type, const void* const value, const uSys size) noexcept
     {
-        m_Variables[newVar - 1] = SsaVariableTypeAndOffset(type, m_CurrentOffset);
-        m_CurrentOffset += size;
+        Define(newVar, type);
+        ++m_Position;
         return true;
     }
 
     bool VisitAssignVar(const VarId newVar, const SsaCustomType type, const VarId var) noexcept
     {
-        m_Variables[newVar - 1] = SsaVariableTypeAndOffset(type, m_CurrentOffset);
-        m_CurrentOffset += type.Size();
+        Use(var);
+        Define(newVar, type);
+        ++m_Position;
         return true;
     }
 
     bool VisitExpandSX(const VarId newVar, const SsaCustomType newType, const SsaCustomType oldType, const VarId var) noexcept
     {
-        m_Variables[newVar - 1] = SsaVariableTypeAndOffset(newType, m_CurrentOffset);
-        m_CurrentOffset += newType.Size();
+        Use(var);
+        Define(newVar, newType);
+        ++m_Position;
         return true;
     }
 
     bool VisitExpandZX(const VarId newVar, const SsaCustomType newType, const SsaCustomType oldType, const VarId var) noexcept
     {
-        m_Variables[newVar - 1] = SsaVariableTypeAndOffset(newType, m_CurrentOffset);
-        m_CurrentOffset += newType.Size();
+        Use(var);
+        Define(newVar, newType);
+        ++m_Position;
         return true;
     }
 
     bool VisitTrunc(const VarId newVar, const SsaCustomType newType, const SsaCustomType oldType, const VarId var) noexcept
     {
-        m_Variables[newVar - 1] = SsaVariableTypeAndOffset(newType, m_CurrentOffset);
-        m_CurrentOffset += newType.Size();
+        Use(var);
+        Define(newVar, newType);
+        ++m_Position;
         return true;
     }
 
     bool VisitRCast(const VarId newVar, const SsaCustomType newType, const SsaCustomType oldType, const VarId var) noexcept
     {
-        m_Variables[newVar - 1] = SsaVariableTypeAndOffset(newType, m_CurrentOffset);
-        m_CurrentOffset += newType.Size();
+        Use(var);
+        Define(newVar, newType);
+        ++m_Position;
         return true;
     }
 
     bool VisitBCast(const VarId newVar, const SsaCustomType newType, const SsaCustomType oldType, const VarId var) noexcept
     {
-        m_Variables[newVar - 1] = SsaVariableTypeAndOffset(newType, m_CurrentOffset);
-        m_CurrentOffset += newType.Size();
+        Use(var);
+        Define(newVar, newType);
+        ++m_Position;
         return true;
     }
 
     bool VisitLoad(const VarId newVar, const SsaCustomType type, const VarId var) noexcept
     {
-        m_Variables[newVar - 1] = SsaVariableTypeAndOffset(type, m_CurrentOffset);
-        m_CurrentOffset += type.Size();
+        Use(var);
+        Define(newVar, type);
+        ++m_Position;
+        return true;
+    }
+
+    bool VisitStoreV(const SsaCustomType type, const VarId destination, const VarId source) noexcept
+    {
+        Use(destination);
+        Use(source);
+        ++m_Position;
+        return true;
+    }
+
+    bool VisitStoreI(const SsaCustomType type, const VarId destination, const void* const value, const uSys size) noexcept
+    {
+        Use(destination);
+        ++m_Position;
         return true;
     }
 
     bool VisitComputePtr(const VarId newVar, const VarId base, const VarId index, const i8 multiplier, const i16 offset) noexcept
     {
-        const SsaCustomType type(SetPointer(SsaType::Void, true));
-        m_Variables[newVar - 1] = SsaVariableTypeAndOffset(type, m_CurrentOffset);
-        m_CurrentOffset += type.Size();
+        Use(base);
+        Use(index);
+        Define(newVar, SsaCustomType(SetPointer(SsaType::Void, true)));
+        ++m_Position;
         return true;
     }
 
     bool VisitBinOpVToV(const VarId newVar, const SsaBinaryOperation operation, const SsaCustomType type, const VarId a, const VarId b) noexcept
     {
-        m_Variables[newVar - 1] = SsaVariableTypeAndOffset(type, m_CurrentOffset);
-        m_CurrentOffset += type.Size();
+        Use(a);
+        Use(b);
+        Define(newVar, type);
+        ++m_Position;
         return true;
     }
 
     bool VisitBinOpVToI(const VarId newVar, const SsaBinaryOperation operation, const SsaCustomType type, const void* const a, const uSys aSize, const VarId b) noexcept
     {
-        m_Variables[newVar - 1] = SsaVariableTypeAndOffset(type, m_CurrentOffset);
-        m_CurrentOffset += type.Size();
+        Use(b);
+        Define(newVar, type);
+        ++m_Position;
         return true;
     }
 
     bool VisitBinOpIToV(const VarId newVar, const SsaBinaryOperation operation, const SsaCustomType type, const VarId a, const void* const b, const uSys bSize) noexcept
     {
-        m_Variables[newVar - 1] = SsaVariableTypeAndOffset(type, m_CurrentOffset);
-        m_CurrentOffset += type.Size();
+        Use(a);
+        Define(newVar, type);
+        ++m_Position;
         return true;
     }
 
     bool VisitSplit(const VarId baseIndex, const SsaCustomType aType, const VarId a, const uSys splitCount, const SsaCustomType* const splitTypes) noexcept
     {
+        Use(a);
+
         for(uSys i = 0; i < splitCount; ++i)
         {
-            m_Variables[baseIndex + i - 1] = SsaVariableTypeAndOffset(splitTypes[i], m_CurrentOffset);
-            m_CurrentOffset += splitTypes[i].Size();
+            Define(static_cast<VarId>(baseIndex + i), splitTypes[i]);
         }
+
+        ++m_Position;
         return true;
     }
 
     bool VisitJoin(const VarId newVar, const SsaCustomType newType, const uSys joinCount, const SsaCustomType* const joinTypes, const VarId* const joinVars) noexcept
     {
-        m_Variables[newVar - 1] = SsaVariableTypeAndOffset(newType, m_CurrentOffset);
-        m_CurrentOffset += newType.Size();
+        for(uSys i = 0; i < joinCount; ++i)
+        {
+            Use(joinVars[i]);
+        }
+
+        Define(newVar, newType);
+        ++m_Position;
+        return true;
+    }
+
+    bool VisitPhi(const VarId newVar, const SsaCustomType type, const uSys incomingCount, const VarId* const labels, const VarId* const vars) noexcept
+    {
+        // The incoming vars are used at the end of the predecessors, which may not have been visited yet.
+        for(uSys i = 0; i < incomingCount; ++i)
+        {
+            m_PhiIncoming.push_back({ newVar, labels[i], vars[i] });
+        }
+
+        Define(newVar, type);
+        ++m_Position;
         return true;
     }
 
     bool VisitCompVToV(const VarId newVar, const CompareCondition operation, const SsaCustomType type, const VarId a, const VarId b) noexcept
     {
-        const SsaCustomType newType(SsaType::Bool);
-        m_Variables[newVar - 1] = SsaVariableTypeAndOffset(newType, m_CurrentOffset);
-        m_CurrentOffset += newType.Size();
+        Use(a);
+        Use(b);
+        Define(newVar, SsaCustomType(SsaType::Bool));
+        ++m_Position;
         return true;
     }
 
     bool VisitCompVToI(const VarId newVar, const CompareCondition operation, const SsaCustomType type, const void* const a, const uSys aSize, const VarId b) noexcept
     {
-        const SsaCustomType newType(SsaType::Bool);
-        m_Variables[newVar - 1] = SsaVariableTypeAndOffset(newType, m_CurrentOffset);
-        m_CurrentOffset += newType.Size();
+        Use(b);
+        Define(newVar, SsaCustomType(SsaType::Bool));
+        ++m_Position;
         return true;
     }
 
     bool VisitCompIToV(const VarId newVar, const CompareCondition operation, const SsaCustomType type, const VarId a, const void* const b, const uSys bSize) noexcept
     {
-        const SsaCustomType newType(SsaType::Bool);
-        m_Variables[newVar - 1] = SsaVariableTypeAndOffset(newType, m_CurrentOffset);
-        m_CurrentOffset += newType.Size();
+        Use(a);
+        Define(newVar, SsaCustomType(SsaType::Bool));
+        ++m_Position;
         return true;
     }
 
-    bool VisitCall(const VarId newVar, const u32 functionIndex, const VarId baseIndex, const u32 parameterCount) noexcept
+    bool VisitBranch(const VarId label) noexcept
     {
+        m_Branches.emplace_back(m_Position, label);
+        m_Terminators.push_back(m_Position);
+        ++m_Position;
+        return true;
+    }
+
+    bool VisitBranchCond(const VarId labelTrue, const VarId labelFalse, const VarId conditionVar) noexcept
+    {
+        Use(conditionVar);
+        m_Branches.emplace_back(m_Position, labelTrue);
+        m_Branches.emplace_back(m_Position, labelFalse);
+        m_Terminators.push_back(m_Position);
+        ++m_Position;
+        return true;
+    }
 
-        const Function* function = m_Module->Functions()[functionIndex];
-        function->FindAttachment<Ssa>()
+    // Calls return their value through the first argument register, like SsaWriter the result is typed as a u64.
 
+    bool VisitCall(const VarId newVar, const u32 functionIndex, const VarId baseIndex, const u32 parameterCount) noexcept
+    {
+        UseParameters(baseIndex, parameterCount);
+        Define(newVar, SsaCustomType(SsaType::U64));
+        ++m_Position;
         return true;
     }
 
     bool VisitCallExt(const VarId newVar, const u32 functionIndex, const VarId baseIndex, const u32 parameterCount, const u16 moduleIndex) noexcept
     {
-        const Function* function = m_Module->Imports()[moduleIndex].Functions()[functionIndex];
-        if(!ShouldInlineFunction(function))
-        {
-            m_NewVarMap[newVar] = m_Writer.WriteCallExt(functionIndex, baseIndex, parameterCount, moduleIndex);
-        }
-        else
-        {
-            InlineFunction(function, baseIndex, parameterCount, newVar);
-        }
-
+        UseParameters(baseIndex, parameterCount);
+        Define(newVar, SsaCustomType(SsaType::U64));
+        ++m_Position;
         return true;
     }
 
     bool VisitCallInd(const VarId newVar, const VarId functionPointer, const VarId baseIndex, const u32 parameterCount) noexcept
     {
-        m_NewVarMap[newVar] = m_Writer.WriteCallInd(TransformVar(functionPointer), TransformVar(baseIndex), parameterCount);
+        Use(functionPointer);
+        UseParameters(baseIndex, parameterCount);
+        Define(newVar, SsaCustomType(SsaType::U64));
+        ++m_Position;
         return true;
     }
 
     bool VisitCallIndExt(const VarId newVar, const VarId functionPointer, const VarId baseIndex, const u32 parameterCount, const VarId modulePointer) noexcept
     {
-        m_NewVarMap[newVar] = m_Writer.WriteCallIndExt(TransformVar(functionPointer), TransformVar(baseIndex), parameterCount, TransformVar(modulePointer));
+        Use(functionPointer);
+        Use(modulePointer);
+        UseParameters(baseIndex, parameterCount);
+        Define(newVar, SsaCustomType(SsaType::U64));
+        ++m_Position;
+        return true;
+    }
+
+    bool VisitRet(const SsaCustomType returnType, const VarId var) noexcept
+    {
+        Use(var);
+        m_Terminators.push_back(m_Position);
+        ++m_Position;
         return true;
     }
 private:
-    ModuleRef m_Module;
+    struct PhiIncoming final
+    {
+        VarId Phi;
+        VarId Label;
+        VarId Var;
+    };
+private:
+    [[nodiscard]] bool IsFrameVar(const VarId var) const noexcept
+    {
+        return (var & 0x80000000) == 0 && var != 0 && var <= m_Variables.Count();
+    }
+
+    /**
+     * The size of a value of the type, raw bytes store their size in place of a custom type.
+     */
+    [[nodiscard]] u32 ValueSize(const SsaCustomType type) const noexcept
+    {
+        if(!IsPointer(type.Type))
+        {
+            if(type.Type == SsaType::Bytes)
+            {
+                return type.CustomType == static_cast<u32>(-1) ? 0 : type.CustomType;
+            }
+
+            if(type.Type == SsaType::Custom)
+            {
+                return static_cast<u32>(Registry()[type.CustomType].Size);
+            }
+        }
+
+        const uSys size = TypeValueSize(type.Type);
+        return size > sizeof(u64) ? 0 : static_cast<u32>(size);
+    }
+
+    [[nodiscard]] static u32 Alignment(const u32 size) noexcept
+    {
+        u32 alignment = 1;
+
+        while(alignment < 8 && (size & (alignment * 2 - 1)) == 0)
+        {
+            alignment *= 2;
+        }
+
+        return alignment;
+    }
+
+    void Cover(const VarId var, const u32 position) noexcept
+    {
+        m_Starts[var - 1] = minT(m_Starts[var - 1], position);
+        m_Ends[var - 1] = maxT(m_Ends[var - 1], position);
+    }
+
+    void Define(const VarId var, const SsaCustomType type) noexcept
+    {
+        if(!IsFrameVar(var))
+        {
+            return;
+        }
+
+        m_Variables[var - 1] = SsaVariableTypeAndOffset(type, 0);
+        m_Sizes[var - 1] = ValueSize(type);
+        Cover(var, m_Position);
+    }
+
+    void Use(const VarId var) noexcept
+    {
+        if(IsFrameVar(var))
+        {
+            Cover(var, m_Position);
+        }
+    }
+
+    void UseParameters(const VarId baseIndex, const u32 parameterCount) noexcept
+    {
+        for(u32 i = 0; i < parameterCount; ++i)
+        {
+            Use(static_cast<VarId>(baseIndex + i));
+        }
+    }
+
+    /**
+     *   The last instruction of the block starting at the label, either its
+     * terminator or the instruction before the next label.
+     */
+    [[nodiscard]] u32 BlockEnd(const VarId label) const noexcept
+    {
+        const u32 start = IsFrameVar(label) ? m_LabelPositions[label - 1] : static_cast<u32>(-1);
+
+        if(start == static_cast<u32>(-1))
+        {
+            return m_Position;
+        }
+
+        u32 end = m_Position;
+
+        const auto terminator = ::std::lower_bound(m_Terminators.begin(), m_Terminators.end(), start);
+
+        if(terminator != m_Terminators.end())
+        {
+            end = *terminator;
+        }
+
+        // Labels are recorded in order, the next label after this one ends a block that falls through.
+        const auto nextLabel = ::std::upper_bound(m_Labels.begin(), m_Labels.end(), start, [this](const u32 position, const VarId other) { return position < m_LabelPositions[other - 1]; });
+
+        if(nextLabel != m_Labels.end())
+        {
+            end = minT(end, m_LabelPositions[*nextLabel - 1] - 1);
+        }
+
+        return end;
+    }
+
+    void ExtendPhis() noexcept
+    {
+        for(const PhiIncoming& incoming : m_PhiIncoming)
+        {
+            const u32 end = BlockEnd(incoming.Label);
+
+            if(IsFrameVar(incoming.Phi))
+            {
+                Cover(incoming.Phi, end);
+            }
+
+            if(IsFrameVar(incoming.Var))
+            {
+                Cover(incoming.Var, end);
+            }
+        }
+    }
+
+    /**
+     *   A var that is live at the target of a back edge has to survive
+     * the whole loop. Extending one loop can make a var live into an
+     * enclosing loop, so this repeats until nothing changes.
+     */
+    void ExtendLoops() noexcept
+    {
+        bool changed = true;
+
+        while(changed)
+        {
+            changed = false;
+
+            for(const ::std::pair<u32, VarId>& branch : m_Branches)
+            {
+                if(!IsFrameVar(branch.second))
+                {
+                    continue;
+                }
+
+                const u32 source = branch.first;
+                const u32 target = m_LabelPositions[branch.second - 1];
+
+                if(target == static_cast<u32>(-1) || target > source)
+                {
+                    continue;
+                }
+
+                for(uSys i = 0; i < m_Starts.size(); ++i)
+                {
+                    if(m_Starts[i] < target && m_Ends[i] >= target && m_Ends[i] < source)
+                    {
+                        m_Ends[i] = source;
+                        changed = true;
+                    }
+                }
+            }
+        }
+    }
+
+    void AssignSlots() noexcept
+    {
+        ::std::vector<VarId> order;
+        order.reserve(m_Starts.size());
+
+        for(uSys i = 0; i < m_Starts.size(); ++i)
+        {
+            if(m_Sizes[i] != 0 && m_Starts[i] != static_cast<u32>(-1))
+            {
+                order.push_back(static_cast<VarId>(i + 1));
+            }
+        }
+
+        ::std::stable_sort(order.begin(), order.end(), [this](const VarId a, const VarId b) { return m_Starts[a - 1] < m_Starts[b - 1]; });
+
+        // The live vars ordered by the end of their range, and the free slots as offset and size.
+        ::std::priority_queue<::std::pair<u32, VarId>, ::std::vector<::std::pair<u32, VarId>>, ::std::greater<>> active;
+        ::std::vector<::std::pair<uSys, u32>> freeSlots;
+
+        for(const VarId var : order)
+        {
+            const u32 start = m_Starts[var - 1];
+            const u32 size = m_Sizes[var - 1];
+
+            // A var can't take the slot of one that dies at its own definition, the operands are read while the result is written.
+            while(!active.empty() && active.top().first < start)
+            {
+                const VarId dead = active.top().second;
+                freeSlots.emplace_back(m_Variables[dead - 1].Offset, m_Sizes[dead - 1]);
+                active.pop();
+            }
+
+            const auto slot = ::std::find_if(freeSlots.rbegin(), freeSlots.rend(), [size](const ::std::pair<uSys, u32>& freeSlot) { return freeSlot.second == size; });
+
+            if(slot != freeSlots.rend())
+            {
+                m_Variables[var - 1].Offset = slot->first;
+                freeSlots.erase(::std::next(slot).base());
+            }
+            else
+            {
+                const u32 alignment = Alignment(size);
+                m_FrameSize = (m_FrameSize + alignment - 1) & ~static_cast<uSys>(alignment - 1);
+                m_Variables[var - 1].Offset = m_FrameSize;
+                m_FrameSize += size;
+            }
+
+            const u32 alignment = Alignment(size);
+            m_UncompactedFrameSize = (m_UncompactedFrameSize + alignment - 1) & ~static_cast<uSys>(alignment - 1);
+            m_UncompactedFrameSize += size;
+
+            active.emplace(m_Ends[var - 1], var);
+        }
+    }
+private:
     DynArray<SsaVariableTypeAndOffset> m_Variables;
-    uSys m_CurrentOffset;
+    uSys m_FrameSize;
+    uSys m_UncompactedFrameSize;
+    // The index of the instruction being visited.
+    u32 m_Position;
+
+    // The live range of each var in instructions, indexed by var - 1.
+    ::std::vector<u32> m_Starts;
+    ::std::vector<u32> m_Ends;
+    ::std::vector<u32> m_Sizes;
+    ::std::vector<u32> m_LabelPositions;
+    ::std::vector<VarId> m_Labels;
+    ::std::vector<u32> m_Terminators;
+    // The position of each branch and the label it targets.
+    ::std::vector<::std::pair<u32, VarId>> m_Branches;
+    ::std::vector<PhiIncoming> m_PhiIncoming;
 };
 
 }
@@ -6,6 +6,8 @@
 #include "TauIR/Opcodes.hpp"
 #include "TauIR/Function.hpp"
 #include "TauIR/ssa/SsaFunctionAttachment.hpp"
+#include "TauIR/ssa/SsaGraph.hpp"
+#include "TauIR/ssa/SsaWriter.hpp"
 #include <cstring>
 #include <DynArray.hpp>
 
@@ -49,6 +51,33 @@ protected:
 public:
     bool Traverse(const u8* codePtr, uSys size, VarId maxId) noexcept;
 
+    /**
+     *   Visits the instructions from last to first, using the offsets and
+     * first var ids recorded by an SsaWriter. PreTraversal and
+     * PostTraversal are called as for a forward traversal.
+     */
+    bool TraverseReverse(const u8* codePtr, uSys size, VarId maxId, const u32* instructionOffsets, const VarId* instructionIds, u32 instructionCount) noexcept;
+
+    /**
+     * Fails if the writer didn't record an instruction index.
+     */
+    bool TraverseReverse(const SsaWriter& writer) noexcept;
+
+    /**
+     *   Visits the single instruction at the offset, firstId is the id of
+     * the first var it defines. Neither PreTraversal nor PostTraversal is
+     * called.
+     */
+    bool VisitAt(const u8* codePtr, uSys offset, VarId firstId) noexcept;
+    bool VisitAt(const SsaWriter& writer, u32 instruction) noexcept;
+
+    /**
+     *   Visits an already decoded graph, nothing is parsed. Nops left by
+     * removed instructions are skipped, codePtr is passed as nullptr to
+     * PreTraversal.
+     */
+    bool Traverse(const SsaGraph& graph) noexcept;
+
     bool Traverse(const Function* const function) noexcept
     {
         {
@@ -134,10 +163,17 @@ protected:
     bool VisitCallIndExt(const VarId newVar, const VarId functionPointer, const VarId baseIndex, const u32 parameterCount, const VarId modulePointer) noexcept { return true; }
     // ReSharper disable once CppHiddenFunction
     bool VisitRet(const SsaCustomType returnType, const VarId var) noexcept { return true; }
+    // ReSharper disable once CppHiddenFunction
+    bool VisitPhi(const VarId newVar, const SsaCustomType type, const uSys incomingCount, const VarId* const labels, const VarId* const vars) noexcept { return true; }
 
     [[nodiscard]] const SsaCustomTypeRegistry& Registry() const noexcept { return *m_Registry; }
 private:
     [[nodiscard]] Derived& GetDerived() noexcept { return *static_cast<Derived*>(this); }
+
+    /**
+     * Decodes and visits the instruction at i, advancing i and idIndex past it.
+     */
+    bool VisitInstruction(const u8* codePtr, uSys& i, VarId& idIndex) noexcept;
 private:
     const SsaCustomTypeRegistry* m_Registry;
 };
@@ -145,8 +181,6 @@ private:
 template<typename Derived>
 bool SsaVisitor<Derived>::Traverse(const u8* const codePtr, const uSys size, const VarId maxId) noexcept
 {
-    using namespace internal;
-
     if(!GetDerived().PreTraversal(codePtr, size, maxId))
     {
         return false;
@@ -156,467 +190,640 @@ bool SsaVisitor<Derived>::Traverse(const u8* const codePtr, const uSys size, con
 
     for(uSys i = 0; i < size;)
     {
-        u16 opcodeRaw = codePtr[i++];
-
-        // Read Second Byte
-        if(opcodeRaw & 0x80)
+        if(!VisitInstruction(codePtr, i, idIndex))
         {
-            opcodeRaw <<= 8;
-            opcodeRaw |= codePtr[i++];
+            return false;
         }
+    }
+
+    return GetDerived().PostTraversal();
+}
+
+template<typename Derived>
+bool SsaVisitor<Derived>::TraverseReverse(const u8* const codePtr, const uSys size, const VarId maxId, const u32* const instructionOffsets, const VarId* const instructionIds, const u32 instructionCount) noexcept
+{
+    if(!GetDerived().PreTraversal(codePtr, size, maxId))
+    {
+        return false;
+    }
 
-        const SsaOpcode opcode = static_cast<SsaOpcode>(opcodeRaw);
-        
-        switch(opcode)
+    for(u32 inst = instructionCount; inst > 0; --inst)
+    {
+        if(!VisitAt(codePtr, instructionOffsets[inst - 1], instructionIds[inst - 1]))
         {
-            case SsaOpcode::Nop:
-                if(!GetDerived().VisitNop())
-                {
-                    return false;
-                }
-                break;
-            case SsaOpcode::Label:
-                if(!GetDerived().VisitLabel(idIndex++))
-                {
-                    return false;
-                }
-                break;
-            case SsaOpcode::AssignImmediate:
-            {
-                const SsaCustomType type = ReadType<SsaCustomType>(codePtr, i);
-                u32 typeSize = static_cast<u32>(TypeValueSize(type.Type));
+            return false;
+        }
+    }
 
-                if(StripPointer(type.Type) == SsaType::Bytes || StripPointer(type.Type) == SsaType::Custom)
-                {
-                    typeSize = Registry()[type.CustomType].Size;
-                }
+    return GetDerived().PostTraversal();
+}
 
-                if(!GetDerived().VisitAssignImmediate(idIndex++, type, codePtr + i, typeSize))
-                {
-                    return false;
-                }
+template<typename Derived>
+bool SsaVisitor<Derived>::TraverseReverse(const SsaWriter& writer) noexcept
+{
+    // Without an index only empty code can be walked.
+    if(!writer.HasInstructionIndex() && writer.Size() != 0)
+    {
+        return false;
+    }
 
-                i += typeSize;
-                break;
+    return TraverseReverse(writer.Buffer(), writer.Size(), writer.IdIndex(), writer.InstructionOffsets(), writer.InstructionIds(), writer.InstructionCount());
+}
+
+template<typename Derived>
+bool SsaVisitor<Derived>::VisitAt(const u8* const codePtr, const uSys offset, const VarId firstId) noexcept
+{
+    uSys i = offset;
+    VarId idIndex = firstId;
+
+    return VisitInstruction(codePtr, i, idIndex);
+}
+
+template<typename Derived>
+bool SsaVisitor<Derived>::VisitAt(const SsaWriter& writer, const u32 instruction) noexcept
+{
+    if(instruction >= writer.InstructionCount())
+    {
+        return false;
+    }
+
+    return VisitAt(writer.Buffer(), writer.InstructionOffsets()[instruction], writer.InstructionIds()[instruction]);
+}
+
+template<typename Derived>
+bool SsaVisitor<Derived>::VisitInstruction(const u8* const codePtr, uSys& i, VarId& idIndex) noexcept
+{
+    using namespace internal;
+
+    u16 opcodeRaw = codePtr[i++];
+
+    // Read Second Byte
+    if(opcodeRaw & 0x80)
+    {
+        opcodeRaw <<= 8;
+        opcodeRaw |= codePtr[i++];
+    }
+
+    const SsaOpcode opcode = static_cast<SsaOpcode>(opcodeRaw);
+    
+    switch(opcode)
+    {
+        case SsaOpcode::Nop:
+            if(!GetDerived().VisitNop())
+            {
+                return false;
             }
-        	case SsaOpcode::AssignVariable:
+            break;
+        case SsaOpcode::Label:
+            if(!GetDerived().VisitLabel(idIndex++))
             {
-                const SsaCustomType type = ReadType<SsaCustomType>(codePtr, i);
-                const VarId var = ReadType<VarId>(codePtr, i);
-
-                if(!GetDerived().VisitAssignVar(idIndex++, type, var))
-                {
-	                return false;
-                }
-                break;
+                return false;
             }
-        	case SsaOpcode::ExpandSX:
+            break;
+        case SsaOpcode::AssignImmediate:
+        {
+            const SsaCustomType type = ReadType<SsaCustomType>(codePtr, i);
+            u32 typeSize = static_cast<u32>(TypeValueSize(type.Type));
+
+            if(StripPointer(type.Type) == SsaType::Bytes || StripPointer(type.Type) == SsaType::Custom)
             {
-                const SsaCustomType newType = ReadType<SsaCustomType>(codePtr, i);
-                const SsaCustomType oldType = ReadType<SsaCustomType>(codePtr, i);
-                const VarId var = ReadType<VarId>(codePtr, i);
+                typeSize = Registry()[type.CustomType].Size;
+            }
 
-                if(!GetDerived().VisitExpandSX(idIndex++, newType, oldType, var))
-                {
-                    return false;
-                }
-                break;
+            if(!GetDerived().VisitAssignImmediate(idIndex++, type, codePtr + i, typeSize))
+            {
+                return false;
             }
-            case SsaOpcode::ExpandZX:
+
+            i += typeSize;
+            break;
+        }
+    	case SsaOpcode::AssignVariable:
+        {
+            const SsaCustomType type = ReadType<SsaCustomType>(codePtr, i);
+            const VarId var = ReadType<VarId>(codePtr, i);
+
+            if(!GetDerived().VisitAssignVar(idIndex++, type, var))
             {
-                const SsaCustomType newType = ReadType<SsaCustomType>(codePtr, i);
-                const SsaCustomType oldType = ReadType<SsaCustomType>(codePtr, i);
-                const VarId var = ReadType<VarId>(codePtr, i);
+	                return false;
+            }
+            break;
+        }
+    	case SsaOpcode::ExpandSX:
+        {
+            const SsaCustomType newType = ReadType<SsaCustomType>(codePtr, i);
+            const SsaCustomType oldType = ReadType<SsaCustomType>(codePtr, i);
+            const VarId var = ReadType<VarId>(codePtr, i);
 
-                if(!GetDerived().VisitExpandZX(idIndex++, newType, oldType, var))
-                {
-                    return false;
-                }
-                break;
+            if(!GetDerived().VisitExpandSX(idIndex++, newType, oldType, var))
+            {
+                return false;
             }
-            case SsaOpcode::Trunc:
+            break;
+        }
+        case SsaOpcode::ExpandZX:
+        {
+            const SsaCustomType newType = ReadType<SsaCustomType>(codePtr, i);
+            const SsaCustomType oldType = ReadType<SsaCustomType>(codePtr, i);
+            const VarId var = ReadType<VarId>(codePtr, i);
+
+            if(!GetDerived().VisitExpandZX(idIndex++, newType, oldType, var))
             {
-                const SsaCustomType newType = ReadType<SsaCustomType>(codePtr, i);
-                const SsaCustomType oldType = ReadType<SsaCustomType>(codePtr, i);
-                const VarId var = ReadType<VarId>(codePtr, i);
+                return false;
+            }
+            break;
+        }
+        case SsaOpcode::Trunc:
+        {
+            const SsaCustomType newType = ReadType<SsaCustomType>(codePtr, i);
+            const SsaCustomType oldType = ReadType<SsaCustomType>(codePtr, i);
+            const VarId var = ReadType<VarId>(codePtr, i);
 
-                if(!GetDerived().VisitTrunc(idIndex++, newType, oldType, var))
-                {
-                    return false;
-                }
-                break;
+            if(!GetDerived().VisitTrunc(idIndex++, newType, oldType, var))
+            {
+                return false;
             }
-            case SsaOpcode::RCast:
+            break;
+        }
+        case SsaOpcode::RCast:
+        {
+            const SsaCustomType newType = ReadType<SsaCustomType>(codePtr, i);
+            const SsaCustomType oldType = ReadType<SsaCustomType>(codePtr, i);
+            const VarId var = ReadType<VarId>(codePtr, i);
+
+            if(!GetDerived().VisitRCast(idIndex++, newType, oldType, var))
             {
-                const SsaCustomType newType = ReadType<SsaCustomType>(codePtr, i);
-                const SsaCustomType oldType = ReadType<SsaCustomType>(codePtr, i);
-                const VarId var = ReadType<VarId>(codePtr, i);
+                return false;
+            }
+            break;
+        }
+        case SsaOpcode::BCast:
+        {
+            const SsaCustomType newType = ReadType<SsaCustomType>(codePtr, i);
+            const SsaCustomType oldType = ReadType<SsaCustomType>(codePtr, i);
+            const VarId var = ReadType<VarId>(codePtr, i);
 
-                if(!GetDerived().VisitRCast(idIndex++, newType, oldType, var))
-                {
-                    return false;
-                }
-                break;
+            if(!GetDerived().VisitBCast(idIndex++, newType, oldType, var))
+            {
+                return false;
             }
-            case SsaOpcode::BCast:
+            break;
+        }
+        case SsaOpcode::Load:
+        {
+            const SsaCustomType type = ReadType<SsaCustomType>(codePtr, i);
+            const VarId var = ReadType<VarId>(codePtr, i);
+
+            if(!GetDerived().VisitLoad(idIndex++, type, var))
             {
-                const SsaCustomType newType = ReadType<SsaCustomType>(codePtr, i);
-                const SsaCustomType oldType = ReadType<SsaCustomType>(codePtr, i);
-                const VarId var = ReadType<VarId>(codePtr, i);
+                return false;
+            }
+            break;
+        }
+        case SsaOpcode::StoreV:
+        {
+            const SsaCustomType type = ReadType<SsaCustomType>(codePtr, i);
+            const VarId dest = ReadType<VarId>(codePtr, i);
+            const VarId src = ReadType<VarId>(codePtr, i);
 
-                if(!GetDerived().VisitBCast(idIndex++, newType, oldType, var))
-                {
-                    return false;
-                }
-                break;
+            if(!GetDerived().VisitStoreV(type, dest, src))
+            {
+                return false;
             }
-            case SsaOpcode::Load:
+            break;
+        }
+        case SsaOpcode::StoreI:
+        {
+            const SsaCustomType type = ReadType<SsaCustomType>(codePtr, i);
+            const VarId dest = ReadType<VarId>(codePtr, i);
+            u32 typeSize = static_cast<u32>(TypeValueSize(type.Type));
+
+            if(StripPointer(type.Type) == SsaType::Bytes || StripPointer(type.Type) == SsaType::Custom)
             {
-                const SsaCustomType type = ReadType<SsaCustomType>(codePtr, i);
-                const VarId var = ReadType<VarId>(codePtr, i);
+                typeSize = Registry()[type.CustomType].Size;
+            }
 
-                if(!GetDerived().VisitLoad(idIndex++, type, var))
-                {
-                    return false;
-                }
-                break;
+            if(!GetDerived().VisitStoreI(type, dest, codePtr + i, typeSize))
+            {
+                return false;
             }
-            case SsaOpcode::StoreV:
+
+            i += typeSize;
+            break;
+        }
+        case SsaOpcode::ComputePtr:
+        {
+            const VarId base = ReadType<VarId>(codePtr, i);
+            const VarId index = ReadType<VarId>(codePtr, i);
+            const i8 multiplier = ReadType<i8>(codePtr, i);
+            const i16 offset = ReadType<i16>(codePtr, i);
+
+            if(!GetDerived().VisitComputePtr(idIndex++, base, index, multiplier, offset))
             {
-                const SsaCustomType type = ReadType<SsaCustomType>(codePtr, i);
-                const VarId dest = ReadType<VarId>(codePtr, i);
-                const VarId src = ReadType<VarId>(codePtr, i);
+                return false;
+            }
+            break;
+        }
+        case SsaOpcode::BinOpVtoV:
+        {
+            const SsaBinaryOperation op = ReadType<SsaBinaryOperation>(codePtr, i);
+            const SsaCustomType type = ReadType<SsaCustomType>(codePtr, i);
+            const VarId a = ReadType<VarId>(codePtr, i);
+            const VarId b = ReadType<VarId>(codePtr, i);
 
-                if(!GetDerived().VisitStoreV(type, dest, src))
-                {
-                    return false;
-                }
-                break;
+            if(!GetDerived().VisitBinOpVToV(idIndex++, op, type, a, b))
+            {
+                return false;
             }
-            case SsaOpcode::StoreI:
+            break;
+        }
+        case SsaOpcode::BinOpVtoI:
+        {
+            const SsaBinaryOperation op = ReadType<SsaBinaryOperation>(codePtr, i);
+            const SsaCustomType type = ReadType<SsaCustomType>(codePtr, i);
+            const void* const aValue = codePtr + i;
+
+            u32 typeSize = static_cast<u32>(TypeValueSize(type.Type));
+
+            if(StripPointer(type.Type) == SsaType::Bytes || StripPointer(type.Type) == SsaType::Custom)
             {
-                const SsaCustomType type = ReadType<SsaCustomType>(codePtr, i);
-                const VarId dest = ReadType<VarId>(codePtr, i);
-                u32 typeSize = static_cast<u32>(TypeValueSize(type.Type));
+                typeSize = Registry()[type.CustomType].Size;
+            }
 
-                if(StripPointer(type.Type) == SsaType::Bytes || StripPointer(type.Type) == SsaType::Custom)
-                {
-                    typeSize = Registry()[type.CustomType].Size;
-                }
+            i += typeSize;
 
-                if(!GetDerived().VisitStoreI(type, dest, codePtr + i, typeSize))
-                {
-                    return false;
-                }
+            const VarId b = ReadType<VarId>(codePtr, i);
 
-                i += typeSize;
-                break;
-            }
-            case SsaOpcode::ComputePtr:
+            if(!GetDerived().VisitBinOpVToI(idIndex++, op, type, aValue, typeSize, b))
             {
-                const VarId base = ReadType<VarId>(codePtr, i);
-                const VarId index = ReadType<VarId>(codePtr, i);
-                const i8 multiplier = ReadType<i8>(codePtr, i);
-                const i16 offset = ReadType<i16>(codePtr, i);
-
-                if(!GetDerived().VisitComputePtr(idIndex++, base, index, multiplier, offset))
-                {
-                    return false;
-                }
-                break;
+                return false;
             }
-            case SsaOpcode::BinOpVtoV:
-            {
-                const SsaBinaryOperation op = ReadType<SsaBinaryOperation>(codePtr, i);
-                const SsaCustomType type = ReadType<SsaCustomType>(codePtr, i);
-                const VarId a = ReadType<VarId>(codePtr, i);
-                const VarId b = ReadType<VarId>(codePtr, i);
+            break;
+        }
+        case SsaOpcode::BinOpItoV:
+        {
+            const SsaBinaryOperation op = ReadType<SsaBinaryOperation>(codePtr, i);
+            const SsaCustomType type = ReadType<SsaCustomType>(codePtr, i);
+            const VarId a = ReadType<VarId>(codePtr, i);
+            const void* const bValue = codePtr + i;
 
-                if(!GetDerived().VisitBinOpVToV(idIndex++, op, type, a, b))
-                {
-                    return false;
-                }
-                break;
+            u32 typeSize = static_cast<u32>(TypeValueSize(type.Type));
+
+            if(StripPointer(type.Type) == SsaType::Bytes || StripPointer(type.Type) == SsaType::Custom)
+            {
+                typeSize = Registry()[type.CustomType].Size;
             }
-            case SsaOpcode::BinOpVtoI:
+
+            i += typeSize;
+
+            if(!GetDerived().VisitBinOpIToV(idIndex++, op, type, a, bValue, typeSize))
             {
-                const SsaBinaryOperation op = ReadType<SsaBinaryOperation>(codePtr, i);
-                const SsaCustomType type = ReadType<SsaCustomType>(codePtr, i);
-                const void* const aValue = codePtr + i;
+                return false;
+            }
+            break;
+        }
+        case SsaOpcode::Split:
+        {
+            const SsaCustomType type = ReadType<SsaCustomType>(codePtr, i);
+            const VarId a = ReadType<VarId>(codePtr, i);
+            const u32 splitCount = ReadType<u32>(codePtr, i);
 
-                u32 typeSize = static_cast<u32>(TypeValueSize(type.Type));
+            if(splitCount <= 32)
+            {
+                SsaCustomType types[32];
 
-                if(StripPointer(type.Type) == SsaType::Bytes || StripPointer(type.Type) == SsaType::Custom)
+                for(uSys j = 0; j < splitCount; ++j)
                 {
-                    typeSize = Registry()[type.CustomType].Size;
+                    types[j] = ReadType<SsaCustomType>(codePtr, i);
                 }
 
-                i += typeSize;
-
-                const VarId b = ReadType<VarId>(codePtr, i);
-
-                if(!GetDerived().VisitBinOpVToI(idIndex++, op, type, aValue, typeSize, b))
+                if(!GetDerived().VisitSplit(idIndex, type, a, splitCount, types))
                 {
                     return false;
                 }
-                break;
             }
-            case SsaOpcode::BinOpItoV:
+            else
             {
-                const SsaBinaryOperation op = ReadType<SsaBinaryOperation>(codePtr, i);
-                const SsaCustomType type = ReadType<SsaCustomType>(codePtr, i);
-                const VarId a = ReadType<VarId>(codePtr, i);
-                const void* const bValue = codePtr + i;
-
-                u32 typeSize = static_cast<u32>(TypeValueSize(type.Type));
+                DynArray<SsaCustomType> types(splitCount);
 
-                if(StripPointer(type.Type) == SsaType::Bytes || StripPointer(type.Type) == SsaType::Custom)
+                for(uSys j = 0; j < splitCount; ++j)
                 {
-                    typeSize = Registry()[type.CustomType].Size;
+                    types[j] = ReadType<SsaCustomType>(codePtr, i);
                 }
 
-                i += typeSize;
-
-                if(!GetDerived().VisitBinOpIToV(idIndex++, op, type, a, bValue, typeSize))
+                if(!GetDerived().VisitSplit(idIndex, type, a, splitCount, types))
                 {
                     return false;
                 }
-                break;
             }
-            case SsaOpcode::Split:
-            {
-                const SsaCustomType type = ReadType<SsaCustomType>(codePtr, i);
-                const VarId a = ReadType<VarId>(codePtr, i);
-                const u32 splitCount = ReadType<u32>(codePtr, i);
 
-                if(splitCount <= 32)
-                {
-                    SsaCustomType types[32];
+            idIndex += splitCount;
+            break;
+        }
+        case SsaOpcode::Join:
+        {
+            const SsaCustomType type = ReadType<SsaCustomType>(codePtr, i);
+            const u32 joinCount = ReadType<u32>(codePtr, i);
 
-                    for(uSys j = 0; j < splitCount; ++j)
-                    {
-                        types[j] = ReadType<SsaCustomType>(codePtr, i);
-                    }
+            if(joinCount <= 32)
+            {
+                SsaCustomType types[32];
+                VarId vars[32];
 
-                    if(!GetDerived().VisitSplit(idIndex, type, a, splitCount, types))
-                    {
-                        return false;
-                    }
-                }
-                else
+                for(uSys j = 0; j < joinCount; ++j)
                 {
-                    DynArray<SsaCustomType> types(splitCount);
-
-                    for(uSys j = 0; j < splitCount; ++j)
-                    {
-                        types[j] = ReadType<SsaCustomType>(codePtr, i);
-                    }
+                    types[j] = ReadType<SsaCustomType>(codePtr, i);
+                }
 
-                    if(!GetDerived().VisitSplit(idIndex, type, a, splitCount, types))
-                    {
-                        return false;
-                    }
+                for(uSys j = 0; j < joinCount; ++j)
+                {
+                    vars[j] = ReadType<VarId>(codePtr, i);
                 }
 
-                idIndex += splitCount;
-                break;
+                if(!GetDerived().VisitJoin(idIndex, type, joinCount, types, vars))
+                {
+                    return false;
+                }
             }
-            case SsaOpcode::Join:
+            else
             {
-                const SsaCustomType type = ReadType<SsaCustomType>(codePtr, i);
-                const u32 joinCount = ReadType<u32>(codePtr, i);
+                void* raw = operator new(joinCount * (sizeof(SsaCustomType) + sizeof(VarId)));
+                SsaCustomType* const types = reinterpret_cast<SsaCustomType*>(raw);
+                VarId* const vars = reinterpret_cast<VarId*>(types + joinCount);
 
-                if(joinCount <= 32)
+                for(uSys j = 0; j < joinCount; ++j)
                 {
-                    SsaCustomType types[32];
-                    VarId vars[32];
-
-                    for(uSys j = 0; j < joinCount; ++j)
-                    {
-                        types[j] = ReadType<SsaCustomType>(codePtr, i);
-                    }
-
-                    for(uSys j = 0; j < joinCount; ++j)
-                    {
-                        vars[j] = ReadType<VarId>(codePtr, i);
-                    }
-
-                    if(!GetDerived().VisitJoin(idIndex, type, joinCount, types, vars))
-                    {
-                        return false;
-                    }
+                    types[j] = ReadType<SsaCustomType>(codePtr, i);
                 }
-                else
+
+                for(uSys j = 0; j < joinCount; ++j)
                 {
-                    void* raw = operator new(joinCount * (sizeof(SsaCustomType) + sizeof(VarId)));
-                    SsaCustomType* const types = reinterpret_cast<SsaCustomType*>(raw);
-                    VarId* const vars = reinterpret_cast<VarId*>(types + joinCount);
-
-                    for(uSys j = 0; j < joinCount; ++j)
-                    {
-                        types[j] = ReadType<SsaCustomType>(codePtr, i);
-                    }
-
-                    for(uSys j = 0; j < joinCount; ++j)
-                    {
-                        vars[j] = ReadType<VarId>(codePtr, i);
-                    }
-
-                    if(!GetDerived().VisitJoin(idIndex, type, joinCount, types, vars))
-                    {
-                        operator delete(raw);
-                        return false;
-                    }
-                    operator delete(raw);
+                    vars[j] = ReadType<VarId>(codePtr, i);
                 }
 
-                idIndex += joinCount;
-                break;
-            }
-            case SsaOpcode::CompVtoV:
-            {
-                const CompareCondition cond = ReadType<CompareCondition>(codePtr, i);
-                const SsaCustomType type = ReadType<SsaCustomType>(codePtr, i);
-                const VarId a = ReadType<VarId>(codePtr, i);
-                const VarId b = ReadType<VarId>(codePtr, i);
-
-                if(!GetDerived().VisitCompVToV(idIndex++, cond, type, a, b))
+                if(!GetDerived().VisitJoin(idIndex, type, joinCount, types, vars))
                 {
+                    operator delete(raw);
                     return false;
                 }
-                break;
+                operator delete(raw);
             }
-            case SsaOpcode::CompVtoI:
+
+            // A join only produces a single var.
+            ++idIndex;
+            break;
+        }
+        case SsaOpcode::CompVtoV:
+        {
+            const CompareCondition cond = ReadType<CompareCondition>(codePtr, i);
+            const SsaCustomType type = ReadType<SsaCustomType>(codePtr, i);
+            const VarId a = ReadType<VarId>(codePtr, i);
+            const VarId b = ReadType<VarId>(codePtr, i);
+
+            if(!GetDerived().VisitCompVToV(idIndex++, cond, type, a, b))
             {
-                const CompareCondition cond = ReadType<CompareCondition>(codePtr, i);
-                const SsaCustomType type = ReadType<SsaCustomType>(codePtr, i);
-                const void* const aValue = codePtr + i;
+                return false;
+            }
+            break;
+        }
+        case SsaOpcode::CompVtoI:
+        {
+            const CompareCondition cond = ReadType<CompareCondition>(codePtr, i);
+            const SsaCustomType type = ReadType<SsaCustomType>(codePtr, i);
+            const void* const aValue = codePtr + i;
 
-                u32 typeSize = static_cast<u32>(TypeValueSize(type.Type));
+            u32 typeSize = static_cast<u32>(TypeValueSize(type.Type));
 
-                if(StripPointer(type.Type) == SsaType::Bytes || StripPointer(type.Type) == SsaType::Custom)
-                {
-                    typeSize = Registry()[type.CustomType].Size;
-                }
+            if(StripPointer(type.Type) == SsaType::Bytes || StripPointer(type.Type) == SsaType::Custom)
+            {
+                typeSize = Registry()[type.CustomType].Size;
+            }
 
-                i += typeSize;
+            i += typeSize;
 
-                const VarId b = ReadType<VarId>(codePtr, i);
+            const VarId b = ReadType<VarId>(codePtr, i);
 
-                if(!GetDerived().VisitCompVToI(idIndex++, cond, type, aValue, typeSize, b))
-                {
-                    return false;
-                }
-                break;
-            }
-            case SsaOpcode::CompItoV:
+            if(!GetDerived().VisitCompVToI(idIndex++, cond, type, aValue, typeSize, b))
             {
-                const CompareCondition cond = ReadType<CompareCondition>(codePtr, i);
-                const SsaCustomType type = ReadType<SsaCustomType>(codePtr, i);
-                const VarId a = ReadType<VarId>(codePtr, i);
-                const void* const bValue = codePtr + i;
+                return false;
+            }
+            break;
+        }
+        case SsaOpcode::CompItoV:
+        {
+            const CompareCondition cond = ReadType<CompareCondition>(codePtr, i);
+            const SsaCustomType type = ReadType<SsaCustomType>(codePtr, i);
+            const VarId a = ReadType<VarId>(codePtr, i);
+            const void* const bValue = codePtr + i;
 
-                u32 typeSize = static_cast<u32>(TypeValueSize(type.Type));
+            u32 typeSize = static_cast<u32>(TypeValueSize(type.Type));
 
-                if(StripPointer(type.Type) == SsaType::Bytes || StripPointer(type.Type) == SsaType::Custom)
-                {
-                    typeSize = Registry()[type.CustomType].Size;
-                }
+            if(StripPointer(type.Type) == SsaType::Bytes || StripPointer(type.Type) == SsaType::Custom)
+            {
+                typeSize = Registry()[type.CustomType].Size;
+            }
 
-                i += typeSize;
+            i += typeSize;
 
-                if(!GetDerived().VisitCompIToV(idIndex++, cond, type, a, bValue, typeSize))
-                {
-                    return false;
-                }
-                break;
+            if(!GetDerived().VisitCompIToV(idIndex++, cond, type, a, bValue, typeSize))
+            {
+                return false;
             }
-            case SsaOpcode::Branch:
+            break;
+        }
+        case SsaOpcode::Branch:
+        {
+            const VarId label = ReadType<VarId>(codePtr, i);
+            if(!GetDerived().VisitBranch(label))
             {
-                const VarId label = ReadType<VarId>(codePtr, i);
-                if(!GetDerived().VisitBranch(label))
-                {
-                    return false;
-                }
-                break;
+                return false;
             }
-            case SsaOpcode::BranchCond:
+            break;
+        }
+        case SsaOpcode::BranchCond:
+        {
+            const VarId labelTrue = ReadType<VarId>(codePtr, i);
+            const VarId labelFalse = ReadType<VarId>(codePtr, i);
+            const VarId conditionVar = ReadType<VarId>(codePtr, i);
+
+            if(!GetDerived().VisitBranchCond(labelTrue, labelFalse, conditionVar))
             {
-                const VarId labelTrue = ReadType<VarId>(codePtr, i);
-                const VarId labelFalse = ReadType<VarId>(codePtr, i);
-                const VarId conditionVar = ReadType<VarId>(codePtr, i);
+                return false;
+            }
+            break;
+        }
+        case SsaOpcode::Call:
+        {
+            const u32 functionIndex = ReadType<u32>(codePtr, i);
+            const VarId baseIndex = ReadType<VarId>(codePtr, i);
+            const u32 parameterCount = ReadType<u32>(codePtr, i);
 
-                if(!GetDerived().VisitBranchCond(labelTrue, labelFalse, conditionVar))
-                {
-                    return false;
-                }
-                break;
+            if(!GetDerived().VisitCall(idIndex++, functionIndex, baseIndex, parameterCount))
+            {
+                return false;
             }
-            case SsaOpcode::Call:
+            break;
+        }
+        case SsaOpcode::CallExt:
+        {
+            const u32 functionIndex = ReadType<u32>(codePtr, i);
+            const VarId baseIndex = ReadType<VarId>(codePtr, i);
+            const u32 parameterCount = ReadType<u32>(codePtr, i);
+            const u16 moduleIndex = ReadType<u16>(codePtr, i);
+
+            if(!GetDerived().VisitCallExt(idIndex++, functionIndex, baseIndex, parameterCount, moduleIndex))
             {
-                const u32 functionIndex = ReadType<u32>(codePtr, i);
-                const VarId baseIndex = ReadType<VarId>(codePtr, i);
-                const u32 parameterCount = ReadType<u32>(codePtr, i);
+                return false;
+            }
+            break;
+        }
+        case SsaOpcode::CallInd:
+        {
+            const VarId functionPointer = ReadType<VarId>(codePtr, i);
+            const VarId baseIndex = ReadType<VarId>(codePtr, i);
+            const u32 parameterCount = ReadType<u32>(codePtr, i);
 
-                if(!GetDerived().VisitCall(idIndex++, functionIndex, baseIndex, parameterCount))
-                {
-                    return false;
-                }
-                break;
+            if(!GetDerived().VisitCallInd(idIndex++, functionPointer, baseIndex, parameterCount))
+            {
+                return false;
+            }
+            break;
+        }
+        case SsaOpcode::CallIndExt:
+        {
+            const VarId functionPointer = ReadType<VarId>(codePtr, i);
+            const VarId baseIndex = ReadType<VarId>(codePtr, i);
+            const u32 parameterCount = ReadType<u32>(codePtr, i);
+            const VarId modulePointer = ReadType<VarId>(codePtr, i);
+
+            if(!GetDerived().VisitCallIndExt(idIndex++, functionPointer, baseIndex, parameterCount, modulePointer))
+            {
+                return false;
+            }
+            break;
+        }
+        case SsaOpcode::Ret:
+        {
+            const SsaCustomType type = ReadType<SsaCustomType>(codePtr, i);
+            const VarId var = ReadType<VarId>(codePtr, i);
+
+            if(!GetDerived().VisitRet(type, var))
+            {
+                return false;
             }
-            case SsaOpcode::CallExt:
+            break;
+        }
+        case SsaOpcode::Phi:
+        {
+            const SsaCustomType type = ReadType<SsaCustomType>(codePtr, i);
+            const u32 incomingCount = ReadType<u32>(codePtr, i);
+
+            // The labels and vars are stored as two contiguous arrays.
+            if(incomingCount <= 16)
             {
-                const u32 functionIndex = ReadType<u32>(codePtr, i);
-                const VarId baseIndex = ReadType<VarId>(codePtr, i);
-                const u32 parameterCount = ReadType<u32>(codePtr, i);
-                const u16 moduleIndex = ReadType<u16>(codePtr, i);
+                VarId operands[32];
 
-                if(!GetDerived().VisitCallExt(idIndex++, functionIndex, baseIndex, parameterCount, moduleIndex))
+                for(uSys j = 0; j < incomingCount * 2; ++j)
                 {
-                    return false;
+                    operands[j] = ReadType<VarId>(codePtr, i);
                 }
-                break;
-            }
-            case SsaOpcode::CallInd:
-            {
-                const VarId functionPointer = ReadType<VarId>(codePtr, i);
-                const VarId baseIndex = ReadType<VarId>(codePtr, i);
-                const u32 parameterCount = ReadType<u32>(codePtr, i);
 
-                if(!GetDerived().VisitCallInd(idIndex++, functionPointer, baseIndex, parameterCount))
+                if(!GetDerived().VisitPhi(idIndex, type, incomingCount, operands, operands + incomingCount))
                 {
                     return false;
                 }
-                break;
             }
-            case SsaOpcode::CallIndExt:
+            else
             {
-                const VarId functionPointer = ReadType<VarId>(codePtr, i);
-                const VarId baseIndex = ReadType<VarId>(codePtr, i);
-                const u32 parameterCount = ReadType<u32>(codePtr, i);
-                const VarId modulePointer = ReadType<VarId>(codePtr, i);
+                DynArray<VarId> operands(incomingCount * 2);
 
-                if(!GetDerived().VisitCallIndExt(idIndex++, functionPointer, baseIndex, parameterCount, modulePointer))
+                for(uSys j = 0; j < incomingCount * 2; ++j)
                 {
-                    return false;
+                    operands[j] = ReadType<VarId>(codePtr, i);
                 }
-                break;
-            }
-            case SsaOpcode::Ret:
-            {
-                const SsaCustomType type = ReadType<SsaCustomType>(codePtr, i);
-                const VarId var = ReadType<VarId>(codePtr, i);
 
-                if(!GetDerived().VisitRet(type, var))
+                if(!GetDerived().VisitPhi(idIndex, type, incomingCount, operands.arr(), operands.arr() + incomingCount))
                 {
                     return false;
                 }
+            }
+
+            ++idIndex;
+            break;
+        }
+    }
+
+    return true;
+}
+
+template<typename Derived>
+bool SsaVisitor<Derived>::Traverse(const SsaGraph& graph) noexcept
+{
+    if(!GetDerived().PreTraversal(nullptr, graph.EncodedSize(), graph.MaxVarId()))
+    {
+        return false;
+    }
+
+    for(u32 inst = 0; inst < graph.InstructionCount(); ++inst)
+    {
+        const VarId result = graph.Result(inst);
+        const SsaCustomType type = graph.Type(inst);
+        const VarId* const operands = graph.Operands(inst);
+        const u8* const immediate = graph.Immediate(inst);
+        const uSys immediateSize = graph.ImmediateSize(inst);
+        const u32 parameterOffset = graph.ParameterOffset(inst);
+        const VarId baseIndex = graph.OperandCount(inst) > parameterOffset ? operands[parameterOffset] : result;
+
+        bool success = true;
+
+        switch(graph.Opcode(inst))
+        {
+            case SsaOpcode::Nop: break;
+            case SsaOpcode::Label: success = GetDerived().VisitLabel(result); break;
+            case SsaOpcode::AssignImmediate: success = GetDerived().VisitAssignImmediate(result, type, immediate, immediateSize); break;
+            case SsaOpcode::AssignVariable: success = GetDerived().VisitAssignVar(result, type, operands[0]); break;
+            case SsaOpcode::ExpandSX: success = GetDerived().VisitExpandSX(result, type, graph.SourceType(inst), operands[0]); break;
+            case SsaOpcode::ExpandZX: success = GetDerived().VisitExpandZX(result, type, graph.SourceType(inst), operands[0]); break;
+            case SsaOpcode::Trunc: success = GetDerived().VisitTrunc(result, type, graph.SourceType(inst), operands[0]); break;
+            case SsaOpcode::RCast: success = GetDerived().VisitRCast(result, type, graph.SourceType(inst), operands[0]); break;
+            case SsaOpcode::BCast: success = GetDerived().VisitBCast(result, type, graph.SourceType(inst), operands[0]); break;
+            case SsaOpcode::Load: success = GetDerived().VisitLoad(result, type, operands[0]); break;
+            case SsaOpcode::StoreV: success = GetDerived().VisitStoreV(type, operands[0], operands[1]); break;
+            case SsaOpcode::StoreI: success = GetDerived().VisitStoreI(type, operands[0], immediate, immediateSize); break;
+            case SsaOpcode::ComputePtr:
+            {
+                uSys i = 0;
+                const i8 multiplier = internal::ReadType<i8>(immediate, i);
+                const i16 offset = internal::ReadType<i16>(immediate, i);
+                success = GetDerived().VisitComputePtr(result, operands[0], operands[1], multiplier, offset);
                 break;
             }
+            case SsaOpcode::BinOpVtoV: success = GetDerived().VisitBinOpVToV(result, graph.BinaryOperation(inst), type, operands[0], operands[1]); break;
+            case SsaOpcode::BinOpVtoI: success = GetDerived().VisitBinOpVToI(result, graph.BinaryOperation(inst), type, immediate, immediateSize, operands[0]); break;
+            case SsaOpcode::BinOpItoV: success = GetDerived().VisitBinOpIToV(result, graph.BinaryOperation(inst), type, operands[0], immediate, immediateSize); break;
+            case SsaOpcode::Split: success = GetDerived().VisitSplit(result, type, operands[0], graph.ResultCount(inst), graph.TypeList(inst)); break;
+            case SsaOpcode::Join: success = GetDerived().VisitJoin(result, type, graph.OperandCount(inst), graph.TypeList(inst), operands); break;
+            case SsaOpcode::CompVtoV: success = GetDerived().VisitCompVToV(result, graph.Condition(inst), type, operands[0], operands[1]); break;
+            case SsaOpcode::CompVtoI: success = GetDerived().VisitCompVToI(result, graph.Condition(inst), type, immediate, immediateSize, operands[0]); break;
+            case SsaOpcode::CompItoV: success = GetDerived().VisitCompIToV(result, graph.Condition(inst), type, operands[0], immediate, immediateSize); break;
+            case SsaOpcode::Branch: success = GetDerived().VisitBranch(operands[0]); break;
+            case SsaOpcode::BranchCond: success = GetDerived().VisitBranchCond(operands[0], operands[1], operands[2]); break;
+            case SsaOpcode::Call: success = GetDerived().VisitCall(result, graph.FunctionIndex(inst), baseIndex, graph.ParameterCount(inst)); break;
+            case SsaOpcode::CallExt: success = GetDerived().VisitCallExt(result, graph.FunctionIndex(inst), baseIndex, graph.ParameterCount(inst), graph.ModuleIndex(inst)); break;
+            case SsaOpcode::CallInd: success = GetDerived().VisitCallInd(result, operands[0], baseIndex, graph.ParameterCount(inst)); break;
+            case SsaOpcode::CallIndExt: success = GetDerived().VisitCallIndExt(result, operands[0], baseIndex, graph.ParameterCount(inst), operands[1]); break;
+            case SsaOpcode::Ret: success = GetDerived().VisitRet(type, operands[0]); break;
+            case SsaOpcode::Phi: success = GetDerived().VisitPhi(result, type, graph.OperandCount(inst) / 2, operands, operands + graph.OperandCount(inst) / 2); break;
+            default: return false;
+        }
+
+        if(!success)
+        {
+            return false;
         }
     }
 
-    return PostTraversal();
+    return GetDerived().PostTraversal();
 }
 
 }
@@ -2,9 +2,9 @@
 
 #include <Objects.hpp>
 #include <NumTypes.hpp>
-#include <deque>
 #include <vector>
 
+#include "SsaArena.hpp"
 #include "SsaTypes.hpp"
 #include "SsaOpcodes.hpp"
 #include "TauIR/Opcodes.hpp"
@@ -15,9 +15,14 @@ class SsaWriter
 {
     DELETE_COPY(SsaWriter);
 public:
-    using VarTypeMapType = ::std::vector<SsaCustomType>;
+    using VarTypeMapType = ::std::vector<SsaCustomType, SsaArenaAllocator<SsaCustomType>>;
 public:
     SsaWriter(uSys initialBufferSize = 64) noexcept;
+    /**
+     *   Writes into memory from the arena. The writer must be detached
+     * before the arena is reset if it needs to outlive it.
+     */
+    SsaWriter(SsaArena& arena, uSys initialBufferSize = 64) noexcept;
     ~SsaWriter() noexcept;
 
     SsaWriter(SsaWriter&& move) noexcept;
@@ -51,11 +56,57 @@ public:
     VarId WriteCallInd(VarId functionPointer, VarId baseIndex, u32 parameterCount) noexcept;
     VarId WriteCallIndExt(VarId functionPointer, VarId baseIndex, u32 parameterCount, VarId modulePointer) noexcept;
     void WriteRet(SsaCustomType returnType, VarId var) noexcept;
+    VarId WritePhi(SsaCustomType type, u32 n, const VarId* labels, const VarId* vars) noexcept;
+
+    /**
+     *   Overwrites a var id that has already been written. Forward
+     * branches and loop phis reference labels and vars that don't exist
+     * yet, those are written as placeholders and patched once known.
+     */
+    void PatchVarId(uSys offset, VarId var) noexcept;
+
+    /**
+     *   Moves the buffer and the var type map out of the arena and onto
+     * the heap, each is allocated at exactly its final size.
+     */
+    void DetachArena() noexcept;
+
+    /**
+     *   Empties the writer so that it can be written again. The buffer
+     * and the var type map keep their memory, the buffer is grown to at
+     * least the given size.
+     */
+    void Reset(uSys minimumBufferSize = 0) noexcept;
+
+    /**
+     *   Records the offset of every instruction written from now on, and
+     * which instruction defines each var. This is what allows the code to
+     * be traversed in reverse, or visited at a single instruction. The
+     * setting is kept across Reset, enabling it on a writer that already
+     * holds code leaves that code out of the index.
+     */
+    void RecordInstructionIndex(bool record = true) noexcept { m_RecordInstructionIndex = record; }
+
+    [[nodiscard]] bool HasInstructionIndex() const noexcept { return m_RecordInstructionIndex; }
+    [[nodiscard]] u32 InstructionCount() const noexcept { return static_cast<u32>(m_InstructionOffsets.size()); }
+    [[nodiscard]] const u32* InstructionOffsets() const noexcept { return m_InstructionOffsets.data(); }
+
+    /**
+     *   The id of the first var each instruction defines. Instructions
+     * that don't define a var get the id the next var will have.
+     */
+    [[nodiscard]] const VarId* InstructionIds() const noexcept { return m_InstructionIds.data(); }
+
+    /**
+     * The index of the instruction that defines the var, or -1 if it isn't known.
+     */
+    [[nodiscard]] u32 VarDefinition(VarId var) const noexcept;
 
     [[nodiscard]] SsaCustomType GetVarType(const VarId var) const noexcept { return m_VarTypeMap[var]; }
 
     [[nodiscard]] const u8* Buffer() const noexcept { return m_Buffer; }
     [[nodiscard]] uSys Size() const noexcept { return m_WriteIndex; }
+    [[nodiscard]] uSys Capacity() const noexcept { return m_BufferSize; }
     [[nodiscard]] VarId IdIndex() const noexcept { return m_IdIndex; }
     [[nodiscard]] const VarTypeMapType& VarTypeMap() const noexcept { return m_VarTypeMap; }
 private:
@@ -72,11 +123,74 @@ private:
     void WriteOpcode(SsaOpcode opcode) noexcept;
     void WriteType(SsaCustomType type) noexcept;
 private:
+    SsaArena* m_Arena;
     u8* m_Buffer;
     uSys m_BufferSize;
     uSys m_WriteIndex;
     VarId m_IdIndex;
     VarTypeMapType m_VarTypeMap;
+    bool m_RecordInstructionIndex;
+    // The index stays empty, and doesn't allocate, unless it is recorded.
+    ::std::vector<u32> m_InstructionOffsets;
+    ::std::vector<VarId> m_InstructionIds;
+    // Filled in lazily when the next instruction is written, the vars of the last instruction aren't in here yet.
+    ::std::vector<u32> m_VarDefinitions;
+};
+
+/**
+ * \brief Collects operands that reference vars which haven't been rewritten yet.
+ *
+ *   Rewriting passes map old vars to new vars in a single forward
+ * traversal. Branches to later labels and phis on loop back edges
+ * reference vars the pass hasn't reached, so they are written with the
+ * old var and patched once the traversal is complete.
+ */
+class SsaForwardRefs final
+{
+    DEFAULT_CONSTRUCT_PU(SsaForwardRefs);
+    DEFAULT_DESTRUCT(SsaForwardRefs);
+    DEFAULT_CM_PU(SsaForwardRefs);
+public:
+    void Add(const uSys offset, const VarId oldVar) noexcept
+    {
+        m_Refs.push_back({ offset, oldVar });
+    }
+
+    /**
+     * Adds every operand of the phi that was just written.
+     */
+    void AddPhi(const SsaWriter& writer, const u32 n, const VarId* const labels, const VarId* const vars) noexcept
+    {
+        const uSys labelsOffset = writer.Size() - 2 * n * sizeof(VarId);
+        const uSys varsOffset = writer.Size() - n * sizeof(VarId);
+
+        for(u32 i = 0; i < n; ++i)
+        {
+            Add(labelsOffset + i * sizeof(VarId), labels[i]);
+            Add(varsOffset + i * sizeof(VarId), vars[i]);
+        }
+    }
+
+    template<typename MapFunc>
+    void Resolve(SsaWriter& writer, MapFunc&& map) noexcept
+    {
+        for(const Ref& ref : m_Refs)
+        {
+            writer.PatchVarId(ref.Offset, map(ref.OldVar));
+        }
+
+        m_Refs.clear();
+    }
+
+    void Clear() noexcept { m_Refs.clear(); }
+private:
+    struct Ref final
+    {
+        uSys Offset;
+        VarId OldVar;
+    };
+private:
+    ::std::vector<Ref> m_Refs;
 };
 
 /**
@@ -101,7 +215,9 @@ public:
         { }
     };
 public:
-    SsaFrameTracker(uSys localCount) noexcept;
+    using FrameStack = ::std::vector<FrameInfo, SsaArenaAllocator<FrameInfo>>;
+public:
+    SsaFrameTracker(uSys localCount, SsaArena* arena = nullptr) noexcept;
     ~SsaFrameTracker() noexcept;
 
     SsaFrameTracker(SsaFrameTracker&& move) noexcept;
@@ -116,8 +232,12 @@ public:
 
     void SetArgument(VarId var, uSys arg);
     [[nodiscard]] VarId GetArgument(uSys arg) const;
+
+    [[nodiscard]] const FrameStack& GetFrames() const noexcept { return m_Frame; }
+    void SetFrames(const FrameStack& frames) noexcept { m_Frame = frames; }
 private:
-    ::std::deque<FrameInfo> m_Frame;
+    SsaArena* m_Arena;
+    FrameStack m_Frame;
     VarId* m_Locals;
     VarId* m_Arguments;
 #ifdef _DEBUG
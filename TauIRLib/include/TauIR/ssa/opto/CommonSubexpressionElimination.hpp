@@ -0,0 +1,370 @@
+#pragma once
+
+#include "TauIR/ssa/opto/ReWriteVisitor.hpp"
+#include <cstring>
+#include <unordered_map>
+#include <utility>
+
+namespace tau::ir::ssa::opto {
+
+namespace internal {
+
+/**
+ *   Everything that determines the value of a pure instruction. Operands
+ * are the vars of the rewritten code, immediates of up to 8 bytes are
+ * stored inline. Commutative operands are stored in a canonical order,
+ * the instruction itself is written unchanged.
+ */
+struct ValueKey final
+{
+    SsaOpcode Opcode;
+    u8 Operation;
+    SsaType Type;
+    SsaType SourceType;
+    u32 CustomType;
+    VarId A;
+    VarId B;
+    // Loads are only equal if no store or call happened between them.
+    u32 MemoryEpoch;
+    u64 Immediate;
+
+    [[nodiscard]] bool operator==(const ValueKey& other) const noexcept = default;
+};
+
+struct ValueKeyHash final
+{
+    [[nodiscard]] uSys operator()(const ValueKey& key) const noexcept
+    {
+        u64 hash = static_cast<u64>(key.Opcode);
+        hash = hash * 31 + key.Operation;
+        hash = hash * 31 + static_cast<u64>(key.Type);
+        hash = hash * 31 + static_cast<u64>(key.SourceType);
+        hash = hash * 31 + key.CustomType;
+        hash = hash * 0x9E3779B97F4A7C15ull + key.A;
+        hash = hash * 0x9E3779B97F4A7C15ull + key.B;
+        hash = hash * 31 + key.MemoryEpoch;
+        hash = hash * 0x9E3779B97F4A7C15ull + key.Immediate;
+        return static_cast<uSys>(hash ^ (hash >> 32));
+    }
+};
+
+[[nodiscard]] inline bool IsCommutative(const SsaBinaryOperation operation) noexcept
+{
+    return operation == SsaBinaryOperation::Add || operation == SsaBinaryOperation::Mul || operation == SsaBinaryOperation::MulHigh;
+}
+
+}
+
+/**
+ * \brief Removes instructions that compute a value that is already available.
+ *
+ *   Pure instructions are hashed by their opcode, types, operation and
+ * operands, operands are first mapped to the vars they were replaced by.
+ * Add, Mul, MulHigh, Equal and NotEqual match with their operands
+ * swapped, as do comparisons with a mirrored condition. When an
+ * instruction matches an earlier one its result is mapped to the earlier
+ * var, and it isn't written.
+ *
+ *   Values are numbered within a basic block, the table is cleared at
+ * every label. Without a dominator tree an earlier value in another block
+ * may not be available on every path. Loads are only matched if no store
+ * or call happened in between.
+ *
+ *   Everything else is copied by ReWriteVisitorBase.
+ */
+// ReSharper disable CppHidingFunction
+class CommonSubexpressionEliminationVisitor final : public ReWriteVisitorBase<CommonSubexpressionEliminationVisitor>
+{
+    DEFAULT_DESTRUCT(CommonSubexpressionEliminationVisitor);
+    DELETE_CM(CommonSubexpressionEliminationVisitor);
+public:
+    CommonSubexpressionEliminationVisitor(const SsaCustomTypeRegistry& registry) noexcept
+        : ReWriteVisitorBase(registry)
+        , m_Values()
+        , m_MemoryEpoch(0)
+        , m_EliminatedCount(0)
+    { }
+
+    /**
+     * The number of instructions removed by the last traversal.
+     */
+    [[nodiscard]] u32 EliminatedCount() const noexcept { return m_EliminatedCount; }
+public:
+    bool PreTraversal(const u8* const codePtr, const uSys size, const VarId maxId) noexcept
+    {
+        m_Values.clear();
+        m_MemoryEpoch = 0;
+        m_EliminatedCount = 0;
+
+        return ReWriteVisitorBase::PreTraversal(codePtr, size, maxId);
+    }
+
+    bool VisitLabel(const VarId label) noexcept
+    {
+        // A value from the previous block may not be available on every path into this one.
+        m_Values.clear();
+        return ReWriteVisitorBase::VisitLabel(label);
+    }
+
+    bool VisitAssignImmediate(const VarId newVar, const SsaCustomType type, const void* const value, const uSys size) noexcept
+    {
+        internal::ValueKey key = MakeKey(SsaOpcode::AssignImmediate, 0, type, 0, 0);
+
+        if(!SetImmediate(key, value, size))
+        {
+            m_NewVarMap[newVar] = m_Writer.WriteAssignImmediate(type, value, size);
+            return true;
+        }
+
+        return Number(newVar, key, [&]() { return m_Writer.WriteAssignImmediate(type, value, size); });
+    }
+
+    bool VisitExpandSX(const VarId newVar, const SsaCustomType newType, const SsaCustomType oldType, const VarId var) noexcept
+    {
+        const VarId source = FindSourceVar(var);
+        internal::ValueKey key = MakeKey(SsaOpcode::ExpandSX, 0, newType, source, 0);
+        key.SourceType = oldType.Type;
+
+        return Number(newVar, key, [&]() { return m_Writer.WriteExpandSX(newType, oldType, source); });
+    }
+
+    bool VisitExpandZX(const VarId newVar, const SsaCustomType newType, const SsaCustomType oldType, const VarId var) noexcept
+    {
+        const VarId source = FindSourceVar(var);
+        internal::ValueKey key = MakeKey(SsaOpcode::ExpandZX, 0, newType, source, 0);
+        key.SourceType = oldType.Type;
+
+        return Number(newVar, key, [&]() { return m_Writer.WriteExpandZX(newType, oldType, source); });
+    }
+
+    bool VisitTrunc(const VarId newVar, const SsaCustomType newType, const SsaCustomType oldType, const VarId var) noexcept
+    {
+        const VarId source = FindSourceVar(var);
+        internal::ValueKey key = MakeKey(SsaOpcode::Trunc, 0, newType, source, 0);
+        key.SourceType = oldType.Type;
+
+        return Number(newVar, key, [&]() { return m_Writer.WriteTrunc(newType, oldType, source); });
+    }
+
+    bool VisitRCast(const VarId newVar, const SsaCustomType newType, const SsaCustomType oldType, const VarId var) noexcept
+    {
+        const VarId source = FindSourceVar(var);
+        internal::ValueKey key = MakeKey(SsaOpcode::RCast, 0, newType, source, 0);
+        key.SourceType = oldType.Type;
+
+        return Number(newVar, key, [&]() { return m_Writer.WriteRCast(newType, oldType, source); });
+    }
+
+    bool VisitBCast(const VarId newVar, const SsaCustomType newType, const SsaCustomType oldType, const VarId var) noexcept
+    {
+        const VarId source = FindSourceVar(var);
+        internal::ValueKey key = MakeKey(SsaOpcode::BCast, 0, newType, source, 0);
+        key.SourceType = oldType.Type;
+
+        return Number(newVar, key, [&]() { return m_Writer.WriteBCast(newType, oldType, source); });
+    }
+
+    bool VisitLoad(const VarId newVar, const SsaCustomType type, const VarId var) noexcept
+    {
+        const VarId source = FindSourceVar(var);
+        internal::ValueKey key = MakeKey(SsaOpcode::Load, 0, type, source, 0);
+        key.MemoryEpoch = m_MemoryEpoch;
+
+        return Number(newVar, key, [&]() { return m_Writer.WriteLoad(type, source); });
+    }
+
+    bool VisitStoreV(const SsaCustomType type, const VarId destination, const VarId source) noexcept
+    {
+        ++m_MemoryEpoch;
+        return ReWriteVisitorBase::VisitStoreV(type, destination, source);
+    }
+
+    bool VisitStoreI(const SsaCustomType type, const VarId destination, const void* const value, const uSys size) noexcept
+    {
+        ++m_MemoryEpoch;
+        return ReWriteVisitorBase::VisitStoreI(type, destination, value, size);
+    }
+
+    bool VisitComputePtr(const VarId newVar, const VarId base, const VarId index, const i8 multiplier, const i16 offset) noexcept
+    {
+        const VarId newBase = FindSourceVar(base);
+        const VarId newIndex = FindSourceVar(index);
+        internal::ValueKey key = MakeKey(SsaOpcode::ComputePtr, 0, SsaCustomType(SsaType::Void), newBase, newIndex);
+        key.Immediate = static_cast<u8>(multiplier) | (static_cast<u64>(static_cast<u16>(offset)) << 8);
+
+        return Number(newVar, key, [&]() { return m_Writer.WriteComputePtr(newBase, newIndex, multiplier, offset); });
+    }
+
+    bool VisitBinOpVToV(const VarId newVar, const SsaBinaryOperation operation, const SsaCustomType type, const VarId a, const VarId b) noexcept
+    {
+        const VarId newA = FindSourceVar(a);
+        const VarId newB = FindSourceVar(b);
+        internal::ValueKey key = MakeKey(SsaOpcode::BinOpVtoV, static_cast<u8>(operation), type, newA, newB);
+
+        if(internal::IsCommutative(operation) && newB < newA)
+        {
+            ::std::swap(key.A, key.B);
+        }
+
+        return Number(newVar, key, [&]() { return m_Writer.WriteBinOpVtoV(operation, type, newA, newB); });
+    }
+
+    bool VisitBinOpVToI(const VarId newVar, const SsaBinaryOperation operation, const SsaCustomType type, const void* const a, const uSys aSize, const VarId b) noexcept
+    {
+        const VarId newB = FindSourceVar(b);
+        internal::ValueKey key = MakeKey(SsaOpcode::BinOpVtoI, static_cast<u8>(operation), type, newB, 0);
+
+        if(!SetImmediate(key, a, aSize))
+        {
+            m_NewVarMap[newVar] = m_Writer.WriteBinOpVtoI(operation, type, a, aSize, newB);
+            return true;
+        }
+
+        return Number(newVar, key, [&]() { return m_Writer.WriteBinOpVtoI(operation, type, a, aSize, newB); });
+    }
+
+    bool VisitBinOpIToV(const VarId newVar, const SsaBinaryOperation operation, const SsaCustomType type, const VarId a, const void* const b, const uSys bSize) noexcept
+    {
+        const VarId newA = FindSourceVar(a);
+        internal::ValueKey key = MakeKey(SsaOpcode::BinOpItoV, static_cast<u8>(operation), type, newA, 0);
+
+        if(!SetImmediate(key, b, bSize))
+        {
+            m_NewVarMap[newVar] = m_Writer.WriteBinOpItoV(operation, type, newA, b, bSize);
+            return true;
+        }
+
+        return Number(newVar, key, [&]() { return m_Writer.WriteBinOpItoV(operation, type, newA, b, bSize); });
+    }
+
+    bool VisitCompVToV(const VarId newVar, const CompareCondition condition, const SsaCustomType type, const VarId a, const VarId b) noexcept
+    {
+        const VarId newA = FindSourceVar(a);
+        const VarId newB = FindSourceVar(b);
+        internal::ValueKey key = MakeKey(SsaOpcode::CompVtoV, static_cast<u8>(condition), type, newA, newB);
+
+        if(newB < newA)
+        {
+            ::std::swap(key.A, key.B);
+            key.Operation = static_cast<u8>(MirrorCondition(condition));
+        }
+
+        return Number(newVar, key, [&]() { return m_Writer.WriteCompVtoV(condition, type, newA, newB); });
+    }
+
+    bool VisitCompVToI(const VarId newVar, const CompareCondition condition, const SsaCustomType type, const void* const a, const uSys aSize, const VarId b) noexcept
+    {
+        const VarId newB = FindSourceVar(b);
+        internal::ValueKey key = MakeKey(SsaOpcode::CompVtoI, static_cast<u8>(condition), type, newB, 0);
+
+        if(!SetImmediate(key, a, aSize))
+        {
+            m_NewVarMap[newVar] = m_Writer.WriteCompVtoI(condition, type, a, aSize, newB);
+            return true;
+        }
+
+        return Number(newVar, key, [&]() { return m_Writer.WriteCompVtoI(condition, type, a, aSize, newB); });
+    }
+
+    bool VisitCompIToV(const VarId newVar, const CompareCondition condition, const SsaCustomType type, const VarId a, const void* const b, const uSys bSize) noexcept
+    {
+        const VarId newA = FindSourceVar(a);
+        internal::ValueKey key = MakeKey(SsaOpcode::CompItoV, static_cast<u8>(condition), type, newA, 0);
+
+        if(!SetImmediate(key, b, bSize))
+        {
+            m_NewVarMap[newVar] = m_Writer.WriteCompItoV(condition, type, newA, b, bSize);
+            return true;
+        }
+
+        return Number(newVar, key, [&]() { return m_Writer.WriteCompItoV(condition, type, newA, b, bSize); });
+    }
+
+    bool VisitCall(const VarId newVar, const u32 functionIndex, const VarId baseIndex, const u32 parameterCount) noexcept
+    {
+        ++m_MemoryEpoch;
+        return ReWriteVisitorBase::VisitCall(newVar, functionIndex, baseIndex, parameterCount);
+    }
+
+    bool VisitCallExt(const VarId newVar, const u32 functionIndex, const VarId baseIndex, const u32 parameterCount, const u16 moduleIndex) noexcept
+    {
+        ++m_MemoryEpoch;
+        return ReWriteVisitorBase::VisitCallExt(newVar, functionIndex, baseIndex, parameterCount, moduleIndex);
+    }
+
+    bool VisitCallInd(const VarId newVar, const VarId functionPointer, const VarId baseIndex, const u32 parameterCount) noexcept
+    {
+        ++m_MemoryEpoch;
+        return ReWriteVisitorBase::VisitCallInd(newVar, functionPointer, baseIndex, parameterCount);
+    }
+
+    bool VisitCallIndExt(const VarId newVar, const VarId functionPointer, const VarId baseIndex, const u32 parameterCount, const VarId modulePointer) noexcept
+    {
+        ++m_MemoryEpoch;
+        return ReWriteVisitorBase::VisitCallIndExt(newVar, functionPointer, baseIndex, parameterCount, modulePointer);
+    }
+private:
+    [[nodiscard]] static internal::ValueKey MakeKey(const SsaOpcode opcode, const u8 operation, const SsaCustomType type, const VarId a, const VarId b) noexcept
+    {
+        return { opcode, operation, type.Type, SsaType::Void, type.CustomType, a, b, 0, 0 };
+    }
+
+    /**
+     * @return False if the immediate is too large to be numbered.
+     */
+    [[nodiscard]] static bool SetImmediate(internal::ValueKey& key, const void* const value, const uSys size) noexcept
+    {
+        if(size > sizeof(key.Immediate))
+        {
+            return false;
+        }
+
+        (void) ::std::memcpy(&key.Immediate, value, size);
+        return true;
+    }
+
+    template<typename WriteFunc>
+    bool Number(const VarId newVar, const internal::ValueKey& key, WriteFunc&& write) noexcept
+    {
+        const auto existing = m_Values.find(key);
+
+        if(existing != m_Values.end())
+        {
+            m_NewVarMap[newVar] = existing->second;
+            ++m_EliminatedCount;
+            return true;
+        }
+
+        const VarId written = write();
+        m_NewVarMap[newVar] = written;
+        m_Values.emplace(key, written);
+
+        return true;
+    }
+
+    /**
+     *   Swapping the operands of a comparison turns greater into less, and
+     * above into below.
+     */
+    [[nodiscard]] static CompareCondition MirrorCondition(const CompareCondition condition) noexcept
+    {
+        switch(condition)
+        {
+            case CompareCondition::Above:          return CompareCondition::Below;
+            case CompareCondition::AboveOrEqual:   return CompareCondition::BelowOrEqual;
+            case CompareCondition::Below:          return CompareCondition::Above;
+            case CompareCondition::BelowOrEqual:   return CompareCondition::AboveOrEqual;
+            case CompareCondition::Greater:        return CompareCondition::Less;
+            case CompareCondition::GreaterOrEqual: return CompareCondition::LessOrEqual;
+            case CompareCondition::Less:           return CompareCondition::Greater;
+            case CompareCondition::LessOrEqual:    return CompareCondition::GreaterOrEqual;
+            default:                               return condition;
+        }
+    }
+private:
+    ::std::unordered_map<internal::ValueKey, VarId, internal::ValueKeyHash> m_Values;
+    u32 m_MemoryEpoch;
+    u32 m_EliminatedCount;
+};
+
+}
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "TauIR/IntMath.hpp"
 #include "TauIR/ssa/SsaVisitor.hpp"
 #include "TauIR/ssa/SsaWriter.hpp"
 
@@ -96,6 +97,7 @@ public:
 	{ }
 
 	[[nodiscard]] const SsaWriter& Writer() const noexcept { return m_Writer; }
+	[[nodiscard]]       SsaWriter& Writer()       noexcept { return m_Writer; }
 
 	void UpdateAttachment(Function* const function) noexcept
 	{
@@ -121,7 +123,7 @@ public:
 public:
 	bool PreTraversal(const u8* const codePtr, const uSys size, const VarId maxId) noexcept
 	{
-		if(m_Linkages.Count() != maxId)
+		if(m_Linkages.Count() != maxId + 1)
 		{
 			m_Linkages = DynArray<internal::ConstantPropLinkage>(maxId + 1);
 			m_NewVarMap = DynArray<VarId>(maxId + 1);
@@ -134,7 +136,8 @@ public:
 			m_Linkages[i] = internal::ConstantPropLinkage(i);
 		}
 
-		m_Writer = SsaWriter(size * 3);
+		m_Writer.Reset(size * 3);
+		m_ForwardRefs.Clear();
 
 		return true;
 	}
@@ -804,6 +807,65 @@ public:
 		m_Writer.WriteRet(returnType, source);
 	    return true;
 	}
+
+	bool VisitSplit(const VarId baseIndex, const SsaCustomType aType, const VarId a, const uSys splitCount, const SsaCustomType* const splitTypes) noexcept
+	{
+		const VarId newBase = m_Writer.WriteSplit(aType, FindSourceVar(a), static_cast<u32>(splitCount), splitTypes);
+
+		for(uSys i = 0; i < splitCount; ++i)
+		{
+			m_NewVarMap[baseIndex + i] = static_cast<VarId>(newBase + i);
+		}
+
+		return true;
+	}
+
+	bool VisitJoin(const VarId newVar, const SsaCustomType newType, const uSys joinCount, const SsaCustomType* const joinTypes, const VarId* const joinVars) noexcept
+	{
+		DynArray<VarId> newJoinVars(joinCount);
+
+		for(uSys i = 0; i < joinCount; ++i)
+		{
+			newJoinVars[i] = FindSourceVar(joinVars[i]);
+		}
+
+		m_NewVarMap[newVar] = m_Writer.WriteJoin(newType, static_cast<u32>(joinCount), joinTypes, newJoinVars);
+
+		return true;
+	}
+
+	bool VisitBranch(const VarId label) noexcept
+	{
+		m_Writer.WriteBranch(label);
+		m_ForwardRefs.Add(m_Writer.Size() - sizeof(VarId), label);
+
+		return true;
+	}
+
+	bool VisitBranchCond(const VarId labelTrue, const VarId labelFalse, const VarId conditionVar) noexcept
+	{
+		m_Writer.WriteBranchCond(labelTrue, labelFalse, FindSourceVar(conditionVar));
+		m_ForwardRefs.Add(m_Writer.Size() - 3 * sizeof(VarId), labelTrue);
+		m_ForwardRefs.Add(m_Writer.Size() - 2 * sizeof(VarId), labelFalse);
+
+		return true;
+	}
+
+	bool VisitPhi(const VarId newVar, const SsaCustomType type, const uSys incomingCount, const VarId* const labels, const VarId* const vars) noexcept
+	{
+		// The incoming values may come from different paths, so a phi is never a constant.
+		m_NewVarMap[newVar] = m_Writer.WritePhi(type, static_cast<u32>(incomingCount), labels, vars);
+		m_ForwardRefs.AddPhi(m_Writer, static_cast<u32>(incomingCount), labels, vars);
+
+		return true;
+	}
+
+	bool PostTraversal() noexcept
+	{
+		m_ForwardRefs.Resolve(m_Writer, [this](const VarId var) { return FindSourceVar(var); });
+
+		return true;
+	}
 private:
 	template<typename TOut, typename TIn>
 	void TransformType(const void* const buffer, const VarId newVar, const SsaCustomType newType) noexcept
@@ -1017,6 +1079,9 @@ private:
 			case SsaBinaryOperation::BarrelShiftRight:
 				result = internal::RotateRight(a, b);
 				break;
+			case SsaBinaryOperation::MulHigh:
+				result = MulHigh(a, b);
+				break;
 		}
 
 		m_NewVarMap[newVar] = m_Writer.WriteAssignImmediate(type, &result, sizeof(result));
@@ -1066,7 +1131,8 @@ private:
 	template<typename T>
 	void CompIToI0(const VarId newVar, const CompareCondition condition, const SsaCustomType type, const T a, const T b)
 	{
-		u8 result = 0;
+		// The result has the type of the operands, so it has to be written with their size.
+		T result{};
 
 		switch(condition)
 		{
@@ -1150,6 +1216,12 @@ private:
 	{
 		m_Linkages[newVar] = internal::ConstantPropLinkage(newVar);
 
+		// Without parameters the base index is the id of the call itself.
+		if(parameterCount == 0)
+		{
+			return m_Writer.IdIndex() + 1;
+		}
+
 		if(parameterCount == 1)
 		{
 			const VarId source = FindSourceVar(baseIndex);
@@ -1177,12 +1249,23 @@ private:
 			}
 			else
 			{
-				for(u32 i = baseIndex; i < baseIndex + parameterCount; ++i)
+				// The copies of the parameters were folded away, they have to be written again to be consecutive.
+				VarId copyBase = 0;
+
+				for(u32 i = 0; i < parameterCount; ++i)
 				{
-					m_Linkages[i] = internal::ConstantPropLinkage(i);
+					const VarId source = FindSourceVar(baseIndex + i);
+					// Arguments aren't in the type map, parameters are passed as U64 anyway.
+					const SsaCustomType type = (source & 0x80000000) != 0 ? SsaCustomType(SsaType::U64) : m_Writer.GetVarType(source);
+					const VarId copy = m_Writer.WriteAssignVariable(type, source);
+
+					if(i == 0)
+					{
+						copyBase = copy;
+					}
 				}
 
-				return baseIndex;
+				return copyBase;
 			}
 		}
 	}
@@ -1200,6 +1283,7 @@ private:
 	DynArray<internal::ConstantPropLinkage> m_Linkages;
 	DynArray<VarId> m_NewVarMap;
 	SsaWriter m_Writer;
+	SsaForwardRefs m_ForwardRefs;
 };
 
 }
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "TauIR/ssa/SsaDefUseIndex.hpp"
 #include "TauIR/ssa/SsaVisitor.hpp"
 #include "TauIR/ssa/SsaWriter.hpp"
 
@@ -12,7 +13,7 @@ class UsageAnalysisFunctionAttachment : public FunctionAttachment
     DELETE_CM(UsageAnalysisFunctionAttachment);
     RTT_IMPL(UsageAnalysisFunctionAttachment, FunctionAttachment);
 public:
-    using TUsageMap = ::std::unordered_multimap<VarId, VarId>;
+    using TUsageMap = SsaDefUseIndex;
 public:
     UsageAnalysisFunctionAttachment(const TUsageMap& usageMap) noexcept
         : m_UsageMap(usageMap)
@@ -20,6 +21,13 @@ public:
 
     [[nodiscard]] const TUsageMap& UsageMap() const noexcept { return m_UsageMap; }
     [[nodiscard]]       TUsageMap& UsageMap()       noexcept { return m_UsageMap; }
+
+    [[nodiscard]] const char* AttachmentName() const noexcept override { return "UsageAnalysisFunctionAttachment"; }
+
+    [[nodiscard]] uSys MemoryUsage() const noexcept override
+    {
+        return sizeof(*this) + m_UsageMap.MemoryUsage();
+    }
 private:
     TUsageMap m_UsageMap;
 };
@@ -45,17 +53,22 @@ public:
 public:
     bool PreTraversal(const u8* const codePtr, const uSys size, const VarId maxId) noexcept
     {
-        m_UsageMap = TUsageMap();
+        m_UsageMap.Reset(maxId);
+
+        return true;
+    }
+
+    bool PostTraversal() noexcept
+    {
+        m_UsageMap.Build();
 
         return true;
     }
 
     bool HandleUsage(const VarId newVar, const VarId var) noexcept
     {
-        if((var & 0x80000000) == 0) // var does not point to an argument
-        {
-            m_UsageMap.insert({ var, newVar });
-        }
+        // Uses of arguments are dropped by the index.
+        m_UsageMap.AddUse(var, newVar);
 
         return true;
     }
@@ -193,6 +206,41 @@ public:
 	{
 		return HandleUsage(var, var);
 	}
+
+	bool VisitSplit(const VarId baseIndex, const SsaCustomType aType, const VarId a, const uSys splitCount, const SsaCustomType* const splitTypes) noexcept
+	{
+		for(uSys i = 0; i < splitCount; ++i)
+		{
+			(void) HandleUsage(static_cast<VarId>(baseIndex + i), a);
+		}
+
+		return true;
+	}
+
+	bool VisitJoin(const VarId newVar, const SsaCustomType newType, const uSys joinCount, const SsaCustomType* const joinTypes, const VarId* const joinVars) noexcept
+	{
+		for(uSys i = 0; i < joinCount; ++i)
+		{
+			(void) HandleUsage(newVar, joinVars[i]);
+		}
+
+		return true;
+	}
+
+	bool VisitBranchCond(const VarId labelTrue, const VarId labelFalse, const VarId conditionVar) noexcept
+	{
+		return HandleUsage(conditionVar, conditionVar);
+	}
+
+	bool VisitPhi(const VarId newVar, const SsaCustomType type, const uSys incomingCount, const VarId* const labels, const VarId* const vars) noexcept
+	{
+		for(uSys i = 0; i < incomingCount; ++i)
+		{
+			(void) HandleUsage(newVar, vars[i]);
+		}
+
+		return true;
+	}
 private:
     TUsageMap m_UsageMap;
 };
@@ -209,6 +257,9 @@ public:
         , m_Writer()
 	    , m_UsageMap(nullptr)
 	    , m_NewVarMap()
+	    , m_Live()
+	    , m_Operands()
+	    , m_ForwardRefs()
 	{
         const UsageAnalysisFunctionAttachment* analysis = function->FindAttachment<UsageAnalysisFunctionAttachment>();
 		if(analysis)
@@ -217,7 +268,23 @@ public:
 		}
 	}
 
+	DeadCodeEliminationVisitor(const SsaCustomTypeRegistry& registry) noexcept
+		: SsaVisitor(registry)
+		, m_Writer()
+		, m_UsageMap(nullptr)
+		, m_NewVarMap()
+		, m_Live()
+		, m_Operands()
+		, m_ForwardRefs()
+	{ }
+
 	[[nodiscard]] const SsaWriter& Writer() const noexcept { return m_Writer; }
+	[[nodiscard]]       SsaWriter& Writer()       noexcept { return m_Writer; }
+
+	/**
+	 * Without a usage map every var is considered live.
+	 */
+	void SetUsageMap(const TUsageMap* const usageMap) noexcept { m_UsageMap = usageMap; }
 
 	void UpdateAttachment(Function* const function) noexcept
 	{
@@ -249,7 +316,17 @@ public:
 
 		(void) ::std::memset(m_NewVarMap.Array(), 0xFF, m_NewVarMap.Size() * sizeof(VarId));
 		
-		m_Writer = SsaWriter(size * 3);
+		m_Writer.Reset(size * 3);
+		m_ForwardRefs.Clear();
+
+		ComputeLiveness(maxId);
+
+		return true;
+	}
+
+	bool PostTraversal() noexcept
+	{
+		m_ForwardRefs.Resolve(m_Writer, [this](const VarId var) { return FindSourceVar(var); });
 
 		return true;
 	}
@@ -436,7 +513,7 @@ public:
 			return true;
 		}
 
-		m_NewVarMap[newVar] = m_Writer.WriteCompVtoI(condition, type, a, aSize, b);
+		m_NewVarMap[newVar] = m_Writer.WriteCompVtoI(condition, type, a, aSize, FindSourceVar(b));
 
 		return true;
 	}
@@ -455,28 +532,28 @@ public:
 
 	bool VisitCall(const VarId newVar, const u32 functionIndex, const VarId baseIndex, const u32 parameterCount) noexcept
 	{
-		m_NewVarMap[newVar] = m_Writer.WriteCall(functionIndex, FindSourceVar(baseIndex), parameterCount);
+		m_NewVarMap[newVar] = m_Writer.WriteCall(functionIndex, FindBaseIndex(baseIndex, parameterCount), parameterCount);
 
 		return true;
 	}
 
 	bool VisitCallExt(const VarId newVar, const u32 functionIndex, const VarId baseIndex, const u32 parameterCount, const u16 moduleIndex) noexcept
 	{
-		m_NewVarMap[newVar] = m_Writer.WriteCallExt(functionIndex, FindSourceVar(baseIndex), parameterCount, moduleIndex);
+		m_NewVarMap[newVar] = m_Writer.WriteCallExt(functionIndex, FindBaseIndex(baseIndex, parameterCount), parameterCount, moduleIndex);
 
 		return true;
 	}
 
 	bool VisitCallInd(const VarId newVar, const VarId functionPointer, const VarId baseIndex, const u32 parameterCount) noexcept
 	{
-		m_NewVarMap[newVar] = m_Writer.WriteCallInd(FindSourceVar(functionPointer), FindSourceVar(baseIndex), parameterCount);
+		m_NewVarMap[newVar] = m_Writer.WriteCallInd(FindSourceVar(functionPointer), FindBaseIndex(baseIndex, parameterCount), parameterCount);
 
 		return true;
 	}
 
 	bool VisitCallIndExt(const VarId newVar, const VarId functionPointer, const VarId baseIndex, const u32 parameterCount, const VarId modulePointer) noexcept
 	{
-		m_NewVarMap[newVar] = m_Writer.WriteCallIndExt(FindSourceVar(functionPointer), FindSourceVar(baseIndex), parameterCount, FindSourceVar(modulePointer));
+		m_NewVarMap[newVar] = m_Writer.WriteCallIndExt(FindSourceVar(functionPointer), FindBaseIndex(baseIndex, parameterCount), parameterCount, FindSourceVar(modulePointer));
 
 		return true;
 	}
@@ -486,6 +563,79 @@ public:
 		m_Writer.WriteRet(returnType, FindSourceVar(var));
 		return true;
 	}
+
+	bool VisitSplit(const VarId baseIndex, const SsaCustomType aType, const VarId a, const uSys splitCount, const SsaCustomType* const splitTypes) noexcept
+	{
+		bool anyUsed = false;
+
+		for(uSys i = 0; i < splitCount; ++i)
+		{
+			anyUsed = anyUsed || ConfirmUsage(static_cast<VarId>(baseIndex + i));
+		}
+
+		if(!anyUsed)
+		{
+			return true;
+		}
+
+		const VarId newBase = m_Writer.WriteSplit(aType, FindSourceVar(a), static_cast<u32>(splitCount), splitTypes);
+
+		for(uSys i = 0; i < splitCount; ++i)
+		{
+			m_NewVarMap[baseIndex + i] = static_cast<VarId>(newBase + i);
+		}
+
+		return true;
+	}
+
+	bool VisitJoin(const VarId newVar, const SsaCustomType newType, const uSys joinCount, const SsaCustomType* const joinTypes, const VarId* const joinVars) noexcept
+	{
+		if(!ConfirmUsage(newVar))
+		{
+			return true;
+		}
+
+		DynArray<VarId> newJoinVars(joinCount);
+
+		for(uSys i = 0; i < joinCount; ++i)
+		{
+			newJoinVars[i] = FindSourceVar(joinVars[i]);
+		}
+
+		m_NewVarMap[newVar] = m_Writer.WriteJoin(newType, static_cast<u32>(joinCount), joinTypes, newJoinVars);
+
+		return true;
+	}
+
+	bool VisitBranch(const VarId label) noexcept
+	{
+		m_Writer.WriteBranch(label);
+		m_ForwardRefs.Add(m_Writer.Size() - sizeof(VarId), label);
+
+		return true;
+	}
+
+	bool VisitBranchCond(const VarId labelTrue, const VarId labelFalse, const VarId conditionVar) noexcept
+	{
+		m_Writer.WriteBranchCond(labelTrue, labelFalse, FindSourceVar(conditionVar));
+		m_ForwardRefs.Add(m_Writer.Size() - 3 * sizeof(VarId), labelTrue);
+		m_ForwardRefs.Add(m_Writer.Size() - 2 * sizeof(VarId), labelFalse);
+
+		return true;
+	}
+
+	bool VisitPhi(const VarId newVar, const SsaCustomType type, const uSys incomingCount, const VarId* const labels, const VarId* const vars) noexcept
+	{
+		if(!ConfirmUsage(newVar))
+		{
+			return true;
+		}
+
+		m_NewVarMap[newVar] = m_Writer.WritePhi(type, static_cast<u32>(incomingCount), labels, vars);
+		m_ForwardRefs.AddPhi(m_Writer, static_cast<u32>(incomingCount), labels, vars);
+
+		return true;
+	}
 private:
 	[[nodiscard]] const TUsageMap& UsageMap() const noexcept { return *m_UsageMap; }
 
@@ -499,31 +649,95 @@ private:
 		return m_NewVarMap[var];
 	}
 
-	bool ConfirmUsage(const VarId var) noexcept
+	/**
+	 *   Without parameters the base index of a call is the id of the
+	 * call itself, which hasn't been written yet.
+	 */
+	VarId FindBaseIndex(const VarId baseIndex, const u32 parameterCount)
+	{
+		if(parameterCount == 0)
+		{
+			return m_Writer.IdIndex() + 1;
+		}
+
+		return FindSourceVar(baseIndex);
+	}
+
+	[[nodiscard]] bool ConfirmUsage(const VarId var) const noexcept
+	{
+		return var < m_Live.Count() && m_Live[var];
+	}
+
+	/**
+	 *   Marks every var that is used by a root, or used by a var that is
+	 * itself used. Phis on loops form cycles, so this walks a worklist
+	 * instead of recursing through the usage map.
+	 */
+	void ComputeLiveness(const VarId maxId) noexcept
 	{
-		auto iter = UsageMap().find(var);
+		m_Live = DynArray<u8>(maxId + 1);
 
-		while(iter != UsageMap().end())
+		if(!m_UsageMap)
 		{
-			if((*iter).second == var)
+			m_Live.MemSetAll(1);
+			return;
+		}
+
+		m_Live.MemSetAll(0);
+
+		// The usage map is keyed by the used var, transpose it so each user can find what it uses.
+		m_Operands.Reset(maxId);
+
+		::std::vector<VarId> workList;
+
+		for(VarId var = 0; var <= m_UsageMap->MaxVarId(); ++var)
+		{
+			const VarId* const end = m_UsageMap->UsersEnd(var);
+
+			for(const VarId* user = m_UsageMap->UsersBegin(var); user != end; ++user)
 			{
-				return true;
+				if(*user == var)
+				{
+					if(var < m_Live.Count() && !m_Live[var])
+					{
+						m_Live[var] = 1;
+						workList.push_back(var);
+					}
+				}
+				else
+				{
+					m_Operands.AddUse(*user, var);
+				}
 			}
+		}
+
+		m_Operands.Build();
+
+		while(!workList.empty())
+		{
+			const VarId user = workList.back();
+			workList.pop_back();
 
-			if(ConfirmUsage((*iter).second))
+			const VarId* const end = m_Operands.UsersEnd(user);
+
+			for(const VarId* used = m_Operands.UsersBegin(user); used != end; ++used)
 			{
-				return true;
+				if(*used < m_Live.Count() && !m_Live[*used])
+				{
+					m_Live[*used] = 1;
+					workList.push_back(*used);
+				}
 			}
-
-			++iter;
 		}
-
-		return false;
 	}
 private:
 	SsaWriter m_Writer;
 	const TUsageMap* m_UsageMap;
 	DynArray<VarId> m_NewVarMap;
+	DynArray<u8> m_Live;
+	// What each var uses, the inverse of the usage map.
+	SsaDefUseIndex m_Operands;
+	SsaForwardRefs m_ForwardRefs;
 };
 
 }
@@ -1,24 +1,219 @@
 #pragma once
+#include <algorithm>
+#include <vector>
+
 #include "TauIR/Module.hpp"
+#include "TauIR/ssa/SsaCallGraph.hpp"
 #include "TauIR/ssa/SsaVisitor.hpp"
 #include "ReWriteVisitor.hpp"
 
 namespace tau::ir::ssa::opto {
 
+namespace internal {
 
-// Copy all the instructions, inline any acceptable functions, and shift the variable ID's appropriately after each inline.
+/**
+ * \brief Measures what inlining a function would cost.
+ *
+ *   The cost is the number of instructions that would be copied into the
+ * caller. Labels and nops are free, and so is the return as it is mapped
+ * straight onto the var of the call. The uses of each argument are
+ * counted, every one of them can fold if the call passes a constant.
+ */
+// ReSharper disable CppHidingFunction
+class InlineCostVisitor final : public SsaVisitor<InlineCostVisitor>
+{
+    DEFAULT_DESTRUCT(InlineCostVisitor);
+    DELETE_CM(InlineCostVisitor);
+public:
+    InlineCostVisitor(const SsaCustomTypeRegistry& registry) noexcept
+        : SsaVisitor(registry)
+        , m_InstructionCount(0)
+        , m_HasControlFlow(false)
+        , m_HasCalls(false)
+    { }
+
+    [[nodiscard]] u32 InstructionCount() const noexcept { return m_InstructionCount; }
+    [[nodiscard]] bool HasControlFlow() const noexcept { return m_HasControlFlow; }
+    [[nodiscard]] bool HasCalls() const noexcept { return m_HasCalls; }
+
+    [[nodiscard]] u32 ArgumentUses(const u32 argument) const noexcept { return argument < m_ArgumentUses.size() ? m_ArgumentUses[argument] : 0; }
+public:
+    bool PreTraversal(const u8* const codePtr, const uSys size, const VarId maxId) noexcept
+    {
+        m_InstructionCount = 0;
+        m_HasControlFlow = false;
+        m_HasCalls = false;
+        m_ArgumentUses.clear();
+        return true;
+    }
+
+    bool VisitLabel(const VarId label) noexcept
+    {
+        m_HasControlFlow = true;
+        return true;
+    }
+
+    bool VisitAssignImmediate(const VarId newVar, const SsaCustomType type, const void* const value, const uSys size) noexcept { return Count(); }
+    bool VisitAssignVar(const VarId newVar, const SsaCustomType type, const VarId var) noexcept { return Count(var); }
+    bool VisitExpandSX(const VarId newVar, const SsaCustomType newType, const SsaCustomType oldType, const VarId var) noexcept { return Count(var); }
+    bool VisitExpandZX(const VarId newVar, const SsaCustomType newType, const SsaCustomType oldType, const VarId var) noexcept { return Count(var); }
+    bool VisitTrunc(const VarId newVar, const SsaCustomType newType, const SsaCustomType oldType, const VarId var) noexcept { return Count(var); }
+    bool VisitRCast(const VarId newVar, const SsaCustomType newType, const SsaCustomType oldType, const VarId var) noexcept { return Count(var); }
+    bool VisitBCast(const VarId newVar, const SsaCustomType newType, const SsaCustomType oldType, const VarId var) noexcept { return Count(var); }
+    bool VisitLoad(const VarId newVar, const SsaCustomType type, const VarId var) noexcept { return Count(var); }
+    bool VisitStoreV(const SsaCustomType type, const VarId destination, const VarId source) noexcept { return Count(destination, source); }
+    bool VisitStoreI(const SsaCustomType type, const VarId destination, const void* const value, const uSys size) noexcept { return Count(destination); }
+    bool VisitComputePtr(const VarId newVar, const VarId base, const VarId index, const i8 multiplier, const i16 offset) noexcept { return Count(base, index); }
+    bool VisitBinOpVToV(const VarId newVar, const SsaBinaryOperation operation, const SsaCustomType type, const VarId a, const VarId b) noexcept { return Count(a, b); }
+    bool VisitBinOpVToI(const VarId newVar, const SsaBinaryOperation operation, const SsaCustomType type, const void* const a, const uSys aSize, const VarId b) noexcept { return Count(b); }
+    bool VisitBinOpIToV(const VarId newVar, const SsaBinaryOperation operation, const SsaCustomType type, const VarId a, const void* const b, const uSys bSize) noexcept { return Count(a); }
+    bool VisitSplit(const VarId baseIndex, const SsaCustomType aType, const VarId a, const uSys splitCount, const SsaCustomType* const splitTypes) noexcept { return Count(a); }
+
+    bool VisitJoin(const VarId newVar, const SsaCustomType newType, const uSys joinCount, const SsaCustomType* const joinTypes, const VarId* const joinVars) noexcept
+    {
+        for(uSys i = 0; i < joinCount; ++i)
+        {
+            Use(joinVars[i]);
+        }
+
+        return Count();
+    }
+
+    bool VisitCompVToV(const VarId newVar, const CompareCondition operation, const SsaCustomType type, const VarId a, const VarId b) noexcept { return Count(a, b); }
+    bool VisitCompVToI(const VarId newVar, const CompareCondition operation, const SsaCustomType type, const void* const a, const uSys aSize, const VarId b) noexcept { return Count(b); }
+    bool VisitCompIToV(const VarId newVar, const CompareCondition operation, const SsaCustomType type, const VarId a, const void* const b, const uSys bSize) noexcept { return Count(a); }
+
+    bool VisitBranch(const VarId label) noexcept
+    {
+        m_HasControlFlow = true;
+        return Count();
+    }
+
+    bool VisitBranchCond(const VarId labelTrue, const VarId labelFalse, const VarId conditionVar) noexcept
+    {
+        m_HasControlFlow = true;
+        return Count(conditionVar);
+    }
+
+    bool VisitCall(const VarId newVar, const u32 functionIndex, const VarId baseIndex, const u32 parameterCount) noexcept
+    {
+        m_HasCalls = true;
+        return Count();
+    }
+
+    bool VisitCallExt(const VarId newVar, const u32 functionIndex, const VarId baseIndex, const u32 parameterCount, const u16 moduleIndex) noexcept
+    {
+        m_HasCalls = true;
+        return Count();
+    }
+
+    bool VisitCallInd(const VarId newVar, const VarId functionPointer, const VarId baseIndex, const u32 parameterCount) noexcept { return Count(functionPointer); }
+    bool VisitCallIndExt(const VarId newVar, const VarId functionPointer, const VarId baseIndex, const u32 parameterCount, const VarId modulePointer) noexcept { return Count(functionPointer, modulePointer); }
+
+    bool VisitRet(const SsaCustomType returnType, const VarId var) noexcept
+    {
+        Use(var);
+        return true;
+    }
+
+    bool VisitPhi(const VarId newVar, const SsaCustomType type, const uSys incomingCount, const VarId* const labels, const VarId* const vars) noexcept
+    {
+        m_HasControlFlow = true;
+        return Count();
+    }
+private:
+    void Use(const VarId var) noexcept
+    {
+        if((var & 0x80000000) == 0)
+        {
+            return;
+        }
+
+        const u32 argument = var & 0x7FFFFFFF;
+
+        if(argument >= m_ArgumentUses.size())
+        {
+            m_ArgumentUses.resize(argument + 1, 0);
+        }
+
+        ++m_ArgumentUses[argument];
+    }
+
+    bool Count(const VarId a = 0, const VarId b = 0) noexcept
+    {
+        Use(a);
+        Use(b);
+        ++m_InstructionCount;
+        return true;
+    }
+private:
+    u32 m_InstructionCount;
+    bool m_HasControlFlow;
+    bool m_HasCalls;
+    ::std::vector<u32> m_ArgumentUses;
+};
+
+}
+
+/**
+ * \brief Copies all the instructions, inlining the calls worth inlining.
+ *
+ *   The var ids are shifted appropriately after each inline. Only callees
+ * without control flow can be inlined, as their return is mapped straight
+ * onto the var of the call.
+ *
+ *   A call is inlined when its cost, the SSA instructions of the callee
+ * less the call itself and its parameters, is within InlineThreshold, or
+ * HintThreshold for InlineHint. Every use of an argument the call passes a
+ * constant for is expected to fold and is taken off the cost. The callee
+ * is measured as it is now, so it should be optimized before its callers,
+ * SsaPassManager::RunModule runs them bottom up over the call graph.
+ *
+ *   Each caller may only grow by GrowthBudget instructions, or by its own
+ * size if that is larger. Callees in the same component of the call graph
+ * as the caller are never inlined, they can recurse back into it and
+ * haven't been optimized yet. ForceInline only skips the cost and the
+ * budget.
+ */
 // ReSharper disable CppHidingFunction
 class InlinerVisitor final : public SsaVisitor<InlinerVisitor>
 {
 	DEFAULT_DESTRUCT(InlinerVisitor);
 	DELETE_CM(InlinerVisitor);
+public:
+    static constexpr u32 InlineThreshold = 16;
+    static constexpr u32 HintThreshold = 64;
+    static constexpr u32 GrowthBudget = 64;
 public:
 	InlinerVisitor(const SsaCustomTypeRegistry& registry, const ModuleRef& module) noexcept
 		: SsaVisitor(registry)
 	    , m_Module(module)
+	    , m_CostVisitor(registry)
+	    , m_CallGraph(nullptr)
+	    , m_Caller(SsaCallGraph::InvalidIndex)
+	    , m_GrowthBudget(0)
+	    , m_Growth(0)
+	    , m_InlinedCount(0)
 	{ }
 
 	[[nodiscard]] const SsaWriter& Writer() const noexcept { return m_Writer; }
+	[[nodiscard]]       SsaWriter& Writer()       noexcept { return m_Writer; }
+
+    /**
+     *   Sets the function being inlined into, and the call graph its
+     * index is in. Without a call graph only the caller itself is never
+     * inlined.
+     */
+    void SetCaller(const SsaCallGraph* const callGraph, const u32 caller) noexcept
+    {
+        m_CallGraph = callGraph;
+        m_Caller = caller;
+    }
+
+    /**
+     * The number of calls inlined by the last traversal.
+     */
+    [[nodiscard]] u32 InlinedCount() const noexcept { return m_InlinedCount; }
 
 	void UpdateAttachment(Function* const function) noexcept
 	{
@@ -45,6 +240,14 @@ public:
     bool PreTraversal(const u8* const codePtr, const uSys size, const VarId maxId) noexcept
     {
         m_NewVarMap.resize(maxId + 1);
+        m_Writer.Reset(size * 2);
+        m_ForwardRefs.Clear();
+        m_Constants.clear();
+
+        (void) m_CostVisitor.Traverse(codePtr, size, maxId);
+        m_GrowthBudget = ::std::max(GrowthBudget, m_CostVisitor.InstructionCount());
+        m_Growth = 0;
+        m_InlinedCount = 0;
         return true;
     }
 
@@ -63,12 +266,21 @@ public:
     bool VisitAssignImmediate(const VarId newVar, const SsaCustomType type, const void* const value, const uSys size) noexcept
     {
         m_NewVarMap[newVar] = m_Writer.WriteAssignImmediate(type, value, size);
+        MarkConstant(m_NewVarMap[newVar]);
         return true;
     }
 
     bool VisitAssignVar(const VarId newVar, const SsaCustomType type, const VarId var) noexcept
     {
-        m_NewVarMap[newVar] = m_Writer.WriteAssignVariable(type, TransformVar(var));
+        const VarId source = TransformVar(var);
+        m_NewVarMap[newVar] = m_Writer.WriteAssignVariable(type, source);
+
+        // The parameters of a call are copies, keep track of the ones copied from constants.
+        if(IsConstant(source))
+        {
+            MarkConstant(m_NewVarMap[newVar]);
+        }
+
         return true;
     }
 
@@ -185,22 +397,38 @@ public:
     
     bool VisitBranch(const VarId label) noexcept
     {
-        m_Writer.WriteBranch(TransformVar(label));
+        m_Writer.WriteBranch(label);
+        m_ForwardRefs.Add(m_Writer.Size() - sizeof(VarId), label);
         return true;
     }
     
     bool VisitBranchCond(const VarId labelTrue, const VarId labelFalse, const VarId conditionVar) noexcept
     {
-        m_Writer.WriteBranchCond(TransformVar(labelTrue), TransformVar(labelFalse), TransformVar(conditionVar));
+        m_Writer.WriteBranchCond(labelTrue, labelFalse, TransformVar(conditionVar));
+        m_ForwardRefs.Add(m_Writer.Size() - 3 * sizeof(VarId), labelTrue);
+        m_ForwardRefs.Add(m_Writer.Size() - 2 * sizeof(VarId), labelFalse);
+        return true;
+    }
+
+    bool VisitPhi(const VarId newVar, const SsaCustomType type, const uSys incomingCount, const VarId* const labels, const VarId* const vars) noexcept
+    {
+        m_NewVarMap[newVar] = m_Writer.WritePhi(type, static_cast<u32>(incomingCount), labels, vars);
+        m_ForwardRefs.AddPhi(m_Writer, static_cast<u32>(incomingCount), labels, vars);
+        return true;
+    }
+
+    bool PostTraversal() noexcept
+    {
+        m_ForwardRefs.Resolve(m_Writer, [this](const VarId var) { return TransformVar(var); });
         return true;
     }
      
     bool VisitCall(const VarId newVar, const u32 functionIndex, const VarId baseIndex, const u32 parameterCount) noexcept
     {
         const Function* function = m_Module->Functions()[functionIndex];
-        if(!ShouldInlineFunction(function))
+        if(!ShouldInlineFunction(function, functionIndex, baseIndex, parameterCount, false))
         {
-            m_NewVarMap[newVar] = m_Writer.WriteCall(functionIndex, baseIndex, parameterCount);
+            m_NewVarMap[newVar] = m_Writer.WriteCall(functionIndex, TransformBaseIndex(baseIndex, parameterCount), parameterCount);
         }
         else
         {
@@ -213,9 +441,9 @@ public:
     bool VisitCallExt(const VarId newVar, const u32 functionIndex, const VarId baseIndex, const u32 parameterCount, const u16 moduleIndex) noexcept
     {
         const Function* function = m_Module->Imports()[moduleIndex].Functions()[functionIndex];
-        if(!ShouldInlineFunction(function))
+        if(!ShouldInlineFunction(function, SsaCallGraph::InvalidIndex, baseIndex, parameterCount, true))
         {
-            m_NewVarMap[newVar] = m_Writer.WriteCallExt(functionIndex, baseIndex, parameterCount, moduleIndex);
+            m_NewVarMap[newVar] = m_Writer.WriteCallExt(functionIndex, TransformBaseIndex(baseIndex, parameterCount), parameterCount, moduleIndex);
         }
         else
         {
@@ -227,13 +455,13 @@ public:
     
     bool VisitCallInd(const VarId newVar, const VarId functionPointer, const VarId baseIndex, const u32 parameterCount) noexcept
     {
-        m_NewVarMap[newVar] = m_Writer.WriteCallInd(TransformVar(functionPointer), TransformVar(baseIndex), parameterCount);
+        m_NewVarMap[newVar] = m_Writer.WriteCallInd(TransformVar(functionPointer), TransformBaseIndex(baseIndex, parameterCount), parameterCount);
         return true;
     }
     
     bool VisitCallIndExt(const VarId newVar, const VarId functionPointer, const VarId baseIndex, const u32 parameterCount, const VarId modulePointer) noexcept
     {
-        m_NewVarMap[newVar] = m_Writer.WriteCallIndExt(TransformVar(functionPointer), TransformVar(baseIndex), parameterCount, TransformVar(modulePointer));
+        m_NewVarMap[newVar] = m_Writer.WriteCallIndExt(TransformVar(functionPointer), TransformBaseIndex(baseIndex, parameterCount), parameterCount, TransformVar(modulePointer));
         return true;
     }
     
@@ -253,7 +481,36 @@ private:
         return m_NewVarMap[var];
     }
 
-    [[nodiscard]] bool ShouldInlineFunction(const Function* const function) const noexcept
+    /**
+     *   Maps the parameters of a call that isn't inlined, they are copied
+     * if inlining an earlier call left them apart.
+     */
+    [[nodiscard]] VarId TransformBaseIndex(const VarId baseIndex, const u32 parameterCount) noexcept
+    {
+        return internal::RemapCallParameters(m_Writer, baseIndex, parameterCount, [this](const VarId var) { return TransformVar(var); });
+    }
+
+    [[nodiscard]] bool IsConstant(const VarId newVar) const noexcept
+    {
+        return (newVar & 0x80000000) == 0 && newVar < m_Constants.size() && m_Constants[newVar] != 0;
+    }
+
+    void MarkConstant(const VarId newVar) noexcept
+    {
+        if(newVar >= m_Constants.size())
+        {
+            m_Constants.resize(static_cast<uSys>(newVar) + 1, 0);
+        }
+
+        m_Constants[newVar] = 1;
+    }
+
+    /**
+     * @param functionIndex
+     *   The index of the callee in the call graph, InvalidIndex for a
+     * callee in another module.
+     */
+    [[nodiscard]] bool ShouldInlineFunction(const Function* const function, const u32 functionIndex, const VarId baseIndex, const u32 parameterCount, const bool isExternal) noexcept
     {
         if(function->Flags().InlineControl == InlineControl::NoInline)
         {
@@ -270,33 +527,91 @@ private:
             return false;
         }
 
+        if(!isExternal && m_Caller != SsaCallGraph::InvalidIndex)
+        {
+            if(functionIndex == m_Caller)
+            {
+                return false;
+            }
+
+            if(m_CallGraph && m_CallGraph->IsSameComponent(functionIndex, m_Caller))
+            {
+                return false;
+            }
+        }
+
+        if(!m_CostVisitor.Traverse(function))
+        {
+            return false;
+        }
+
+        // The callee's return is mapped straight onto the call's var, that only works for a single block.
+        if(m_CostVisitor.HasControlFlow())
+        {
+            return false;
+        }
+
+        // The calls of a callee in another module would be resolved against this one.
+        if(isExternal && m_CostVisitor.HasCalls())
+        {
+            return false;
+        }
+
+        const u32 instructionCount = m_CostVisitor.InstructionCount();
+
         if(function->Flags().InlineControl == InlineControl::ForceInline)
         {
+            m_Growth += instructionCount;
             return true;
         }
 
-        if(function->CodeSize() <= 64)
+        if(m_Growth + instructionCount > m_GrowthBudget)
         {
-            return true;
+            return false;
         }
 
-        if(function->Flags().InlineControl == InlineControl::InlineHint && function->CodeSize() <= 256)
+        // The call goes away, and so do the copies of its parameters once they're propagated.
+        u32 savings = 1 + parameterCount;
+
+        for(u32 i = 0; i < parameterCount; ++i)
         {
-            return true;
+            if(IsConstant(TransformVar(baseIndex + i)))
+            {
+                savings += m_CostVisitor.ArgumentUses(i);
+            }
+        }
+
+        const u32 cost = instructionCount > savings ? instructionCount - savings : 0;
+        const u32 threshold = function->Flags().InlineControl == InlineControl::InlineHint ? HintThreshold : InlineThreshold;
+
+        if(cost > threshold)
+        {
+            return false;
         }
 
-        return false;
+        m_Growth += instructionCount;
+        return true;
     }
 
     void InlineFunction(const Function* const function, const VarId baseIndex, const u32 parameterCount, const VarId newVar) noexcept
     {
         ReWriteVisitor rewriter(Registry(), m_Writer, m_NewVarMap, baseIndex, parameterCount, newVar);
         rewriter.Traverse(function);
+        ++m_InlinedCount;
     }
 private:
 	SsaWriter m_Writer;
     ::std::vector<VarId> m_NewVarMap;
 	ModuleRef m_Module;
+    SsaForwardRefs m_ForwardRefs;
+    internal::InlineCostVisitor m_CostVisitor;
+    const SsaCallGraph* m_CallGraph;
+    u32 m_Caller;
+    u32 m_GrowthBudget;
+    u32 m_Growth;
+    u32 m_InlinedCount;
+    // Whether each var of the new code holds a constant, indexed by the new id.
+    ::std::vector<u8> m_Constants;
 };
 
 }
@@ -0,0 +1,531 @@
+#pragma once
+
+#include "TauIR/ssa/opto/ReWriteVisitor.hpp"
+#include <cstring>
+#include <vector>
+
+namespace tau::ir::ssa::opto {
+
+namespace internal {
+
+struct JoinSplitPart final
+{
+    VarId Var;
+    SsaCustomType Type;
+    u32 Size;
+};
+
+/**
+ * What is known about a rewritten var, indexed by its new id.
+ */
+struct JoinSplitValue final
+{
+    enum class ValueKind : u8
+    {
+        Unknown = 0,
+        Immediate,
+        Join,
+        SplitPart
+    };
+
+    ValueKind Kind;
+    u32 Size;
+    // The zero extended value of an immediate.
+    u64 Value;
+    // The var a split part was split from, and the byte offset of the part within it.
+    VarId Source;
+    u32 SourceSize;
+    u32 Offset;
+    // The range of a join in the flattened part list.
+    u32 PartsBegin;
+    u32 PartsCount;
+};
+
+}
+
+/**
+ * \brief Removes the joins and splits IrToSsa writes when stack frames don't line up.
+ *
+ *   A join of immediates becomes a single immediate of the joined type,
+ * `Const.N 14; Const.0` popped as an i64 is just `i64 $14`. Splitting an
+ * immediate likewise becomes an immediate per part. A part type of raw
+ * bytes is written as the unsigned integer of the same size.
+ *
+ *   A split of a join whose part boundaries line up with the join is
+ * replaced by the joined parts, and a join of every part of a split, in
+ * order, is replaced by the split var. A join or split with a single part
+ * is a plain assignment. Joins of joins are flattened first, so a value
+ * that was split and put back together across several pops still folds.
+ *
+ *   Assignments between vars of different types are kept as assignments,
+ * constant propagation forwards them.
+ */
+// ReSharper disable CppHidingFunction
+class JoinSplitFoldingVisitor final : public ReWriteVisitorBase<JoinSplitFoldingVisitor>
+{
+    DEFAULT_DESTRUCT(JoinSplitFoldingVisitor);
+    DELETE_CM(JoinSplitFoldingVisitor);
+public:
+    JoinSplitFoldingVisitor(const SsaCustomTypeRegistry& registry) noexcept
+        : ReWriteVisitorBase(registry)
+        , m_FoldedCount(0)
+        , m_Values()
+        , m_JoinParts()
+    { }
+
+    /**
+     * The number of joins and splits removed by the last traversal.
+     */
+    [[nodiscard]] u32 FoldedCount() const noexcept { return m_FoldedCount; }
+public:
+    bool PreTraversal(const u8* const codePtr, const uSys size, const VarId maxId) noexcept
+    {
+        m_FoldedCount = 0;
+        m_Values.clear();
+        m_JoinParts.clear();
+
+        return ReWriteVisitorBase::PreTraversal(codePtr, size, maxId);
+    }
+
+    bool VisitAssignImmediate(const VarId newVar, const SsaCustomType type, const void* const value, const uSys size) noexcept
+    {
+        m_NewVarMap[newVar] = m_Writer.WriteAssignImmediate(type, value, size);
+
+        if(IsIntegerType(type) && size <= sizeof(u64))
+        {
+            internal::JoinSplitValue& info = ValueOf(m_NewVarMap[newVar]);
+            info.Kind = internal::JoinSplitValue::ValueKind::Immediate;
+            info.Size = static_cast<u32>(size);
+            info.Value = 0;
+            (void) ::std::memcpy(&info.Value, value, size);
+        }
+
+        return true;
+    }
+
+    bool VisitAssignVar(const VarId newVar, const SsaCustomType type, const VarId var) noexcept
+    {
+        m_NewVarMap[newVar] = WriteAssignment(type, FindSourceVar(var));
+        return true;
+    }
+
+    bool VisitSplit(const VarId baseIndex, const SsaCustomType aType, const VarId a, const uSys splitCount, const SsaCustomType* const splitTypes) noexcept
+    {
+        const VarId newA = FindSourceVar(a);
+        const u32 sourceSize = TypeSize(aType);
+
+        if(splitCount == 1 && TypeSize(splitTypes[0]) == sourceSize)
+        {
+            m_NewVarMap[baseIndex] = WriteCopy(splitTypes[0], newA);
+            ++m_FoldedCount;
+            return true;
+        }
+
+        if(FoldSplitOfImmediate(baseIndex, newA, splitCount, splitTypes) || FoldSplitOfJoin(baseIndex, newA, splitCount, splitTypes))
+        {
+            ++m_FoldedCount;
+            return true;
+        }
+
+        const VarId newBase = m_Writer.WriteSplit(aType, newA, static_cast<u32>(splitCount), splitTypes);
+        u32 offset = 0;
+
+        for(uSys i = 0; i < splitCount; ++i)
+        {
+            const VarId part = static_cast<VarId>(newBase + i);
+            m_NewVarMap[baseIndex + i] = part;
+
+            internal::JoinSplitValue& info = ValueOf(part);
+            info.Kind = internal::JoinSplitValue::ValueKind::SplitPart;
+            info.Size = TypeSize(splitTypes[i]);
+            info.Source = newA;
+            info.SourceSize = sourceSize;
+            info.Offset = offset;
+
+            offset += info.Size;
+        }
+
+        return true;
+    }
+
+    bool VisitJoin(const VarId newVar, const SsaCustomType newType, const uSys joinCount, const SsaCustomType* const joinTypes, const VarId* const joinVars) noexcept
+    {
+        const u32 partsBegin = static_cast<u32>(m_JoinParts.size());
+        bool flattened = false;
+
+        for(uSys i = 0; i < joinCount; ++i)
+        {
+            const VarId part = FindSourceVar(joinVars[i]);
+            const internal::JoinSplitValue* const info = FindValue(part);
+
+            if(info && info->Kind == internal::JoinSplitValue::ValueKind::Join)
+            {
+                // Copy by index, the part list may grow while copying.
+                for(u32 j = 0; j < info->PartsCount; ++j)
+                {
+                    m_JoinParts.push_back(m_JoinParts[info->PartsBegin + j]);
+                }
+
+                flattened = true;
+            }
+            else
+            {
+                m_JoinParts.push_back({ part, joinTypes[i], TypeSize(joinTypes[i]) });
+            }
+        }
+
+        const u32 partsCount = static_cast<u32>(m_JoinParts.size()) - partsBegin;
+        const internal::JoinSplitPart* const parts = m_JoinParts.data() + partsBegin;
+
+        if(partsCount == 1 && parts[0].Size == TypeSize(newType))
+        {
+            m_NewVarMap[newVar] = WriteCopy(newType, parts[0].Var);
+            m_JoinParts.resize(partsBegin);
+            ++m_FoldedCount;
+            return true;
+        }
+
+        if(FoldJoinOfImmediates(newVar, newType, parts, partsCount) || FoldJoinOfSplit(newVar, newType, parts, partsCount))
+        {
+            m_JoinParts.resize(partsBegin);
+            ++m_FoldedCount;
+            return true;
+        }
+
+        DynArray<SsaCustomType> newJoinTypes(partsCount);
+        DynArray<VarId> newJoinVars(partsCount);
+
+        for(u32 i = 0; i < partsCount; ++i)
+        {
+            newJoinTypes[i] = parts[i].Type;
+            newJoinVars[i] = parts[i].Var;
+        }
+
+        m_NewVarMap[newVar] = m_Writer.WriteJoin(newType, partsCount, newJoinTypes, newJoinVars);
+
+        if(flattened)
+        {
+            ++m_FoldedCount;
+        }
+
+        internal::JoinSplitValue& info = ValueOf(m_NewVarMap[newVar]);
+        info.Kind = internal::JoinSplitValue::ValueKind::Join;
+        info.Size = TypeSize(newType);
+        info.PartsBegin = partsBegin;
+        info.PartsCount = partsCount;
+
+        return true;
+    }
+private:
+    [[nodiscard]] static bool IsIntegerType(const SsaCustomType type) noexcept
+    {
+        switch(type.Type)
+        {
+            case SsaType::I8:
+            case SsaType::I16:
+            case SsaType::I32:
+            case SsaType::I64:
+            case SsaType::U8:
+            case SsaType::U16:
+            case SsaType::U32:
+            case SsaType::U64:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    [[nodiscard]] static bool IsSameType(const SsaCustomType a, const SsaCustomType b) noexcept
+    {
+        return a.Type == b.Type && (!a.HasCustomSize() || a.CustomType == b.CustomType);
+    }
+
+    /**
+     *   The type an immediate of this type is written as, raw bytes become
+     * the unsigned integer of the same size. Void if there is none.
+     */
+    [[nodiscard]] static SsaCustomType ImmediateType(const SsaCustomType type) noexcept
+    {
+        if(IsIntegerType(type))
+        {
+            return type;
+        }
+
+        if(type.Type == SsaType::Bytes)
+        {
+            switch(type.CustomType)
+            {
+                case 1: return SsaCustomType(SsaType::U8);
+                case 2: return SsaCustomType(SsaType::U16);
+                case 4: return SsaCustomType(SsaType::U32);
+                case 8: return SsaCustomType(SsaType::U64);
+                default: break;
+            }
+        }
+
+        return SsaCustomType(SsaType::Void);
+    }
+
+    /**
+     * @return The size in bytes, or 0 if it isn't known.
+     */
+    [[nodiscard]] u32 TypeSize(const SsaCustomType type) const noexcept
+    {
+        if(!IsPointer(type.Type))
+        {
+            if(type.Type == SsaType::Bytes)
+            {
+                return type.CustomType == static_cast<u32>(-1) ? 0 : type.CustomType;
+            }
+
+            if(type.Type == SsaType::Custom)
+            {
+                return static_cast<u32>(Registry()[type.CustomType].Size);
+            }
+        }
+
+        const uSys size = TypeValueSize(type.Type);
+        return size > sizeof(u64) ? 0 : static_cast<u32>(size);
+    }
+
+    [[nodiscard]] const internal::JoinSplitValue* FindValue(const VarId var) const noexcept
+    {
+        if((var & 0x80000000) != 0 || var >= m_Values.size())
+        {
+            return nullptr;
+        }
+
+        return &m_Values[var];
+    }
+
+    [[nodiscard]] internal::JoinSplitValue& ValueOf(const VarId var) noexcept
+    {
+        if(var >= m_Values.size())
+        {
+            m_Values.resize(var + 1, internal::JoinSplitValue { });
+        }
+
+        return m_Values[var];
+    }
+
+    [[nodiscard]] bool IsImmediate(const VarId var) const noexcept
+    {
+        const internal::JoinSplitValue* const info = FindValue(var);
+        return info && info->Kind == internal::JoinSplitValue::ValueKind::Immediate;
+    }
+
+    VarId WriteImmediate(const SsaCustomType type, const u64 value) noexcept
+    {
+        const u32 size = static_cast<u32>(TypeValueSize(type.Type));
+        const VarId var = m_Writer.WriteAssignImmediate(type, &value, size);
+
+        internal::JoinSplitValue& info = ValueOf(var);
+        info.Kind = internal::JoinSplitValue::ValueKind::Immediate;
+        info.Size = size;
+        info.Value = size == sizeof(u64) ? value : value & ((1ull << (size * 8)) - 1);
+
+        return var;
+    }
+
+    /**
+     * A var of the same size, only written as an assignment if the type changes.
+     */
+    VarId WriteCopy(const SsaCustomType type, const VarId var) noexcept
+    {
+        if((var & 0x80000000) == 0 && IsSameType(m_Writer.GetVarType(var), type))
+        {
+            return var;
+        }
+
+        return WriteAssignment(type, var);
+    }
+
+    /**
+     * An assignment holds the same bytes, so it carries over what is known about its source.
+     */
+    VarId WriteAssignment(const SsaCustomType type, const VarId var) noexcept
+    {
+        const VarId newVar = m_Writer.WriteAssignVariable(type, var);
+        const internal::JoinSplitValue* const info = FindValue(var);
+
+        if(info && info->Kind != internal::JoinSplitValue::ValueKind::Unknown && info->Size == TypeSize(type))
+        {
+            const internal::JoinSplitValue copy = *info;
+            ValueOf(newVar) = copy;
+        }
+
+        return newVar;
+    }
+
+    bool FoldJoinOfImmediates(const VarId newVar, const SsaCustomType newType, const internal::JoinSplitPart* const parts, const u32 partsCount) noexcept
+    {
+        const SsaCustomType immediateType = ImmediateType(newType);
+
+        if(immediateType.Type == SsaType::Void || TypeValueSize(immediateType.Type) != TypeSize(newType))
+        {
+            return false;
+        }
+
+        u64 value = 0;
+        u32 offset = 0;
+
+        // The parts are ordered from the lowest byte.
+        for(u32 i = 0; i < partsCount; ++i)
+        {
+            if(!IsImmediate(parts[i].Var) || m_Values[parts[i].Var].Size != parts[i].Size)
+            {
+                return false;
+            }
+
+            value |= m_Values[parts[i].Var].Value << (offset * 8);
+            offset += parts[i].Size;
+        }
+
+        if(offset != TypeSize(newType))
+        {
+            return false;
+        }
+
+        m_NewVarMap[newVar] = WriteImmediate(immediateType, value);
+        return true;
+    }
+
+    bool FoldJoinOfSplit(const VarId newVar, const SsaCustomType newType, const internal::JoinSplitPart* const parts, const u32 partsCount) noexcept
+    {
+        const internal::JoinSplitValue* const first = FindValue(parts[0].Var);
+
+        if(!first || first->Kind != internal::JoinSplitValue::ValueKind::SplitPart)
+        {
+            return false;
+        }
+
+        const VarId source = first->Source;
+        u32 offset = 0;
+
+        // Every part of the split has to come back in order.
+        for(u32 i = 0; i < partsCount; ++i)
+        {
+            const internal::JoinSplitValue* const info = FindValue(parts[i].Var);
+
+            if(!info || info->Kind != internal::JoinSplitValue::ValueKind::SplitPart || info->Source != source || info->Offset != offset)
+            {
+                return false;
+            }
+
+            offset += info->Size;
+        }
+
+        if(offset != first->SourceSize || offset != TypeSize(newType))
+        {
+            return false;
+        }
+
+        m_NewVarMap[newVar] = WriteCopy(newType, source);
+        return true;
+    }
+
+    bool FoldSplitOfImmediate(const VarId baseIndex, const VarId a, const uSys splitCount, const SsaCustomType* const splitTypes) noexcept
+    {
+        if(!IsImmediate(a))
+        {
+            return false;
+        }
+
+        // Check every part first, the parts of a split have consecutive ids.
+        for(uSys i = 0; i < splitCount; ++i)
+        {
+            const SsaCustomType immediateType = ImmediateType(splitTypes[i]);
+
+            if(immediateType.Type == SsaType::Void || TypeValueSize(immediateType.Type) != TypeSize(splitTypes[i]))
+            {
+                return false;
+            }
+        }
+
+        const u64 value = m_Values[a].Value;
+        u32 offset = 0;
+
+        for(uSys i = 0; i < splitCount; ++i)
+        {
+            const SsaCustomType immediateType = ImmediateType(splitTypes[i]);
+            m_NewVarMap[baseIndex + i] = WriteImmediate(immediateType, offset < sizeof(u64) ? value >> (offset * 8) : 0);
+            offset += TypeSize(splitTypes[i]);
+        }
+
+        return true;
+    }
+
+    bool FoldSplitOfJoin(const VarId baseIndex, const VarId a, const uSys splitCount, const SsaCustomType* const splitTypes) noexcept
+    {
+        const internal::JoinSplitValue* const info = FindValue(a);
+
+        if(!info || info->Kind != internal::JoinSplitValue::ValueKind::Join)
+        {
+            return false;
+        }
+
+        const u32 partsBegin = info->PartsBegin;
+        const u32 partsCount = info->PartsCount;
+
+        // The range of join parts each split part covers, the part boundaries have to line up.
+        ::std::vector<u32> ranges(splitCount + 1);
+        u32 joinIndex = 0;
+        u32 joinOffset = 0;
+
+        for(uSys i = 0; i < splitCount; ++i)
+        {
+            ranges[i] = joinIndex;
+
+            const u32 end = joinOffset + TypeSize(splitTypes[i]);
+
+            while(joinIndex < partsCount && joinOffset < end)
+            {
+                joinOffset += m_JoinParts[partsBegin + joinIndex].Size;
+                ++joinIndex;
+            }
+
+            if(joinOffset != end || joinIndex == ranges[i])
+            {
+                return false;
+            }
+        }
+
+        if(joinIndex != partsCount)
+        {
+            return false;
+        }
+
+        ranges[splitCount] = joinIndex;
+
+        for(uSys i = 0; i < splitCount; ++i)
+        {
+            const u32 count = ranges[i + 1] - ranges[i];
+
+            if(count == 1)
+            {
+                m_NewVarMap[baseIndex + i] = WriteCopy(splitTypes[i], m_JoinParts[partsBegin + ranges[i]].Var);
+                continue;
+            }
+
+            DynArray<SsaCustomType> joinTypes(count);
+            DynArray<VarId> joinVars(count);
+
+            for(u32 j = 0; j < count; ++j)
+            {
+                joinTypes[j] = m_JoinParts[partsBegin + ranges[i] + j].Type;
+                joinVars[j] = m_JoinParts[partsBegin + ranges[i] + j].Var;
+            }
+
+            m_NewVarMap[baseIndex + i] = m_Writer.WriteJoin(splitTypes[i], count, joinTypes, joinVars);
+        }
+
+        return true;
+    }
+private:
+    u32 m_FoldedCount;
+    ::std::vector<internal::JoinSplitValue> m_Values;
+    // The flattened parts of every join, a join refers to a range of this.
+    ::std::vector<internal::JoinSplitPart> m_JoinParts;
+};
+
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <Objects.hpp>
+#include <NumTypes.hpp>
+#include <vector>
+
+#include "TauIR/ssa/SsaGraph.hpp"
+#include "TauIR/ssa/SsaWriter.hpp"
+
+namespace tau::ir {
+
+class Function;
+
+}
+
+namespace tau::ir::ssa::opto {
+
+/**
+ * \brief Removes loads of values that are already known, and stores that are overwritten before being read.
+ *
+ *   Each address is split into a base, an index with its multiplier, and
+ * a constant offset. Addresses computed by a ComputePtr use its operands,
+ * any other pointer is its own base with an offset of 0, copies are
+ * followed to the original var. Two accesses with the same base and index
+ * whose byte ranges don't overlap can't alias, any other pair may.
+ *
+ *   Within a block a load from the exact address and type of an earlier
+ * store or load is turned into a copy of that value. A store is removed
+ * when a later store in the same block writes all of its bytes, and
+ * nothing that may read them comes in between.
+ *
+ *   Calls can read and write any memory, so nothing is known across them.
+ * Nothing is known across blocks either, and accesses of custom types
+ * have no known size so they may alias anything.
+ */
+class LoadStoreElimination final
+{
+    DEFAULT_DESTRUCT(LoadStoreElimination);
+    DELETE_CM(LoadStoreElimination);
+public:
+    LoadStoreElimination(const SsaCustomTypeRegistry& registry) noexcept
+        : m_Registry(&registry)
+        , m_Writer()
+        , m_Graph()
+        , m_ForwardedCount(0)
+        , m_RemovedStoreCount(0)
+    { }
+
+    [[nodiscard]] const SsaWriter& Writer() const noexcept { return m_Writer; }
+    [[nodiscard]]       SsaWriter& Writer()       noexcept { return m_Writer; }
+
+    /**
+     * The number of loads replaced by the last run.
+     */
+    [[nodiscard]] u32 ForwardedCount() const noexcept { return m_ForwardedCount; }
+
+    /**
+     * The number of stores removed by the last run.
+     */
+    [[nodiscard]] u32 RemovedStoreCount() const noexcept { return m_RemovedStoreCount; }
+
+    /**
+     *   Named like the visitors so the pass manager can run it the same
+     * way, the code is decoded into an SsaGraph first.
+     */
+    [[nodiscard]] bool Traverse(const u8* codePtr, uSys size, VarId maxId) noexcept;
+    [[nodiscard]] bool Traverse(const Function* function) noexcept;
+
+    void UpdateAttachment(Function* function) noexcept;
+private:
+    struct Address final
+    {
+        VarId Base;
+        // 0 if there is no index.
+        VarId Index;
+        i32 Multiplier;
+        i32 Offset;
+        // 0 if the size isn't known.
+        u32 Size;
+    };
+
+    struct KnownValue final
+    {
+        Address Location;
+        SsaCustomType Type;
+        // The store or load the value comes from.
+        u32 Inst;
+    };
+private:
+    [[nodiscard]] static bool IsSameBase(const Address& a, const Address& b) noexcept;
+    [[nodiscard]] static bool IsSameAddress(const Address& a, const Address& b) noexcept;
+    [[nodiscard]] static bool MayAlias(const Address& a, const Address& b) noexcept;
+    /**
+     * Whether every byte of inner is also accessed by outer.
+     */
+    [[nodiscard]] static bool Covers(const Address& outer, const Address& inner) noexcept;
+
+    [[nodiscard]] VarId ResolveCopies(VarId var) const noexcept;
+    [[nodiscard]] Address AccessAddress(u32 inst) const noexcept;
+    void ForwardLoads(u32 block) noexcept;
+    void RemoveDeadStores(u32 block) noexcept;
+private:
+    const SsaCustomTypeRegistry* m_Registry;
+    SsaWriter m_Writer;
+    SsaGraph m_Graph;
+    u32 m_ForwardedCount;
+    u32 m_RemovedStoreCount;
+
+    // Kept between blocks so the storage is reused.
+    ::std::vector<KnownValue> m_KnownValues;
+    ::std::vector<Address> m_Overwritten;
+};
+
+}
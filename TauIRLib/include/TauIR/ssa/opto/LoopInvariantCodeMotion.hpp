@@ -0,0 +1,108 @@
+#pragma once
+
+#include <Objects.hpp>
+#include <NumTypes.hpp>
+#include <vector>
+
+#include "TauIR/ssa/SsaGraph.hpp"
+#include "TauIR/ssa/SsaWriter.hpp"
+
+namespace tau::ir {
+
+class Function;
+
+}
+
+namespace tau::ir::ssa::opto {
+
+/**
+ * \brief Moves instructions that compute the same value on every iteration out of loops.
+ *
+ *   Natural loops are found from the back edges of the control flow
+ * graph, an edge whose target dominates its source. Only loops whose
+ * header has a single predecessor from outside the loop, that itself only
+ * branches to the header, are handled. That predecessor is the preheader,
+ * hoisted instructions are placed right before its branch.
+ *
+ *   An instruction is hoisted when it has no side effects, and all of its
+ * operands are defined outside the loop or were hoisted themselves. Loads
+ * are only hoisted if the loop contains no store and no call. Loads,
+ * divisions and remainders can fault, so they are also only hoisted from
+ * blocks that run on every iteration. Inner loops are processed first, so
+ * their hoisted instructions can move further out.
+ *
+ *   Vars that are passed to a call are never hoisted, the parameters of a
+ * call have to stay consecutive.
+ */
+class LoopInvariantCodeMotion final
+{
+    DEFAULT_DESTRUCT(LoopInvariantCodeMotion);
+    DELETE_CM(LoopInvariantCodeMotion);
+public:
+    LoopInvariantCodeMotion(const SsaCustomTypeRegistry& registry) noexcept
+        : m_Registry(&registry)
+        , m_Writer()
+        , m_Graph()
+        , m_HoistedCount(0)
+    { }
+
+    [[nodiscard]] const SsaWriter& Writer() const noexcept { return m_Writer; }
+    [[nodiscard]]       SsaWriter& Writer()       noexcept { return m_Writer; }
+
+    /**
+     * The number of instructions moved by the last run.
+     */
+    [[nodiscard]] u32 HoistedCount() const noexcept { return m_HoistedCount; }
+
+    /**
+     *   Named like the visitors so the pass manager can run it the same
+     * way, the code is decoded into an SsaGraph first.
+     */
+    [[nodiscard]] bool Traverse(const u8* codePtr, uSys size, VarId maxId) noexcept;
+    [[nodiscard]] bool Traverse(const Function* function) noexcept;
+
+    void UpdateAttachment(Function* function) noexcept;
+private:
+    struct Loop final
+    {
+        u32 Header;
+        u32 Preheader;
+        u32 BlockCount;
+        bool WritesMemory;
+        // Indexed by block.
+        ::std::vector<u8> Blocks;
+        // The blocks that branch back to the header, and the blocks that branch out of the loop.
+        ::std::vector<u32> Latches;
+        ::std::vector<u32> Exits;
+    };
+private:
+    void ComputeControlFlow() noexcept;
+    void ComputeDominators() noexcept;
+    [[nodiscard]] bool Dominates(u32 dominator, u32 block) const noexcept;
+    void FindLoops() noexcept;
+    void HoistLoop(const Loop& loop) noexcept;
+    [[nodiscard]] bool IsInvariant(const Loop& loop, u32 inst) const noexcept;
+    [[nodiscard]] bool RunsEveryIteration(const Loop& loop, u32 block) const noexcept;
+private:
+    const SsaCustomTypeRegistry* m_Registry;
+    SsaWriter m_Writer;
+    SsaGraph m_Graph;
+    u32 m_HoistedCount;
+
+    // Successors and predecessors including fall through, which the graph doesn't record.
+    ::std::vector<::std::vector<u32>> m_Successors;
+    ::std::vector<::std::vector<u32>> m_Predecessors;
+    // The position of each block in a post order walk, -1 for unreachable blocks.
+    ::std::vector<u32> m_PostIndices;
+    ::std::vector<u32> m_Dominators;
+    ::std::vector<Loop> m_Loops;
+
+    // The instructions of each block in the order they will be written.
+    ::std::vector<::std::vector<u32>> m_BlockInsts;
+    // The block each instruction is currently placed in.
+    ::std::vector<u32> m_InstBlocks;
+    // Set for vars that are passed to a call.
+    ::std::vector<u8> m_CallParameters;
+};
+
+}
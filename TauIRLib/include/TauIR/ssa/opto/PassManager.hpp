@@ -0,0 +1,272 @@
+#pragma once
+
+#include <Objects.hpp>
+#include <NumTypes.hpp>
+#include <initializer_list>
+#include <vector>
+
+#include "CommonSubexpressionElimination.hpp"
+#include "ConstantProp.hpp"
+#include "DeadCodeElimination.hpp"
+#include "Inliner.hpp"
+#include "JoinSplitFolding.hpp"
+#include "LoadStoreElimination.hpp"
+#include "LoopInvariantCodeMotion.hpp"
+#include "StrengthReduction.hpp"
+#include "TauIR/Function.hpp"
+#include "TauIR/Module.hpp"
+#include "TauIR/ssa/SsaCallGraph.hpp"
+#include "TauIR/ssa/SsaGraph.hpp"
+#include "TauIR/ssa/SsaWriter.hpp"
+
+namespace tau::ir::ssa::opto {
+
+enum class SsaPass : u32
+{
+    ConstantProp = 0,
+    /**
+     *   Computes the usage map for DeadCodeElimination. It doesn't change
+     * the code, DeadCodeElimination runs it itself if the map is stale.
+     */
+    UsageAnalysis,
+    DeadCodeElimination,
+    Inline,
+    CommonSubexpressionElimination,
+    LoopInvariantCodeMotion,
+    StrengthReduction,
+    JoinSplitFolding,
+    LoadStoreElimination
+};
+
+/**
+ * \brief A declarative sequence of SSA passes.
+ *
+ *   The passes are grouped into stages that run in order. A stage runs
+ * all of its passes, and repeats them until a full round leaves the
+ * code unchanged, or it has run MaxIterations rounds.
+ */
+class SsaPipeline final
+{
+    DEFAULT_CONSTRUCT_PU(SsaPipeline);
+    DEFAULT_DESTRUCT(SsaPipeline);
+    DEFAULT_CM_PU(SsaPipeline);
+public:
+    struct Stage final
+    {
+        ::std::vector<SsaPass> Passes;
+        u32 MaxIterations;
+    };
+public:
+    /**
+     * Adds a stage that runs once.
+     */
+    SsaPipeline& Run(const ::std::initializer_list<SsaPass> passes) noexcept
+    {
+        m_Stages.push_back({ passes, 1 });
+        return *this;
+    }
+
+    /**
+     * Adds a stage that is repeated until it reaches a fixed point.
+     */
+    SsaPipeline& Repeat(const ::std::initializer_list<SsaPass> passes, const u32 maxIterations) noexcept
+    {
+        m_Stages.push_back({ passes, maxIterations });
+        return *this;
+    }
+
+    [[nodiscard]] const ::std::vector<Stage>& Stages() const noexcept { return m_Stages; }
+    [[nodiscard]] bool IsEmpty() const noexcept { return m_Stages.empty(); }
+private:
+    ::std::vector<Stage> m_Stages;
+};
+
+/**
+ * \brief Runs a pipeline of passes over the SSA of functions.
+ *
+ *   Each OptimizationControl level has its own pipeline, functions
+ * marked NoOptimize are always skipped. The passes write into two
+ * SsaWriters that are swapped between passes, the buffers are reused
+ * for every pass and every function. The attachment of a function is
+ * only updated once, after its whole pipeline has run, and only if
+ * the code changed.
+ *
+ *   A pass that produces the exact same code as its input counts as
+ * unchanged, this is what ends the repeated stages.
+ */
+class SsaPassManager final
+{
+    DEFAULT_DESTRUCT(SsaPassManager);
+    DELETE_CM(SsaPassManager);
+public:
+    /**
+     * The most specialized copies made of a single function.
+     */
+    static constexpr u32 MaxSpecializations = 4;
+    /**
+     *   The most SSA instructions the specialized copies may add to the
+     * module in one SpecializeFunctions.
+     */
+    static constexpr u32 SpecializationBudget = 256;
+public:
+    /**
+     * @param module
+     *   The module that calls are resolved against for inlining.
+     */
+    SsaPassManager(const SsaCustomTypeRegistry& registry, const ModuleRef& module) noexcept;
+
+    /**
+     *   The pipeline that is used for each level when none is set.
+     * Default optimizes like ForceOptimize, except in debug builds where
+     * it doesn't optimize at all. OptimizeHint only runs a single round
+     * without inlining.
+     */
+    [[nodiscard]] static SsaPipeline DefaultPipeline(OptimizationControl optimizationControl) noexcept;
+
+    [[nodiscard]] const SsaPipeline& Pipeline(const OptimizationControl optimizationControl) const noexcept { return m_Pipelines[static_cast<u32>(optimizationControl)]; }
+
+    /**
+     * The pipeline for NoOptimize is never run.
+     */
+    void SetPipeline(const OptimizationControl optimizationControl, SsaPipeline pipeline) noexcept { m_Pipelines[static_cast<u32>(optimizationControl)] = ::std::move(pipeline); }
+
+    /**
+     * The call graph of the module as of the last RunModule.
+     */
+    [[nodiscard]] const SsaCallGraph& CallGraph() const noexcept { return m_CallGraph; }
+
+    /**
+     * @return Whether the SSA attached to the function changed.
+     */
+    bool RunFunction(Function* function) noexcept;
+
+    /**
+     *   Runs every function of the module, bottom up over the call graph
+     * so that callees are optimized before they are inlined. Functions
+     * that can't be reached from the entry point or an export are
+     * skipped.
+     *
+     * @return The number of functions whose SSA changed.
+     */
+    u32 RunModule() noexcept;
+
+    /**
+     *   Deletes the functions of the module that can't be reached, and
+     * renumbers the calls in the SSA of the rest. The IR code of the
+     * functions still has the old indices, the module has to be lowered
+     * with SsaToIr before it is run again.
+     *
+     *   The module is only changed if it isn't imported, and SsaToIr can
+     * lower every function that is kept. Otherwise the functions that
+     * can't be reached are only left out by RunModule and
+     * SpecializeFunctions.
+     *
+     * @param isImported
+     *   Whether another module imports this one. Imports refer to the
+     *   functions by index and by pointer, neither of which can be
+     *   updated from here.
+     * @return The number of functions that were deleted.
+     */
+    u32 RemoveDeadFunctions(bool isImported) noexcept;
+
+    /**
+     *   Redirects calls that pass constants to a copy of the callee with
+     * those arguments replaced by the constants. The copy is optimized
+     * with ConstantProp and DeadCodeElimination, and is added after the
+     * last function of the module. Calls with the same callee and the
+     * same constants share a copy.
+     *
+     *   Only parameters that are copies of an 8 byte immediate count as
+     * constant, so this is meant to run after RunModule. The calls that
+     * are left then are the ones that weren't worth inlining. The copy
+     * keeps the full signature of the callee, the call still passes the
+     * constants. Each callee gets at most MaxSpecializations copies, and
+     * the copies may add at most SpecializationBudget instructions.
+     *
+     * @return The number of calls that were redirected.
+     */
+    u32 SpecializeFunctions() noexcept;
+private:
+    struct ConstantArgument final
+    {
+        u32 Index;
+        u64 Value;
+
+        [[nodiscard]] bool operator==(const ConstantArgument& other) const noexcept = default;
+    };
+
+    struct Specialization final
+    {
+        u32 Callee;
+        u32 Copy;
+        // Owned by the pass manager until the copies are added to the module.
+        Function* CopyFunction;
+        ::std::vector<ConstantArgument> Constants;
+    };
+private:
+    bool RunFunction(Function* function, u32 functionIndex) noexcept;
+
+    /**
+     * @return Whether the pipeline changed the loaded code.
+     */
+    bool RunPipeline(const SsaPipeline& pipeline) noexcept;
+
+    /**
+     *   Finds or makes the copy of the callee for a call in m_Graph.
+     *
+     * @return The index of the copy, or SsaCallGraph::InvalidIndex if the
+     * call is left alone.
+     */
+    [[nodiscard]] u32 SpecializeCall(u32 inst, ::std::vector<Specialization>& specializations, u32& growth) noexcept;
+
+    /**
+     *   Follows the copies of a var in m_Graph back to an 8 byte
+     * immediate.
+     */
+    [[nodiscard]] bool FindConstant(VarId var, u64* value) const noexcept;
+
+    [[nodiscard]] bool LoadFunction(const Function* function) noexcept;
+    void UpdateAttachment(Function* function) noexcept;
+
+    /**
+     * @return Whether the pass changed the code.
+     */
+    bool RunPass(SsaPass pass) noexcept;
+    void RunUsageAnalysis() noexcept;
+
+    template<typename Visitor>
+    bool RunTransform(Visitor& visitor) noexcept;
+private:
+    const SsaCustomTypeRegistry& m_Registry;
+    ModuleRef m_Module;
+    SsaCallGraph m_CallGraph;
+    SsaPipeline m_Pipelines[4];
+    SsaPipeline m_SpecializationPipeline;
+
+    ConstantPropVisitor m_ConstantProp;
+    UsageAnalyzerVisitor m_UsageAnalyzer;
+    DeadCodeEliminationVisitor m_DeadCodeElimination;
+    InlinerVisitor m_Inliner;
+    CommonSubexpressionEliminationVisitor m_CommonSubexpressionElimination;
+    LoopInvariantCodeMotion m_LoopInvariantCodeMotion;
+    StrengthReductionVisitor m_StrengthReduction;
+    JoinSplitFoldingVisitor m_JoinSplitFolding;
+    LoadStoreElimination m_LoadStoreElimination;
+
+    // Decodes the functions whose calls are renumbered or redirected.
+    SsaGraph m_Graph;
+    // Decodes the callees that are copied.
+    SsaGraph m_SpecializationGraph;
+    internal::InlineCostVisitor m_SpecializationCost;
+
+    SsaWriter m_Writers[2];
+    // The writer the next pass writes into, the other one holds the current code once a pass has changed it.
+    u32 m_Back;
+
+    const u8* m_Code;
+    uSys m_CodeSize;
+    VarId m_MaxId;
+    bool m_UsageValid;
+};
+
+}
@@ -1,8 +1,359 @@
 #pragma once
 #include "TauIR/ssa/SsaVisitor.hpp"
+#include "TauIR/ssa/SsaWriter.hpp"
+#include "TauIR/ssa/SsaFunctionAttachment.hpp"
+#include <DynArray.hpp>
+#include <cstring>
 
 namespace tau::ir::ssa::opto {
 
+namespace internal {
+
+/**
+ *   Without parameters the base index of a call is the id of the call
+ * itself. Parameters have to be consecutive vars, if the vars they map to
+ * aren't they are copied into new consecutive vars before the call.
+ *
+ * @return The base index of the parameters in the rewritten code.
+ */
+template<typename TMapVar>
+[[nodiscard]] VarId RemapCallParameters(SsaWriter& writer, const VarId baseIndex, const u32 parameterCount, TMapVar&& mapVar) noexcept
+{
+    if(parameterCount == 0)
+    {
+        return writer.IdIndex() + 1;
+    }
+
+    const VarId newBase = mapVar(baseIndex);
+    bool isSequential = true;
+
+    for(u32 i = 1; i < parameterCount; ++i)
+    {
+        if(mapVar(baseIndex + i) != newBase + i)
+        {
+            isSequential = false;
+            break;
+        }
+    }
+
+    if(isSequential)
+    {
+        return newBase;
+    }
+
+    VarId copyBase = 0;
+
+    for(u32 i = 0; i < parameterCount; ++i)
+    {
+        const VarId source = mapVar(baseIndex + i);
+        // Arguments aren't in the type map, parameters are passed as U64 anyway.
+        const SsaCustomType type = (source & 0x80000000) != 0 ? SsaCustomType(SsaType::U64) : writer.GetVarType(source);
+        const VarId copy = writer.WriteAssignVariable(type, source);
+
+        if(i == 0)
+        {
+            copyBase = copy;
+        }
+    }
+
+    return copyBase;
+}
+
+}
+
+/**
+ * \brief The base of passes that copy a function into a new writer, changing some instructions on the way.
+ *
+ *   Every instruction is written again with its operands mapped to the
+ * vars that replaced them, a pass only implements the visits of the
+ * instructions it changes. Arguments map to themselves. Branches and phis
+ * can refer to a label that isn't written yet, those are patched once the
+ * traversal is done.
+ *
+ *   A pass that hides PreTraversal or PostTraversal has to call the one
+ * of the base as well.
+ */
+// ReSharper disable CppHidingFunction
+template<typename TVisitor>
+class ReWriteVisitorBase : public SsaVisitor<TVisitor>
+{
+    DEFAULT_DESTRUCT(ReWriteVisitorBase);
+    DELETE_CM(ReWriteVisitorBase);
+protected:
+    ReWriteVisitorBase(const SsaCustomTypeRegistry& registry) noexcept
+        : SsaVisitor<TVisitor>(registry)
+        , m_Writer()
+        , m_NewVarMap()
+        , m_ForwardRefs()
+    { }
+public:
+    [[nodiscard]] const SsaWriter& Writer() const noexcept { return m_Writer; }
+    [[nodiscard]]       SsaWriter& Writer()       noexcept { return m_Writer; }
+
+    void UpdateAttachment(Function* const function) noexcept
+    {
+        {
+            SsaWriterFunctionAttachment* const ssaWriterAttachment = function->FindAttachment<SsaWriterFunctionAttachment>();
+
+            if(ssaWriterAttachment)
+            {
+                ssaWriterAttachment->Writer() = ::std::move(m_Writer);
+            }
+        }
+
+        {
+            const SsaFunctionAttachment* const ssaAttachment = function->FindAttachment<SsaFunctionAttachment>();
+
+            if(ssaAttachment)
+            {
+                function->RemoveAttachment<SsaFunctionAttachment>();
+                function->Attach<SsaFunctionAttachment>(m_Writer.Buffer(), m_Writer.Size(), m_Writer.IdIndex(), m_Writer.VarTypeMap());
+            }
+        }
+    }
+public:
+    bool PreTraversal(const u8* const codePtr, const uSys size, const VarId maxId) noexcept
+    {
+        if(m_NewVarMap.Count() != maxId + 1)
+        {
+            m_NewVarMap = DynArray<VarId>(maxId + 1);
+        }
+
+        (void) ::std::memset(m_NewVarMap.Array(), 0xFF, m_NewVarMap.Count() * sizeof(VarId));
+
+        m_Writer.Reset(size);
+        m_ForwardRefs.Clear();
+
+        return true;
+    }
+
+    bool PostTraversal() noexcept
+    {
+        m_ForwardRefs.Resolve(m_Writer, [this](const VarId var) { return FindSourceVar(var); });
+
+        return true;
+    }
+
+    bool VisitLabel(const VarId label) noexcept
+    {
+        m_NewVarMap[label] = m_Writer.WriteLabel();
+        return true;
+    }
+
+    bool VisitAssignImmediate(const VarId newVar, const SsaCustomType type, const void* const value, const uSys size) noexcept
+    {
+        m_NewVarMap[newVar] = m_Writer.WriteAssignImmediate(type, value, size);
+        return true;
+    }
+
+    bool VisitAssignVar(const VarId newVar, const SsaCustomType type, const VarId var) noexcept
+    {
+        m_NewVarMap[newVar] = m_Writer.WriteAssignVariable(type, FindSourceVar(var));
+        return true;
+    }
+
+    bool VisitExpandSX(const VarId newVar, const SsaCustomType newType, const SsaCustomType oldType, const VarId var) noexcept
+    {
+        m_NewVarMap[newVar] = m_Writer.WriteExpandSX(newType, oldType, FindSourceVar(var));
+        return true;
+    }
+
+    bool VisitExpandZX(const VarId newVar, const SsaCustomType newType, const SsaCustomType oldType, const VarId var) noexcept
+    {
+        m_NewVarMap[newVar] = m_Writer.WriteExpandZX(newType, oldType, FindSourceVar(var));
+        return true;
+    }
+
+    bool VisitTrunc(const VarId newVar, const SsaCustomType newType, const SsaCustomType oldType, const VarId var) noexcept
+    {
+        m_NewVarMap[newVar] = m_Writer.WriteTrunc(newType, oldType, FindSourceVar(var));
+        return true;
+    }
+
+    bool VisitRCast(const VarId newVar, const SsaCustomType newType, const SsaCustomType oldType, const VarId var) noexcept
+    {
+        m_NewVarMap[newVar] = m_Writer.WriteRCast(newType, oldType, FindSourceVar(var));
+        return true;
+    }
+
+    bool VisitBCast(const VarId newVar, const SsaCustomType newType, const SsaCustomType oldType, const VarId var) noexcept
+    {
+        m_NewVarMap[newVar] = m_Writer.WriteBCast(newType, oldType, FindSourceVar(var));
+        return true;
+    }
+
+    bool VisitLoad(const VarId newVar, const SsaCustomType type, const VarId var) noexcept
+    {
+        m_NewVarMap[newVar] = m_Writer.WriteLoad(type, FindSourceVar(var));
+        return true;
+    }
+
+    bool VisitStoreV(const SsaCustomType type, const VarId destination, const VarId source) noexcept
+    {
+        m_Writer.WriteStoreV(type, FindSourceVar(destination), FindSourceVar(source));
+        return true;
+    }
+
+    bool VisitStoreI(const SsaCustomType type, const VarId destination, const void* const value, const uSys size) noexcept
+    {
+        m_Writer.WriteStoreI(type, FindSourceVar(destination), value, size);
+        return true;
+    }
+
+    bool VisitComputePtr(const VarId newVar, const VarId base, const VarId index, const i8 multiplier, const i16 offset) noexcept
+    {
+        m_NewVarMap[newVar] = m_Writer.WriteComputePtr(FindSourceVar(base), FindSourceVar(index), multiplier, offset);
+        return true;
+    }
+
+    bool VisitBinOpVToV(const VarId newVar, const SsaBinaryOperation operation, const SsaCustomType type, const VarId a, const VarId b) noexcept
+    {
+        m_NewVarMap[newVar] = m_Writer.WriteBinOpVtoV(operation, type, FindSourceVar(a), FindSourceVar(b));
+        return true;
+    }
+
+    bool VisitBinOpVToI(const VarId newVar, const SsaBinaryOperation operation, const SsaCustomType type, const void* const a, const uSys aSize, const VarId b) noexcept
+    {
+        m_NewVarMap[newVar] = m_Writer.WriteBinOpVtoI(operation, type, a, aSize, FindSourceVar(b));
+        return true;
+    }
+
+    bool VisitBinOpIToV(const VarId newVar, const SsaBinaryOperation operation, const SsaCustomType type, const VarId a, const void* const b, const uSys bSize) noexcept
+    {
+        m_NewVarMap[newVar] = m_Writer.WriteBinOpItoV(operation, type, FindSourceVar(a), b, bSize);
+        return true;
+    }
+
+    bool VisitCompVToV(const VarId newVar, const CompareCondition condition, const SsaCustomType type, const VarId a, const VarId b) noexcept
+    {
+        m_NewVarMap[newVar] = m_Writer.WriteCompVtoV(condition, type, FindSourceVar(a), FindSourceVar(b));
+        return true;
+    }
+
+    bool VisitCompVToI(const VarId newVar, const CompareCondition condition, const SsaCustomType type, const void* const a, const uSys aSize, const VarId b) noexcept
+    {
+        m_NewVarMap[newVar] = m_Writer.WriteCompVtoI(condition, type, a, aSize, FindSourceVar(b));
+        return true;
+    }
+
+    bool VisitCompIToV(const VarId newVar, const CompareCondition condition, const SsaCustomType type, const VarId a, const void* const b, const uSys bSize) noexcept
+    {
+        m_NewVarMap[newVar] = m_Writer.WriteCompItoV(condition, type, FindSourceVar(a), b, bSize);
+        return true;
+    }
+
+    bool VisitCall(const VarId newVar, const u32 functionIndex, const VarId baseIndex, const u32 parameterCount) noexcept
+    {
+        const VarId newBase = FindBaseIndex(baseIndex, parameterCount);
+        m_NewVarMap[newVar] = m_Writer.WriteCall(functionIndex, newBase, parameterCount);
+
+        return true;
+    }
+
+    bool VisitCallExt(const VarId newVar, const u32 functionIndex, const VarId baseIndex, const u32 parameterCount, const u16 moduleIndex) noexcept
+    {
+        const VarId newBase = FindBaseIndex(baseIndex, parameterCount);
+        m_NewVarMap[newVar] = m_Writer.WriteCallExt(functionIndex, newBase, parameterCount, moduleIndex);
+
+        return true;
+    }
+
+    bool VisitCallInd(const VarId newVar, const VarId functionPointer, const VarId baseIndex, const u32 parameterCount) noexcept
+    {
+        const VarId newFunctionPointer = FindSourceVar(functionPointer);
+        const VarId newBase = FindBaseIndex(baseIndex, parameterCount);
+        m_NewVarMap[newVar] = m_Writer.WriteCallInd(newFunctionPointer, newBase, parameterCount);
+
+        return true;
+    }
+
+    bool VisitCallIndExt(const VarId newVar, const VarId functionPointer, const VarId baseIndex, const u32 parameterCount, const VarId modulePointer) noexcept
+    {
+        const VarId newFunctionPointer = FindSourceVar(functionPointer);
+        const VarId newModulePointer = FindSourceVar(modulePointer);
+        const VarId newBase = FindBaseIndex(baseIndex, parameterCount);
+        m_NewVarMap[newVar] = m_Writer.WriteCallIndExt(newFunctionPointer, newBase, parameterCount, newModulePointer);
+
+        return true;
+    }
+
+    bool VisitRet(const SsaCustomType returnType, const VarId var) noexcept
+    {
+        m_Writer.WriteRet(returnType, FindSourceVar(var));
+        return true;
+    }
+
+    bool VisitSplit(const VarId baseIndex, const SsaCustomType aType, const VarId a, const uSys splitCount, const SsaCustomType* const splitTypes) noexcept
+    {
+        const VarId newBase = m_Writer.WriteSplit(aType, FindSourceVar(a), static_cast<u32>(splitCount), splitTypes);
+
+        for(uSys i = 0; i < splitCount; ++i)
+        {
+            m_NewVarMap[baseIndex + i] = static_cast<VarId>(newBase + i);
+        }
+
+        return true;
+    }
+
+    bool VisitJoin(const VarId newVar, const SsaCustomType newType, const uSys joinCount, const SsaCustomType* const joinTypes, const VarId* const joinVars) noexcept
+    {
+        DynArray<VarId> newJoinVars(joinCount);
+
+        for(uSys i = 0; i < joinCount; ++i)
+        {
+            newJoinVars[i] = FindSourceVar(joinVars[i]);
+        }
+
+        m_NewVarMap[newVar] = m_Writer.WriteJoin(newType, static_cast<u32>(joinCount), joinTypes, newJoinVars);
+
+        return true;
+    }
+
+    bool VisitBranch(const VarId label) noexcept
+    {
+        m_Writer.WriteBranch(label);
+        m_ForwardRefs.Add(m_Writer.Size() - sizeof(VarId), label);
+
+        return true;
+    }
+
+    bool VisitBranchCond(const VarId labelTrue, const VarId labelFalse, const VarId conditionVar) noexcept
+    {
+        m_Writer.WriteBranchCond(labelTrue, labelFalse, FindSourceVar(conditionVar));
+        m_ForwardRefs.Add(m_Writer.Size() - 3 * sizeof(VarId), labelTrue);
+        m_ForwardRefs.Add(m_Writer.Size() - 2 * sizeof(VarId), labelFalse);
+
+        return true;
+    }
+
+    bool VisitPhi(const VarId newVar, const SsaCustomType type, const uSys incomingCount, const VarId* const labels, const VarId* const vars) noexcept
+    {
+        m_NewVarMap[newVar] = m_Writer.WritePhi(type, static_cast<u32>(incomingCount), labels, vars);
+        m_ForwardRefs.AddPhi(m_Writer, static_cast<u32>(incomingCount), labels, vars);
+
+        return true;
+    }
+protected:
+    [[nodiscard]] VarId FindSourceVar(const VarId var) const noexcept
+    {
+        if((var & 0x80000000) != 0)
+        {
+            return var;
+        }
+
+        return m_NewVarMap[var];
+    }
+
+    [[nodiscard]] VarId FindBaseIndex(const VarId baseIndex, const u32 parameterCount) noexcept
+    {
+        return internal::RemapCallParameters(m_Writer, baseIndex, parameterCount, [this](const VarId var) { return FindSourceVar(var); });
+    }
+protected:
+    SsaWriter m_Writer;
+    DynArray<VarId> m_NewVarMap;
+    SsaForwardRefs m_ForwardRefs;
+};
+
 // ReSharper disable CppHidingFunction
 class ReWriteVisitor final : public SsaVisitor<ReWriteVisitor>
 {
@@ -206,25 +557,25 @@ public:
 
     bool VisitCall(const VarId newVar, const u32 functionIndex, const VarId baseIndex, const u32 parameterCount) noexcept
     {
-        NewVarMap()[newVar + m_OldVarMapSize] = Writer().WriteCall(functionIndex, baseIndex, parameterCount);
+        NewVarMap()[newVar + m_OldVarMapSize] = Writer().WriteCall(functionIndex, TransformBaseIndex(baseIndex, parameterCount), parameterCount);
         return true;
     }
 
     bool VisitCallExt(const VarId newVar, const u32 functionIndex, const VarId baseIndex, const u32 parameterCount, const u16 moduleIndex) noexcept
     {
-        NewVarMap()[newVar + m_OldVarMapSize] = Writer().WriteCallExt(functionIndex, baseIndex, parameterCount, moduleIndex);
+        NewVarMap()[newVar + m_OldVarMapSize] = Writer().WriteCallExt(functionIndex, TransformBaseIndex(baseIndex, parameterCount), parameterCount, moduleIndex);
         return true;
     }
 
     bool VisitCallInd(const VarId newVar, const VarId functionPointer, const VarId baseIndex, const u32 parameterCount) noexcept
     {
-        NewVarMap()[newVar + m_OldVarMapSize] = Writer().WriteCallInd(TransformVar(functionPointer), TransformVar(baseIndex), parameterCount);
+        NewVarMap()[newVar + m_OldVarMapSize] = Writer().WriteCallInd(TransformVar(functionPointer), TransformBaseIndex(baseIndex, parameterCount), parameterCount);
         return true;
     }
 
     bool VisitCallIndExt(const VarId newVar, const VarId functionPointer, const VarId baseIndex, const u32 parameterCount, const VarId modulePointer) noexcept
     {
-        NewVarMap()[newVar + m_OldVarMapSize] = Writer().WriteCallIndExt(TransformVar(functionPointer), TransformVar(baseIndex), parameterCount, TransformVar(modulePointer));
+        NewVarMap()[newVar + m_OldVarMapSize] = Writer().WriteCallIndExt(TransformVar(functionPointer), TransformBaseIndex(baseIndex, parameterCount), parameterCount, TransformVar(modulePointer));
         return true;
     }
 
@@ -239,16 +590,28 @@ private:
     {
         if((var & 0x80000000) == 0x80000000)
         {
+            // An argument the call didn't pass is undefined.
+            if((var & 0x7FFFFFFF) >= m_ArgCount)
+            {
+                return 0;
+            }
+
             return NewVarMap()[m_BaseArg + (var & 0x7FFFFFFF)];
         }
 
         return NewVarMap()[var + m_OldVarMapSize];
     }
+
+    // The parameters of a call have to stay consecutive, they are copied if the arguments they map to aren't.
+    [[nodiscard]] VarId TransformBaseIndex(const VarId baseIndex, const u32 parameterCount)
+    {
+        return internal::RemapCallParameters(Writer(), baseIndex, parameterCount, [this](const VarId var) { return TransformVar(var); });
+    }
 private:
     SsaWriter* m_Writer;
     ::std::vector<VarId>* m_NewVarMap;
     VarId m_BaseArg;
-    [[maybe_unused]] u32 m_ArgCount;
+    u32 m_ArgCount;
     VarId m_RetVar;
     uSys m_OldVarMapSize;
 };
@@ -0,0 +1,519 @@
+#pragma once
+
+#include "TauIR/ssa/opto/ReWriteVisitor.hpp"
+#include <cstring>
+#include <type_traits>
+
+namespace tau::ir::ssa::opto {
+
+namespace internal {
+
+template<typename U>
+struct DivisionMagic final
+{
+    U Multiplier;
+    u32 Shift;
+    /**
+     *   Unsigned only, the multiplier didn't fit and the dividend has to be
+     * added back after the multiply.
+     */
+    bool Add;
+};
+
+/**
+ *   The magic number for signed division by a constant, from Hacker's
+ * Delight, figure 10-1. The divisor is the two's complement bit pattern,
+ * it can't be -1, 0, 1 or the minimum value.
+ */
+template<typename U>
+[[nodiscard]] constexpr DivisionMagic<U> ComputeSignedMagic(const U divisor) noexcept
+{
+    static_assert(::std::is_unsigned_v<U>, "The magic is computed with unsigned arithmetic.");
+
+    constexpr u32 Bits = sizeof(U) * 8;
+    constexpr U SignBit = static_cast<U>(U { 1 } << (Bits - 1));
+
+    const bool negative = (divisor & SignBit) != 0;
+    const U absDivisor = negative ? static_cast<U>(U { 0 } - divisor) : divisor;
+    const U t = static_cast<U>(SignBit + (divisor >> (Bits - 1)));
+    // The absolute value of the largest dividend whose remainder is divisor - 1.
+    const U absNc = static_cast<U>(t - 1 - t % absDivisor);
+
+    u32 p = Bits - 1;
+    U q1 = static_cast<U>(SignBit / absNc);
+    U r1 = static_cast<U>(SignBit - q1 * absNc);
+    U q2 = static_cast<U>(SignBit / absDivisor);
+    U r2 = static_cast<U>(SignBit - q2 * absDivisor);
+    U delta;
+
+    do
+    {
+        ++p;
+
+        q1 = static_cast<U>(q1 * 2);
+        r1 = static_cast<U>(r1 * 2);
+
+        if(r1 >= absNc)
+        {
+            ++q1;
+            r1 = static_cast<U>(r1 - absNc);
+        }
+
+        q2 = static_cast<U>(q2 * 2);
+        r2 = static_cast<U>(r2 * 2);
+
+        if(r2 >= absDivisor)
+        {
+            ++q2;
+            r2 = static_cast<U>(r2 - absDivisor);
+        }
+
+        delta = static_cast<U>(absDivisor - r2);
+    } while(q1 < delta || (q1 == delta && r1 == 0));
+
+    U multiplier = static_cast<U>(q2 + 1);
+
+    if(negative)
+    {
+        multiplier = static_cast<U>(U { 0 } - multiplier);
+    }
+
+    return { multiplier, p - Bits, false };
+}
+
+/**
+ *   The magic number for unsigned division by a constant, from Hacker's
+ * Delight, figure 10-2. The divisor can't be 0.
+ */
+template<typename U>
+[[nodiscard]] constexpr DivisionMagic<U> ComputeUnsignedMagic(const U divisor) noexcept
+{
+    static_assert(::std::is_unsigned_v<U>, "The magic is computed with unsigned arithmetic.");
+
+    constexpr u32 Bits = sizeof(U) * 8;
+    constexpr U SignBit = static_cast<U>(U { 1 } << (Bits - 1));
+    constexpr U MaxSigned = static_cast<U>(SignBit - 1);
+
+    bool add = false;
+    const U nc = static_cast<U>(static_cast<U>(~U { 0 }) - static_cast<U>(U { 0 } - divisor) % divisor);
+
+    u32 p = Bits - 1;
+    U q1 = static_cast<U>(SignBit / nc);
+    U r1 = static_cast<U>(SignBit - q1 * nc);
+    U q2 = static_cast<U>(MaxSigned / divisor);
+    U r2 = static_cast<U>(MaxSigned - q2 * divisor);
+    U delta;
+
+    do
+    {
+        ++p;
+
+        if(r1 >= nc - r1)
+        {
+            q1 = static_cast<U>(q1 * 2 + 1);
+            r1 = static_cast<U>(r1 * 2 - nc);
+        }
+        else
+        {
+            q1 = static_cast<U>(q1 * 2);
+            r1 = static_cast<U>(r1 * 2);
+        }
+
+        if(r2 + 1 >= divisor - r2)
+        {
+            if(q2 >= MaxSigned)
+            {
+                add = true;
+            }
+
+            q2 = static_cast<U>(q2 * 2 + 1);
+            r2 = static_cast<U>(r2 * 2 + 1 - divisor);
+        }
+        else
+        {
+            if(q2 >= SignBit)
+            {
+                add = true;
+            }
+
+            q2 = static_cast<U>(q2 * 2);
+            r2 = static_cast<U>(r2 * 2 + 1);
+        }
+
+        delta = static_cast<U>(divisor - 1 - r2);
+    } while(p < 2 * Bits && (q1 < delta || (q1 == delta && r1 == 0)));
+
+    return { static_cast<U>(q2 + 1), p - Bits, add };
+}
+
+[[nodiscard]] inline bool IsPowerOf2(const u64 value) noexcept
+{
+    return value != 0 && (value & (value - 1)) == 0;
+}
+
+[[nodiscard]] inline u32 Log2(u64 value) noexcept
+{
+    u32 log = 0;
+
+    while(value > 1)
+    {
+        value >>= 1;
+        ++log;
+    }
+
+    return log;
+}
+
+}
+
+/**
+ * \brief Replaces multiplication and division by a constant with cheaper instructions.
+ *
+ *   Multiplying by a power of two becomes a left shift, and multiplying
+ * by the sum or difference of two powers of two becomes two shifts and
+ * an add or sub. Other constants are left as a multiply.
+ *
+ *   Unsigned division by a power of two becomes a right shift, signed
+ * division adds a bias to negative dividends first so the result still
+ * rounds towards zero. Division of 4 and 8 byte integers by any other
+ * constant becomes a multiply by a magic number, keeping the high half of
+ * the product, followed by a shift. A remainder is computed from the
+ * quotient as x - q * d.
+ *
+ *   The rewritten instructions are typed like the original, narrow types
+ * only get the shift forms, the high half of a widened product isn't the
+ * high half of the narrow one.
+ */
+// ReSharper disable CppHidingFunction
+class StrengthReductionVisitor final : public ReWriteVisitorBase<StrengthReductionVisitor>
+{
+    DEFAULT_DESTRUCT(StrengthReductionVisitor);
+    DELETE_CM(StrengthReductionVisitor);
+public:
+    StrengthReductionVisitor(const SsaCustomTypeRegistry& registry) noexcept
+        : ReWriteVisitorBase(registry)
+        , m_ReducedCount(0)
+    { }
+
+    /**
+     * The number of instructions rewritten by the last traversal.
+     */
+    [[nodiscard]] u32 ReducedCount() const noexcept { return m_ReducedCount; }
+public:
+    bool PreTraversal(const u8* const codePtr, const uSys size, const VarId maxId) noexcept
+    {
+        m_ReducedCount = 0;
+        return ReWriteVisitorBase::PreTraversal(codePtr, size, maxId);
+    }
+
+    bool VisitBinOpVToI(const VarId newVar, const SsaBinaryOperation operation, const SsaCustomType type, const void* const a, const uSys aSize, const VarId b) noexcept
+    {
+        const VarId newB = FindSourceVar(b);
+
+        // Only a multiply can have its constant on the left.
+        if(operation == SsaBinaryOperation::Mul && IsReducibleType(type, aSize))
+        {
+            const VarId reduced = ReduceMultiply(type, newB, ReadImmediate(a, aSize));
+
+            if(reduced != 0)
+            {
+                m_NewVarMap[newVar] = reduced;
+                ++m_ReducedCount;
+                return true;
+            }
+        }
+
+        m_NewVarMap[newVar] = m_Writer.WriteBinOpVtoI(operation, type, a, aSize, newB);
+        return true;
+    }
+
+    bool VisitBinOpIToV(const VarId newVar, const SsaBinaryOperation operation, const SsaCustomType type, const VarId a, const void* const b, const uSys bSize) noexcept
+    {
+        const VarId newA = FindSourceVar(a);
+
+        if(IsReducibleType(type, bSize))
+        {
+            const u64 constant = ReadImmediate(b, bSize);
+            VarId reduced = 0;
+
+            switch(operation)
+            {
+                case SsaBinaryOperation::Mul:
+                    reduced = ReduceMultiply(type, newA, constant);
+                    break;
+                case SsaBinaryOperation::Div:
+                case SsaBinaryOperation::Rem:
+                    reduced = ReduceDivide(operation, type, newA, constant);
+                    break;
+                default:
+                    break;
+            }
+
+            if(reduced != 0)
+            {
+                m_NewVarMap[newVar] = reduced;
+                ++m_ReducedCount;
+                return true;
+            }
+        }
+
+        m_NewVarMap[newVar] = m_Writer.WriteBinOpItoV(operation, type, newA, b, bSize);
+        return true;
+    }
+private:
+    [[nodiscard]] static bool IsReducibleType(const SsaCustomType type, const uSys immediateSize) noexcept
+    {
+        switch(type.Type)
+        {
+            case SsaType::I8:
+            case SsaType::I16:
+            case SsaType::I32:
+            case SsaType::I64:
+            case SsaType::U8:
+            case SsaType::U16:
+            case SsaType::U32:
+            case SsaType::U64:
+                return immediateSize == TypeValueSize(type.Type);
+            default:
+                return false;
+        }
+    }
+
+    [[nodiscard]] static bool IsSigned(const SsaType type) noexcept
+    {
+        return type == SsaType::I8 || type == SsaType::I16 || type == SsaType::I32 || type == SsaType::I64;
+    }
+
+    [[nodiscard]] static SsaCustomType ToUnsigned(const SsaCustomType type) noexcept
+    {
+        switch(type.Type)
+        {
+            case SsaType::I8:  return SsaCustomType(SsaType::U8);
+            case SsaType::I16: return SsaCustomType(SsaType::U16);
+            case SsaType::I32: return SsaCustomType(SsaType::U32);
+            case SsaType::I64: return SsaCustomType(SsaType::U64);
+            default:           return type;
+        }
+    }
+
+    /**
+     * Reads the immediate zero extended.
+     */
+    [[nodiscard]] static u64 ReadImmediate(const void* const value, const uSys size) noexcept
+    {
+        u64 result = 0;
+        (void) ::std::memcpy(&result, value, size);
+        return result;
+    }
+
+    VarId WriteImmediateOp(const SsaBinaryOperation operation, const SsaCustomType type, const VarId a, const u64 b) noexcept
+    {
+        return m_Writer.WriteBinOpItoV(operation, type, a, &b, TypeValueSize(type.Type));
+    }
+
+    VarId WriteNegate(const SsaCustomType type, const VarId a) noexcept
+    {
+        const u64 zero = 0;
+        return m_Writer.WriteBinOpVtoI(SsaBinaryOperation::Sub, type, &zero, TypeValueSize(type.Type), a);
+    }
+
+    /**
+     * @return The var holding the product, or 0 if the constant has no cheaper form.
+     */
+    VarId ReduceMultiply(const SsaCustomType type, const VarId a, const u64 constant) noexcept
+    {
+        const u32 bits = static_cast<u32>(TypeValueSize(type.Type) * 8);
+        const u64 mask = bits == 64 ? ~0ull : (1ull << bits) - 1;
+        const u64 value = constant & mask;
+        const u64 negated = (0 - value) & mask;
+
+        if(value == 0)
+        {
+            const u64 zero = 0;
+            return m_Writer.WriteAssignImmediate(type, &zero, TypeValueSize(type.Type));
+        }
+
+        if(value == 1)
+        {
+            return a;
+        }
+
+        if(internal::IsPowerOf2(value))
+        {
+            return WriteImmediateOp(SsaBinaryOperation::BitShiftLeft, type, a, internal::Log2(value));
+        }
+
+        if(internal::IsPowerOf2(negated))
+        {
+            const u32 shift = internal::Log2(negated);
+            const VarId shifted = shift == 0 ? a : WriteImmediateOp(SsaBinaryOperation::BitShiftLeft, type, a, shift);
+            return WriteNegate(type, shifted);
+        }
+
+        const u64 low = value & (0 - value);
+        const u64 high = value - low;
+
+        // 2^h + 2^l
+        if(internal::IsPowerOf2(high))
+        {
+            const VarId highPart = WriteImmediateOp(SsaBinaryOperation::BitShiftLeft, type, a, internal::Log2(high));
+            const VarId lowPart = low == 1 ? a : WriteImmediateOp(SsaBinaryOperation::BitShiftLeft, type, a, internal::Log2(low));
+            return m_Writer.WriteBinOpVtoV(SsaBinaryOperation::Add, type, highPart, lowPart);
+        }
+
+        // 2^h - 2^l, the value is a single run of ones.
+        const u64 run = value + low;
+
+        if(internal::IsPowerOf2(run) && run <= mask)
+        {
+            const VarId highPart = WriteImmediateOp(SsaBinaryOperation::BitShiftLeft, type, a, internal::Log2(run));
+            const VarId lowPart = low == 1 ? a : WriteImmediateOp(SsaBinaryOperation::BitShiftLeft, type, a, internal::Log2(low));
+            return m_Writer.WriteBinOpVtoV(SsaBinaryOperation::Sub, type, highPart, lowPart);
+        }
+
+        return 0;
+    }
+
+    /**
+     * @return The var holding the quotient or remainder, or 0 if the division has to stay.
+     */
+    VarId ReduceDivide(const SsaBinaryOperation operation, const SsaCustomType type, const VarId a, const u64 constant) noexcept
+    {
+        const u32 bits = static_cast<u32>(TypeValueSize(type.Type) * 8);
+        const u64 mask = bits == 64 ? ~0ull : (1ull << bits) - 1;
+        const u64 signBit = 1ull << (bits - 1);
+        const u64 divisor = constant & mask;
+        const bool isSigned = IsSigned(type.Type);
+        const bool isRem = operation == SsaBinaryOperation::Rem;
+
+        // Division by zero has to fault the same way, and the minimum signed value has no absolute value.
+        if(divisor == 0 || (isSigned && divisor == signBit))
+        {
+            return 0;
+        }
+
+        const bool isNegative = isSigned && (divisor & signBit) != 0;
+        const u64 absDivisor = isNegative ? (0 - divisor) & mask : divisor;
+
+        if(absDivisor == 1)
+        {
+            if(isRem)
+            {
+                const u64 zero = 0;
+                return m_Writer.WriteAssignImmediate(type, &zero, TypeValueSize(type.Type));
+            }
+
+            return isNegative ? WriteNegate(type, a) : a;
+        }
+
+        if(internal::IsPowerOf2(absDivisor))
+        {
+            const u32 shift = internal::Log2(absDivisor);
+
+            if(!isSigned)
+            {
+                if(isRem)
+                {
+                    // Shift the quotient bits out the top and back.
+                    const VarId low = WriteImmediateOp(SsaBinaryOperation::BitShiftLeft, type, a, bits - shift);
+                    return WriteImmediateOp(SsaBinaryOperation::BitShiftRight, type, low, bits - shift);
+                }
+
+                return WriteImmediateOp(SsaBinaryOperation::BitShiftRight, type, a, shift);
+            }
+
+            // Negative dividends get 2^shift - 1 added, so the arithmetic shift rounds towards zero.
+            const VarId sign = shift == 1 ? a : WriteImmediateOp(SsaBinaryOperation::BitShiftRight, type, a, bits - 1);
+            const VarId bias = WriteImmediateOp(SsaBinaryOperation::BitShiftRight, ToUnsigned(type), sign, bits - shift);
+            const VarId biased = m_Writer.WriteBinOpVtoV(SsaBinaryOperation::Add, type, a, bias);
+            const VarId quotient = WriteImmediateOp(SsaBinaryOperation::BitShiftRight, type, biased, shift);
+
+            if(isRem)
+            {
+                // The sign of the remainder follows the dividend, the sign of the divisor doesn't matter.
+                const VarId product = WriteImmediateOp(SsaBinaryOperation::BitShiftLeft, type, quotient, shift);
+                return m_Writer.WriteBinOpVtoV(SsaBinaryOperation::Sub, type, a, product);
+            }
+
+            return isNegative ? WriteNegate(type, quotient) : quotient;
+        }
+
+        if(bits < 32)
+        {
+            return 0;
+        }
+
+        const VarId quotient = isSigned ? WriteSignedMagicDivide(type, a, divisor, bits) : WriteUnsignedMagicDivide(type, a, divisor, bits);
+
+        if(!isRem)
+        {
+            return quotient;
+        }
+
+        VarId product = ReduceMultiply(type, quotient, divisor);
+
+        if(product == 0)
+        {
+            product = WriteImmediateOp(SsaBinaryOperation::Mul, type, quotient, divisor);
+        }
+
+        return m_Writer.WriteBinOpVtoV(SsaBinaryOperation::Sub, type, a, product);
+    }
+
+    VarId WriteSignedMagicDivide(const SsaCustomType type, const VarId a, const u64 divisor, const u32 bits) noexcept
+    {
+        const internal::DivisionMagic<u64> magic = bits == 64 ? internal::ComputeSignedMagic<u64>(divisor) : Widen(internal::ComputeSignedMagic<u32>(static_cast<u32>(divisor)));
+        const u64 signBit = 1ull << (bits - 1);
+        const bool isDivisorNegative = (divisor & signBit) != 0;
+        const bool isMagicNegative = (magic.Multiplier & signBit) != 0;
+
+        VarId quotient = WriteImmediateOp(SsaBinaryOperation::MulHigh, type, a, magic.Multiplier);
+
+        // The multiplier wrapped around, correct for the sign it ended up with.
+        if(!isDivisorNegative && isMagicNegative)
+        {
+            quotient = m_Writer.WriteBinOpVtoV(SsaBinaryOperation::Add, type, quotient, a);
+        }
+        else if(isDivisorNegative && !isMagicNegative)
+        {
+            quotient = m_Writer.WriteBinOpVtoV(SsaBinaryOperation::Sub, type, quotient, a);
+        }
+
+        if(magic.Shift != 0)
+        {
+            quotient = WriteImmediateOp(SsaBinaryOperation::BitShiftRight, type, quotient, magic.Shift);
+        }
+
+        // Add one to negative quotients, rounding towards zero.
+        const VarId sign = WriteImmediateOp(SsaBinaryOperation::BitShiftRight, ToUnsigned(type), quotient, bits - 1);
+        return m_Writer.WriteBinOpVtoV(SsaBinaryOperation::Add, type, quotient, sign);
+    }
+
+    VarId WriteUnsignedMagicDivide(const SsaCustomType type, const VarId a, const u64 divisor, const u32 bits) noexcept
+    {
+        const internal::DivisionMagic<u64> magic = bits == 64 ? internal::ComputeUnsignedMagic<u64>(divisor) : Widen(internal::ComputeUnsignedMagic<u32>(static_cast<u32>(divisor)));
+
+        const VarId high = WriteImmediateOp(SsaBinaryOperation::MulHigh, type, a, magic.Multiplier);
+
+        if(!magic.Add)
+        {
+            return magic.Shift == 0 ? high : WriteImmediateOp(SsaBinaryOperation::BitShiftRight, type, high, magic.Shift);
+        }
+
+        // The multiplier is 2^bits too small, add the dividend back without overflowing.
+        const VarId difference = m_Writer.WriteBinOpVtoV(SsaBinaryOperation::Sub, type, a, high);
+        const VarId halfDifference = WriteImmediateOp(SsaBinaryOperation::BitShiftRight, type, difference, 1);
+        const VarId sum = m_Writer.WriteBinOpVtoV(SsaBinaryOperation::Add, type, halfDifference, high);
+
+        return magic.Shift == 1 ? sum : WriteImmediateOp(SsaBinaryOperation::BitShiftRight, type, sum, magic.Shift - 1);
+    }
+
+    [[nodiscard]] static internal::DivisionMagic<u64> Widen(const internal::DivisionMagic<u32>& magic) noexcept
+    {
+        return { magic.Multiplier, magic.Shift, magic.Add };
+    }
+private:
+    u32 m_ReducedCount;
+};
+
+}
@@ -1,6 +1,9 @@
 #include "TauIR/Emulator.hpp"
+#include "TauIR/ExecutionProfile.hpp"
+#include "TauIR/TraceBuffer.hpp"
 
 #include "TauIR/Function.hpp"
+#include "TauIR/IntMath.hpp"
 #include "TauIR/Module.hpp"
 #include "TauIR/Opcodes.hpp"
 #include "TauIR/TypeInfo.hpp"
@@ -48,15 +51,46 @@ void Emulator::Executor(const Function* function, const Module* module) noexcept
     module = PopValueLocal<const Module*>();      \
     localsHead = PopValueLocal<uSys>();           \
     m_LocalsStackPointer = PopValueLocal<uSys>()
+#define PROFILE_ENTER() \
+    if(m_Profile) { profile = &m_Profile->GetFunction(function); }
+#define PROFILE_CALL(TARGET) \
+    if(profile) { profile->RecordCall(static_cast<uSys>(instructionPtr - function->Address()), TARGET); }
+#define TRACE(TYPE, FUNCTION) \
+    if(m_Trace) { m_Trace->Record(TraceEventType::TYPE, FUNCTION, static_cast<uSys>(instructionPtr - function->Address()), callDepth); }
+#define TRACE_ENTER(TARGET) \
+    if(m_Trace) { m_Trace->Record(TraceEventType::FunctionEnter, TARGET, static_cast<uSys>(instructionPtr - function->Address()), callDepth + 1); }
+#define TRACE_BRANCH() \
+    if(m_Trace) { m_Trace->Record(TraceEventType::BranchTaken, function, static_cast<uSys>(instructionPtr - function->Address()), callDepth, 0); }
+#define CHECK_LOCALS_OVERFLOW(TARGET) \
+    if(m_LocalsStackPointer + CallFrameSize + (TARGET)->LocalSize() > m_LocalsStack.Count()) { \
+        TRACE(StackOverflow, function); \
+        ConPrinter::PrintLn("Locals stack overflow at call depth {}.", callDepth); \
+        return; \
+    }
 
     const u8* codePtr = function->Address();
+    FunctionProfile* profile = nullptr;
+
+    PROFILE_ENTER();
 
     uSys callDepth = 0;
     uSys localsHead = m_LocalsStackPointer;
     m_LocalsStackPointer += function->LocalSize();
+
+    if(m_Trace)
+    {
+        m_Trace->Record(TraceEventType::FunctionEnter, function, 0, callDepth);
+    }
     
     while(true)
     {
+        const u8* const instructionPtr = codePtr;
+
+        if(profile)
+        {
+            profile->RecordInstruction(static_cast<uSys>(instructionPtr - function->Address()));
+        }
+
         u16 opcodeRaw = *codePtr;
         ++codePtr;
 
@@ -374,7 +408,8 @@ void Emulator::Executor(const Function* function, const Module* module) noexcept
                 const i32 a = PopValue<i32>();
                 const i32 b = PopValue<i32>();
                 
-                const i32 result = a + b;
+                // Computed unsigned so overflow wraps instead of being undefined.
+                const i32 result = static_cast<i32>(static_cast<u32>(a) + static_cast<u32>(b));
                 PushValue<i32>(result);
                 break;
             }
@@ -383,7 +418,7 @@ void Emulator::Executor(const Function* function, const Module* module) noexcept
                 const i64 a = PopValue<i64>();
                 const i64 b = PopValue<i64>();
 
-                const i64 result = a + b;
+                const i64 result = static_cast<i64>(static_cast<u64>(a) + static_cast<u64>(b));
                 PushValue<i64>(result);
                 break;
             }
@@ -392,7 +427,7 @@ void Emulator::Executor(const Function* function, const Module* module) noexcept
                 const i32 a = PopValue<i32>();
                 const i32 b = PopValue<i32>();
 
-                const i32 result = a - b;
+                const i32 result = static_cast<i32>(static_cast<u32>(a) - static_cast<u32>(b));
                 PushValue<i32>(result);
                 break;
             }
@@ -401,7 +436,7 @@ void Emulator::Executor(const Function* function, const Module* module) noexcept
                 const i64 a = PopValue<i64>();
                 const i64 b = PopValue<i64>();
 
-                const i64 result = a - b;
+                const i64 result = static_cast<i64>(static_cast<u64>(a) - static_cast<u64>(b));
                 PushValue<i64>(result);
                 break;
             }
@@ -410,7 +445,7 @@ void Emulator::Executor(const Function* function, const Module* module) noexcept
                 const i32 a = PopValue<i32>();
                 const i32 b = PopValue<i32>();
 
-                const i32 result = a * b;
+                const i32 result = static_cast<i32>(static_cast<u32>(a) * static_cast<u32>(b));
                 PushValue<i32>(result);
                 break;
             }
@@ -419,7 +454,7 @@ void Emulator::Executor(const Function* function, const Module* module) noexcept
                 const i64 a = PopValue<i64>();
                 const i64 b = PopValue<i64>();
 
-                const i64 result = a * b;
+                const i64 result = static_cast<i64>(static_cast<u64>(a) * static_cast<u64>(b));
                 PushValue<i64>(result);
                 break;
             }
@@ -445,6 +480,97 @@ void Emulator::Executor(const Function* function, const Module* module) noexcept
                 PushValue<i64>(remainder);
                 break;
             }
+            case Opcode::MulHighI32:
+            {
+                const i32 a = PopValue<i32>();
+                const i32 b = PopValue<i32>();
+
+                const i32 result = MulHigh(a, b);
+                PushValue<i32>(result);
+                break;
+            }
+            case Opcode::MulHighI64:
+            {
+                const i64 a = PopValue<i64>();
+                const i64 b = PopValue<i64>();
+
+                const i64 result = MulHigh(a, b);
+                PushValue<i64>(result);
+                break;
+            }
+            case Opcode::MulHighU32:
+            {
+                const u32 a = PopValue<u32>();
+                const u32 b = PopValue<u32>();
+
+                const u32 result = MulHigh(a, b);
+                PushValue<u32>(result);
+                break;
+            }
+            case Opcode::MulHighU64:
+            {
+                const u64 a = PopValue<u64>();
+                const u64 b = PopValue<u64>();
+
+                const u64 result = MulHigh(a, b);
+                PushValue<u64>(result);
+                break;
+            }
+            // Shift counts are masked to the width of the operand.
+            case Opcode::ShlI32:
+            {
+                const u32 a = PopValue<u32>();
+                const u32 b = PopValue<u32>();
+
+                const u32 result = a << (b & 31);
+                PushValue<u32>(result);
+                break;
+            }
+            case Opcode::ShlI64:
+            {
+                const u64 a = PopValue<u64>();
+                const u64 b = PopValue<u64>();
+
+                const u64 result = a << (b & 63);
+                PushValue<u64>(result);
+                break;
+            }
+            case Opcode::ShrI32:
+            {
+                const u32 a = PopValue<u32>();
+                const u32 b = PopValue<u32>();
+
+                const u32 result = a >> (b & 31);
+                PushValue<u32>(result);
+                break;
+            }
+            case Opcode::ShrI64:
+            {
+                const u64 a = PopValue<u64>();
+                const u64 b = PopValue<u64>();
+
+                const u64 result = a >> (b & 63);
+                PushValue<u64>(result);
+                break;
+            }
+            case Opcode::SarI32:
+            {
+                const i32 a = PopValue<i32>();
+                const i32 b = PopValue<i32>();
+
+                const i32 result = a >> (b & 31);
+                PushValue<i32>(result);
+                break;
+            }
+            case Opcode::SarI64:
+            {
+                const i64 a = PopValue<i64>();
+                const i64 b = PopValue<i64>();
+
+                const i64 result = a >> (b & 63);
+                PushValue<i64>(result);
+                break;
+            }
             case Opcode::CompI32Above:
             case Opcode::CompI32AboveOrEqual:
             case Opcode::CompI32Below:
@@ -561,14 +687,19 @@ void Emulator::Executor(const Function* function, const Module* module) noexcept
             {
                 const u32 functionIndex = ReadCodeValue<u32>(codePtr);
                 
-                CALL_PUSH();
-
                 const Function* nextFunction = module->Functions()[functionIndex];
 
+                PROFILE_CALL(nextFunction);
+                CHECK_LOCALS_OVERFLOW(nextFunction);
+                TRACE_ENTER(nextFunction);
+                CALL_PUSH();
+
+                function = nextFunction;
                 codePtr = nextFunction->Address();
                 localsHead = m_LocalsStackPointer;
                 m_LocalsStackPointer += nextFunction->LocalSize();
                 ++callDepth;
+                PROFILE_ENTER();
                 break;
             }
             case Opcode::CallExt:
@@ -578,20 +709,29 @@ void Emulator::Executor(const Function* function, const Module* module) noexcept
 
                 const Module* const targetModule = module->Imports()[moduleIndex].Module().Get();
 
+                const Function* nextFunction = targetModule->Functions()[functionIndex];
+
+                PROFILE_CALL(nextFunction);
+
                 if(targetModule->IsNative())
                 {
-                    ::tau::ir::CallNativeFunctionPointer(targetModule->Functions()[functionIndex], m_Arguments, m_ExecutionStack, m_ExecutionStackPointer);
+                    TRACE(NativeCallBegin, nextFunction);
+                    ::tau::ir::CallNativeFunctionPointer(nextFunction, m_Arguments, m_ExecutionStack, m_ExecutionStackPointer);
+                    TRACE(NativeCallEnd, nextFunction);
                 }
                 else
                 {
+                    CHECK_LOCALS_OVERFLOW(nextFunction);
+                    TRACE_ENTER(nextFunction);
                     CALL_PUSH();
 
-                    const Function* nextFunction = targetModule->Functions()[functionIndex];
-
+                    function = nextFunction;
+                    module = targetModule;
                     codePtr = nextFunction->Address();
                     localsHead = m_LocalsStackPointer;
                     m_LocalsStackPointer += nextFunction->LocalSize();
                     ++callDepth;
+                    PROFILE_ENTER();
                 }
                 break;
             }
@@ -600,14 +740,19 @@ void Emulator::Executor(const Function* function, const Module* module) noexcept
                 const u16 localIndex = ReadCodeValue<u16>(codePtr);
                 const u32 functionIndex = GetLocal<u32>(function, localsHead, localIndex);
 
-                CALL_PUSH();
-
                 const Function* nextFunction = module->Functions()[functionIndex];
 
+                PROFILE_CALL(nextFunction);
+                CHECK_LOCALS_OVERFLOW(nextFunction);
+                TRACE_ENTER(nextFunction);
+                CALL_PUSH();
+
+                function = nextFunction;
                 codePtr = nextFunction->Address();
                 localsHead = m_LocalsStackPointer;
                 m_LocalsStackPointer += nextFunction->LocalSize();
                 ++callDepth;
+                PROFILE_ENTER();
                 break;
             }
             case Opcode::CallIndExt:
@@ -619,31 +764,47 @@ void Emulator::Executor(const Function* function, const Module* module) noexcept
 
                 const Module* const targetModule = module->Imports()[moduleIndex].Module().Get();
 
+                const Function* nextFunction = targetModule->Functions()[functionIndex];
+
+                PROFILE_CALL(nextFunction);
+
                 if(targetModule->IsNative())
                 {
-                    ::tau::ir::CallNativeFunctionPointer(targetModule->Functions()[functionIndex], m_Arguments, m_ExecutionStack, m_ExecutionStackPointer);
+                    TRACE(NativeCallBegin, nextFunction);
+                    ::tau::ir::CallNativeFunctionPointer(nextFunction, m_Arguments, m_ExecutionStack, m_ExecutionStackPointer);
+                    TRACE(NativeCallEnd, nextFunction);
                 }
                 else
                 {
+                    CHECK_LOCALS_OVERFLOW(nextFunction);
+                    TRACE_ENTER(nextFunction);
                     CALL_PUSH();
 
-                    const Function* nextFunction = targetModule->Functions()[functionIndex];
-
+                    function = nextFunction;
+                    module = targetModule;
                     codePtr = nextFunction->Address();
                     localsHead = m_LocalsStackPointer;
                     m_LocalsStackPointer += nextFunction->LocalSize();
                     ++callDepth;
+                    PROFILE_ENTER();
                 }
                 break;
             }
             case Opcode::Ret:
             {
+                TRACE(FunctionExit, function);
+
                 if(callDepth == 0)
                 {
+                    // Release the entry point's locals so the emulator can be executed again.
+                    m_LocalsStackPointer = localsHead;
                     return;
                 }
                 --callDepth;
+                // The caller's frame sits below the callee's locals.
+                m_LocalsStackPointer = localsHead;
                 RET_POP();
+                PROFILE_ENTER();
 
                 break;
             }
@@ -651,6 +812,7 @@ void Emulator::Executor(const Function* function, const Module* module) noexcept
             {
                 const i32 jumpOffset = ReadCodeValue<i32>(codePtr);
                 codePtr += jumpOffset;
+                TRACE_BRANCH();
 
                 break;
             }
@@ -662,6 +824,7 @@ void Emulator::Executor(const Function* function, const Module* module) noexcept
                 if(condition != 0)
                 {
                     codePtr += jumpOffset;
+                    TRACE_BRANCH();
                 }
 
                 break;
@@ -674,6 +837,7 @@ void Emulator::Executor(const Function* function, const Module* module) noexcept
                 if(condition == 0)
                 {
                     codePtr += jumpOffset;
+                    TRACE_BRANCH();
                 }
 
                 break;
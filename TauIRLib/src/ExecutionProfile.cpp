@@ -0,0 +1,77 @@
+#include "TauIR/ExecutionProfile.hpp"
+#include "TauIR/Function.hpp"
+
+namespace tau::ir {
+
+FunctionProfile::FunctionProfile(const uSys codeSize) noexcept
+    : m_InstructionHits(codeSize)
+    , m_CallSites()
+{
+    m_InstructionHits.MemSetAll(0);
+}
+
+void FunctionProfile::RecordCall(const uSys offset, const Function* const target) noexcept
+{
+    CallTargetList& targets = m_CallSites[offset];
+
+    for(CallTargetCount& callTarget : targets)
+    {
+        if(callTarget.Target == target)
+        {
+            ++callTarget.Count;
+            return;
+        }
+    }
+
+    targets.emplace_back(target, 1);
+}
+
+const FunctionProfile::CallTargetList* FunctionProfile::FindCallSite(const uSys offset) const noexcept
+{
+    const auto iter = m_CallSites.find(offset);
+
+    if(iter == m_CallSites.end())
+    {
+        return nullptr;
+    }
+
+    return &iter->second;
+}
+
+u64 FunctionProfile::TotalInstructionHits() const noexcept
+{
+    u64 total = 0;
+
+    for(uSys i = 0; i < m_InstructionHits.Count(); ++i)
+    {
+        total += m_InstructionHits[i];
+    }
+
+    return total;
+}
+
+FunctionProfile& ExecutionProfile::GetFunction(const Function* const function) noexcept
+{
+    const auto iter = m_Functions.find(function);
+
+    if(iter != m_Functions.end())
+    {
+        return iter->second;
+    }
+
+    return m_Functions.emplace(function, FunctionProfile(function->CodeSize())).first->second;
+}
+
+const FunctionProfile* ExecutionProfile::FindFunction(const Function* const function) const noexcept
+{
+    const auto iter = m_Functions.find(function);
+
+    if(iter == m_Functions.end())
+    {
+        return nullptr;
+    }
+
+    return &iter->second;
+}
+
+}
@@ -53,6 +53,12 @@ static FixedBlockAllocator<TAU_IR_ALLOCATION_TRACKING>* g_allocator = ::new(::st
  * release a deadlock.
  */
 static ::std::mutex g_allocatorMutex;
+/**
+ * \brief The number of live blocks in the global allocator.
+ *
+ *   This is guarded by the allocator mutex.
+ */
+static uSys g_allocationCount = 0;
 
 void* Function::operator new(const ::std::size_t sz) noexcept
 {
@@ -63,7 +69,14 @@ void* Function::operator new(const ::std::size_t sz) noexcept
 
     ::std::lock_guard lock(g_allocatorMutex);
 
-    return g_allocator->Allocate(sz);
+    void* const ret = g_allocator->Allocate(sz);
+
+    if(ret)
+    {
+        ++g_allocationCount;
+    }
+
+    return ret;
 }
 
 void Function::operator delete(void* const ptr) noexcept
@@ -76,6 +89,14 @@ void Function::operator delete(void* const ptr) noexcept
     ::std::lock_guard lock(g_allocatorMutex);
 
     g_allocator->deallocate(ptr);
+    --g_allocationCount;
+}
+
+FixedBlockAllocatorStats Function::AllocatorStats() noexcept
+{
+    ::std::lock_guard lock(g_allocatorMutex);
+
+    return { AlignTo<uSys, 8>(sizeof(Function)), g_allocationCount };
 }
 
     
@@ -1,6 +1,9 @@
 #include "TauIR/FunctionNameMangler.hpp"
 #include "TauIR/Function.hpp"
 #include <ToString.hpp>
+#include <mutex>
+#include <string_view>
+#include <unordered_map>
 
 namespace tau::ir {
 
@@ -71,4 +74,59 @@ DynArray<FunctionArgument> DeMangleFunctionName(const C8DynString& mangledName)
     return args;
 }
 
+FunctionSignature::FunctionSignature(const C8DynString& mangledName) noexcept
+    : m_MangledName(mangledName)
+    , m_Arguments(DeMangleFunctionName(mangledName))
+{ }
+
+FunctionSignature::~FunctionSignature() noexcept = default;
+
+namespace {
+
+struct SignatureRegistry final
+{
+    ::std::mutex Mutex;
+    // The keys view the mangled name held by the signature.
+    ::std::unordered_map<::std::basic_string_view<c8>, const FunctionSignature*> Signatures;
+};
+
+}
+
+/**
+ *   Function types can be built during static initialization, so the
+ * registry is created on first use. Like the TypeInfo allocator it is
+ * never destroyed, the signatures need to outlive every type.
+ */
+static SignatureRegistry& GetSignatureRegistry() noexcept
+{
+    static SignatureRegistry* const registry = ::new(::std::nothrow_t {}) SignatureRegistry;
+    return *registry;
+}
+
+const FunctionSignature* InternFunctionSignature(const C8DynString& mangledName) noexcept
+{
+    SignatureRegistry& registry = GetSignatureRegistry();
+
+    ::std::lock_guard lock(registry.Mutex);
+
+    const auto iter = registry.Signatures.find(::std::basic_string_view<c8>(mangledName.String(), mangledName.Length()));
+
+    if(iter != registry.Signatures.end())
+    {
+        return iter->second;
+    }
+
+    const FunctionSignature* const signature = new(::std::nothrow) FunctionSignature(mangledName);
+
+    if(!signature)
+    {
+        return nullptr;
+    }
+
+    const C8DynString& name = signature->MangledName();
+    registry.Signatures.emplace(::std::basic_string_view<c8>(name.String(), name.Length()), signature);
+
+    return signature;
+}
+
 }
@@ -0,0 +1,280 @@
+#include "TauIR/IrGenerator.hpp"
+#include "TauIR/Module.hpp"
+#include "TauIR/TypeInfo.hpp"
+#include <ToString.hpp>
+#include <iterator>
+
+namespace tau::ir {
+
+RTT_IMPL_TU(IrWriterFunctionAttachment, FunctionAttachment);
+
+struct IrGenerator::FunctionState final
+{
+    IrWriter Writer;
+    u32 FirstCallee;
+    u32 RemainingStatements;
+    u32 LoopDepth;
+};
+
+ModuleRef IrGenerator::Build() noexcept
+{
+    m_State = m_Seed;
+
+    FunctionList functions(m_FunctionCount);
+
+    for(u32 i = 0; i < m_FunctionCount; ++i)
+    {
+        functions[i] = GenerateFunction(i);
+    }
+
+    return ModuleBuilder()
+        .Functions(::std::move(functions))
+        .Exports()
+        .Imports()
+        .Emulated()
+        .Name(u8"Generated")
+        .Build();
+}
+
+Function* IrGenerator::GenerateFunction(const u32 functionIndex) noexcept
+{
+    FunctionState state {
+        IrWriter(),
+        FirstFunctionBelowLevel(CallLevel(functionIndex)),
+        m_StatementCount,
+        0
+    };
+
+    // Initialize every value local, the locals stack is not cleared between calls.
+    for(u16 i = 0; i < m_LocalCount; ++i)
+    {
+        state.Writer.WriteConstant(NextBounded(64));
+        state.Writer.WritePop(i);
+    }
+
+    GenerateBlock(state, m_StatementCount);
+
+    // Return the first local.
+    state.Writer.WritePush(0);
+    state.Writer.WriteExpandSX(4, 8);
+    state.Writer.WritePopArg(0);
+    state.Writer.WriteRet();
+
+    DynArray<const TypeInfo*> localTypes(m_LocalCount + m_LoopNesting);
+
+    for(uSys i = 0; i < localTypes.Count(); ++i)
+    {
+        localTypes[i] = &TypeInfo::I32;
+    }
+
+    const u8* const address = state.Writer.Buffer();
+    const uSys codeSize = state.Writer.Size();
+
+    C8StringBuilder name(16);
+    name.Append(u8"Gen");
+    name.Append(ToString<c8>(functionIndex));
+
+    return FunctionBuilder()
+        .Address(address)
+        .CodeSize(codeSize)
+        .LocalTypes(::std::move(localTypes))
+        .Arguments()
+        .Flags()
+        .Name(name.toString())
+        .Attachment<IrWriterFunctionAttachment>(::std::move(state.Writer))
+        .Build();
+}
+
+void IrGenerator::GenerateBlock(FunctionState& state, const u32 statementCount) noexcept
+{
+    for(u32 i = 0; i < statementCount && state.RemainingStatements > 0; ++i)
+    {
+        --state.RemainingStatements;
+        GenerateStatement(state);
+    }
+}
+
+void IrGenerator::GenerateStatement(FunctionState& state) noexcept
+{
+    if(state.RemainingStatements > 0 && NextChance(m_BranchDensity))
+    {
+        if(state.LoopDepth < m_LoopNesting && NextChance(50))
+        {
+            GenerateLoop(state);
+        }
+        else
+        {
+            GenerateIf(state);
+        }
+    }
+    else if(state.FirstCallee < m_FunctionCount && NextChance(20))
+    {
+        GenerateCall(state);
+    }
+    else
+    {
+        GenerateAssignment(state);
+    }
+}
+
+void IrGenerator::GenerateAssignment(FunctionState& state) noexcept
+{
+    GenerateExpression(state, m_ExpressionDepth);
+    state.Writer.WritePop(static_cast<u16>(NextBounded(m_LocalCount)));
+}
+
+void IrGenerator::GenerateCall(FunctionState& state) noexcept
+{
+    const u32 callee = state.FirstCallee + NextBounded(m_FunctionCount - state.FirstCallee);
+
+    state.Writer.WriteCall(callee);
+    state.Writer.WritePushArg(0);
+    state.Writer.WriteTrunc(8, 4);
+    state.Writer.WritePop(static_cast<u16>(NextBounded(m_LocalCount)));
+}
+
+void IrGenerator::GenerateIf(FunctionState& state) noexcept
+{
+    static constexpr CompareCondition Conditions[] = {
+        CompareCondition::Above,
+        CompareCondition::AboveOrEqual,
+        CompareCondition::Below,
+        CompareCondition::BelowOrEqual,
+        CompareCondition::Equal,
+        CompareCondition::Greater,
+        CompareCondition::GreaterOrEqual,
+        CompareCondition::Less,
+        CompareCondition::LessOrEqual,
+        CompareCondition::NotEqual
+    };
+
+    GenerateExpression(state, m_ExpressionDepth);
+    GenerateExpression(state, m_ExpressionDepth);
+    state.Writer.WriteCompI32(Conditions[NextBounded(static_cast<u32>(::std::size(Conditions)))]);
+
+    const uSys jumpElse = state.Writer.Size();
+    state.Writer.WriteJumpFalse(0);
+
+    GenerateBlock(state, 1 + NextBounded(4));
+
+    if(state.RemainingStatements > 0 && NextChance(50))
+    {
+        const uSys jumpEnd = state.Writer.Size();
+        state.Writer.WriteJump(0);
+
+        state.Writer.PatchJump(jumpElse, static_cast<i32>(state.Writer.Size() - (jumpElse + 5)));
+
+        GenerateBlock(state, 1 + NextBounded(4));
+
+        state.Writer.PatchJump(jumpEnd, static_cast<i32>(state.Writer.Size() - (jumpEnd + 5)));
+    }
+    else
+    {
+        state.Writer.PatchJump(jumpElse, static_cast<i32>(state.Writer.Size() - (jumpElse + 5)));
+    }
+}
+
+void IrGenerator::GenerateLoop(FunctionState& state) noexcept
+{
+    const u16 counter = static_cast<u16>(m_LocalCount + state.LoopDepth);
+
+    state.Writer.WriteConstant(m_LoopTripCount);
+    state.Writer.WritePop(counter);
+
+    const uSys loopHead = state.Writer.Size();
+
+    ++state.LoopDepth;
+    GenerateBlock(state, 1 + NextBounded(8));
+    --state.LoopDepth;
+
+    // counter = counter - 1
+    state.Writer.WriteConstant(1);
+    state.Writer.WritePush(counter);
+    state.Writer.WriteSubI32();
+    state.Writer.WriteDup(4);
+    state.Writer.WritePop(counter);
+
+    // if(counter != 0) goto loopHead
+    state.Writer.WriteConstant(0);
+    state.Writer.WriteCompI32(CompareCondition::NotEqual);
+
+    const uSys jumpHead = state.Writer.Size();
+    state.Writer.WriteJumpTrue(static_cast<i32>(static_cast<iSys>(loopHead) - static_cast<iSys>(jumpHead + 5)));
+}
+
+void IrGenerator::GenerateExpression(FunctionState& state, const u32 depth) noexcept
+{
+    if(depth == 0 || NextChance(30))
+    {
+        GenerateLeaf(state);
+        return;
+    }
+
+    GenerateExpression(state, depth - 1);
+    GenerateExpression(state, depth - 1);
+
+    switch(NextBounded(3))
+    {
+        case 0: state.Writer.WriteAddI32(); break;
+        case 1: state.Writer.WriteSubI32(); break;
+        default: state.Writer.WriteMulI32(); break;
+    }
+}
+
+void IrGenerator::GenerateLeaf(FunctionState& state) noexcept
+{
+    if(NextChance(50))
+    {
+        state.Writer.WritePush(static_cast<u16>(NextBounded(m_LocalCount)));
+    }
+    else
+    {
+        state.Writer.WriteConstant(NextBounded(256));
+    }
+}
+
+u32 IrGenerator::CallLevel(const u32 functionIndex) const noexcept
+{
+    const u32 callDepth = minT(m_CallDepth, m_FunctionCount - 1);
+    return static_cast<u32>((static_cast<u64>(functionIndex) * (callDepth + 1)) / m_FunctionCount);
+}
+
+u32 IrGenerator::FirstFunctionBelowLevel(const u32 level) const noexcept
+{
+    // Levels are monotonic in the function index.
+    for(u32 i = 0; i < m_FunctionCount; ++i)
+    {
+        if(CallLevel(i) > level)
+        {
+            return i;
+        }
+    }
+
+    return m_FunctionCount;
+}
+
+u64 IrGenerator::Next() noexcept
+{
+    // SplitMix64
+    u64 z = (m_State += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+u32 IrGenerator::NextBounded(const u32 bound) noexcept
+{
+    if(bound == 0)
+    {
+        return 0;
+    }
+
+    return static_cast<u32>(Next() % bound);
+}
+
+bool IrGenerator::NextChance(const u32 percent) noexcept
+{
+    return NextBounded(100) < percent;
+}
+
+}
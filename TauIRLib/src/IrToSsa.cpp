@@ -1,4 +1,11 @@
 #include "TauIR/IrToSsa.hpp"
+#include <algorithm>
+#include <atomic>
+#include <iterator>
+#include <thread>
+#include <vector>
+#include <TUMaths.hpp>
+
 #include "TauIR/Function.hpp"
 #include "TauIR/Opcodes.hpp"
 #include "TauIR/TypeInfo.hpp"
@@ -9,13 +16,53 @@
 
 namespace tau::ir {
 
-static ssa::SsaType GetSsaType(const TypeInfo& type) noexcept;
+// Indexed by TypeInfoPrimitive.
+static constexpr ssa::SsaType PrimitiveSsaTypes[] = {
+    ssa::SsaType::Custom,
+    ssa::SsaType::Void,
+    ssa::SsaType::Bool,
+    ssa::SsaType::I8,
+    ssa::SsaType::I16,
+    ssa::SsaType::I32,
+    ssa::SsaType::I64,
+    ssa::SsaType::U8,
+    ssa::SsaType::U16,
+    ssa::SsaType::U32,
+    ssa::SsaType::U64,
+    ssa::SsaType::F32,
+    ssa::SsaType::F64,
+    ssa::SsaType::Char
+};
+
+static_assert(::std::size(PrimitiveSsaTypes) == static_cast<uSys>(TypeInfoPrimitive::Char) + 1, "Every TypeInfoPrimitive needs an SsaType.");
+
+static ssa::SsaType GetSsaType(const TypeInfo& type) noexcept
+{
+    return PrimitiveSsaTypes[static_cast<u8>(type.Primitive())];
+}
 
 static ssa::SsaType GetSsaType(const TypeInfo* type) noexcept
 {
     return GetSsaType(*TypeInfo::StripPointer(type));
 }
 
+/**
+ *   Custom types are looked up by the TypeInfo id in the registry, types
+ * the registry doesn't know about are left without a custom type.
+ */
+static ssa::SsaCustomType GetSsaCustomType(const TypeInfo* type, const ssa::SsaCustomTypeRegistry* const registry) noexcept
+{
+    const TypeInfo& stripped = *TypeInfo::StripPointer(type);
+    const ssa::SsaType ssaType = GetSsaType(stripped);
+
+    if(ssaType != ssa::SsaType::Custom || !registry)
+    {
+        return ssaType;
+    }
+
+    return ssa::SsaCustomType(ssaType, registry->FindTypeInfo(stripped.Id()));
+}
+
 static ssa::SsaType GetSignedSizeType(const uSys size) noexcept
 {
     switch(size)
@@ -40,6 +87,259 @@ static ssa::SsaType GetUnsignedSizeType(const uSys size) noexcept
     }
 }
 
+namespace {
+
+constexpr u32 InvalidBlock = static_cast<u32>(-1);
+
+// All of the scratch state of a translation lives in the arena.
+template<typename T>
+using ArenaVector = ::std::vector<T, ssa::SsaArenaAllocator<T>>;
+
+// Jumps are a single byte opcode followed by an i32 offset from the end of the instruction.
+constexpr uSys JumpInstructionSize = 5;
+
+enum class BlockExit : u8
+{
+    FallThrough,
+    Jump,
+    JumpTrue,
+    JumpFalse,
+    Ret
+};
+
+struct IrBlock final
+{
+    uSys Begin;
+    uSys End;
+    BlockExit Exit;
+    // The jump target, only valid for jumps.
+    u32 Target;
+    // The block that follows in code order, InvalidBlock if this is the last block.
+    u32 Next;
+    // Only reachable predecessors are included, each appears once.
+    ArenaVector<u32> Predecessors;
+};
+
+struct IrBlockExitInfo final
+{
+    uSys Offset;
+    BlockExit Exit;
+    uSys Target;
+};
+
+/**
+ *   Splits a function into basic blocks. A block starts at the entry,
+ * at every jump target, and after every jump or return. This also
+ * records which locals and arguments are ever assigned, only those can
+ * change around a loop.
+ */
+// ReSharper disable CppHidingFunction
+class IrBlockFinderVisitor final : public BaseIrVisitor<IrBlockFinderVisitor>
+{
+    DEFAULT_DESTRUCT(IrBlockFinderVisitor);
+    DELETE_CM(IrBlockFinderVisitor);
+public:
+    IrBlockFinderVisitor(const Function* const function, ssa::SsaArena& arena) noexcept
+        : m_Arena(&arena)
+        , m_CodeBase(function->Address())
+        , m_CodeSize(function->CodeSize())
+        , m_Leaders(function->CodeSize() + 1, 0, &arena)
+        , m_InstructionStarts(function->CodeSize() + 1, 0, &arena)
+        , m_AssignedLocals(function->LocalTypes().count(), 0, &arena)
+        , m_AssignedArguments(MaxArgumentRegisters, 0, &arena)
+        , m_Exits(&arena)
+        , m_CurrOffset(0)
+        , m_SplitNext(true)
+    { }
+
+    [[nodiscard]] bool IsLocalAssigned(const uSys local) const noexcept { return m_AssignedLocals[local]; }
+    [[nodiscard]] bool IsArgumentAssigned(const uSys argument) const noexcept { return m_AssignedArguments[argument]; }
+
+    /**
+     *   Builds the blocks in code order. This fails if a jump lands
+     * outside of the function or in the middle of an instruction.
+     */
+    [[nodiscard]] bool BuildBlocks(ArenaVector<IrBlock>& blocks) const noexcept
+    {
+        const ArenaVector<u32> blockIndices = BuildBlockIndices();
+
+        for(uSys offset = 0; offset < m_CodeSize; ++offset)
+        {
+            if(!m_Leaders[offset])
+            {
+                continue;
+            }
+
+            if(!m_InstructionStarts[offset])
+            {
+                return false;
+            }
+
+            if(!blocks.empty())
+            {
+                blocks.back().End = offset;
+                blocks.back().Next = static_cast<u32>(blocks.size());
+            }
+
+            blocks.push_back({ offset, m_CodeSize, BlockExit::FallThrough, InvalidBlock, InvalidBlock, ArenaVector<u32>(m_Arena) });
+        }
+
+        uSys blockIndex = 0;
+
+        for(const IrBlockExitInfo& exit : m_Exits)
+        {
+            // Every exit ends a block, so the block containing it is the last one that starts at or before it.
+            while(blockIndex + 1 < blocks.size() && blocks[blockIndex + 1].Begin <= exit.Offset)
+            {
+                ++blockIndex;
+            }
+
+            IrBlock& block = blocks[blockIndex];
+            block.Exit = exit.Exit;
+
+            if(exit.Exit == BlockExit::Ret)
+            {
+                continue;
+            }
+
+            if(exit.Target >= m_CodeSize || blockIndices[exit.Target] == InvalidBlock)
+            {
+                return false;
+            }
+
+            block.Target = blockIndices[exit.Target];
+
+            // A conditional jump at the very end of the function would fall off of it.
+            if(exit.Exit != BlockExit::Jump && block.Next == InvalidBlock)
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    void PreVisit(const u8* const codePtr) noexcept
+    {
+        m_CurrOffset = static_cast<uSys>(codePtr - m_CodeBase);
+        m_InstructionStarts[m_CurrOffset] = 1;
+
+        if(m_SplitNext)
+        {
+            m_Leaders[m_CurrOffset] = 1;
+            m_SplitNext = false;
+        }
+    }
+
+    void VisitPop(const u16 localIndex) noexcept
+    {
+        if(localIndex < m_AssignedLocals.size())
+        {
+            m_AssignedLocals[localIndex] = 1;
+        }
+    }
+
+    // A load writes its local the same as a pop.
+    void VisitLoad(const u16 localIndex, const u16 addressIndex) noexcept { VisitPop(localIndex); }
+
+    void VisitPopArg(const u16 argumentIndex) noexcept
+    {
+        if(argumentIndex < m_AssignedArguments.size())
+        {
+            m_AssignedArguments[argumentIndex] = 1;
+        }
+    }
+
+    // Calls write their return value into the first argument register.
+    void VisitCall(const u32 functionIndex) noexcept { m_AssignedArguments[0] = 1; }
+    void VisitCallExt(const u32 functionIndex, const u16 moduleIndex) noexcept { m_AssignedArguments[0] = 1; }
+    void VisitCallInd(const u16 localIndex) noexcept { m_AssignedArguments[0] = 1; }
+    void VisitCallIndExt(const u16 localIndex) noexcept { m_AssignedArguments[0] = 1; }
+
+    void VisitRet() noexcept
+    {
+        m_Exits.push_back({ m_CurrOffset, BlockExit::Ret, 0 });
+        m_SplitNext = true;
+    }
+
+    void VisitJump(const i32 offset) noexcept { AddJump(BlockExit::Jump, offset); }
+    void VisitJumpTrue(const i32 offset) noexcept { AddJump(BlockExit::JumpTrue, offset); }
+    void VisitJumpFalse(const i32 offset) noexcept { AddJump(BlockExit::JumpFalse, offset); }
+private:
+    [[nodiscard]] ArenaVector<u32> BuildBlockIndices() const noexcept
+    {
+        ArenaVector<u32> blockIndices(m_CodeSize + 1, InvalidBlock, m_Arena);
+        u32 blockCount = 0;
+
+        for(uSys offset = 0; offset < m_CodeSize; ++offset)
+        {
+            if(m_Leaders[offset] && m_InstructionStarts[offset])
+            {
+                blockIndices[offset] = blockCount++;
+            }
+        }
+
+        return blockIndices;
+    }
+
+    void AddJump(const BlockExit exit, const i32 offset) noexcept
+    {
+        const iSys target = static_cast<iSys>(m_CurrOffset + JumpInstructionSize) + offset;
+
+        // Out of range targets are rejected by BuildBlocks.
+        const uSys clampedTarget = target < 0 || static_cast<uSys>(target) >= m_CodeSize ? m_CodeSize : static_cast<uSys>(target);
+
+        m_Exits.push_back({ m_CurrOffset, exit, clampedTarget });
+        m_Leaders[clampedTarget] = 1;
+        m_SplitNext = true;
+    }
+private:
+    ssa::SsaArena* m_Arena;
+    const u8* m_CodeBase;
+    uSys m_CodeSize;
+    ArenaVector<u8> m_Leaders;
+    ArenaVector<u8> m_InstructionStarts;
+    ArenaVector<u8> m_AssignedLocals;
+    ArenaVector<u8> m_AssignedArguments;
+    ArenaVector<IrBlockExitInfo> m_Exits;
+    uSys m_CurrOffset;
+    bool m_SplitNext;
+};
+
+[[nodiscard]] u32 GetSuccessors(const IrBlock& block, u32 (&successors)[2]) noexcept
+{
+    switch(block.Exit)
+    {
+        case BlockExit::FallThrough:
+            if(block.Next == InvalidBlock)
+            {
+                return 0;
+            }
+            successors[0] = block.Next;
+            return 1;
+        case BlockExit::Jump:
+            successors[0] = block.Target;
+            return 1;
+        case BlockExit::JumpTrue:
+        case BlockExit::JumpFalse:
+            successors[0] = block.Target;
+            successors[1] = block.Next;
+            return 2;
+        case BlockExit::Ret:
+        default:
+            return 0;
+    }
+}
+
+enum class SlotKind : u8
+{
+    Local,
+    Argument,
+    Frame
+};
+
+}
+
 // ReSharper disable CppHidingFunction
 class IrToSsaVisitor final : public BaseIrVisitor<IrToSsaVisitor>
 {
@@ -50,13 +350,32 @@ public:
     using SsaFrameTracker = ssa::SsaFrameTracker;
     using VarId = ssa::VarId;
 public:
-    IrToSsaVisitor(const Function* const function, const ModuleRef& module, const u16 currentModule) noexcept
+    IrToSsaVisitor(const Function* const function, const ModuleRef& module, const u16 currentModule, ssa::SsaArena& arena, const ssa::SsaCustomTypeRegistry* const registry) noexcept
         : m_Function(function)
-        , m_Writer{}
-        , m_FrameTracker(function->LocalTypes().count())
+        , m_Arena(&arena)
+        , m_Writer(arena, function->CodeSize() * 4)
+        , m_FrameTracker(function->LocalTypes().count(), &arena)
         , m_Module(module)
         , m_CurrentModule(currentModule)
-    { }
+        , m_Blocks(&arena)
+        , m_BlockLabels(&arena)
+        , m_BranchPatches(&arena)
+        , m_PendingPhis(&arena)
+        , m_CurrentBlock(0)
+        , m_LocalSsaTypes(&arena)
+        , m_LocalSizes(&arena)
+    {
+        // Resolve the local types once, every push and pop of a local is then an index.
+        const DynArray<const TypeInfo*>& localTypes = function->LocalTypes();
+        m_LocalSsaTypes.reserve(localTypes.count());
+        m_LocalSizes.reserve(localTypes.count());
+
+        for(uSys i = 0; i < localTypes.count(); ++i)
+        {
+            m_LocalSsaTypes.push_back(GetSsaCustomType(localTypes[i], registry));
+            m_LocalSizes.push_back(TypeInfo::StripPointer(localTypes[i])->Size());
+        }
+    }
 
     [[nodiscard]] const ssa::SsaWriter& Writer() const noexcept { return m_Writer; }
     [[nodiscard]]       ssa::SsaWriter& Writer()       noexcept { return m_Writer; }
@@ -64,8 +383,8 @@ public:
     void VisitPush(const u16 localIndex) noexcept
     {
         const VarId localVar = m_FrameTracker.GetLocal(localIndex);
-        const VarId newVar = m_Writer.WriteAssignVariable(GetSsaType(m_Function->LocalTypes()[localIndex]), localVar);
-        m_FrameTracker.PushFrame(newVar, TypeInfo::StripPointer(m_Function->LocalTypes()[localIndex])->Size());
+        const VarId newVar = m_Writer.WriteAssignVariable(m_LocalSsaTypes[localIndex], localVar);
+        m_FrameTracker.PushFrame(newVar, m_LocalSizes[localIndex]);
     }
 
     void VisitPushArg(const u16 argumentIndex) noexcept
@@ -78,13 +397,14 @@ public:
     void VisitPushPtr(const u16 localIndex) noexcept
     {
         const VarId localVar = m_FrameTracker.GetLocal(localIndex);
-        const VarId newVar = m_Writer.WriteLoad(GetSsaType(m_Function->LocalTypes()[localIndex]), localVar);
-        m_FrameTracker.PushFrame(newVar, TypeInfo::StripPointer(m_Function->LocalTypes()[localIndex])->Size());
+        const VarId newVar = m_Writer.WriteLoad(m_LocalSsaTypes[localIndex], localVar);
+        m_FrameTracker.PushFrame(newVar, m_LocalSizes[localIndex]);
     }
 
     void VisitPop(const u16 localIndex) noexcept
     {
-        IrToSsa::PopLocal(m_Function, m_Writer, m_FrameTracker, localIndex);
+        const VarId newVar = IrToSsa::PopRaw(m_Writer, m_FrameTracker, m_LocalSizes[localIndex], m_LocalSsaTypes[localIndex]);
+        m_FrameTracker.SetLocal(newVar, localIndex);
     }
 
     void VisitPopArg(const u16 argumentIndex) noexcept
@@ -94,12 +414,24 @@ public:
 
     void VisitPopPtr(const u16 localIndex) noexcept
     {
-        const TypeInfo& typeInfo = *TypeInfo::StripPointer(m_Function->LocalTypes()[localIndex]);
-
         const VarId dataDest = m_FrameTracker.GetLocal(localIndex);
-        const VarId newVar = IrToSsa::PopRaw(m_Writer, m_FrameTracker, typeInfo.Size(), GetSsaType(typeInfo));
+        const VarId newVar = IrToSsa::PopRaw(m_Writer, m_FrameTracker, m_LocalSizes[localIndex], m_LocalSsaTypes[localIndex]);
 
-        m_Writer.WriteStoreV(GetSsaType(typeInfo), dataDest, newVar);
+        m_Writer.WriteStoreV(m_LocalSsaTypes[localIndex], dataDest, newVar);
+    }
+
+    void VisitLoad(const u16 localIndex, const u16 addressIndex) noexcept
+    {
+        const VarId addressVar = m_FrameTracker.GetLocal(addressIndex);
+        const VarId newVar = m_Writer.WriteLoad(m_LocalSsaTypes[localIndex], addressVar);
+        m_FrameTracker.SetLocal(newVar, localIndex);
+    }
+
+    void VisitStore(const u16 localIndex, const u16 addressIndex) noexcept
+    {
+        const VarId addressVar = m_FrameTracker.GetLocal(addressIndex);
+        const VarId localVar = m_FrameTracker.GetLocal(localIndex);
+        m_Writer.WriteStoreV(m_LocalSsaTypes[localIndex], addressVar, localVar);
     }
 
     void VisitPopCount(const u16 byteCount) noexcept
@@ -155,12 +487,13 @@ public:
         m_FrameTracker.PushFrame(constantVar, 4);
     }
 
+    // The emulator takes the left operand from the top of the stack.
     void VisitBinOp(const uSys size, const ssa::SsaBinaryOperation operation, const ssa::SsaType type) noexcept
     {
-        // Pop `size` bytes from the stack into register B.
-        const VarId regB = IrToSsa::PopRaw(m_Writer, m_FrameTracker, size, type);
         // Pop `size` bytes from the stack into register A.
         const VarId regA = IrToSsa::PopRaw(m_Writer, m_FrameTracker, size, type);
+        // Pop `size` bytes from the stack into register B.
+        const VarId regB = IrToSsa::PopRaw(m_Writer, m_FrameTracker, size, type);
         // Operate B to A.
         const VarId res = m_Writer.WriteBinOpVtoV(operation, type, regA, regB);
         // Push result onto the stack.
@@ -184,16 +517,31 @@ public:
     VISIT_BASIC_BIN_OP_I32(Mul);
     VISIT_BASIC_BIN_OP_I64(Mul);
 
+    void VisitShlI32() noexcept { VisitBinOp(4, ssa::SsaBinaryOperation::BitShiftLeft, ssa::SsaType::U32); }
+    void VisitShlI64() noexcept { VisitBinOp(8, ssa::SsaBinaryOperation::BitShiftLeft, ssa::SsaType::U64); }
+    void VisitShrI32() noexcept { VisitBinOp(4, ssa::SsaBinaryOperation::BitShiftRight, ssa::SsaType::U32); }
+    void VisitShrI64() noexcept { VisitBinOp(8, ssa::SsaBinaryOperation::BitShiftRight, ssa::SsaType::U64); }
+
+    // An arithmetic shift is a right shift of a signed type.
+    void VisitSarI32() noexcept { VisitBinOp(4, ssa::SsaBinaryOperation::BitShiftRight, ssa::SsaType::I32); }
+    void VisitSarI64() noexcept { VisitBinOp(8, ssa::SsaBinaryOperation::BitShiftRight, ssa::SsaType::I64); }
+
+    void VisitMulHighI32() noexcept { VisitBinOp(4, ssa::SsaBinaryOperation::MulHigh, ssa::SsaType::I32); }
+    void VisitMulHighI64() noexcept { VisitBinOp(8, ssa::SsaBinaryOperation::MulHigh, ssa::SsaType::I64); }
+    void VisitMulHighU32() noexcept { VisitBinOp(4, ssa::SsaBinaryOperation::MulHigh, ssa::SsaType::U32); }
+    void VisitMulHighU64() noexcept { VisitBinOp(8, ssa::SsaBinaryOperation::MulHigh, ssa::SsaType::U64); }
+
+    // The emulator divides signed, rounding towards zero.
     void VisitDivI32() noexcept
     {
-        // Pop 4 bytes from the stack into register B.
-        const VarId regB = IrToSsa::PopRaw(m_Writer, m_FrameTracker, 4, ssa::SsaType::U32);
         // Pop 4 bytes from the stack into register A.
-        const VarId regA = IrToSsa::PopRaw(m_Writer, m_FrameTracker, 4, ssa::SsaType::U32);
+        const VarId regA = IrToSsa::PopRaw(m_Writer, m_FrameTracker, 4, ssa::SsaType::I32);
+        // Pop 4 bytes from the stack into register B.
+        const VarId regB = IrToSsa::PopRaw(m_Writer, m_FrameTracker, 4, ssa::SsaType::I32);
         // Divide A by B.
-        const VarId quotient = m_Writer.WriteBinOpVtoV(ssa::SsaBinaryOperation::Div, ssa::SsaType::U32, regA, regB);
+        const VarId quotient = m_Writer.WriteBinOpVtoV(ssa::SsaBinaryOperation::Div, ssa::SsaType::I32, regA, regB);
         // Modulo A by B.
-        const VarId remainder = m_Writer.WriteBinOpVtoV(ssa::SsaBinaryOperation::Rem, ssa::SsaType::U32, regA, regB);
+        const VarId remainder = m_Writer.WriteBinOpVtoV(ssa::SsaBinaryOperation::Rem, ssa::SsaType::I32, regA, regB);
         // Push the quotient onto the stack.
         m_FrameTracker.PushFrame(quotient, 4);
         // Push the remainder onto the stack.
@@ -202,14 +550,14 @@ public:
 
     void VisitDivI64() noexcept
     {
-        // Pop 8 bytes from the stack into register B.
-        const VarId regB = IrToSsa::PopRaw(m_Writer, m_FrameTracker, 8, ssa::SsaType::U64);
         // Pop 8 bytes from the stack into register A.
-        const VarId regA = IrToSsa::PopRaw(m_Writer, m_FrameTracker, 8, ssa::SsaType::U64);
+        const VarId regA = IrToSsa::PopRaw(m_Writer, m_FrameTracker, 8, ssa::SsaType::I64);
+        // Pop 8 bytes from the stack into register B.
+        const VarId regB = IrToSsa::PopRaw(m_Writer, m_FrameTracker, 8, ssa::SsaType::I64);
         // Divide A by B.
-        const VarId quotient = m_Writer.WriteBinOpVtoV(ssa::SsaBinaryOperation::Div, ssa::SsaType::U64, regA, regB);
+        const VarId quotient = m_Writer.WriteBinOpVtoV(ssa::SsaBinaryOperation::Div, ssa::SsaType::I64, regA, regB);
         // Modulo A by B.
-        const VarId remainder = m_Writer.WriteBinOpVtoV(ssa::SsaBinaryOperation::Rem, ssa::SsaType::U64, regA, regB);
+        const VarId remainder = m_Writer.WriteBinOpVtoV(ssa::SsaBinaryOperation::Rem, ssa::SsaType::I64, regA, regB);
         // Push the quotient onto the stack.
         m_FrameTracker.PushFrame(quotient, 8);
         // Push the remainder onto the stack.
@@ -218,14 +566,14 @@ public:
 
     void VisitComp(const uSys size, const CompareCondition condition, const ssa::SsaType type) noexcept
     {
-        // Pop `size` bytes from the stack into register B.
-        const VarId regB = IrToSsa::PopRaw(m_Writer, m_FrameTracker, size, type);
         // Pop `size` bytes from the stack into register A.
         const VarId regA = IrToSsa::PopRaw(m_Writer, m_FrameTracker, size, type);
+        // Pop `size` bytes from the stack into register B.
+        const VarId regB = IrToSsa::PopRaw(m_Writer, m_FrameTracker, size, type);
         // Operate B to A.
         const VarId res = m_Writer.WriteCompVtoV(condition, type, regA, regB);
-        // Push result onto the stack.
-        m_FrameTracker.PushFrame(res, size);
+        // Push the 1 byte result onto the stack.
+        m_FrameTracker.PushFrame(res, 1);
     }
 
     void VisitCompI32(const CompareCondition condition) noexcept
@@ -283,12 +631,12 @@ public:
     {
         const TypeInfo* const functionType = m_Function->LocalTypes()[localIndex];
 
-        if(functionType->Size() != 4)
+        if(functionType->Size() != 4 || !functionType->Signature())
         {
             return 0;
         }
         
-        return HandleFunctionArgs(DeMangleFunctionName(functionType->Name()));
+        return HandleFunctionArgs(functionType->Signature()->Arguments());
     }
 
     void VisitCallInd(const u16 localIndex) noexcept
@@ -313,23 +661,569 @@ public:
         const VarId argVar = m_FrameTracker.GetArgument(0);
         m_Writer.WriteRet(ssa::SsaType::U64, argVar);
     }
+
+    void VisitJump(const i32 offset) noexcept
+    {
+        WriteBranch(m_Blocks[m_CurrentBlock].Target);
+    }
+
+    void VisitJumpTrue(const i32 offset) noexcept
+    {
+        WriteBranchCond(m_Blocks[m_CurrentBlock].Target, m_Blocks[m_CurrentBlock].Next);
+    }
+
+    void VisitJumpFalse(const i32 offset) noexcept
+    {
+        WriteBranchCond(m_Blocks[m_CurrentBlock].Next, m_Blocks[m_CurrentBlock].Target);
+    }
+public:
+    /**
+     *   Translates the function one basic block at a time in reverse
+     * postorder. Locals, arguments and stack frames that differ between
+     * predecessors are merged with phis. Loop headers get a phi for every
+     * slot that can change, these are filled in once the loop body has
+     * been translated.
+     *
+     *   Straight line code has no labels, branches or phis, so its output
+     * is the same as a plain traversal.
+     *
+     * @return False if a jump doesn't land on an instruction, or the
+     *   stack frames don't line up where paths merge.
+     */
+    [[nodiscard]] bool Build() noexcept;
+private:
+    struct BlockState final
+    {
+        ArenaVector<VarId> Locals;
+        ArenaVector<VarId> Arguments;
+        SsaFrameTracker::FrameStack Frames;
+    };
+
+    struct PendingPhi final
+    {
+        u32 Block;
+        SlotKind Kind;
+        u32 Index;
+        VarId Phi;
+        uSys LabelsOffset;
+        // Only used for frames, every predecessor must leave the same stack shape.
+        uSys FrameCount;
+        uSys FrameSize;
+    };
+
+    struct BranchPatch final
+    {
+        uSys Offset;
+        u32 Block;
+    };
+
+    void SaveState(BlockState& state) const noexcept
+    {
+        const uSys localCount = m_Function->LocalTypes().count();
+
+        state.Locals.resize(localCount);
+        state.Arguments.resize(MaxArgumentRegisters);
+
+        for(uSys i = 0; i < localCount; ++i)
+        {
+            state.Locals[i] = m_FrameTracker.GetLocal(i);
+        }
+
+        for(uSys i = 0; i < MaxArgumentRegisters; ++i)
+        {
+            state.Arguments[i] = m_FrameTracker.GetArgument(i);
+        }
+
+        state.Frames = m_FrameTracker.GetFrames();
+    }
+
+    void LoadState(const BlockState& state) noexcept
+    {
+        for(uSys i = 0; i < state.Locals.size(); ++i)
+        {
+            m_FrameTracker.SetLocal(state.Locals[i], i);
+        }
+
+        for(uSys i = 0; i < state.Arguments.size(); ++i)
+        {
+            m_FrameTracker.SetArgument(state.Arguments[i], i);
+        }
+
+        m_FrameTracker.SetFrames(state.Frames);
+    }
+
+    void WriteBranch(const u32 block) noexcept
+    {
+        // Labels are written as blocks are reached, so they're all patched in at the end.
+        m_Writer.WriteBranch(0);
+        m_BranchPatches.push_back({ m_Writer.Size() - sizeof(VarId), block });
+    }
+
+    void WriteBranchCond(const u32 trueBlock, const u32 falseBlock) noexcept
+    {
+        const VarId condition = IrToSsa::PopRaw(m_Writer, m_FrameTracker, 1, ssa::SsaType::U8);
+        m_Writer.WriteBranchCond(0, 0, condition);
+        m_BranchPatches.push_back({ m_Writer.Size() - 3 * sizeof(VarId), trueBlock });
+        m_BranchPatches.push_back({ m_Writer.Size() - 2 * sizeof(VarId), falseBlock });
+    }
+
+    /**
+     *   Merges a single slot from every predecessor. Var 0 is an
+     * undefined local, it doesn't need to agree with anything.
+     */
+    [[nodiscard]] VarId MergeIncoming(const ssa::SsaCustomType type, const ArenaVector<u32>& predecessors, ArenaVector<VarId>& incoming) noexcept
+    {
+        VarId defined = 0;
+        bool differs = false;
+
+        for(const VarId var : incoming)
+        {
+            if(var == 0)
+            {
+                continue;
+            }
+
+            if(defined == 0)
+            {
+                defined = var;
+            }
+            else if(var != defined)
+            {
+                differs = true;
+            }
+        }
+
+        if(!differs)
+        {
+            return defined;
+        }
+
+        ArenaVector<VarId> labels(predecessors.size(), m_Arena);
+
+        for(uSys i = 0; i < predecessors.size(); ++i)
+        {
+            labels[i] = m_BlockLabels[predecessors[i]];
+
+            if(incoming[i] == 0)
+            {
+                incoming[i] = defined;
+            }
+        }
+
+        return m_Writer.WritePhi(type, static_cast<u32>(predecessors.size()), labels.data(), incoming.data());
+    }
+
+    [[nodiscard]] bool MergeStates(const ArenaVector<u32>& predecessors, const ArenaVector<BlockState>& states) noexcept
+    {
+        const BlockState& first = states[predecessors[0]];
+
+        for(const u32 predecessor : predecessors)
+        {
+            const BlockState& state = states[predecessor];
+
+            if(state.Frames.size() != first.Frames.size())
+            {
+                return false;
+            }
+
+            for(uSys i = 0; i < first.Frames.size(); ++i)
+            {
+                if(state.Frames[i].Size != first.Frames[i].Size)
+                {
+                    return false;
+                }
+            }
+        }
+
+        ArenaVector<VarId> incoming(predecessors.size(), m_Arena);
+
+        for(uSys local = 0; local < first.Locals.size(); ++local)
+        {
+            for(uSys i = 0; i < predecessors.size(); ++i)
+            {
+                incoming[i] = states[predecessors[i]].Locals[local];
+            }
+
+            m_FrameTracker.SetLocal(MergeIncoming(m_LocalSsaTypes[local], predecessors, incoming), local);
+        }
+
+        for(uSys argument = 0; argument < first.Arguments.size(); ++argument)
+        {
+            for(uSys i = 0; i < predecessors.size(); ++i)
+            {
+                incoming[i] = states[predecessors[i]].Arguments[argument];
+            }
+
+            m_FrameTracker.SetArgument(MergeIncoming(ssa::SsaType::U64, predecessors, incoming), argument);
+        }
+
+        SsaFrameTracker::FrameStack frames(m_Arena);
+
+        for(uSys frame = 0; frame < first.Frames.size(); ++frame)
+        {
+            for(uSys i = 0; i < predecessors.size(); ++i)
+            {
+                incoming[i] = states[predecessors[i]].Frames[frame].Var;
+            }
+
+            const VarId var = MergeIncoming(m_Writer.GetVarType(first.Frames[frame].Var), predecessors, incoming);
+            frames.emplace_back(var, first.Frames[frame].Size);
+        }
+
+        m_FrameTracker.SetFrames(frames);
+
+        return true;
+    }
+
+    VarId WritePendingPhi(const u32 block, const SlotKind kind, const u32 index, const ssa::SsaCustomType type, const uSys frameCount, const uSys frameSize) noexcept
+    {
+        const uSys predecessorCount = m_Blocks[block].Predecessors.size();
+        const ArenaVector<VarId> placeholders(predecessorCount, 0, m_Arena);
+
+        const VarId phi = m_Writer.WritePhi(type, static_cast<u32>(predecessorCount), placeholders.data(), placeholders.data());
+        m_PendingPhis.push_back({ block, kind, index, phi, m_Writer.Size() - 2 * predecessorCount * sizeof(VarId), frameCount, frameSize });
+        return phi;
+    }
+
+    [[nodiscard]] bool FillPendingPhis(const ArenaVector<BlockState>& states) noexcept
+    {
+        for(const PendingPhi& phi : m_PendingPhis)
+        {
+            const ArenaVector<u32>& predecessors = m_Blocks[phi.Block].Predecessors;
+
+            for(uSys i = 0; i < predecessors.size(); ++i)
+            {
+                const BlockState& state = states[predecessors[i]];
+                VarId var;
+
+                switch(phi.Kind)
+                {
+                    case SlotKind::Local:
+                        var = state.Locals[phi.Index];
+                        break;
+                    case SlotKind::Argument:
+                        var = state.Arguments[phi.Index];
+                        break;
+                    case SlotKind::Frame:
+                    default:
+                        if(state.Frames.size() != phi.FrameCount || state.Frames[phi.Index].Size != phi.FrameSize)
+                        {
+                            return false;
+                        }
+                        var = state.Frames[phi.Index].Var;
+                        break;
+                }
+
+                // A local that is undefined on this path just carries the phi around.
+                if(var == 0)
+                {
+                    var = phi.Phi;
+                }
+
+                m_Writer.PatchVarId(phi.LabelsOffset + i * sizeof(VarId), m_BlockLabels[predecessors[i]]);
+                m_Writer.PatchVarId(phi.LabelsOffset + (predecessors.size() + i) * sizeof(VarId), var);
+            }
+        }
+
+        return true;
+    }
 private:
     const Function* m_Function;
+    ssa::SsaArena* m_Arena;
     SsaWriter m_Writer;
     SsaFrameTracker m_FrameTracker;
-    ModuleRef m_Module;
+    // Held by reference, the ref count isn't touched when transforming on several threads.
+    const ModuleRef& m_Module;
     u16 m_CurrentModule;
+    ArenaVector<IrBlock> m_Blocks;
+    // Indexed by block, the extra entry at the end is the label of the entry preamble.
+    ArenaVector<VarId> m_BlockLabels;
+    ArenaVector<BranchPatch> m_BranchPatches;
+    ArenaVector<PendingPhi> m_PendingPhis;
+    u32 m_CurrentBlock;
+    ArenaVector<ssa::SsaCustomType> m_LocalSsaTypes;
+    ArenaVector<uSys> m_LocalSizes;
 };
 
-void IrToSsa::TransformFunction(Function* const function, const ModuleRef& module, const u16 currentModule) noexcept
+bool IrToSsaVisitor::Build() noexcept
+{
+    const u8* const code = m_Function->Address();
+
+    IrBlockFinderVisitor blockFinder(m_Function, *m_Arena);
+    blockFinder.Traverse(code, code + m_Function->CodeSize());
+
+    if(!blockFinder.BuildBlocks(m_Blocks))
+    {
+        return false;
+    }
+
+    if(m_Blocks.empty())
+    {
+        return true;
+    }
+
+    const u32 blockCount = static_cast<u32>(m_Blocks.size());
+    // The pseudo block that holds the state on entry to the function.
+    const u32 entryBlock = blockCount;
+
+    ArenaVector<u32> order(m_Arena);
+    ArenaVector<u32> orderIndices(blockCount, InvalidBlock, m_Arena);
+
+    {
+        ArenaVector<u8> visited(blockCount, 0, m_Arena);
+        // Pairs of a block and the index of the next successor to visit.
+        ArenaVector<::std::pair<u32, u32>> stack(m_Arena);
+
+        visited[0] = 1;
+        stack.emplace_back(0, 0);
+
+        while(!stack.empty())
+        {
+            const u32 block = stack.back().first;
+            u32 successors[2];
+            const u32 successorCount = GetSuccessors(m_Blocks[block], successors);
+
+            if(stack.back().second < successorCount)
+            {
+                const u32 successor = successors[stack.back().second++];
+
+                if(!visited[successor])
+                {
+                    visited[successor] = 1;
+                    stack.emplace_back(successor, 0);
+                }
+            }
+            else
+            {
+                order.push_back(block);
+                stack.pop_back();
+            }
+        }
+
+        ::std::reverse(order.begin(), order.end());
+    }
+
+    for(uSys i = 0; i < order.size(); ++i)
+    {
+        orderIndices[order[i]] = static_cast<u32>(i);
+    }
+
+    for(const u32 block : order)
+    {
+        u32 successors[2];
+        const u32 successorCount = GetSuccessors(m_Blocks[block], successors);
+
+        for(u32 i = 0; i < successorCount; ++i)
+        {
+            ArenaVector<u32>& predecessors = m_Blocks[successors[i]].Predecessors;
+
+            if(::std::find(predecessors.begin(), predecessors.end(), block) == predecessors.end())
+            {
+                predecessors.push_back(block);
+            }
+        }
+    }
+
+    const bool useLabels = order.size() > 1 || !m_Blocks[0].Predecessors.empty();
+
+    const BlockState emptyState { ArenaVector<VarId>(m_Arena), ArenaVector<VarId>(m_Arena), SsaFrameTracker::FrameStack(m_Arena) };
+    ArenaVector<BlockState> states(blockCount + 1, emptyState, m_Arena);
+    m_BlockLabels.assign(blockCount + 1, 0);
+
+    SaveState(states[entryBlock]);
+
+    // The entry block is a loop header, its phis need a label to refer to the state on entry.
+    if(!m_Blocks[0].Predecessors.empty())
+    {
+        m_BlockLabels[entryBlock] = m_Writer.WriteLabel();
+        WriteBranch(0);
+        m_Blocks[0].Predecessors.insert(m_Blocks[0].Predecessors.begin(), entryBlock);
+    }
+
+    const auto isForwardEdge = [&](const u32 predecessor, const u32 block)
+    {
+        return predecessor == entryBlock || orderIndices[predecessor] < orderIndices[block];
+    };
+
+    for(const u32 blockIndex : order)
+    {
+        m_CurrentBlock = blockIndex;
+        const IrBlock& block = m_Blocks[blockIndex];
+
+        if(useLabels)
+        {
+            m_BlockLabels[blockIndex] = m_Writer.WriteLabel();
+        }
+
+        const bool isLoopHeader = ::std::any_of(block.Predecessors.begin(), block.Predecessors.end(), [&](const u32 predecessor) { return !isForwardEdge(predecessor, blockIndex); });
+
+        if(block.Predecessors.empty())
+        {
+            LoadState(states[entryBlock]);
+        }
+        else if(!isLoopHeader)
+        {
+            if(block.Predecessors.size() == 1)
+            {
+                LoadState(states[block.Predecessors[0]]);
+            }
+            else if(!MergeStates(block.Predecessors, states))
+            {
+                return false;
+            }
+        }
+        else
+        {
+            // Reverse postorder guarantees at least one predecessor has already been translated.
+            const u32 forwardPredecessor = *::std::find_if(block.Predecessors.begin(), block.Predecessors.end(), [&](const u32 predecessor) { return isForwardEdge(predecessor, blockIndex); });
+            LoadState(states[forwardPredecessor]);
+
+            for(u32 local = 0; local < states[entryBlock].Locals.size(); ++local)
+            {
+                if(blockFinder.IsLocalAssigned(local))
+                {
+                    m_FrameTracker.SetLocal(WritePendingPhi(blockIndex, SlotKind::Local, local, m_LocalSsaTypes[local], 0, 0), local);
+                }
+            }
+
+            for(u32 argument = 0; argument < MaxArgumentRegisters; ++argument)
+            {
+                if(blockFinder.IsArgumentAssigned(argument))
+                {
+                    m_FrameTracker.SetArgument(WritePendingPhi(blockIndex, SlotKind::Argument, argument, ssa::SsaType::U64, 0, 0), argument);
+                }
+            }
+
+            SsaFrameTracker::FrameStack frames = m_FrameTracker.GetFrames();
+
+            for(u32 frame = 0; frame < frames.size(); ++frame)
+            {
+                frames[frame].Var = WritePendingPhi(blockIndex, SlotKind::Frame, frame, m_Writer.GetVarType(frames[frame].Var), frames.size(), frames[frame].Size);
+            }
+
+            m_FrameTracker.SetFrames(frames);
+        }
+
+        Traverse(code + block.Begin, code + block.End);
+
+        // Blocks are no longer laid out in code order, so falling through has to be explicit.
+        if(block.Exit == BlockExit::FallThrough && block.Next != InvalidBlock)
+        {
+            WriteBranch(block.Next);
+        }
+
+        SaveState(states[blockIndex]);
+    }
+
+    if(!FillPendingPhis(states))
+    {
+        return false;
+    }
+
+    for(const BranchPatch& patch : m_BranchPatches)
+    {
+        m_Writer.PatchVarId(patch.Offset, m_BlockLabels[patch.Block]);
+    }
+
+    return true;
+}
+
+bool IrToSsa::TransformFunction(Function* const function, const ModuleRef& module, const u16 currentModule) noexcept
 {
-    IrToSsaVisitor visitor(function, module, currentModule);
-    visitor.Traverse(function->Address(), function->Address() + function->CodeSize());
+    ssa::SsaArena arena;
+    return TransformFunction(function, module, currentModule, arena);
+}
+
+bool IrToSsa::TransformFunction(Function* const function, const ModuleRef& module, const u16 currentModule, ssa::SsaArena& arena, const ssa::SsaCustomTypeRegistry* const registry) noexcept
+{
+    bool success;
+
+    {
+        IrToSsaVisitor visitor(function, module, currentModule, arena, registry);
+        success = visitor.Build();
+
+        if(success)
+        {
+            visitor.Writer().DetachArena();
+            function->Attach<ssa::SsaWriterFunctionAttachment>(::std::move(visitor.Writer()));
+        }
+    }
+
+    // The visitor is gone, nothing references the scratch memory anymore.
+    arena.Reset();
+
+    return success;
+}
+
+bool IrToSsa::TransformModule(const ModuleRef& module, const u16 currentModule, u32 threadCount, const ssa::SsaCustomTypeRegistry* const registry) noexcept
+{
+    // Native functions have no IR to transform.
+    if(module->IsNative())
+    {
+        return true;
+    }
+
+    const FunctionList& functions = module->Functions();
+    const uSys functionCount = functions.count();
+
+    if(threadCount == 0)
+    {
+        threadCount = maxT(::std::thread::hardware_concurrency(), 1u);
+    }
+
+    threadCount = static_cast<u32>(minT(static_cast<uSys>(threadCount), functionCount));
+
+    ::std::atomic<uSys> nextFunction(0);
+    ::std::atomic<bool> success(true);
+
+    // Each function is only touched by the worker that claimed it, so attaching needs no lock.
+    // Every function is transformed on its own, the output doesn't depend on which worker claims it.
+    const auto worker = [&]()
+    {
+        ssa::SsaArena arena;
 
-    function->Attach<ssa::SsaWriterFunctionAttachment>(::std::move(visitor.Writer()));
+        while(true)
+        {
+            const uSys index = nextFunction.fetch_add(1, ::std::memory_order_relaxed);
+
+            if(index >= functionCount)
+            {
+                break;
+            }
+
+            if(!TransformFunction(functions[index], module, currentModule, arena, registry))
+            {
+                success.store(false, ::std::memory_order_relaxed);
+            }
+        }
+    };
+
+    if(threadCount <= 1)
+    {
+        worker();
+        return success.load(::std::memory_order_relaxed);
+    }
+
+    ::std::vector<::std::thread> threads;
+    threads.reserve(threadCount - 1);
+
+    for(u32 i = 0; i < threadCount - 1; ++i)
+    {
+        threads.emplace_back(worker);
+    }
+
+    // The calling thread works through the functions as well.
+    worker();
+
+    for(::std::thread& thread : threads)
+    {
+        thread.join();
+    }
+
+    return success.load(::std::memory_order_relaxed);
 }
     
-IrToSsa::VarId IrToSsa::PopRaw(SsaWriter& writer, SsaFrameTracker& frameTracker, const uSys size, const ssa::SsaType ssaType)
+IrToSsa::VarId IrToSsa::PopRaw(SsaWriter& writer, SsaFrameTracker& frameTracker, const uSys size, const ssa::SsaCustomType ssaType)
 {
     // Pop the first frame.
     auto frame = frameTracker.PopFrame(size);
@@ -398,8 +1292,11 @@ IrToSsa::VarId IrToSsa::PopRaw(SsaWriter& writer, SsaFrameTracker& frameTracker,
             frameTracker.PushFrame(splitBase, sizeSpill);
         }
 
+        // Raw byte pops don't know their size until here.
+        const ssa::SsaCustomType joinType = ssaType.Type == ssa::SsaType::Bytes ? ssa::SsaCustomType(ssa::SsaType::Bytes, static_cast<u32>(size)) : ssaType;
+
         // Write the join of all the vars.
-        const VarId newVar = writer.WriteJoin(ssaType, 0, types + index, vars + index);
+        const VarId newVar = writer.WriteJoin(joinType, static_cast<u32>(packSize - index), types + index, vars + index);
         return newVar;
     }
 }
@@ -419,65 +1316,5 @@ IrToSsa::VarId IrToSsa::PopArgument(const Function* const function, SsaWriter& w
     frameTracker.SetArgument(newVar, argIndex);
     return newVar;
 }
-    
-static ssa::SsaType GetSsaType(const TypeInfo& type) noexcept
-{
-    if(type == TypeInfo::Void)
-    {
-        return ssa::SsaType::Void;
-    }
-    else if(type == TypeInfo::Bool)
-    {
-        return ssa::SsaType::Bool;
-    }
-    else if(type == TypeInfo::I8)
-    {
-        return ssa::SsaType::I8;
-    }
-    else if(type == TypeInfo::I16)
-    {
-        return ssa::SsaType::I16;
-    }
-    else if(type == TypeInfo::I32)
-    {
-        return ssa::SsaType::I32;
-    }
-    else if(type == TypeInfo::I64)
-    {
-        return ssa::SsaType::I64;
-    }
-    else if(type == TypeInfo::U8)
-    {
-        return ssa::SsaType::U8;
-    }
-    else if(type == TypeInfo::U16)
-    {
-        return ssa::SsaType::U16;
-    }
-    else if(type == TypeInfo::U32)
-    {
-        return ssa::SsaType::U32;
-    }
-    else if(type == TypeInfo::U64)
-    {
-        return ssa::SsaType::U64;
-    }
-    else if(type == TypeInfo::F32)
-    {
-        return ssa::SsaType::F32;
-    }
-    else if(type == TypeInfo::F64)
-    {
-        return ssa::SsaType::F64;
-    }
-    else if(type == TypeInfo::Char)
-    {
-        return ssa::SsaType::Char;
-    }
-    else
-    {
-        return ssa::SsaType::Custom;
-    }
-}
 
 }
@@ -192,6 +192,12 @@ void IrWriter::WritePopGlobalExtPtr(const u32 globalIndex, const u16 moduleIndex
     WriteT(moduleIndex);
 }
 
+void IrWriter::WritePopCount(const u16 byteCount) noexcept
+{
+    WriteOpcode(Opcode::PopCount);
+    WriteT(byteCount);
+}
+
 void IrWriter::WriteDup(const uSys byteCount) noexcept
 {
     switch(byteCount)
@@ -324,9 +330,10 @@ void IrWriter::WriteLoadGlobalExt(const u32 valueGlobalIndex, const u16 pointerL
 
 void IrWriter::WriteStore(const u16 pointerLocalIndex, const u16 valueLocalIndex) noexcept
 {
-    WriteOpcode(Opcode::StoreGlobalExt);
-    WriteT(pointerLocalIndex);
+    WriteOpcode(Opcode::Store);
+    // The value local is decoded first, the same as a Load.
     WriteT(valueLocalIndex);
+    WriteT(pointerLocalIndex);
 }
 
 void IrWriter::WriteStoreGlobal(const u16 pointerLocalIndex, const u32 valueGlobalIndex) noexcept
@@ -401,6 +408,56 @@ void IrWriter::WriteDivI64() noexcept
     WriteOpcode(Opcode::DivI64);
 }
 
+void IrWriter::WriteMulHighI32() noexcept
+{
+    WriteOpcode(Opcode::MulHighI32);
+}
+
+void IrWriter::WriteMulHighI64() noexcept
+{
+    WriteOpcode(Opcode::MulHighI64);
+}
+
+void IrWriter::WriteMulHighU32() noexcept
+{
+    WriteOpcode(Opcode::MulHighU32);
+}
+
+void IrWriter::WriteMulHighU64() noexcept
+{
+    WriteOpcode(Opcode::MulHighU64);
+}
+
+void IrWriter::WriteShlI32() noexcept
+{
+    WriteOpcode(Opcode::ShlI32);
+}
+
+void IrWriter::WriteShlI64() noexcept
+{
+    WriteOpcode(Opcode::ShlI64);
+}
+
+void IrWriter::WriteShrI32() noexcept
+{
+    WriteOpcode(Opcode::ShrI32);
+}
+
+void IrWriter::WriteShrI64() noexcept
+{
+    WriteOpcode(Opcode::ShrI64);
+}
+
+void IrWriter::WriteSarI32() noexcept
+{
+    WriteOpcode(Opcode::SarI32);
+}
+
+void IrWriter::WriteSarI64() noexcept
+{
+    WriteOpcode(Opcode::SarI64);
+}
+
 void IrWriter::WriteCompI32(const CompareCondition cond) noexcept
 {
     switch(cond)
@@ -450,17 +507,16 @@ void IrWriter::WriteCallExt(const u32 functionIndex, const u16 moduleIndex) noex
     WriteT(moduleIndex);
 }
 
-void IrWriter::WriteCallInd(const u32 functionPointerIndex) noexcept
+void IrWriter::WriteCallInd(const u16 functionPointerIndex) noexcept
 {
     WriteOpcode(Opcode::CallInd);
     WriteT(functionPointerIndex);
 }
 
-void IrWriter::WriteCallIndExt(const u32 functionPointerIndex, const u16 moduleIndex) noexcept
+void IrWriter::WriteCallIndExt(const u16 functionPointerIndex) noexcept
 {
     WriteOpcode(Opcode::CallIndExt);
     WriteT(functionPointerIndex);
-    WriteT(moduleIndex);
 }
 
 void IrWriter::WriteRet() noexcept
@@ -486,6 +542,22 @@ void IrWriter::WriteJumpFalse(const i32 offset) noexcept
     WriteT(offset);
 }
 
+void IrWriter::PatchJump(const uSys jumpIndex, const i32 offset) noexcept
+{
+    // All jump opcodes are a single byte.
+    if(jumpIndex + 1 + sizeof(offset) > m_WriteIndex)
+    {
+        return;
+    }
+
+    (void) ::std::memcpy(m_Buffer + jumpIndex + 1, &offset, sizeof(offset));
+}
+
+void IrWriter::WriteCode(const u8* const code, const uSys size) noexcept
+{
+    WriteRaw(code, size);
+}
+
 void IrWriter::WriteRaw(const void* const value, const uSys size) noexcept
 {
     EnsureSize(size);
@@ -0,0 +1,298 @@
+#include "TauIR/ssa/opto/LoadStoreElimination.hpp"
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+#include "TauIR/Function.hpp"
+#include "TauIR/ssa/SsaFunctionAttachment.hpp"
+
+namespace tau::ir::ssa::opto {
+
+static constexpr u32 InvalidIndex = SsaGraph::InvalidIndex;
+
+[[nodiscard]] static bool IsCall(const SsaOpcode opcode) noexcept
+{
+    return opcode == SsaOpcode::Call || opcode == SsaOpcode::CallExt || opcode == SsaOpcode::CallInd || opcode == SsaOpcode::CallIndExt;
+}
+
+[[nodiscard]] static bool IsStore(const SsaOpcode opcode) noexcept
+{
+    return opcode == SsaOpcode::StoreV || opcode == SsaOpcode::StoreI;
+}
+
+[[nodiscard]] static bool IsSameType(const SsaCustomType a, const SsaCustomType b) noexcept
+{
+    // SsaCustomType converts to its encoded size, so it can't be compared with ==.
+    return a.Type == b.Type && (!a.HasCustomSize() || a.CustomType == b.CustomType);
+}
+
+bool LoadStoreElimination::Traverse(const u8* const codePtr, const uSys size, const VarId maxId) noexcept
+{
+    m_ForwardedCount = 0;
+    m_RemovedStoreCount = 0;
+    m_Writer.Reset(size);
+
+    if(!m_Graph.Decode(codePtr, size, maxId, *m_Registry))
+    {
+        return false;
+    }
+
+    for(u32 block = 0; block < m_Graph.Blocks().size(); ++block)
+    {
+        ForwardLoads(block);
+        // Forwarded loads no longer read memory, so more stores may be dead.
+        RemoveDeadStores(block);
+    }
+
+    return m_Graph.Encode(m_Writer);
+}
+
+bool LoadStoreElimination::Traverse(const Function* const function) noexcept
+{
+    {
+        const SsaWriterFunctionAttachment* const ssaWriterAttachment = function->FindAttachment<SsaWriterFunctionAttachment>();
+
+        if(ssaWriterAttachment)
+        {
+            return Traverse(ssaWriterAttachment->Writer().Buffer(), ssaWriterAttachment->Writer().Size(), ssaWriterAttachment->Writer().IdIndex());
+        }
+    }
+
+    {
+        const SsaFunctionAttachment* const ssaAttachment = function->FindAttachment<SsaFunctionAttachment>();
+
+        if(ssaAttachment)
+        {
+            return Traverse(ssaAttachment->Buffer(), ssaAttachment->Buffer().Size(), ssaAttachment->MaxVarId());
+        }
+    }
+
+    return false;
+}
+
+void LoadStoreElimination::UpdateAttachment(Function* const function) noexcept
+{
+    {
+        SsaWriterFunctionAttachment* const ssaWriterAttachment = function->FindAttachment<SsaWriterFunctionAttachment>();
+
+        if(ssaWriterAttachment)
+        {
+            ssaWriterAttachment->Writer() = ::std::move(m_Writer);
+        }
+    }
+
+    {
+        const SsaFunctionAttachment* const ssaAttachment = function->FindAttachment<SsaFunctionAttachment>();
+
+        if(ssaAttachment)
+        {
+            function->RemoveAttachment<SsaFunctionAttachment>();
+            function->Attach<SsaFunctionAttachment>(m_Writer.Buffer(), m_Writer.Size(), m_Writer.IdIndex(), m_Writer.VarTypeMap());
+        }
+    }
+}
+
+VarId LoadStoreElimination::ResolveCopies(VarId var) const noexcept
+{
+    u32 inst = m_Graph.Definition(var);
+
+    while(inst != InvalidIndex && m_Graph.Opcode(inst) == SsaOpcode::AssignVariable)
+    {
+        var = m_Graph.Operand(inst, 0);
+        inst = m_Graph.Definition(var);
+    }
+
+    return var;
+}
+
+LoadStoreElimination::Address LoadStoreElimination::AccessAddress(const u32 inst) const noexcept
+{
+    Address address { };
+    address.Base = ResolveCopies(m_Graph.Operand(inst, 0));
+
+    const uSys size = TypeValueSize(m_Graph.Type(inst).Type);
+    address.Size = size <= sizeof(u64) ? static_cast<u32>(size) : 0;
+
+    const u32 definition = m_Graph.Definition(address.Base);
+
+    if(definition == InvalidIndex || m_Graph.Opcode(definition) != SsaOpcode::ComputePtr)
+    {
+        return address;
+    }
+
+    i8 multiplier;
+    i16 offset;
+    (void) ::std::memcpy(&multiplier, m_Graph.Immediate(definition), sizeof(multiplier));
+    (void) ::std::memcpy(&offset, m_Graph.Immediate(definition) + sizeof(multiplier), sizeof(offset));
+
+    address.Base = ResolveCopies(m_Graph.Operand(definition, 0));
+    address.Multiplier = multiplier;
+    address.Offset = offset;
+
+    // Without a multiplier the index doesn't change the address.
+    if(multiplier != 0)
+    {
+        address.Index = ResolveCopies(m_Graph.Operand(definition, 1));
+    }
+
+    return address;
+}
+
+bool LoadStoreElimination::IsSameBase(const Address& a, const Address& b) noexcept
+{
+    return a.Base == b.Base && a.Index == b.Index && a.Multiplier == b.Multiplier;
+}
+
+bool LoadStoreElimination::IsSameAddress(const Address& a, const Address& b) noexcept
+{
+    return a.Size != 0 && IsSameBase(a, b) && a.Offset == b.Offset && a.Size == b.Size;
+}
+
+bool LoadStoreElimination::MayAlias(const Address& a, const Address& b) noexcept
+{
+    if(a.Size == 0 || b.Size == 0 || !IsSameBase(a, b))
+    {
+        return true;
+    }
+
+    return a.Offset < b.Offset + static_cast<i32>(b.Size) && b.Offset < a.Offset + static_cast<i32>(a.Size);
+}
+
+bool LoadStoreElimination::Covers(const Address& outer, const Address& inner) noexcept
+{
+    if(outer.Size == 0 || inner.Size == 0 || !IsSameBase(outer, inner))
+    {
+        return false;
+    }
+
+    return outer.Offset <= inner.Offset && inner.Offset + static_cast<i32>(inner.Size) <= outer.Offset + static_cast<i32>(outer.Size);
+}
+
+void LoadStoreElimination::ForwardLoads(const u32 block) noexcept
+{
+    m_KnownValues.clear();
+
+    for(u32 inst = m_Graph.Blocks()[block].Begin; inst < m_Graph.Blocks()[block].End; ++inst)
+    {
+        const SsaOpcode opcode = m_Graph.Opcode(inst);
+
+        if(IsCall(opcode))
+        {
+            m_KnownValues.clear();
+            continue;
+        }
+
+        if(opcode == SsaOpcode::Load)
+        {
+            const Address address = AccessAddress(inst);
+
+            if(address.Size == 0)
+            {
+                continue;
+            }
+
+            const auto known = ::std::find_if(m_KnownValues.begin(), m_KnownValues.end(), [&](const KnownValue& value)
+            {
+                return IsSameAddress(value.Location, address) && IsSameType(value.Type, m_Graph.Type(inst));
+            });
+
+            if(known == m_KnownValues.end())
+            {
+                m_KnownValues.push_back({ address, m_Graph.Type(inst), inst });
+                continue;
+            }
+
+            switch(m_Graph.Opcode(known->Inst))
+            {
+                case SsaOpcode::StoreI:
+                {
+                    // The immediate is copied first, it lives in the pool that is written to.
+                    u8 value[sizeof(u64)];
+                    const u32 valueSize = m_Graph.ImmediateSize(known->Inst);
+                    (void) ::std::memcpy(value, m_Graph.Immediate(known->Inst), valueSize);
+                    m_Graph.MakeAssignImmediate(inst, value, valueSize);
+                    break;
+                }
+                case SsaOpcode::StoreV:
+                    m_Graph.MakeAssignVariable(inst, m_Graph.Operand(known->Inst, 1));
+                    break;
+                default:
+                    m_Graph.MakeAssignVariable(inst, m_Graph.Result(known->Inst));
+                    break;
+            }
+
+            ++m_ForwardedCount;
+            continue;
+        }
+
+        if(!IsStore(opcode))
+        {
+            continue;
+        }
+
+        const Address address = AccessAddress(inst);
+
+        ::std::erase_if(m_KnownValues, [&address](const KnownValue& value) { return MayAlias(value.Location, address); });
+
+        if(address.Size == 0)
+        {
+            continue;
+        }
+
+        // The stored value can only stand in for a load if it is exactly what the load would read.
+        const bool isExact = opcode == SsaOpcode::StoreI ?
+            m_Graph.ImmediateSize(inst) == address.Size :
+            IsSameType(m_Graph.VarType(m_Graph.Operand(inst, 1)), m_Graph.Type(inst));
+
+        if(isExact)
+        {
+            m_KnownValues.push_back({ address, m_Graph.Type(inst), inst });
+        }
+    }
+}
+
+void LoadStoreElimination::RemoveDeadStores(const u32 block) noexcept
+{
+    m_Overwritten.clear();
+
+    for(u32 inst = m_Graph.Blocks()[block].End; inst-- > m_Graph.Blocks()[block].Begin;)
+    {
+        const SsaOpcode opcode = m_Graph.Opcode(inst);
+
+        if(IsCall(opcode))
+        {
+            m_Overwritten.clear();
+            continue;
+        }
+
+        if(opcode == SsaOpcode::Load)
+        {
+            const Address address = AccessAddress(inst);
+            ::std::erase_if(m_Overwritten, [&address](const Address& overwritten) { return MayAlias(overwritten, address); });
+            continue;
+        }
+
+        if(!IsStore(opcode))
+        {
+            continue;
+        }
+
+        const Address address = AccessAddress(inst);
+
+        if(address.Size == 0)
+        {
+            continue;
+        }
+
+        if(::std::any_of(m_Overwritten.begin(), m_Overwritten.end(), [&address](const Address& overwritten) { return Covers(overwritten, address); }))
+        {
+            m_Graph.Remove(inst);
+            ++m_RemovedStoreCount;
+            continue;
+        }
+
+        m_Overwritten.push_back(address);
+    }
+}
+
+}
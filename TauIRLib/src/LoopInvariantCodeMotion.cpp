@@ -0,0 +1,552 @@
+#include "TauIR/ssa/opto/LoopInvariantCodeMotion.hpp"
+#include <algorithm>
+#include <utility>
+
+#include "TauIR/Function.hpp"
+#include "TauIR/ssa/SsaFunctionAttachment.hpp"
+
+namespace tau::ir::ssa::opto {
+
+static constexpr u32 InvalidIndex = SsaGraph::InvalidIndex;
+
+[[nodiscard]] static bool IsTerminator(const SsaOpcode opcode) noexcept
+{
+    return opcode == SsaOpcode::Branch || opcode == SsaOpcode::BranchCond || opcode == SsaOpcode::Ret;
+}
+
+[[nodiscard]] static bool IsCall(const SsaOpcode opcode) noexcept
+{
+    return opcode == SsaOpcode::Call || opcode == SsaOpcode::CallExt || opcode == SsaOpcode::CallInd || opcode == SsaOpcode::CallIndExt;
+}
+
+bool LoopInvariantCodeMotion::Traverse(const u8* const codePtr, const uSys size, const VarId maxId) noexcept
+{
+    m_HoistedCount = 0;
+    m_Writer.Reset(size);
+
+    if(!m_Graph.Decode(codePtr, size, maxId, *m_Registry))
+    {
+        return false;
+    }
+
+    ComputeControlFlow();
+    ComputeDominators();
+    FindLoops();
+
+    m_BlockInsts.resize(m_Graph.Blocks().size());
+    m_InstBlocks.resize(m_Graph.InstructionCount());
+    m_CallParameters.assign(static_cast<uSys>(maxId) + 1, 0);
+
+    for(u32 block = 0; block < m_Graph.Blocks().size(); ++block)
+    {
+        m_BlockInsts[block].clear();
+
+        for(u32 inst = m_Graph.Blocks()[block].Begin; inst < m_Graph.Blocks()[block].End; ++inst)
+        {
+            m_BlockInsts[block].push_back(inst);
+            m_InstBlocks[inst] = block;
+        }
+    }
+
+    for(u32 inst = 0; inst < m_Graph.InstructionCount(); ++inst)
+    {
+        if(!IsCall(m_Graph.Opcode(inst)))
+        {
+            continue;
+        }
+
+        for(u32 i = m_Graph.ParameterOffset(inst); i < m_Graph.OperandCount(inst); ++i)
+        {
+            const VarId var = m_Graph.Operand(inst, i);
+
+            if(var < m_CallParameters.size())
+            {
+                m_CallParameters[var] = 1;
+            }
+        }
+    }
+
+    // Inner loops have fewer blocks than the loops around them.
+    ::std::sort(m_Loops.begin(), m_Loops.end(), [](const Loop& a, const Loop& b) { return a.BlockCount < b.BlockCount; });
+
+    for(const Loop& loop : m_Loops)
+    {
+        HoistLoop(loop);
+    }
+
+    ::std::vector<u32> order;
+    order.reserve(m_Graph.InstructionCount());
+
+    for(const ::std::vector<u32>& insts : m_BlockInsts)
+    {
+        order.insert(order.end(), insts.begin(), insts.end());
+    }
+
+    return m_Graph.Encode(m_Writer, order);
+}
+
+bool LoopInvariantCodeMotion::Traverse(const Function* const function) noexcept
+{
+    {
+        const SsaWriterFunctionAttachment* const ssaWriterAttachment = function->FindAttachment<SsaWriterFunctionAttachment>();
+
+        if(ssaWriterAttachment)
+        {
+            return Traverse(ssaWriterAttachment->Writer().Buffer(), ssaWriterAttachment->Writer().Size(), ssaWriterAttachment->Writer().IdIndex());
+        }
+    }
+
+    {
+        const SsaFunctionAttachment* const ssaAttachment = function->FindAttachment<SsaFunctionAttachment>();
+
+        if(ssaAttachment)
+        {
+            return Traverse(ssaAttachment->Buffer(), ssaAttachment->Buffer().Size(), ssaAttachment->MaxVarId());
+        }
+    }
+
+    return false;
+}
+
+void LoopInvariantCodeMotion::UpdateAttachment(Function* const function) noexcept
+{
+    {
+        SsaWriterFunctionAttachment* const ssaWriterAttachment = function->FindAttachment<SsaWriterFunctionAttachment>();
+
+        if(ssaWriterAttachment)
+        {
+            ssaWriterAttachment->Writer() = ::std::move(m_Writer);
+        }
+    }
+
+    {
+        const SsaFunctionAttachment* const ssaAttachment = function->FindAttachment<SsaFunctionAttachment>();
+
+        if(ssaAttachment)
+        {
+            function->RemoveAttachment<SsaFunctionAttachment>();
+            function->Attach<SsaFunctionAttachment>(m_Writer.Buffer(), m_Writer.Size(), m_Writer.IdIndex(), m_Writer.VarTypeMap());
+        }
+    }
+}
+
+void LoopInvariantCodeMotion::ComputeControlFlow() noexcept
+{
+    const u32 blockCount = static_cast<u32>(m_Graph.Blocks().size());
+
+    m_Successors.resize(blockCount);
+    m_Predecessors.resize(blockCount);
+
+    for(u32 block = 0; block < blockCount; ++block)
+    {
+        m_Successors[block].clear();
+        m_Predecessors[block].clear();
+    }
+
+    for(u32 block = 0; block < blockCount; ++block)
+    {
+        const SsaGraph::Block& info = m_Graph.Blocks()[block];
+
+        m_Successors[block].assign(m_Graph.Successors(block), m_Graph.Successors(block) + info.SuccessorCount);
+
+        u32 last = info.End;
+
+        while(last > info.Begin && m_Graph.Opcode(last - 1) == SsaOpcode::Nop)
+        {
+            --last;
+        }
+
+        // A block that doesn't end in a terminator falls through into the next one.
+        if((last == info.Begin || !IsTerminator(m_Graph.Opcode(last - 1))) && block + 1 < blockCount)
+        {
+            m_Successors[block].push_back(block + 1);
+        }
+
+        for(const u32 successor : m_Successors[block])
+        {
+            m_Predecessors[successor].push_back(block);
+        }
+    }
+}
+
+void LoopInvariantCodeMotion::ComputeDominators() noexcept
+{
+    const u32 blockCount = static_cast<u32>(m_Graph.Blocks().size());
+
+    m_PostIndices.assign(blockCount, InvalidIndex);
+    m_Dominators.assign(blockCount, InvalidIndex);
+
+    if(blockCount == 0)
+    {
+        return;
+    }
+
+    ::std::vector<u32> postOrder;
+    postOrder.reserve(blockCount);
+
+    {
+        // Each entry is a block and the index of the next successor to visit.
+        ::std::vector<::std::pair<u32, u32>> stack;
+        ::std::vector<u8> visited(blockCount, 0);
+
+        stack.emplace_back(0, 0);
+        visited[0] = 1;
+
+        while(!stack.empty())
+        {
+            auto& [block, next] = stack.back();
+
+            if(next < m_Successors[block].size())
+            {
+                const u32 successor = m_Successors[block][next++];
+
+                if(!visited[successor])
+                {
+                    visited[successor] = 1;
+                    stack.emplace_back(successor, 0);
+                }
+
+                continue;
+            }
+
+            m_PostIndices[block] = static_cast<u32>(postOrder.size());
+            postOrder.push_back(block);
+            stack.pop_back();
+        }
+    }
+
+    // Cooper, Harvey and Kennedy's iterative algorithm, blocks are visited in reverse post order.
+    const auto intersect = [this](u32 a, u32 b)
+    {
+        while(a != b)
+        {
+            while(m_PostIndices[a] < m_PostIndices[b])
+            {
+                a = m_Dominators[a];
+            }
+
+            while(m_PostIndices[b] < m_PostIndices[a])
+            {
+                b = m_Dominators[b];
+            }
+        }
+
+        return a;
+    };
+
+    m_Dominators[0] = 0;
+
+    bool changed = true;
+
+    while(changed)
+    {
+        changed = false;
+
+        for(auto iter = postOrder.rbegin(); iter != postOrder.rend(); ++iter)
+        {
+            const u32 block = *iter;
+
+            if(block == 0)
+            {
+                continue;
+            }
+
+            u32 dominator = InvalidIndex;
+
+            for(const u32 predecessor : m_Predecessors[block])
+            {
+                if(m_Dominators[predecessor] == InvalidIndex)
+                {
+                    continue;
+                }
+
+                dominator = dominator == InvalidIndex ? predecessor : intersect(predecessor, dominator);
+            }
+
+            if(m_Dominators[block] != dominator)
+            {
+                m_Dominators[block] = dominator;
+                changed = true;
+            }
+        }
+    }
+}
+
+bool LoopInvariantCodeMotion::Dominates(const u32 dominator, u32 block) const noexcept
+{
+    if(m_Dominators[block] == InvalidIndex || m_Dominators[dominator] == InvalidIndex)
+    {
+        return false;
+    }
+
+    while(block != dominator)
+    {
+        if(block == 0)
+        {
+            return false;
+        }
+
+        block = m_Dominators[block];
+    }
+
+    return true;
+}
+
+void LoopInvariantCodeMotion::FindLoops() noexcept
+{
+    const u32 blockCount = static_cast<u32>(m_Graph.Blocks().size());
+
+    m_Loops.clear();
+
+    ::std::vector<u32> headerLoops(blockCount, InvalidIndex);
+    ::std::vector<u32> workList;
+
+    for(u32 block = 0; block < blockCount; ++block)
+    {
+        for(const u32 header : m_Successors[block])
+        {
+            if(!Dominates(header, block))
+            {
+                continue;
+            }
+
+            if(headerLoops[header] == InvalidIndex)
+            {
+                headerLoops[header] = static_cast<u32>(m_Loops.size());
+
+                Loop loop { };
+                loop.Header = header;
+                loop.Preheader = InvalidIndex;
+                loop.Blocks.assign(blockCount, 0);
+                loop.Blocks[header] = 1;
+                m_Loops.push_back(::std::move(loop));
+            }
+
+            Loop& loop = m_Loops[headerLoops[header]];
+            loop.Latches.push_back(block);
+
+            // Everything that reaches the latch without passing through the header is in the loop.
+            workList.push_back(block);
+
+            while(!workList.empty())
+            {
+                const u32 current = workList.back();
+                workList.pop_back();
+
+                if(loop.Blocks[current])
+                {
+                    continue;
+                }
+
+                loop.Blocks[current] = 1;
+
+                for(const u32 predecessor : m_Predecessors[current])
+                {
+                    if(m_Dominators[predecessor] != InvalidIndex)
+                    {
+                        workList.push_back(predecessor);
+                    }
+                }
+            }
+        }
+    }
+
+    for(Loop& loop : m_Loops)
+    {
+        for(const u32 predecessor : m_Predecessors[loop.Header])
+        {
+            if(loop.Blocks[predecessor])
+            {
+                continue;
+            }
+
+            // More than one way into the loop, there is no single block to hoist into.
+            if(loop.Preheader != InvalidIndex)
+            {
+                loop.Preheader = InvalidIndex;
+                break;
+            }
+
+            loop.Preheader = predecessor;
+        }
+
+        if(loop.Preheader != InvalidIndex && m_Successors[loop.Preheader].size() != 1)
+        {
+            loop.Preheader = InvalidIndex;
+        }
+
+        for(u32 block = 0; block < blockCount; ++block)
+        {
+            if(!loop.Blocks[block])
+            {
+                continue;
+            }
+
+            ++loop.BlockCount;
+
+            for(const u32 successor : m_Successors[block])
+            {
+                if(!loop.Blocks[successor])
+                {
+                    loop.Exits.push_back(block);
+                    break;
+                }
+            }
+
+            for(u32 inst = m_Graph.Blocks()[block].Begin; inst < m_Graph.Blocks()[block].End; ++inst)
+            {
+                const SsaOpcode opcode = m_Graph.Opcode(inst);
+
+                if(opcode == SsaOpcode::StoreV || opcode == SsaOpcode::StoreI || IsCall(opcode))
+                {
+                    loop.WritesMemory = true;
+                }
+            }
+        }
+    }
+
+    m_Loops.erase(::std::remove_if(m_Loops.begin(), m_Loops.end(), [](const Loop& loop) { return loop.Preheader == InvalidIndex; }), m_Loops.end());
+}
+
+void LoopInvariantCodeMotion::HoistLoop(const Loop& loop) noexcept
+{
+    ::std::vector<u32>& preheaderInsts = m_BlockInsts[loop.Preheader];
+
+    // Hoisted instructions go before the branch into the header.
+    uSys insertPosition = preheaderInsts.size();
+
+    while(insertPosition > 0 && m_Graph.Opcode(preheaderInsts[insertPosition - 1]) == SsaOpcode::Nop)
+    {
+        --insertPosition;
+    }
+
+    if(insertPosition > 0 && IsTerminator(m_Graph.Opcode(preheaderInsts[insertPosition - 1])))
+    {
+        --insertPosition;
+    }
+
+    ::std::vector<u32> kept;
+    bool changed = true;
+
+    // Hoisting an instruction can make the instructions using it invariant.
+    while(changed)
+    {
+        changed = false;
+
+        for(u32 block = 0; block < m_BlockInsts.size(); ++block)
+        {
+            if(!loop.Blocks[block])
+            {
+                continue;
+            }
+
+            kept.clear();
+
+            for(const u32 inst : m_BlockInsts[block])
+            {
+                if(!IsInvariant(loop, inst))
+                {
+                    kept.push_back(inst);
+                    continue;
+                }
+
+                preheaderInsts.insert(preheaderInsts.begin() + static_cast<iSys>(insertPosition++), inst);
+                m_InstBlocks[inst] = loop.Preheader;
+                ++m_HoistedCount;
+                changed = true;
+            }
+
+            m_BlockInsts[block].swap(kept);
+        }
+    }
+}
+
+bool LoopInvariantCodeMotion::IsInvariant(const Loop& loop, const u32 inst) const noexcept
+{
+    bool mayFault = false;
+
+    switch(m_Graph.Opcode(inst))
+    {
+        case SsaOpcode::AssignImmediate:
+        case SsaOpcode::AssignVariable:
+        case SsaOpcode::ExpandSX:
+        case SsaOpcode::ExpandZX:
+        case SsaOpcode::Trunc:
+        case SsaOpcode::RCast:
+        case SsaOpcode::BCast:
+        case SsaOpcode::ComputePtr:
+        case SsaOpcode::CompVtoV:
+        case SsaOpcode::CompVtoI:
+        case SsaOpcode::CompItoV:
+            break;
+        case SsaOpcode::BinOpVtoV:
+        case SsaOpcode::BinOpVtoI:
+        case SsaOpcode::BinOpItoV:
+            mayFault = m_Graph.BinaryOperation(inst) == SsaBinaryOperation::Div || m_Graph.BinaryOperation(inst) == SsaBinaryOperation::Rem;
+            break;
+        case SsaOpcode::Load:
+            if(loop.WritesMemory)
+            {
+                return false;
+            }
+
+            mayFault = true;
+            break;
+        default:
+            return false;
+    }
+
+    const VarId result = m_Graph.Result(inst);
+
+    if(result < m_CallParameters.size() && m_CallParameters[result])
+    {
+        return false;
+    }
+
+    if(mayFault && !RunsEveryIteration(loop, m_InstBlocks[inst]))
+    {
+        return false;
+    }
+
+    for(u32 i = 0; i < m_Graph.OperandCount(inst); ++i)
+    {
+        const VarId var = m_Graph.Operand(inst, i);
+
+        if((var & 0x80000000) != 0)
+        {
+            continue;
+        }
+
+        const u32 definition = m_Graph.Definition(var);
+
+        if(definition != InvalidIndex && loop.Blocks[m_InstBlocks[definition]])
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool LoopInvariantCodeMotion::RunsEveryIteration(const Loop& loop, const u32 block) const noexcept
+{
+    for(const u32 latch : loop.Latches)
+    {
+        if(!Dominates(block, latch))
+        {
+            return false;
+        }
+    }
+
+    for(const u32 exit : loop.Exits)
+    {
+        if(!Dominates(block, exit))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+}
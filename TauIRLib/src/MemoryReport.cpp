@@ -0,0 +1,119 @@
+#include "TauIR/MemoryReport.hpp"
+#include "TauIR/Function.hpp"
+#include "TauIR/Module.hpp"
+#include "TauIR/TypeInfo.hpp"
+#include <cstring>
+
+namespace tau::ir {
+
+MemoryReport MemoryReport::Build(const ModuleRef& module) noexcept
+{
+    return Build(module.Get());
+}
+
+MemoryReport MemoryReport::Build(const Module* const module) noexcept
+{
+    MemoryReport report;
+    report.m_Module = module;
+    report.m_ModuleBytes = 0;
+    report.m_FunctionAllocator = Function::AllocatorStats();
+    report.m_ModuleAllocator = Module::AllocatorStats();
+    report.m_TypeInfoAllocator = TypeInfo::AllocatorStats();
+
+    if(!module)
+    {
+        return report;
+    }
+
+    report.m_ModuleBytes += sizeof(Module);
+    report.m_ModuleBytes += module->Functions().Count() * sizeof(Function*);
+    report.m_ModuleBytes += module->Exports().Count() * sizeof(Function*);
+    report.m_ModuleBytes += module->Imports().Count() * sizeof(ImportModule);
+    report.m_ModuleBytes += module->Name().Length();
+
+    for(const ImportModule& import : module->Imports())
+    {
+        report.m_ModuleBytes += import.Functions().Count() * sizeof(Function*);
+    }
+
+    report.m_Functions.reserve(module->Functions().Count());
+
+    for(const Function* function : module->Functions())
+    {
+        if(!function)
+        {
+            continue;
+        }
+
+        report.m_Functions.push_back(BuildFunction(function));
+
+        for(const FunctionAttachment* attachment = function->Attachment(); attachment; attachment = attachment->Next())
+        {
+            report.AddAttachment(attachment->AttachmentName(), attachment->MemoryUsage());
+        }
+    }
+
+    return report;
+}
+
+FunctionMemoryReport MemoryReport::BuildFunction(const Function* const function) noexcept
+{
+    FunctionMemoryReport report;
+    report.Function = function;
+    report.Object = Function::AllocatorStats().BlockSize;
+    report.Code = function->CodeSize();
+    report.LocalTypes = function->LocalTypes().Count() * sizeof(const TypeInfo*);
+    report.LocalOffsets = function->LocalOffsets().Count() * sizeof(uSys);
+    report.Arguments = function->Arguments().Count() * sizeof(FunctionArgument);
+    report.Name = function->Name().Length();
+    report.Attachments = 0;
+
+    for(const FunctionAttachment* attachment = function->Attachment(); attachment; attachment = attachment->Next())
+    {
+        report.Attachments += attachment->MemoryUsage();
+    }
+
+    return report;
+}
+
+FunctionMemoryReport MemoryReport::FunctionTotals() const noexcept
+{
+    FunctionMemoryReport totals { };
+    totals.Function = nullptr;
+
+    for(const FunctionMemoryReport& function : m_Functions)
+    {
+        totals.Object += function.Object;
+        totals.Code += function.Code;
+        totals.LocalTypes += function.LocalTypes;
+        totals.LocalOffsets += function.LocalOffsets;
+        totals.Arguments += function.Arguments;
+        totals.Name += function.Name;
+        totals.Attachments += function.Attachments;
+    }
+
+    return totals;
+}
+
+uSys MemoryReport::Total() const noexcept
+{
+    return m_ModuleBytes + FunctionTotals().Total();
+}
+
+void MemoryReport::AddAttachment(const char* const name, const uSys bytes) noexcept
+{
+    for(AttachmentMemoryReport& attachment : m_Attachments)
+    {
+        // Names are string literals, but they're not guaranteed to be pooled across translation units.
+        if(attachment.Name == name || ::std::strcmp(attachment.Name, name) == 0)
+        {
+            ++attachment.Count;
+            attachment.Bytes += bytes;
+            return;
+        }
+    }
+
+    m_Attachments.emplace_back(name, 1, bytes);
+}
+
+}
@@ -4,6 +4,9 @@
 #include <atomic>
 #include <allocator/FixedBlockAllocator.hpp>
 #include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include "TauIR/CompileControls.hpp"
 
@@ -35,8 +38,98 @@ void Module::AttachModuleReference(const ModuleRef& module) noexcept
     }
 }
 
+void Module::CompactFunctions(const u32* const newIndices) noexcept
+{
+    uSys keptCount = 0;
+    uSys keptExportCount = 0;
+
+    for(uSys i = 0; i < m_Functions.count(); ++i)
+    {
+        if(newIndices[i] != static_cast<u32>(-1))
+        {
+            ++keptCount;
+        }
+    }
+
+    FunctionList functions(keptCount);
+
+    for(uSys i = 0; i < m_Functions.count(); ++i)
+    {
+        if(newIndices[i] != static_cast<u32>(-1))
+        {
+            functions[newIndices[i]] = m_Functions[i];
+        }
+    }
+
+    // Exports are pointers, the old index of each is needed to look up its new one.
+    ::std::unordered_map<const Function*, u32> oldIndices;
+    oldIndices.reserve(m_Functions.count());
+
+    for(uSys i = 0; i < m_Functions.count(); ++i)
+    {
+        oldIndices.emplace(m_Functions[i], static_cast<u32>(i));
+    }
+
+    ::std::vector<bool> isExportKept(m_Exports.count());
+
+    for(uSys i = 0; i < m_Exports.count(); ++i)
+    {
+        const auto oldIndex = oldIndices.find(m_Exports[i]);
+
+        if(oldIndex != oldIndices.end() && newIndices[oldIndex->second] != static_cast<u32>(-1))
+        {
+            isExportKept[i] = true;
+            ++keptExportCount;
+        }
+    }
+
+    FunctionList exports(keptExportCount);
+    keptExportCount = 0;
+
+    for(uSys i = 0; i < m_Exports.count(); ++i)
+    {
+        if(isExportKept[i])
+        {
+            exports[keptExportCount++] = m_Exports[i];
+        }
+    }
+
+    // Only delete the functions once the exports are done looking for them.
+    for(uSys i = 0; i < m_Functions.count(); ++i)
+    {
+        if(newIndices[i] == static_cast<u32>(-1))
+        {
+            delete m_Functions[i];
+        }
+    }
+
+    m_Functions = ::std::move(functions);
+    m_Exports = ::std::move(exports);
+}
+
+u32 Module::AddFunctions(Function* const* const functions, const uSys count) noexcept
+{
+    const uSys firstIndex = m_Functions.count();
+    FunctionList newFunctions(firstIndex + count);
+
+    for(uSys i = 0; i < firstIndex; ++i)
+    {
+        newFunctions[i] = m_Functions[i];
+    }
+
+    for(uSys i = 0; i < count; ++i)
+    {
+        newFunctions[firstIndex + i] = functions[i];
+    }
+
+    m_Functions = ::std::move(newFunctions);
+
+    return static_cast<u32>(firstIndex);
+}
+
 static FixedBlockAllocator<TAU_IR_ALLOCATION_TRACKING> g_allocator(sizeof(Module), PageCountVal{ 128 });
 static ::std::mutex g_allocatorMutex;
+static uSys g_allocationCount = 0;
 
 void* Module::operator new(const ::std::size_t sz) noexcept
 {
@@ -47,7 +140,14 @@ void* Module::operator new(const ::std::size_t sz) noexcept
 
     ::std::lock_guard lock(g_allocatorMutex);
 
-    return g_allocator.Allocate(sz);
+    void* const ret = g_allocator.Allocate(sz);
+
+    if(ret)
+    {
+        ++g_allocationCount;
+    }
+
+    return ret;
 }
 
 void Module::operator delete(void* const ptr) noexcept
@@ -60,6 +160,14 @@ void Module::operator delete(void* const ptr) noexcept
     ::std::lock_guard lock(g_allocatorMutex);
 
     g_allocator.deallocate(ptr);
+    --g_allocationCount;
+}
+
+FixedBlockAllocatorStats Module::AllocatorStats() noexcept
+{
+    ::std::lock_guard lock(g_allocatorMutex);
+
+    return { sizeof(Module), g_allocationCount };
 }
 
 
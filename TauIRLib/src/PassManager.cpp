@@ -0,0 +1,640 @@
+#include "TauIR/ssa/opto/PassManager.hpp"
+#include <cstring>
+#include <utility>
+
+#include "TauIR/SsaToIr.hpp"
+#include "TauIR/ssa/SsaFunctionAttachment.hpp"
+
+namespace tau::ir::ssa::opto {
+
+SsaPassManager::SsaPassManager(const SsaCustomTypeRegistry& registry, const ModuleRef& module) noexcept
+    : m_Registry(registry)
+    , m_Module(module)
+    , m_CallGraph()
+    , m_Pipelines {
+        DefaultPipeline(OptimizationControl::Default),
+        DefaultPipeline(OptimizationControl::NoOptimize),
+        DefaultPipeline(OptimizationControl::ForceOptimize),
+        DefaultPipeline(OptimizationControl::OptimizeHint)
+    }
+    , m_SpecializationPipeline(SsaPipeline().Repeat({ SsaPass::ConstantProp, SsaPass::UsageAnalysis, SsaPass::DeadCodeElimination }, 8))
+    , m_ConstantProp(registry)
+    , m_UsageAnalyzer(registry)
+    , m_DeadCodeElimination(registry)
+    , m_Inliner(registry, module)
+    , m_CommonSubexpressionElimination(registry)
+    , m_LoopInvariantCodeMotion(registry)
+    , m_StrengthReduction(registry)
+    , m_JoinSplitFolding(registry)
+    , m_LoadStoreElimination(registry)
+    , m_SpecializationCost(registry)
+    , m_Writers()
+    , m_Back(0)
+    , m_Code(nullptr)
+    , m_CodeSize(0)
+    , m_MaxId(0)
+    , m_UsageValid(false)
+{ }
+
+SsaPipeline SsaPassManager::DefaultPipeline(const OptimizationControl optimizationControl) noexcept
+{
+    SsaPipeline pipeline;
+
+#ifdef _DEBUG
+    if(optimizationControl == OptimizationControl::Default)
+    {
+        return pipeline;
+    }
+#endif
+
+    switch(optimizationControl)
+    {
+        case OptimizationControl::Default:
+        case OptimizationControl::ForceOptimize:
+            pipeline
+                .Run({ SsaPass::Inline })
+                .Repeat({ SsaPass::JoinSplitFolding, SsaPass::ConstantProp, SsaPass::StrengthReduction, SsaPass::LoadStoreElimination, SsaPass::CommonSubexpressionElimination, SsaPass::LoopInvariantCodeMotion, SsaPass::UsageAnalysis, SsaPass::DeadCodeElimination }, 8);
+            break;
+        case OptimizationControl::OptimizeHint:
+            pipeline.Run({ SsaPass::JoinSplitFolding, SsaPass::ConstantProp, SsaPass::StrengthReduction, SsaPass::LoadStoreElimination, SsaPass::CommonSubexpressionElimination, SsaPass::UsageAnalysis, SsaPass::DeadCodeElimination });
+            break;
+        case OptimizationControl::NoOptimize:
+        default:
+            break;
+    }
+
+    return pipeline;
+}
+
+bool SsaPassManager::RunFunction(Function* const function) noexcept
+{
+    if(!m_Module || m_Module->IsNative())
+    {
+        return RunFunction(function, SsaCallGraph::InvalidIndex);
+    }
+
+    if(m_CallGraph.FunctionCount() != m_Module->Functions().Count())
+    {
+        m_CallGraph.Build(m_Module, m_Registry);
+    }
+
+    u32 functionIndex = SsaCallGraph::InvalidIndex;
+
+    for(u32 i = 0; i < m_Module->Functions().Count(); ++i)
+    {
+        if(m_Module->Functions()[i] == function)
+        {
+            functionIndex = i;
+            break;
+        }
+    }
+
+    return RunFunction(function, functionIndex);
+}
+
+u32 SsaPassManager::RunModule() noexcept
+{
+    if(!m_Module || m_Module->IsNative())
+    {
+        return 0;
+    }
+
+    // Inlining since the last build may have changed the calls.
+    m_CallGraph.Build(m_Module, m_Registry);
+
+    u32 changedCount = 0;
+
+    for(const u32 functionIndex : m_CallGraph.BottomUpOrder())
+    {
+        // Nothing will ever run it.
+        if(!m_CallGraph.IsReachable(functionIndex))
+        {
+            continue;
+        }
+
+        if(RunFunction(m_Module->Functions()[functionIndex], functionIndex))
+        {
+            ++changedCount;
+        }
+    }
+
+    return changedCount;
+}
+
+u32 SsaPassManager::RemoveDeadFunctions(const bool isImported) noexcept
+{
+    if(!m_Module || m_Module->IsNative() || isImported)
+    {
+        return 0;
+    }
+
+    m_CallGraph.Build(m_Module, m_Registry);
+
+    const u32 functionCount = m_CallGraph.FunctionCount();
+
+    if(m_CallGraph.ReachableCount() == functionCount)
+    {
+        return 0;
+    }
+
+    const ::std::vector<u32> newIndices = m_CallGraph.CompactedIndices();
+
+    // A function SsaToIr can't lower would keep its IR code, which calls by the old indices.
+    {
+        SsaArena arena;
+
+        for(u32 i = 0; i < functionCount; ++i)
+        {
+            if(newIndices[i] == SsaCallGraph::InvalidIndex)
+            {
+                continue;
+            }
+
+            const Function* const lowered = SsaToIr::TransformFunction(m_Module->Functions()[i], m_Module, m_Registry, arena);
+
+            if(!lowered)
+            {
+                return 0;
+            }
+
+            delete lowered;
+        }
+    }
+
+    // Renumber everything before changing anything, the module is left alone if any function fails.
+    ::std::vector<u32> renumbered;
+    ::std::vector<SsaWriter> writers;
+
+    for(u32 i = 0; i < functionCount; ++i)
+    {
+        if(newIndices[i] == SsaCallGraph::InvalidIndex || m_CallGraph.CalleeCount(i) == 0)
+        {
+            continue;
+        }
+
+        if(!m_Graph.Decode(m_Module->Functions()[i], m_Registry))
+        {
+            return 0;
+        }
+
+        for(u32 inst = 0; inst < m_Graph.InstructionCount(); ++inst)
+        {
+            // A reachable function only calls reachable functions.
+            if(m_Graph.Opcode(inst) == SsaOpcode::Call && m_Graph.FunctionIndex(inst) < functionCount)
+            {
+                m_Graph.SetFunctionIndex(inst, newIndices[m_Graph.FunctionIndex(inst)]);
+            }
+        }
+
+        SsaWriter& writer = writers.emplace_back();
+        writer.Reset(m_Graph.EncodedSize());
+
+        if(!m_Graph.Encode(writer))
+        {
+            return 0;
+        }
+
+        renumbered.push_back(i);
+    }
+
+    for(uSys i = 0; i < renumbered.size(); ++i)
+    {
+        ::std::swap(m_Writers[m_Back ^ 1], writers[i]);
+        UpdateAttachment(m_Module->Functions()[renumbered[i]]);
+    }
+
+    m_Module->CompactFunctions(newIndices.data());
+
+    // Every index has moved.
+    m_CallGraph.Build(m_Module, m_Registry);
+
+    return functionCount - m_CallGraph.FunctionCount();
+}
+
+u32 SsaPassManager::SpecializeFunctions() noexcept
+{
+    if(!m_Module || m_Module->IsNative())
+    {
+        return 0;
+    }
+
+    m_CallGraph.Build(m_Module, m_Registry);
+
+    // The copies are added after this, they are never specialized themselves.
+    const u32 functionCount = m_CallGraph.FunctionCount();
+
+    ::std::vector<Specialization> specializations;
+    u32 growth = 0;
+    u32 redirectedCount = 0;
+
+    for(u32 caller = 0; caller < functionCount; ++caller)
+    {
+        Function* const function = m_Module->Functions()[caller];
+
+        if(!m_CallGraph.IsReachable(caller) || m_CallGraph.CalleeCount(caller) == 0 || function->Flags().OptimizationControl == OptimizationControl::NoOptimize)
+        {
+            continue;
+        }
+
+        if(!m_Graph.Decode(function, m_Registry))
+        {
+            continue;
+        }
+
+        u32 callerRedirectedCount = 0;
+
+        for(u32 inst = 0; inst < m_Graph.InstructionCount(); ++inst)
+        {
+            if(m_Graph.Opcode(inst) != SsaOpcode::Call || m_Graph.FunctionIndex(inst) >= functionCount)
+            {
+                continue;
+            }
+
+            const u32 copy = SpecializeCall(inst, specializations, growth);
+
+            if(copy != SsaCallGraph::InvalidIndex)
+            {
+                m_Graph.SetFunctionIndex(inst, copy);
+                ++callerRedirectedCount;
+            }
+        }
+
+        if(callerRedirectedCount == 0)
+        {
+            continue;
+        }
+
+        SsaWriter& front = m_Writers[m_Back ^ 1];
+        front.Reset(m_Graph.EncodedSize());
+
+        // Only the function indices changed, but if it fails the caller keeps calling the originals.
+        if(m_Graph.Encode(front))
+        {
+            UpdateAttachment(function);
+            redirectedCount += callerRedirectedCount;
+        }
+    }
+
+    // The list of functions is rebuilt for each add, so the copies are added together.
+    if(!specializations.empty())
+    {
+        ::std::vector<Function*> copies;
+        copies.reserve(specializations.size());
+
+        for(const Specialization& specialization : specializations)
+        {
+            copies.push_back(specialization.CopyFunction);
+        }
+
+        (void) m_Module->AddFunctions(copies.data(), copies.size());
+    }
+
+    m_CallGraph.Build(m_Module, m_Registry);
+
+    return redirectedCount;
+}
+
+u32 SsaPassManager::SpecializeCall(const u32 inst, ::std::vector<Specialization>& specializations, u32& growth) noexcept
+{
+    const u32 callee = m_Graph.FunctionIndex(inst);
+    const Function* const calleeFunction = m_Module->Functions()[callee];
+    const u32 parameterCount = m_Graph.ParameterCount(inst);
+
+    if(calleeFunction->Flags().OptimizationControl == OptimizationControl::NoOptimize || calleeFunction->Flags().HasVarArgs)
+    {
+        return SsaCallGraph::InvalidIndex;
+    }
+
+    if(calleeFunction->Arguments().Count() != parameterCount || !m_SpecializationCost.Traverse(calleeFunction))
+    {
+        return SsaCallGraph::InvalidIndex;
+    }
+
+    ::std::vector<ConstantArgument> constants;
+
+    for(u32 i = 0; i < parameterCount; ++i)
+    {
+        u64 value;
+
+        // A constant the callee never reads gains nothing.
+        if(m_SpecializationCost.ArgumentUses(i) != 0 && FindConstant(m_Graph.Operand(inst, i), &value))
+        {
+            constants.push_back({ i, value });
+        }
+    }
+
+    if(constants.empty())
+    {
+        return SsaCallGraph::InvalidIndex;
+    }
+
+    u32 copyCount = 0;
+
+    for(const Specialization& specialization : specializations)
+    {
+        if(specialization.Callee != callee)
+        {
+            continue;
+        }
+
+        if(specialization.Constants == constants)
+        {
+            return specialization.Copy;
+        }
+
+        ++copyCount;
+    }
+
+    if(copyCount >= MaxSpecializations || growth + m_SpecializationCost.InstructionCount() > SpecializationBudget)
+    {
+        return SsaCallGraph::InvalidIndex;
+    }
+
+    if(!m_SpecializationGraph.Decode(calleeFunction, m_Registry))
+    {
+        return SsaCallGraph::InvalidIndex;
+    }
+
+    const u32 instructionCount = m_SpecializationGraph.InstructionCount();
+
+    // The constants are appended, the order puts them ahead of the callee's code.
+    ::std::vector<u32> order;
+    order.reserve(instructionCount + constants.size());
+
+    for(const ConstantArgument& argument : constants)
+    {
+        const VarId argumentVar = static_cast<VarId>(0x80000000 | argument.Index);
+        const VarId constant = m_SpecializationGraph.AppendAssignImmediate(SsaType::U64, &argument.Value, sizeof(argument.Value));
+        (void) m_SpecializationGraph.ReplaceAllUses(argumentVar, constant);
+        order.push_back(m_SpecializationGraph.InstructionCount() - 1);
+    }
+
+    for(u32 i = 0; i < instructionCount; ++i)
+    {
+        order.push_back(i);
+    }
+
+    SsaWriter writer(m_SpecializationGraph.EncodedSize());
+
+    if(!m_SpecializationGraph.Encode(writer, order))
+    {
+        return SsaCallGraph::InvalidIndex;
+    }
+
+    FunctionBuilder builder;
+    builder
+        .Address(calleeFunction->Address())
+        .CodeSize(calleeFunction->CodeSize())
+        .LocalTypes(calleeFunction->LocalTypes())
+        .Arguments(calleeFunction->Arguments())
+        .Flags(calleeFunction->Flags())
+        .Name(calleeFunction->Name());
+
+    // The copy keeps its SSA the same way as the callee.
+    if(calleeFunction->FindAttachment<SsaWriterFunctionAttachment>())
+    {
+        builder.Attachment<SsaWriterFunctionAttachment>(::std::move(writer));
+    }
+    else
+    {
+        builder.Attachment<SsaFunctionAttachment>(writer.Buffer(), writer.Size(), writer.IdIndex(), writer.VarTypeMap());
+    }
+
+    Function* const copyFunction = builder.Build();
+    copyFunction->Module() = m_Module;
+    // Each specialization makes one copy, they are added in the same order once every call is done.
+    const u32 copy = static_cast<u32>(m_Module->Functions().Count() + specializations.size());
+
+    if(LoadFunction(copyFunction) && RunPipeline(m_SpecializationPipeline))
+    {
+        UpdateAttachment(copyFunction);
+    }
+
+    // What the copy costs is what's left once the constants have folded.
+    growth += m_SpecializationCost.Traverse(copyFunction) ? m_SpecializationCost.InstructionCount() : 0;
+
+    specializations.push_back({ callee, copy, copyFunction, ::std::move(constants) });
+
+    return copy;
+}
+
+bool SsaPassManager::FindConstant(VarId var, u64* const value) const noexcept
+{
+    // Parameters are copies, usually of a copy.
+    while((var & 0x80000000) == 0)
+    {
+        const u32 inst = m_Graph.Definition(var);
+
+        if(inst == SsaGraph::InvalidIndex)
+        {
+            return false;
+        }
+
+        if(m_Graph.Opcode(inst) == SsaOpcode::AssignImmediate)
+        {
+            if(m_Graph.ImmediateSize(inst) != sizeof(u64))
+            {
+                return false;
+            }
+
+            (void) ::std::memcpy(value, m_Graph.Immediate(inst), sizeof(u64));
+            return true;
+        }
+
+        if(m_Graph.Opcode(inst) != SsaOpcode::AssignVariable)
+        {
+            return false;
+        }
+
+        var = m_Graph.Operand(inst, 0);
+    }
+
+    return false;
+}
+
+bool SsaPassManager::RunFunction(Function* const function, const u32 functionIndex) noexcept
+{
+    if(!function || function->Flags().OptimizationControl == OptimizationControl::NoOptimize)
+    {
+        return false;
+    }
+
+    const SsaPipeline& pipeline = Pipeline(function->Flags().OptimizationControl);
+
+    if(pipeline.IsEmpty() || !LoadFunction(function))
+    {
+        return false;
+    }
+
+    m_Inliner.SetCaller(&m_CallGraph, functionIndex);
+
+    const bool changed = RunPipeline(pipeline);
+
+    if(changed)
+    {
+        UpdateAttachment(function);
+    }
+
+    return changed;
+}
+
+bool SsaPassManager::RunPipeline(const SsaPipeline& pipeline) noexcept
+{
+    bool changed = false;
+
+    for(const SsaPipeline::Stage& stage : pipeline.Stages())
+    {
+        for(u32 i = 0; i < stage.MaxIterations; ++i)
+        {
+            bool stageChanged = false;
+
+            for(const SsaPass pass : stage.Passes)
+            {
+                stageChanged = RunPass(pass) || stageChanged;
+            }
+
+            changed = changed || stageChanged;
+
+            if(!stageChanged)
+            {
+                break;
+            }
+        }
+    }
+
+    return changed;
+}
+
+bool SsaPassManager::LoadFunction(const Function* const function) noexcept
+{
+    m_UsageValid = false;
+
+    {
+        const SsaWriterFunctionAttachment* const ssaWriterAttachment = function->FindAttachment<SsaWriterFunctionAttachment>();
+
+        if(ssaWriterAttachment)
+        {
+            m_Code = ssaWriterAttachment->Writer().Buffer();
+            m_CodeSize = ssaWriterAttachment->Writer().Size();
+            m_MaxId = ssaWriterAttachment->Writer().IdIndex();
+            return true;
+        }
+    }
+
+    {
+        const SsaFunctionAttachment* const ssaAttachment = function->FindAttachment<SsaFunctionAttachment>();
+
+        if(ssaAttachment)
+        {
+            m_Code = ssaAttachment->Buffer();
+            m_CodeSize = ssaAttachment->Buffer().Size();
+            m_MaxId = ssaAttachment->MaxVarId();
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void SsaPassManager::UpdateAttachment(Function* const function) noexcept
+{
+    // The front writer holds the code of the last pass that changed it.
+    SsaWriter& front = m_Writers[m_Back ^ 1];
+
+    {
+        const SsaFunctionAttachment* const ssaAttachment = function->FindAttachment<SsaFunctionAttachment>();
+
+        if(ssaAttachment)
+        {
+            function->RemoveAttachment<SsaFunctionAttachment>();
+            function->Attach<SsaFunctionAttachment>(front.Buffer(), front.Size(), front.IdIndex(), front.VarTypeMap());
+        }
+    }
+
+    {
+        SsaWriterFunctionAttachment* const ssaWriterAttachment = function->FindAttachment<SsaWriterFunctionAttachment>();
+
+        if(ssaWriterAttachment)
+        {
+            // The old buffer of the attachment is reused by the next function.
+            ::std::swap(ssaWriterAttachment->Writer(), front);
+        }
+    }
+
+    // Any usage analysis that was attached is for the old code.
+    function->RemoveAttachment<UsageAnalysisFunctionAttachment>();
+
+    m_Code = nullptr;
+    m_CodeSize = 0;
+    m_MaxId = 0;
+}
+
+bool SsaPassManager::RunPass(const SsaPass pass) noexcept
+{
+    switch(pass)
+    {
+        case SsaPass::ConstantProp:
+            return RunTransform(m_ConstantProp);
+        case SsaPass::UsageAnalysis:
+            RunUsageAnalysis();
+            return false;
+        case SsaPass::DeadCodeElimination:
+            if(!m_UsageValid)
+            {
+                RunUsageAnalysis();
+            }
+
+            m_DeadCodeElimination.SetUsageMap(m_UsageValid ? &m_UsageAnalyzer.UsageMap() : nullptr);
+            return RunTransform(m_DeadCodeElimination);
+        case SsaPass::Inline:
+            return RunTransform(m_Inliner);
+        case SsaPass::CommonSubexpressionElimination:
+            return RunTransform(m_CommonSubexpressionElimination);
+        case SsaPass::LoopInvariantCodeMotion:
+            return RunTransform(m_LoopInvariantCodeMotion);
+        case SsaPass::StrengthReduction:
+            return RunTransform(m_StrengthReduction);
+        case SsaPass::JoinSplitFolding:
+            return RunTransform(m_JoinSplitFolding);
+        case SsaPass::LoadStoreElimination:
+            return RunTransform(m_LoadStoreElimination);
+        default:
+            return false;
+    }
+}
+
+void SsaPassManager::RunUsageAnalysis() noexcept
+{
+    m_UsageValid = m_UsageAnalyzer.Traverse(m_Code, m_CodeSize, m_MaxId);
+}
+
+template<typename Visitor>
+bool SsaPassManager::RunTransform(Visitor& visitor) noexcept
+{
+    SsaWriter& back = m_Writers[m_Back];
+
+    // Lend the back buffer to the visitor, it resets the writer before writing.
+    visitor.Writer() = ::std::move(back);
+    const bool success = visitor.Traverse(m_Code, m_CodeSize, m_MaxId);
+    back = ::std::move(visitor.Writer());
+
+    if(!success)
+    {
+        return false;
+    }
+
+    if(back.Size() == m_CodeSize && ::std::memcmp(back.Buffer(), m_Code, m_CodeSize) == 0)
+    {
+        return false;
+    }
+
+    m_Code = back.Buffer();
+    m_CodeSize = back.Size();
+    m_MaxId = back.IdIndex();
+    m_Back ^= 1;
+    m_UsageValid = false;
+
+    return true;
+}
+
+}
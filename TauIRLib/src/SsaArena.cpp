@@ -0,0 +1,149 @@
+#include "TauIR/ssa/SsaArena.hpp"
+#include <TUMaths.hpp>
+#include <new>
+#include <cstring>
+
+namespace tau::ir::ssa {
+
+static uPtr AlignPointer(const uPtr pointer, const uSys alignment) noexcept
+{
+    return (pointer + (alignment - 1)) & ~static_cast<uPtr>(alignment - 1);
+}
+
+// Keeps the first allocation in each chunk at the default new alignment.
+static constexpr uSys ChunkHeaderSize = (sizeof(void*) + sizeof(uSys) + alignof(::std::max_align_t) - 1) & ~(alignof(::std::max_align_t) - 1);
+
+SsaArena::SsaArena(const uSys initialChunkSize) noexcept
+    : m_Head(nullptr)
+    , m_Current(0)
+    , m_End(0)
+    , m_LastAllocation(0)
+    , m_ChunkSize(maxT(initialChunkSize, static_cast<uSys>(256)))
+    , m_BytesReserved(0)
+    , m_HeapAllocationCount(0)
+{ }
+
+SsaArena::~SsaArena() noexcept
+{
+    FreeChunks();
+}
+
+void* SsaArena::Allocate(const uSys size, const uSys alignment) noexcept
+{
+    uPtr aligned = AlignPointer(m_Current, alignment);
+
+    if(!m_Head || aligned + size > m_End)
+    {
+        // Double the chunk size each time we run out, the chunk count stays logarithmic in the total size.
+        const uSys chunkSize = m_Head ? maxT(m_ChunkSize * 2, size + alignment) : maxT(m_ChunkSize, size + alignment);
+
+        if(!NewChunk(chunkSize))
+        {
+            return nullptr;
+        }
+
+        aligned = AlignPointer(m_Current, alignment);
+    }
+
+    m_Current = aligned + size;
+    m_LastAllocation = aligned;
+    return reinterpret_cast<void*>(aligned);
+}
+
+void* SsaArena::Reallocate(void* const pointer, const uSys oldSize, const uSys newSize, const uSys alignment) noexcept
+{
+    if(!pointer)
+    {
+        return Allocate(newSize, alignment);
+    }
+
+    const uPtr address = reinterpret_cast<uPtr>(pointer);
+
+    if(address == m_LastAllocation && address + newSize <= m_End)
+    {
+        m_Current = address + newSize;
+        return pointer;
+    }
+
+    void* const newPointer = Allocate(newSize, alignment);
+
+    if(!newPointer)
+    {
+        return nullptr;
+    }
+
+    (void) ::std::memcpy(newPointer, pointer, minT(oldSize, newSize));
+    return newPointer;
+}
+
+void SsaArena::Deallocate(void* const pointer, const uSys size) noexcept
+{
+    const uPtr address = reinterpret_cast<uPtr>(pointer);
+
+    if(address == m_LastAllocation && address + size == m_Current)
+    {
+        m_Current = address;
+        m_LastAllocation = 0;
+    }
+}
+
+void SsaArena::Reset() noexcept
+{
+    m_LastAllocation = 0;
+
+    if(!m_Head)
+    {
+        return;
+    }
+
+    if(m_Head->Previous)
+    {
+        // Merge everything into one chunk so the next use fits without allocating.
+        const uSys totalSize = m_BytesReserved;
+        FreeChunks();
+        m_ChunkSize = totalSize;
+        (void) NewChunk(totalSize);
+        return;
+    }
+
+    m_Current = reinterpret_cast<uPtr>(m_Head) + ChunkHeaderSize;
+}
+
+bool SsaArena::NewChunk(const uSys size) noexcept
+{
+    u8* const block = new(::std::nothrow) u8[ChunkHeaderSize + size];
+
+    if(!block)
+    {
+        return false;
+    }
+
+    Chunk* const chunk = reinterpret_cast<Chunk*>(block);
+    chunk->Previous = m_Head;
+    chunk->Size = size;
+
+    m_Head = chunk;
+    m_Current = reinterpret_cast<uPtr>(block) + ChunkHeaderSize;
+    m_End = m_Current + size;
+    m_ChunkSize = maxT(m_ChunkSize, size);
+    m_BytesReserved += size;
+    ++m_HeapAllocationCount;
+
+    return true;
+}
+
+void SsaArena::FreeChunks() noexcept
+{
+    while(m_Head)
+    {
+        Chunk* const previous = m_Head->Previous;
+        delete[] reinterpret_cast<u8*>(m_Head);
+        m_Head = previous;
+    }
+
+    m_Current = 0;
+    m_End = 0;
+    m_BytesReserved = 0;
+}
+
+}
@@ -0,0 +1,259 @@
+#include "TauIR/ssa/SsaCallGraph.hpp"
+#include <algorithm>
+
+#include "TauIR/Function.hpp"
+#include "TauIR/ssa/SsaVisitor.hpp"
+
+namespace tau::ir::ssa {
+
+// ReSharper disable CppHidingFunction
+class SsaCallSiteCollector final : public SsaVisitor<SsaCallSiteCollector>
+{
+    DEFAULT_DESTRUCT(SsaCallSiteCollector);
+    DELETE_CM(SsaCallSiteCollector);
+public:
+    SsaCallSiteCollector(const SsaCustomTypeRegistry& registry, ::std::vector<u32>& callees) noexcept
+        : SsaVisitor(registry)
+        , m_Callees(callees)
+        , m_CallsIndirectly(false)
+    { }
+
+    [[nodiscard]] bool CallsIndirectly() const noexcept { return m_CallsIndirectly; }
+public:
+    bool PreTraversal(const u8* const codePtr, const uSys size, const VarId maxId) noexcept
+    {
+        m_CallsIndirectly = false;
+        return true;
+    }
+
+    bool VisitCall(const VarId newVar, const u32 functionIndex, const VarId baseIndex, const u32 parameterCount) noexcept
+    {
+        m_Callees.push_back(functionIndex);
+        return true;
+    }
+
+    bool VisitCallInd(const VarId newVar, const VarId functionPointer, const VarId baseIndex, const u32 parameterCount) noexcept
+    {
+        m_CallsIndirectly = true;
+        return true;
+    }
+
+    // The module pointer may well be this module.
+    bool VisitCallIndExt(const VarId newVar, const VarId functionPointer, const VarId baseIndex, const u32 parameterCount, const VarId modulePointer) noexcept
+    {
+        m_CallsIndirectly = true;
+        return true;
+    }
+private:
+    ::std::vector<u32>& m_Callees;
+    bool m_CallsIndirectly;
+};
+
+void SsaCallGraph::Build(const ModuleRef& module, const SsaCustomTypeRegistry& registry) noexcept
+{
+    const u32 functionCount = static_cast<u32>(module->Functions().Count());
+
+    m_CalleeOffsets.clear();
+    m_Callees.clear();
+    m_CalleeOffsets.reserve(static_cast<uSys>(functionCount) + 1);
+    m_CalleeOffsets.push_back(0);
+    m_CallsIndirectly.assign(functionCount, 0);
+
+    SsaCallSiteCollector collector(registry, m_Callees);
+
+    for(u32 i = 0; i < functionCount; ++i)
+    {
+        const uSys rowBegin = m_Callees.size();
+
+        // Without SSA there is no telling what the function calls.
+        if(!collector.Traverse(module->Functions()[i]) || collector.CallsIndirectly())
+        {
+            m_CallsIndirectly[i] = 1;
+        }
+
+        // Calls outside of the module can't be part of the graph.
+        const auto rowEnd = ::std::remove_if(m_Callees.begin() + static_cast<iSys>(rowBegin), m_Callees.end(), [functionCount](const u32 callee) { return callee >= functionCount; });
+        ::std::sort(m_Callees.begin() + static_cast<iSys>(rowBegin), rowEnd);
+        m_Callees.erase(::std::unique(m_Callees.begin() + static_cast<iSys>(rowBegin), rowEnd), m_Callees.end());
+
+        m_CalleeOffsets.push_back(static_cast<u32>(m_Callees.size()));
+    }
+
+    ComputeComponents();
+    ComputeReachable(module);
+}
+
+bool SsaCallGraph::IsRecursive(const u32 function) const noexcept
+{
+    if(function >= FunctionCount())
+    {
+        return false;
+    }
+
+    for(const u32* callee = CalleesBegin(function); callee != CalleesEnd(function); ++callee)
+    {
+        if(m_Components[*callee] == m_Components[function])
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+::std::vector<u32> SsaCallGraph::CompactedIndices() const noexcept
+{
+    ::std::vector<u32> indices(FunctionCount(), InvalidIndex);
+    u32 nextIndex = 0;
+
+    for(u32 i = 0; i < FunctionCount(); ++i)
+    {
+        if(m_Reachable[i])
+        {
+            indices[i] = nextIndex++;
+        }
+    }
+
+    return indices;
+}
+
+void SsaCallGraph::ComputeReachable(const ModuleRef& module) noexcept
+{
+    const u32 functionCount = FunctionCount();
+
+    m_Reachable.assign(functionCount, 0);
+    m_ReachableCount = 0;
+
+    ::std::vector<u32> worklist;
+
+    const auto reach = [&](const u32 function)
+    {
+        if(function < functionCount && !m_Reachable[function])
+        {
+            m_Reachable[function] = 1;
+            ++m_ReachableCount;
+            worklist.push_back(function);
+        }
+    };
+
+    // The emulator starts at the first function, everything else has to be called or exported.
+    reach(0);
+
+    for(const Function* const exported : module->Exports())
+    {
+        const auto found = ::std::find(module->Functions().begin(), module->Functions().end(), exported);
+        reach(static_cast<u32>(found - module->Functions().begin()));
+    }
+
+    while(!worklist.empty())
+    {
+        const u32 function = worklist.back();
+        worklist.pop_back();
+
+        if(m_CallsIndirectly[function])
+        {
+            // Any function could be behind the pointer.
+            for(u32 i = 0; i < functionCount; ++i)
+            {
+                reach(i);
+            }
+
+            break;
+        }
+
+        for(const u32* callee = CalleesBegin(function); callee != CalleesEnd(function); ++callee)
+        {
+            reach(*callee);
+        }
+    }
+}
+
+void SsaCallGraph::ComputeComponents() noexcept
+{
+    // Tarjan's algorithm with an explicit stack, call chains can be far deeper than the native stack.
+    struct Frame final
+    {
+        u32 Function;
+        u32 NextCallee;
+    };
+
+    const u32 functionCount = static_cast<u32>(m_CalleeOffsets.size() - 1);
+
+    m_Components.assign(functionCount, InvalidIndex);
+    m_BottomUpOrder.clear();
+    m_BottomUpOrder.reserve(functionCount);
+    m_ComponentCount = 0;
+
+    ::std::vector<u32> indices(functionCount, InvalidIndex);
+    ::std::vector<u32> lowLinks(functionCount, 0);
+    ::std::vector<u8> onStack(functionCount, 0);
+    ::std::vector<u32> stack;
+    ::std::vector<Frame> frames;
+    u32 nextIndex = 0;
+
+    for(u32 root = 0; root < functionCount; ++root)
+    {
+        if(indices[root] != InvalidIndex)
+        {
+            continue;
+        }
+
+        indices[root] = lowLinks[root] = nextIndex++;
+        stack.push_back(root);
+        onStack[root] = 1;
+        frames.push_back({ root, m_CalleeOffsets[root] });
+
+        while(!frames.empty())
+        {
+            Frame& frame = frames.back();
+            const u32 function = frame.Function;
+
+            if(frame.NextCallee < m_CalleeOffsets[function + 1])
+            {
+                const u32 callee = m_Callees[frame.NextCallee++];
+
+                if(indices[callee] == InvalidIndex)
+                {
+                    indices[callee] = lowLinks[callee] = nextIndex++;
+                    stack.push_back(callee);
+                    onStack[callee] = 1;
+                    frames.push_back({ callee, m_CalleeOffsets[callee] });
+                }
+                else if(onStack[callee])
+                {
+                    lowLinks[function] = ::std::min(lowLinks[function], indices[callee]);
+                }
+
+                continue;
+            }
+
+            frames.pop_back();
+
+            if(!frames.empty())
+            {
+                const u32 caller = frames.back().Function;
+                lowLinks[caller] = ::std::min(lowLinks[caller], lowLinks[function]);
+            }
+
+            if(lowLinks[function] != indices[function])
+            {
+                continue;
+            }
+
+            // Components are completed callees first, which is already bottom up.
+            u32 member;
+            do
+            {
+                member = stack.back();
+                stack.pop_back();
+                onStack[member] = 0;
+                m_Components[member] = m_ComponentCount;
+                m_BottomUpOrder.push_back(member);
+            } while(member != function);
+
+            ++m_ComponentCount;
+        }
+    }
+}
+
+}
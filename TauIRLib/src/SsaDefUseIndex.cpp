@@ -0,0 +1,65 @@
+#include "TauIR/ssa/SsaDefUseIndex.hpp"
+
+namespace tau::ir::ssa {
+
+void SsaDefUseIndex::Reset(const VarId maxId) noexcept
+{
+    m_MaxVarId = maxId;
+    m_Offsets.clear();
+    m_Users.clear();
+    m_PendingUses.clear();
+}
+
+void SsaDefUseIndex::AddUse(const VarId var, const VarId user) noexcept
+{
+    if((var & 0x80000000) != 0 || var > m_MaxVarId)
+    {
+        return;
+    }
+
+    m_PendingUses.push_back({ var, user });
+}
+
+void SsaDefUseIndex::Build() noexcept
+{
+    m_Offsets.assign(static_cast<uSys>(m_MaxVarId) + 2, 0);
+    m_Users.resize(m_PendingUses.size());
+
+    // Count into the slot after each var, the prefix sum then gives each row its start.
+    for(const PendingUse& use : m_PendingUses)
+    {
+        ++m_Offsets[use.Var + 1];
+    }
+
+    for(uSys i = 1; i < m_Offsets.size(); ++i)
+    {
+        m_Offsets[i] += m_Offsets[i - 1];
+    }
+
+    // Fill each row from its start, the cursor ends up at the start of the next row.
+    ::std::vector<u32> cursors(m_Offsets.begin(), m_Offsets.end() - 1);
+
+    for(const PendingUse& use : m_PendingUses)
+    {
+        m_Users[cursors[use.Var]++] = use.User;
+    }
+
+    m_PendingUses.clear();
+}
+
+bool SsaDefUseIndex::IsRoot(const VarId var) const noexcept
+{
+    const VarId* const end = UsersEnd(var);
+
+    for(const VarId* user = UsersBegin(var); user != end; ++user)
+    {
+        if(*user == var)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+}
@@ -85,6 +85,8 @@ void tau::ir::ssa::SsaEmulator::Execute(const Function* function, const Module*
                 break;
             case SsaOpcode::Ret:
                 break;
+            case SsaOpcode::Phi:
+                break;
             default: return;
         }
     }
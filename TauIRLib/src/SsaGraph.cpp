@@ -0,0 +1,757 @@
+#include "TauIR/ssa/SsaGraph.hpp"
+#include <cstring>
+
+#include "TauIR/Function.hpp"
+#include "TauIR/ssa/SsaVisitor.hpp"
+
+namespace tau::ir::ssa {
+
+// ReSharper disable CppHidingFunction
+class SsaGraphDecoder final : public SsaVisitor<SsaGraphDecoder>
+{
+    DEFAULT_DESTRUCT(SsaGraphDecoder);
+    DELETE_CM(SsaGraphDecoder);
+public:
+    SsaGraphDecoder(SsaGraph& graph, const SsaCustomTypeRegistry& registry) noexcept
+        : SsaVisitor(registry)
+        , m_Graph(graph)
+    { }
+public:
+    bool PreTraversal(const u8* const codePtr, const uSys size, const VarId maxId) noexcept
+    {
+        m_Graph.Clear();
+        m_Graph.m_MaxVarId = maxId;
+        m_Graph.m_EncodedSize = size;
+
+        // Roughly one instruction per var, with a couple of operands each.
+        m_Graph.m_Opcodes.reserve(maxId);
+        m_Graph.m_Operands.reserve(maxId * 2);
+        return true;
+    }
+
+    bool VisitNop() noexcept
+    {
+        (void) m_Graph.AddInstruction(SsaOpcode::Nop, 0, 0);
+        return true;
+    }
+
+    bool VisitLabel(const VarId label) noexcept
+    {
+        const u32 inst = m_Graph.AddInstruction(SsaOpcode::Label, label, 1);
+        m_Graph.m_Types[inst] = SsaType::Void;
+        return true;
+    }
+
+    bool VisitAssignImmediate(const VarId newVar, const SsaCustomType type, const void* const value, const uSys size) noexcept
+    {
+        const u32 inst = m_Graph.AddInstruction(SsaOpcode::AssignImmediate, newVar, 1);
+        m_Graph.m_Types[inst] = type;
+        m_Graph.AddImmediate(value, static_cast<u32>(size));
+        return true;
+    }
+
+    bool VisitAssignVar(const VarId newVar, const SsaCustomType type, const VarId var) noexcept
+    {
+        const u32 inst = m_Graph.AddInstruction(SsaOpcode::AssignVariable, newVar, 1);
+        m_Graph.m_Types[inst] = type;
+        m_Graph.AddOperand(var);
+        return true;
+    }
+
+    bool VisitExpandSX(const VarId newVar, const SsaCustomType newType, const SsaCustomType oldType, const VarId var) noexcept
+    {
+        return Cast(SsaOpcode::ExpandSX, newVar, newType, oldType, var);
+    }
+
+    bool VisitExpandZX(const VarId newVar, const SsaCustomType newType, const SsaCustomType oldType, const VarId var) noexcept
+    {
+        return Cast(SsaOpcode::ExpandZX, newVar, newType, oldType, var);
+    }
+
+    bool VisitTrunc(const VarId newVar, const SsaCustomType newType, const SsaCustomType oldType, const VarId var) noexcept
+    {
+        return Cast(SsaOpcode::Trunc, newVar, newType, oldType, var);
+    }
+
+    bool VisitRCast(const VarId newVar, const SsaCustomType newType, const SsaCustomType oldType, const VarId var) noexcept
+    {
+        return Cast(SsaOpcode::RCast, newVar, newType, oldType, var);
+    }
+
+    bool VisitBCast(const VarId newVar, const SsaCustomType newType, const SsaCustomType oldType, const VarId var) noexcept
+    {
+        return Cast(SsaOpcode::BCast, newVar, newType, oldType, var);
+    }
+
+    bool VisitLoad(const VarId newVar, const SsaCustomType type, const VarId var) noexcept
+    {
+        const u32 inst = m_Graph.AddInstruction(SsaOpcode::Load, newVar, 1);
+        m_Graph.m_Types[inst] = type;
+        m_Graph.AddOperand(var);
+        return true;
+    }
+
+    bool VisitStoreV(const SsaCustomType type, const VarId destination, const VarId source) noexcept
+    {
+        const u32 inst = m_Graph.AddInstruction(SsaOpcode::StoreV, 0, 0);
+        m_Graph.m_Types[inst] = type;
+        m_Graph.AddOperand(destination);
+        m_Graph.AddOperand(source);
+        return true;
+    }
+
+    bool VisitStoreI(const SsaCustomType type, const VarId destination, const void* const value, const uSys size) noexcept
+    {
+        const u32 inst = m_Graph.AddInstruction(SsaOpcode::StoreI, 0, 0);
+        m_Graph.m_Types[inst] = type;
+        m_Graph.AddOperand(destination);
+        m_Graph.AddImmediate(value, static_cast<u32>(size));
+        return true;
+    }
+
+    bool VisitComputePtr(const VarId newVar, const VarId base, const VarId index, const i8 multiplier, const i16 offset) noexcept
+    {
+        const u32 inst = m_Graph.AddInstruction(SsaOpcode::ComputePtr, newVar, 1);
+        m_Graph.m_Types[inst] = AddPointer(SsaType::Void);
+        m_Graph.AddOperand(base);
+        m_Graph.AddOperand(index);
+
+        u8 displacement[sizeof(multiplier) + sizeof(offset)];
+        (void) ::std::memcpy(displacement, &multiplier, sizeof(multiplier));
+        (void) ::std::memcpy(displacement + sizeof(multiplier), &offset, sizeof(offset));
+        m_Graph.AddImmediate(displacement, sizeof(displacement));
+        return true;
+    }
+
+    bool VisitBinOpVToV(const VarId newVar, const SsaBinaryOperation operation, const SsaCustomType type, const VarId a, const VarId b) noexcept
+    {
+        Operation(SsaOpcode::BinOpVtoV, newVar, static_cast<u8>(operation), type);
+        m_Graph.AddOperand(a);
+        m_Graph.AddOperand(b);
+        return true;
+    }
+
+    bool VisitBinOpVToI(const VarId newVar, const SsaBinaryOperation operation, const SsaCustomType type, const void* const a, const uSys aSize, const VarId b) noexcept
+    {
+        Operation(SsaOpcode::BinOpVtoI, newVar, static_cast<u8>(operation), type);
+        m_Graph.AddOperand(b);
+        m_Graph.AddImmediate(a, static_cast<u32>(aSize));
+        return true;
+    }
+
+    bool VisitBinOpIToV(const VarId newVar, const SsaBinaryOperation operation, const SsaCustomType type, const VarId a, const void* const b, const uSys bSize) noexcept
+    {
+        Operation(SsaOpcode::BinOpItoV, newVar, static_cast<u8>(operation), type);
+        m_Graph.AddOperand(a);
+        m_Graph.AddImmediate(b, static_cast<u32>(bSize));
+        return true;
+    }
+
+    bool VisitSplit(const VarId baseIndex, const SsaCustomType aType, const VarId a, const uSys splitCount, const SsaCustomType* const splitTypes) noexcept
+    {
+        const u32 inst = m_Graph.AddInstruction(SsaOpcode::Split, baseIndex, static_cast<u32>(splitCount));
+        m_Graph.m_Types[inst] = aType;
+        m_Graph.m_TypeListBegins[inst] = static_cast<u32>(m_Graph.m_TypePool.size());
+        m_Graph.m_TypePool.insert(m_Graph.m_TypePool.end(), splitTypes, splitTypes + splitCount);
+        m_Graph.AddOperand(a);
+        return true;
+    }
+
+    bool VisitJoin(const VarId newVar, const SsaCustomType newType, const uSys joinCount, const SsaCustomType* const joinTypes, const VarId* const joinVars) noexcept
+    {
+        const u32 inst = m_Graph.AddInstruction(SsaOpcode::Join, newVar, 1);
+        m_Graph.m_Types[inst] = newType;
+        m_Graph.m_TypeListBegins[inst] = static_cast<u32>(m_Graph.m_TypePool.size());
+        m_Graph.m_TypePool.insert(m_Graph.m_TypePool.end(), joinTypes, joinTypes + joinCount);
+
+        for(uSys i = 0; i < joinCount; ++i)
+        {
+            m_Graph.AddOperand(joinVars[i]);
+        }
+
+        return true;
+    }
+
+    bool VisitCompVToV(const VarId newVar, const CompareCondition operation, const SsaCustomType type, const VarId a, const VarId b) noexcept
+    {
+        Operation(SsaOpcode::CompVtoV, newVar, static_cast<u8>(operation), type);
+        m_Graph.AddOperand(a);
+        m_Graph.AddOperand(b);
+        return true;
+    }
+
+    bool VisitCompVToI(const VarId newVar, const CompareCondition operation, const SsaCustomType type, const void* const a, const uSys aSize, const VarId b) noexcept
+    {
+        Operation(SsaOpcode::CompVtoI, newVar, static_cast<u8>(operation), type);
+        m_Graph.AddOperand(b);
+        m_Graph.AddImmediate(a, static_cast<u32>(aSize));
+        return true;
+    }
+
+    bool VisitCompIToV(const VarId newVar, const CompareCondition operation, const SsaCustomType type, const VarId a, const void* const b, const uSys bSize) noexcept
+    {
+        Operation(SsaOpcode::CompItoV, newVar, static_cast<u8>(operation), type);
+        m_Graph.AddOperand(a);
+        m_Graph.AddImmediate(b, static_cast<u32>(bSize));
+        return true;
+    }
+
+    bool VisitBranch(const VarId label) noexcept
+    {
+        (void) m_Graph.AddInstruction(SsaOpcode::Branch, 0, 0);
+        m_Graph.AddOperand(label);
+        return true;
+    }
+
+    bool VisitBranchCond(const VarId labelTrue, const VarId labelFalse, const VarId conditionVar) noexcept
+    {
+        (void) m_Graph.AddInstruction(SsaOpcode::BranchCond, 0, 0);
+        m_Graph.AddOperand(labelTrue);
+        m_Graph.AddOperand(labelFalse);
+        m_Graph.AddOperand(conditionVar);
+        return true;
+    }
+
+    bool VisitCall(const VarId newVar, const u32 functionIndex, const VarId baseIndex, const u32 parameterCount) noexcept
+    {
+        const u32 inst = Call(SsaOpcode::Call, newVar);
+        m_Graph.m_FunctionIndices[inst] = functionIndex;
+        AddParameters(baseIndex, parameterCount);
+        return true;
+    }
+
+    bool VisitCallExt(const VarId newVar, const u32 functionIndex, const VarId baseIndex, const u32 parameterCount, const u16 moduleIndex) noexcept
+    {
+        const u32 inst = Call(SsaOpcode::CallExt, newVar);
+        m_Graph.m_FunctionIndices[inst] = functionIndex;
+        m_Graph.m_ModuleIndices[inst] = moduleIndex;
+        AddParameters(baseIndex, parameterCount);
+        return true;
+    }
+
+    bool VisitCallInd(const VarId newVar, const VarId functionPointer, const VarId baseIndex, const u32 parameterCount) noexcept
+    {
+        (void) Call(SsaOpcode::CallInd, newVar);
+        m_Graph.AddOperand(functionPointer);
+        AddParameters(baseIndex, parameterCount);
+        return true;
+    }
+
+    bool VisitCallIndExt(const VarId newVar, const VarId functionPointer, const VarId baseIndex, const u32 parameterCount, const VarId modulePointer) noexcept
+    {
+        (void) Call(SsaOpcode::CallIndExt, newVar);
+        m_Graph.AddOperand(functionPointer);
+        m_Graph.AddOperand(modulePointer);
+        AddParameters(baseIndex, parameterCount);
+        return true;
+    }
+
+    bool VisitRet(const SsaCustomType returnType, const VarId var) noexcept
+    {
+        const u32 inst = m_Graph.AddInstruction(SsaOpcode::Ret, 0, 0);
+        m_Graph.m_Types[inst] = returnType;
+        m_Graph.AddOperand(var);
+        return true;
+    }
+
+    bool VisitPhi(const VarId newVar, const SsaCustomType type, const uSys incomingCount, const VarId* const labels, const VarId* const vars) noexcept
+    {
+        const u32 inst = m_Graph.AddInstruction(SsaOpcode::Phi, newVar, 1);
+        m_Graph.m_Types[inst] = type;
+
+        for(uSys i = 0; i < incomingCount; ++i)
+        {
+            m_Graph.AddOperand(labels[i]);
+        }
+
+        for(uSys i = 0; i < incomingCount; ++i)
+        {
+            m_Graph.AddOperand(vars[i]);
+        }
+
+        return true;
+    }
+
+    bool PostTraversal() noexcept
+    {
+        m_Graph.RebuildBlocks();
+        return true;
+    }
+private:
+    [[nodiscard]] bool Cast(const SsaOpcode opcode, const VarId newVar, const SsaCustomType newType, const SsaCustomType oldType, const VarId var) noexcept
+    {
+        const u32 inst = m_Graph.AddInstruction(opcode, newVar, 1);
+        m_Graph.m_Types[inst] = newType;
+        m_Graph.m_SourceTypes[inst] = oldType;
+        m_Graph.AddOperand(var);
+        return true;
+    }
+
+    void Operation(const SsaOpcode opcode, const VarId newVar, const u8 operation, const SsaCustomType type) noexcept
+    {
+        const u32 inst = m_Graph.AddInstruction(opcode, newVar, 1);
+        m_Graph.m_Operations[inst] = operation;
+        m_Graph.m_Types[inst] = type;
+    }
+
+    [[nodiscard]] u32 Call(const SsaOpcode opcode, const VarId newVar) noexcept
+    {
+        const u32 inst = m_Graph.AddInstruction(opcode, newVar, 1);
+        // The return value of a call is always read from a full register.
+        m_Graph.m_Types[inst] = SsaType::U64;
+        return inst;
+    }
+
+    void AddParameters(const VarId baseIndex, const u32 parameterCount) noexcept
+    {
+        for(u32 i = 0; i < parameterCount; ++i)
+        {
+            m_Graph.AddOperand(baseIndex + i);
+        }
+    }
+private:
+    SsaGraph& m_Graph;
+};
+
+bool SsaGraph::Decode(const u8* const codePtr, const uSys size, const VarId maxId, const SsaCustomTypeRegistry& registry) noexcept
+{
+    SsaGraphDecoder decoder(*this, registry);
+    return decoder.Traverse(codePtr, size, maxId);
+}
+
+bool SsaGraph::Decode(const Function* const function, const SsaCustomTypeRegistry& registry) noexcept
+{
+    SsaGraphDecoder decoder(*this, registry);
+    return decoder.Traverse(function);
+}
+
+bool SsaGraph::Encode(SsaWriter& writer) const noexcept
+{
+    return EncodeInOrder(writer, nullptr, InstructionCount());
+}
+
+bool SsaGraph::Encode(SsaWriter& writer, const ::std::vector<u32>& order) const noexcept
+{
+    return EncodeInOrder(writer, order.data(), static_cast<u32>(order.size()));
+}
+
+bool SsaGraph::EncodeInOrder(SsaWriter& writer, const u32* const order, const u32 count) const noexcept
+{
+    constexpr VarId InvalidVar = static_cast<VarId>(-1);
+    constexpr VarId ArgumentVarFlag = 0x80000000;
+
+    // The new ids are known up front, so forward references to labels and loop phis don't need patching.
+    ::std::vector<VarId> newVars(static_cast<uSys>(m_MaxVarId) + 1, InvalidVar);
+    newVars[0] = 0;
+
+    VarId idIndex = writer.IdIndex();
+
+    for(u32 n = 0; n < count; ++n)
+    {
+        const u32 inst = order ? order[n] : n;
+
+        if(m_Opcodes[inst] == SsaOpcode::Nop || m_ResultCounts[inst] == 0)
+        {
+            continue;
+        }
+
+        for(u32 i = 0; i < m_ResultCounts[inst]; ++i)
+        {
+            newVars[m_Results[inst] + i] = ++idIndex;
+        }
+    }
+
+    const auto map = [&](const VarId var) -> VarId
+    {
+        if(var & ArgumentVarFlag)
+        {
+            return var;
+        }
+
+        return var < newVars.size() ? newVars[var] : InvalidVar;
+    };
+
+    ::std::vector<VarId> operands;
+
+    for(u32 n = 0; n < count; ++n)
+    {
+        const u32 inst = order ? order[n] : n;
+        const SsaOpcode opcode = m_Opcodes[inst];
+
+        if(opcode == SsaOpcode::Nop)
+        {
+            continue;
+        }
+
+        operands.resize(m_OperandCounts[inst]);
+
+        for(u32 i = 0; i < m_OperandCounts[inst]; ++i)
+        {
+            operands[i] = map(Operand(inst, i));
+
+            if(operands[i] == InvalidVar)
+            {
+                return false;
+            }
+        }
+
+        const SsaCustomType type = m_Types[inst];
+        const void* const immediate = Immediate(inst);
+        const uSys immediateSize = m_ImmediateSizes[inst];
+
+        VarId baseIndex = writer.IdIndex() + 1;
+
+        if(opcode == SsaOpcode::Call || opcode == SsaOpcode::CallExt || opcode == SsaOpcode::CallInd || opcode == SsaOpcode::CallIndExt)
+        {
+            const u32 parameterOffset = ParameterOffset(inst);
+
+            if(m_OperandCounts[inst] > parameterOffset)
+            {
+                baseIndex = operands[parameterOffset];
+            }
+
+            // The parameters are encoded as a range of vars.
+            for(u32 i = parameterOffset; i < m_OperandCounts[inst]; ++i)
+            {
+                if(operands[i] != baseIndex + (i - parameterOffset))
+                {
+                    return false;
+                }
+            }
+        }
+
+        switch(opcode)
+        {
+            case SsaOpcode::Label: (void) writer.WriteLabel(); break;
+            case SsaOpcode::AssignImmediate: (void) writer.WriteAssignImmediate(type, immediate, immediateSize); break;
+            case SsaOpcode::AssignVariable: (void) writer.WriteAssignVariable(type, operands[0]); break;
+            case SsaOpcode::ExpandSX: (void) writer.WriteExpandSX(type, m_SourceTypes[inst], operands[0]); break;
+            case SsaOpcode::ExpandZX: (void) writer.WriteExpandZX(type, m_SourceTypes[inst], operands[0]); break;
+            case SsaOpcode::Trunc: (void) writer.WriteTrunc(type, m_SourceTypes[inst], operands[0]); break;
+            case SsaOpcode::RCast: (void) writer.WriteRCast(type, m_SourceTypes[inst], operands[0]); break;
+            case SsaOpcode::BCast: (void) writer.WriteBCast(type, m_SourceTypes[inst], operands[0]); break;
+            case SsaOpcode::Load: (void) writer.WriteLoad(type, operands[0]); break;
+            case SsaOpcode::StoreV: writer.WriteStoreV(type, operands[0], operands[1]); break;
+            case SsaOpcode::StoreI: writer.WriteStoreI(type, operands[0], immediate, immediateSize); break;
+            case SsaOpcode::ComputePtr:
+            {
+                i8 multiplier;
+                i16 offset;
+                (void) ::std::memcpy(&multiplier, immediate, sizeof(multiplier));
+                (void) ::std::memcpy(&offset, static_cast<const u8*>(immediate) + sizeof(multiplier), sizeof(offset));
+                (void) writer.WriteComputePtr(operands[0], operands[1], multiplier, offset);
+                break;
+            }
+            case SsaOpcode::BinOpVtoV: (void) writer.WriteBinOpVtoV(BinaryOperation(inst), type, operands[0], operands[1]); break;
+            case SsaOpcode::BinOpVtoI: (void) writer.WriteBinOpVtoI(BinaryOperation(inst), type, immediate, immediateSize, operands[0]); break;
+            case SsaOpcode::BinOpItoV: (void) writer.WriteBinOpItoV(BinaryOperation(inst), type, operands[0], immediate, immediateSize); break;
+            case SsaOpcode::Split: (void) writer.WriteSplit(type, operands[0], m_ResultCounts[inst], TypeList(inst)); break;
+            case SsaOpcode::Join: (void) writer.WriteJoin(type, m_OperandCounts[inst], TypeList(inst), operands.data()); break;
+            case SsaOpcode::CompVtoV: (void) writer.WriteCompVtoV(Condition(inst), type, operands[0], operands[1]); break;
+            case SsaOpcode::CompVtoI: (void) writer.WriteCompVtoI(Condition(inst), type, immediate, immediateSize, operands[0]); break;
+            case SsaOpcode::CompItoV: (void) writer.WriteCompItoV(Condition(inst), type, operands[0], immediate, immediateSize); break;
+            case SsaOpcode::Branch: writer.WriteBranch(operands[0]); break;
+            case SsaOpcode::BranchCond: writer.WriteBranchCond(operands[0], operands[1], operands[2]); break;
+            case SsaOpcode::Call: (void) writer.WriteCall(m_FunctionIndices[inst], baseIndex, ParameterCount(inst)); break;
+            case SsaOpcode::CallExt: (void) writer.WriteCallExt(m_FunctionIndices[inst], baseIndex, ParameterCount(inst), m_ModuleIndices[inst]); break;
+            case SsaOpcode::CallInd: (void) writer.WriteCallInd(operands[0], baseIndex, ParameterCount(inst)); break;
+            case SsaOpcode::CallIndExt: (void) writer.WriteCallIndExt(operands[0], baseIndex, ParameterCount(inst), operands[1]); break;
+            case SsaOpcode::Ret: writer.WriteRet(type, operands[0]); break;
+            case SsaOpcode::Phi:
+            {
+                const u32 incomingCount = m_OperandCounts[inst] / 2;
+                (void) writer.WritePhi(type, incomingCount, operands.data(), operands.data() + incomingCount);
+                break;
+            }
+            default: return false;
+        }
+    }
+
+    return true;
+}
+
+void SsaGraph::RebuildBlocks() noexcept
+{
+    m_Blocks.clear();
+    m_Edges.clear();
+    m_InstBlocks.resize(m_Opcodes.size());
+    m_LabelBlocks.assign(static_cast<uSys>(m_MaxVarId) + 1, InvalidIndex);
+    m_VarDefs.assign(static_cast<uSys>(m_MaxVarId) + 1, InvalidIndex);
+
+    for(u32 inst = 0; inst < m_Opcodes.size(); ++inst)
+    {
+        if(inst == 0 || m_Opcodes[inst] == SsaOpcode::Label)
+        {
+            if(!m_Blocks.empty())
+            {
+                m_Blocks.back().End = inst;
+            }
+
+            Block block { };
+            block.Begin = inst;
+            block.Label = m_Opcodes[inst] == SsaOpcode::Label ? m_Results[inst] : 0;
+            m_Blocks.push_back(block);
+
+            if(block.Label != 0)
+            {
+                m_LabelBlocks[block.Label] = static_cast<u32>(m_Blocks.size() - 1);
+            }
+        }
+
+        m_InstBlocks[inst] = static_cast<u32>(m_Blocks.size() - 1);
+
+        if(m_Opcodes[inst] != SsaOpcode::Nop)
+        {
+            for(u32 i = 0; i < m_ResultCounts[inst]; ++i)
+            {
+                m_VarDefs[m_Results[inst] + i] = inst;
+            }
+        }
+    }
+
+    if(!m_Blocks.empty())
+    {
+        m_Blocks.back().End = static_cast<u32>(m_Opcodes.size());
+    }
+
+    ::std::vector<u32> predecessorCounts(m_Blocks.size(), 0);
+
+    for(Block& block : m_Blocks)
+    {
+        block.SuccessorBegin = static_cast<u32>(m_Edges.size());
+
+        u32 last = block.End;
+
+        // Removed instructions can trail the terminator.
+        while(last > block.Begin && m_Opcodes[last - 1] == SsaOpcode::Nop)
+        {
+            --last;
+        }
+
+        if(last > block.Begin)
+        {
+            const u32 inst = last - 1;
+            const u32 labelCount = m_Opcodes[inst] == SsaOpcode::Branch ? 1 : m_Opcodes[inst] == SsaOpcode::BranchCond ? 2 : 0;
+
+            for(u32 i = 0; i < labelCount; ++i)
+            {
+                const u32 successor = LabelBlock(Operand(inst, i));
+
+                if(successor != InvalidIndex)
+                {
+                    m_Edges.push_back(successor);
+                    ++predecessorCounts[successor];
+                }
+            }
+        }
+
+        block.SuccessorCount = static_cast<u32>(m_Edges.size()) - block.SuccessorBegin;
+    }
+
+    // The predecessors follow the successors in the edge pool.
+    for(uSys i = 0; i < m_Blocks.size(); ++i)
+    {
+        m_Blocks[i].PredecessorBegin = static_cast<u32>(m_Edges.size());
+        m_Blocks[i].PredecessorCount = 0;
+        m_Edges.resize(m_Edges.size() + predecessorCounts[i]);
+    }
+
+    for(u32 b = 0; b < m_Blocks.size(); ++b)
+    {
+        for(u32 i = 0; i < m_Blocks[b].SuccessorCount; ++i)
+        {
+            Block& successor = m_Blocks[m_Edges[m_Blocks[b].SuccessorBegin + i]];
+            m_Edges[successor.PredecessorBegin + successor.PredecessorCount++] = b;
+        }
+    }
+}
+
+void SsaGraph::Clear() noexcept
+{
+    m_Opcodes.clear();
+    m_Operations.clear();
+    m_Types.clear();
+    m_SourceTypes.clear();
+    m_Results.clear();
+    m_ResultCounts.clear();
+    m_OperandBegins.clear();
+    m_OperandCounts.clear();
+    m_TypeListBegins.clear();
+    m_ImmediateBegins.clear();
+    m_ImmediateSizes.clear();
+    m_FunctionIndices.clear();
+    m_ModuleIndices.clear();
+    m_InstBlocks.clear();
+    m_Operands.clear();
+    m_TypePool.clear();
+    m_ImmediatePool.clear();
+    m_Blocks.clear();
+    m_Edges.clear();
+    m_LabelBlocks.clear();
+    m_VarDefs.clear();
+    m_MaxVarId = 0;
+    m_EncodedSize = 0;
+}
+
+SsaCustomType SsaGraph::VarType(const VarId var) const noexcept
+{
+    // Argument registers are always read whole.
+    if(var & 0x80000000)
+    {
+        return SsaType::U64;
+    }
+
+    const u32 inst = Definition(var);
+
+    if(inst == InvalidIndex)
+    {
+        return SsaType::Void;
+    }
+
+    if(m_Opcodes[inst] == SsaOpcode::Split)
+    {
+        return TypeList(inst)[var - m_Results[inst]];
+    }
+
+    return m_Types[inst];
+}
+
+void SsaGraph::SetOperands(const u32 inst, const VarId* const vars, const u32 count) noexcept
+{
+    if(count > m_OperandCounts[inst])
+    {
+        m_OperandBegins[inst] = static_cast<u32>(m_Operands.size());
+        m_Operands.resize(m_Operands.size() + count);
+    }
+
+    (void) ::std::memcpy(m_Operands.data() + m_OperandBegins[inst], vars, count * sizeof(VarId));
+    m_OperandCounts[inst] = count;
+}
+
+void SsaGraph::SetImmediate(const u32 inst, const void* const value, const u32 size) noexcept
+{
+    if(size > m_ImmediateSizes[inst])
+    {
+        m_ImmediateBegins[inst] = static_cast<u32>(m_ImmediatePool.size());
+        m_ImmediatePool.resize(m_ImmediatePool.size() + size);
+    }
+
+    (void) ::std::memcpy(m_ImmediatePool.data() + m_ImmediateBegins[inst], value, size);
+    m_ImmediateSizes[inst] = size;
+}
+
+u32 SsaGraph::ReplaceAllUses(const VarId from, const VarId to) noexcept
+{
+    u32 count = 0;
+
+    for(u32 inst = 0; inst < m_Opcodes.size(); ++inst)
+    {
+        if(m_Opcodes[inst] == SsaOpcode::Nop)
+        {
+            continue;
+        }
+
+        // Labels are operands of branches and phis, but they are never replaced by values.
+        u32 begin = 0;
+        u32 end = m_OperandCounts[inst];
+
+        switch(m_Opcodes[inst])
+        {
+            case SsaOpcode::Branch: end = 0; break;
+            case SsaOpcode::BranchCond: begin = 2; break;
+            case SsaOpcode::Phi: begin = end / 2; break;
+            default: break;
+        }
+
+        for(u32 i = begin; i < end; ++i)
+        {
+            VarId& operand = m_Operands[m_OperandBegins[inst] + i];
+
+            if(operand == from)
+            {
+                operand = to;
+                ++count;
+            }
+        }
+    }
+
+    return count;
+}
+
+void SsaGraph::MakeAssignVariable(const u32 inst, const VarId var) noexcept
+{
+    m_Opcodes[inst] = SsaOpcode::AssignVariable;
+    m_Types[inst] = VarType(m_Results[inst]);
+    m_ImmediateSizes[inst] = 0;
+    SetOperands(inst, &var, 1);
+}
+
+void SsaGraph::MakeAssignImmediate(const u32 inst, const void* const value, const u32 size) noexcept
+{
+    m_Opcodes[inst] = SsaOpcode::AssignImmediate;
+    m_Types[inst] = VarType(m_Results[inst]);
+    m_OperandCounts[inst] = 0;
+    SetImmediate(inst, value, size);
+}
+
+VarId SsaGraph::AppendAssignImmediate(const SsaCustomType type, const void* const value, const u32 size) noexcept
+{
+    const VarId var = ++m_MaxVarId;
+    const u32 inst = AddInstruction(SsaOpcode::AssignImmediate, var, 1);
+    m_Types[inst] = type;
+    AddImmediate(value, size);
+
+    m_InstBlocks.push_back(InvalidIndex);
+    m_LabelBlocks.push_back(InvalidIndex);
+    m_VarDefs.push_back(inst);
+
+    return var;
+}
+
+void SsaGraph::Remove(const u32 inst) noexcept
+{
+    m_Opcodes[inst] = SsaOpcode::Nop;
+    m_OperandCounts[inst] = 0;
+
+    for(u32 i = 0; i < m_ResultCounts[inst]; ++i)
+    {
+        if(m_Results[inst] + i < m_VarDefs.size())
+        {
+            m_VarDefs[m_Results[inst] + i] = InvalidIndex;
+        }
+    }
+}
+
+u32 SsaGraph::AddInstruction(const SsaOpcode opcode, const VarId result, const u32 resultCount) noexcept
+{
+    m_Opcodes.push_back(opcode);
+    m_Operations.push_back(0);
+    m_Types.emplace_back(SsaType::Void);
+    m_SourceTypes.emplace_back(SsaType::Void);
+    m_Results.push_back(result);
+    m_ResultCounts.push_back(resultCount);
+    m_OperandBegins.push_back(static_cast<u32>(m_Operands.size()));
+    m_OperandCounts.push_back(0);
+    m_TypeListBegins.push_back(0);
+    m_ImmediateBegins.push_back(static_cast<u32>(m_ImmediatePool.size()));
+    m_ImmediateSizes.push_back(0);
+    m_FunctionIndices.push_back(0);
+    m_ModuleIndices.push_back(0);
+    return static_cast<u32>(m_Opcodes.size() - 1);
+}
+
+void SsaGraph::AddOperand(const VarId var) noexcept
+{
+    m_Operands.push_back(var);
+    ++m_OperandCounts.back();
+}
+
+void SsaGraph::AddImmediate(const void* const value, const u32 size) noexcept
+{
+    const uSys begin = m_ImmediatePool.size();
+    m_ImmediatePool.resize(begin + size);
+    (void) ::std::memcpy(m_ImmediatePool.data() + begin, value, size);
+    m_ImmediateSizes.back() = size;
+}
+
+}
@@ -0,0 +1,385 @@
+#include "TauIR/ssa/SsaLivenessAnalysis.hpp"
+
+#include <algorithm>
+
+namespace tau::ir::ssa {
+
+u32 SsaLivenessAnalysisAttachment::BlockOf(const u32 instruction) const noexcept
+{
+    // The last block starting at or before the instruction.
+    const auto next = ::std::upper_bound(m_BlockStarts.begin(), m_BlockStarts.end(), instruction);
+    return next == m_BlockStarts.begin() ? 0 : static_cast<u32>(next - m_BlockStarts.begin() - 1);
+}
+
+bool SsaLivenessAnalysisAttachment::IsKilled(const u32 instruction, const VarId var) const noexcept
+{
+    const VarId* const end = KillsEnd(instruction);
+
+    for(const VarId* kill = KillsBegin(instruction); kill != end; ++kill)
+    {
+        if(*kill == var)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void SsaLivenessAnalysisVisitor::UpdateAttachment(Function* const function) noexcept
+{
+    if(function->FindAttachment<SsaLivenessAnalysisAttachment>())
+    {
+        function->RemoveAttachment<SsaLivenessAnalysisAttachment>();
+    }
+
+    function->Attach<SsaLivenessAnalysisAttachment>(m_MaxVarId, ::std::move(m_BlockStarts), ::std::move(m_LiveIn), ::std::move(m_LiveOut), ::std::move(m_KillOffsets), ::std::move(m_Kills));
+}
+
+bool SsaLivenessAnalysisVisitor::PreTraversal(const u8* const codePtr, const uSys size, const VarId maxId) noexcept
+{
+    m_MaxVarId = maxId;
+    m_WordCount = SsaLivenessAnalysisAttachment::WordCount(maxId);
+    m_InstructionCount = 0;
+    m_IterationCount = 0;
+    m_Terminated = false;
+
+    m_BlockStarts.clear();
+    m_LabelBlocks.assign(static_cast<uSys>(maxId) + 1, static_cast<u32>(-1));
+    m_Edges.clear();
+    m_FallsThrough.clear();
+    m_SuccessorOffsets.clear();
+    m_Successors.clear();
+
+    m_UseOffsets.clear();
+    m_Uses.clear();
+    m_DefBegins.clear();
+    m_DefCounts.clear();
+    m_PhiUses.clear();
+
+    m_KillOffsets.clear();
+    m_Kills.clear();
+
+    return true;
+}
+
+bool SsaLivenessAnalysisVisitor::PostTraversal() noexcept
+{
+    m_UseOffsets.push_back(static_cast<u32>(m_Uses.size()));
+
+    BuildSuccessors();
+    ComputeLocalSets();
+    SolveDataFlow();
+    ComputeKills();
+
+    return true;
+}
+
+bool SsaLivenessAnalysisVisitor::VisitLabel(const VarId label) noexcept
+{
+    StartBlock();
+
+    if(IsTracked(label))
+    {
+        m_LabelBlocks[label] = BlockCount() - 1;
+    }
+
+    AddInstruction();
+    return true;
+}
+
+bool SsaLivenessAnalysisVisitor::VisitBranch(const VarId label) noexcept
+{
+    BeginInstruction();
+    m_Edges.push_back({ BlockCount() - 1, label });
+    m_Terminated = true;
+    return true;
+}
+
+bool SsaLivenessAnalysisVisitor::VisitBranchCond(const VarId labelTrue, const VarId labelFalse, const VarId conditionVar) noexcept
+{
+    BeginInstruction();
+    Use(conditionVar);
+    m_Edges.push_back({ BlockCount() - 1, labelTrue });
+    m_Edges.push_back({ BlockCount() - 1, labelFalse });
+    m_Terminated = true;
+    return true;
+}
+
+bool SsaLivenessAnalysisVisitor::VisitPhi(const VarId newVar, const SsaCustomType type, const uSys incomingCount, const VarId* const labels, const VarId* const vars) noexcept
+{
+    BeginInstruction();
+
+    for(uSys i = 0; i < incomingCount; ++i)
+    {
+        if(IsTracked(vars[i]))
+        {
+            m_PhiUses.push_back({ labels[i], vars[i] });
+        }
+    }
+
+    Define(newVar, 1);
+    return true;
+}
+
+void SsaLivenessAnalysisVisitor::BeginInstruction() noexcept
+{
+    // Code after a terminator can only be reached through a label, but it still needs a block.
+    if(m_BlockStarts.empty() || m_Terminated)
+    {
+        StartBlock();
+    }
+
+    AddInstruction();
+}
+
+void SsaLivenessAnalysisVisitor::AddInstruction() noexcept
+{
+    m_UseOffsets.push_back(static_cast<u32>(m_Uses.size()));
+    m_DefBegins.push_back(0);
+    m_DefCounts.push_back(0);
+    ++m_InstructionCount;
+}
+
+void SsaLivenessAnalysisVisitor::StartBlock() noexcept
+{
+    if(!m_BlockStarts.empty() && !m_Terminated)
+    {
+        m_FallsThrough.back() = 1;
+    }
+
+    m_BlockStarts.push_back(m_InstructionCount);
+    m_FallsThrough.push_back(0);
+    m_Terminated = false;
+}
+
+void SsaLivenessAnalysisVisitor::Use(const VarId var) noexcept
+{
+    if(IsTracked(var))
+    {
+        m_Uses.push_back(var);
+    }
+}
+
+void SsaLivenessAnalysisVisitor::UseParameters(const VarId baseIndex, const u32 parameterCount) noexcept
+{
+    for(u32 i = 0; i < parameterCount; ++i)
+    {
+        Use(baseIndex + i);
+    }
+}
+
+void SsaLivenessAnalysisVisitor::Define(const VarId firstVar, const u32 count) noexcept
+{
+    if(!IsTracked(firstVar))
+    {
+        return;
+    }
+
+    m_DefBegins.back() = firstVar;
+    m_DefCounts.back() = ::std::min<u32>(count, m_MaxVarId - firstVar + 1);
+}
+
+void SsaLivenessAnalysisVisitor::BuildSuccessors() noexcept
+{
+    const u32 blockCount = BlockCount();
+
+    m_SuccessorOffsets.assign(static_cast<uSys>(blockCount) + 1, 0);
+
+    for(const Edge& edge : m_Edges)
+    {
+        if(IsTracked(edge.Label) && m_LabelBlocks[edge.Label] != static_cast<u32>(-1))
+        {
+            ++m_SuccessorOffsets[edge.Block + 1];
+        }
+    }
+
+    for(u32 block = 0; block < blockCount; ++block)
+    {
+        if(m_FallsThrough[block])
+        {
+            ++m_SuccessorOffsets[block + 1];
+        }
+    }
+
+    for(u32 block = 0; block < blockCount; ++block)
+    {
+        m_SuccessorOffsets[block + 1] += m_SuccessorOffsets[block];
+    }
+
+    m_Successors.resize(m_SuccessorOffsets[blockCount]);
+
+    ::std::vector<u32> cursors(m_SuccessorOffsets.begin(), m_SuccessorOffsets.end() - 1);
+
+    for(const Edge& edge : m_Edges)
+    {
+        if(IsTracked(edge.Label) && m_LabelBlocks[edge.Label] != static_cast<u32>(-1))
+        {
+            m_Successors[cursors[edge.Block]++] = m_LabelBlocks[edge.Label];
+        }
+    }
+
+    for(u32 block = 0; block < blockCount; ++block)
+    {
+        if(m_FallsThrough[block])
+        {
+            m_Successors[cursors[block]++] = block + 1;
+        }
+    }
+}
+
+void SsaLivenessAnalysisVisitor::ComputeLocalSets() noexcept
+{
+    const uSys setSize = static_cast<uSys>(BlockCount()) * m_WordCount;
+
+    m_UpwardUses.assign(setSize, 0);
+    m_Defs.assign(setSize, 0);
+    m_PhiOuts.assign(setSize, 0);
+
+    for(u32 block = 0; block < BlockCount(); ++block)
+    {
+        u64* const upwardUses = Row(m_UpwardUses, block);
+        u64* const defs = Row(m_Defs, block);
+        const u32 end = block + 1 < BlockCount() ? m_BlockStarts[block + 1] : m_InstructionCount;
+
+        for(u32 instruction = m_BlockStarts[block]; instruction < end; ++instruction)
+        {
+            // The operands are read before the result is written.
+            for(u32 i = m_UseOffsets[instruction]; i < m_UseOffsets[instruction + 1]; ++i)
+            {
+                if(!Contains(defs, m_Uses[i]))
+                {
+                    Insert(upwardUses, m_Uses[i]);
+                }
+            }
+
+            for(u32 i = 0; i < m_DefCounts[instruction]; ++i)
+            {
+                Insert(defs, m_DefBegins[instruction] + i);
+            }
+        }
+    }
+
+    for(const PhiUse& use : m_PhiUses)
+    {
+        if(IsTracked(use.Label) && m_LabelBlocks[use.Label] != static_cast<u32>(-1))
+        {
+            Insert(Row(m_PhiOuts, m_LabelBlocks[use.Label]), use.Var);
+        }
+    }
+}
+
+void SsaLivenessAnalysisVisitor::SolveDataFlow() noexcept
+{
+    const uSys setSize = static_cast<uSys>(BlockCount()) * m_WordCount;
+
+    m_LiveIn.assign(setSize, 0);
+    m_LiveOut.assign(setSize, 0);
+
+    // Successors mostly follow their block, so walking backwards settles most functions in a couple of rounds.
+    bool changed;
+    do
+    {
+        changed = false;
+        ++m_IterationCount;
+
+        for(u32 block = BlockCount(); block-- > 0;)
+        {
+            u64* const liveIn = Row(m_LiveIn, block);
+            u64* const liveOut = Row(m_LiveOut, block);
+            const u64* const upwardUses = Row(m_UpwardUses, block);
+            const u64* const defs = Row(m_Defs, block);
+            const u64* const phiOuts = Row(m_PhiOuts, block);
+
+            for(u32 word = 0; word < m_WordCount; ++word)
+            {
+                u64 out = phiOuts[word];
+
+                for(u32 i = m_SuccessorOffsets[block]; i < m_SuccessorOffsets[block + 1]; ++i)
+                {
+                    out |= Row(m_LiveIn, m_Successors[i])[word];
+                }
+
+                const u64 in = upwardUses[word] | (out & ~defs[word]);
+
+                if(out != liveOut[word] || in != liveIn[word])
+                {
+                    liveOut[word] = out;
+                    liveIn[word] = in;
+                    changed = true;
+                }
+            }
+        }
+    } while(changed);
+}
+
+void SsaLivenessAnalysisVisitor::ComputeKills() noexcept
+{
+    struct PendingKill final
+    {
+        u32 Instruction;
+        VarId Var;
+    };
+
+    ::std::vector<PendingKill> pendingKills;
+    ::std::vector<u64> live(m_WordCount);
+
+    for(u32 block = 0; block < BlockCount(); ++block)
+    {
+        const u64* const liveOut = Row(m_LiveOut, block);
+        ::std::copy(liveOut, liveOut + m_WordCount, live.begin());
+
+        const u32 end = block + 1 < BlockCount() ? m_BlockStarts[block + 1] : m_InstructionCount;
+
+        for(u32 instruction = end; instruction-- > m_BlockStarts[block];)
+        {
+            // A result that is not live after its definition is never used.
+            for(u32 i = 0; i < m_DefCounts[instruction]; ++i)
+            {
+                const VarId var = m_DefBegins[instruction] + i;
+
+                if(!Contains(live.data(), var))
+                {
+                    pendingKills.push_back({ instruction, var });
+                }
+
+                Erase(live.data(), var);
+            }
+
+            // An operand that is not live after the instruction is used here for the last time.
+            for(u32 i = m_UseOffsets[instruction]; i < m_UseOffsets[instruction + 1]; ++i)
+            {
+                const VarId var = m_Uses[i];
+
+                if(!Contains(live.data(), var))
+                {
+                    pendingKills.push_back({ instruction, var });
+                    Insert(live.data(), var);
+                }
+            }
+        }
+    }
+
+    // The blocks are in order but each is walked backwards, bucket the kills by instruction.
+    m_KillOffsets.assign(static_cast<uSys>(m_InstructionCount) + 1, 0);
+    m_Kills.resize(pendingKills.size());
+
+    for(const PendingKill& kill : pendingKills)
+    {
+        ++m_KillOffsets[kill.Instruction + 1];
+    }
+
+    for(u32 i = 0; i < m_InstructionCount; ++i)
+    {
+        m_KillOffsets[i + 1] += m_KillOffsets[i];
+    }
+
+    ::std::vector<u32> cursors(m_KillOffsets.begin(), m_KillOffsets.end() - 1);
+
+    for(const PendingKill& kill : pendingKills)
+    {
+        m_Kills[cursors[kill.Instruction]++] = kill.Var;
+    }
+}
+
+}
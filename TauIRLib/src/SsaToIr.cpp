@@ -0,0 +1,2589 @@
+#include "TauIR/SsaToIr.hpp"
+#include <algorithm>
+#include <cstring>
+#include <vector>
+#include <TUMaths.hpp>
+
+#include "TauIR/Function.hpp"
+#include "TauIR/IrGenerator.hpp"
+#include "TauIR/Module.hpp"
+#include "TauIR/TypeInfo.hpp"
+#include "TauIR/ssa/SsaVisitor.hpp"
+
+namespace tau::ir {
+
+namespace {
+
+using VarId = ssa::VarId;
+
+// All of the scratch state of a lowering lives in the arena.
+template<typename T>
+using ArenaVector = ::std::vector<T, ssa::SsaArenaAllocator<T>>;
+
+constexpr u32 InvalidIndex = static_cast<u32>(-1);
+constexpr VarId InvalidVar = static_cast<VarId>(-1);
+constexpr u16 NoRegister = static_cast<u16>(-1);
+
+// Argument registers are referenced by setting the high bit of the var.
+constexpr VarId ArgumentVarFlag = 0x80000000;
+
+// Pointers in the SSA are always 8 bytes.
+constexpr u32 PointerSize = 8;
+
+// Jumps are a single byte opcode followed by an i32 offset from the end of the instruction.
+constexpr uSys JumpInstructionSize = 5;
+
+enum class LowerOp : u8
+{
+    Label,
+    Phi,
+    Expand,
+    Trunc,
+    BinOp,
+    Comp,
+    Split,
+    Join,
+    Call,
+    Load,
+    Store,
+    ComputePtr,
+    Branch,
+    BranchCond,
+    Ret
+};
+
+enum class CallKind : u8
+{
+    Call,
+    CallExt,
+    CallInd,
+    CallIndExt
+};
+
+enum class VarKind : u8
+{
+    None,
+    // Produced by an instruction.
+    Value,
+    Phi,
+    // The value of an argument register on entry to the function.
+    Argument,
+    // Rematerialized at every use, an immediate never takes a local.
+    Immediate,
+    // A copy of another var, these are resolved away before scheduling.
+    Alias
+};
+
+struct LowerVar final
+{
+    VarKind Kind = VarKind::None;
+    // The value stays on the execution stack between its definition and its only use.
+    bool OnStack = false;
+    // The value can never stay on the stack.
+    bool ForceSlot = false;
+    u32 Size = 0;
+    // The instruction that defines the var.
+    u32 Def = InvalidIndex;
+    u32 Uses = 0;
+    // Uses that can take the value straight from the stack.
+    u32 StackUses = 0;
+    // The last instruction to use the var.
+    u32 UseInst = InvalidIndex;
+    VarId Alias = 0;
+    u64 Immediate = 0;
+    u32 Slot = InvalidIndex;
+    u32 LiveIndex = InvalidIndex;
+};
+
+struct LowerInst final
+{
+    LowerOp Op;
+    bool Live;
+    // The sign of an expansion, or how narrow operands are widened.
+    bool Signed;
+    // An SsaBinaryOperation, CompareCondition or CallKind.
+    u8 Operation;
+    u32 Size;
+    u32 ToSize;
+    VarId Result;
+    u32 ResultCount;
+    // Operands are listed in the order they are pushed.
+    u32 OperandBegin;
+    u32 OperandCount;
+    // Only this many leading operands can be taken from the stack.
+    u32 MatchableCount;
+    // The leading operands that are already on the stack.
+    u32 StackOperands;
+    // The function of a call, the target label of a branch, or the first label of a phi.
+    u32 Target;
+    // The label taken when the condition of a branch is false.
+    u32 FalseTarget;
+    u16 Module;
+    // The function index local of an indirect call.
+    VarId Pointer;
+    // The module index of an indirect external call.
+    VarId ModuleVar;
+    // The scale of the index and the constant offset of a computed pointer.
+    i8 Multiplier;
+    i16 Offset;
+};
+
+struct LowerBlock final
+{
+    u32 Begin;
+    u32 End;
+    VarId Label;
+    u32 Successors[2];
+    u32 SuccessorCount;
+    // The phi copies on each outgoing edge.
+    u32 CopyBegin[2];
+    u32 CopyCount[2];
+};
+
+struct PhiCopy final
+{
+    VarId Phi;
+    VarId Value;
+};
+
+struct ActiveSlot final
+{
+    u32 End;
+    u32 Slot;
+};
+
+struct JumpPatch final
+{
+    uSys Offset;
+    u32 Block;
+};
+
+[[nodiscard]] bool IsFloatType(const ssa::SsaType type) noexcept
+{
+    return type == ssa::SsaType::F16 || type == ssa::SsaType::F32 || type == ssa::SsaType::F64;
+}
+
+[[nodiscard]] bool IsSignedType(const ssa::SsaType type) noexcept
+{
+    return type == ssa::SsaType::I8 || type == ssa::SsaType::I16 || type == ssa::SsaType::I32 || type == ssa::SsaType::I64;
+}
+
+[[nodiscard]] bool IsSignedCondition(const CompareCondition condition) noexcept
+{
+    switch(condition)
+    {
+        case CompareCondition::Greater:
+        case CompareCondition::GreaterOrEqual:
+        case CompareCondition::Less:
+        case CompareCondition::LessOrEqual:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// The sizes a local can have, and the sizes the emulator can operate on.
+[[nodiscard]] u32 SizeClass(const u32 size) noexcept
+{
+    switch(size)
+    {
+        case 1: return 0;
+        case 2: return 1;
+        case 4: return 2;
+        case 8: return 3;
+        default: return InvalidIndex;
+    }
+}
+
+[[nodiscard]] const TypeInfo* SizeClassType(const u32 size) noexcept
+{
+    switch(size)
+    {
+        case 1: return &TypeInfo::U8;
+        case 2: return &TypeInfo::U16;
+        case 4: return &TypeInfo::U32;
+        default: return &TypeInfo::U64;
+    }
+}
+
+/**
+ *   Copies the IR of a function that can't be lowered. Functions that
+ * only exist as SSA have nothing to copy.
+ */
+[[nodiscard]] Function* CopyFunction(const Function* const function) noexcept
+{
+    if(!function->Address() || function->CodeSize() == 0)
+    {
+        return nullptr;
+    }
+
+    IrWriter writer(function->CodeSize());
+    writer.WriteCode(function->Address(), function->CodeSize());
+
+    const u8* const address = writer.Buffer();
+    const uSys codeSize = writer.Size();
+
+    return FunctionBuilder()
+        .Address(address)
+        .CodeSize(codeSize)
+        .LocalTypes(function->LocalTypes())
+        .Arguments(function->Arguments())
+        .Flags(function->Flags())
+        .Name(function->Name())
+        .Attachment<IrWriterFunctionAttachment>(::std::move(writer))
+        .Build();
+}
+
+}
+
+// ReSharper disable CppHidingFunction
+class SsaToIrVisitor final : public ssa::SsaVisitor<SsaToIrVisitor>
+{
+    DEFAULT_DESTRUCT(SsaToIrVisitor);
+    DELETE_CM(SsaToIrVisitor);
+public:
+    SsaToIrVisitor(const Function* const function, const ModuleRef& module, const ssa::SsaCustomTypeRegistry& registry, ssa::SsaArena& arena) noexcept
+        : SsaVisitor(registry)
+        , m_Function(function)
+        , m_Module(module)
+        , m_Vars(&arena)
+        , m_Insts(&arena)
+        , m_Operands(&arena)
+        , m_OperandSizes(&arena)
+        , m_OperandRegisters(&arena)
+        , m_PhiLabels(&arena)
+        , m_Blocks(&arena)
+        , m_InstBlocks(&arena)
+        , m_LabelBlocks(&arena)
+        , m_Copies(&arena)
+        , m_Stack(&arena)
+        , m_SlotSizes(&arena)
+        , m_BlockOffsets(&arena)
+        , m_JumpPatches(&arena)
+        , m_Arena(&arena)
+        , m_ArgumentBase(0)
+        , m_ScratchSlots { InvalidIndex, InvalidIndex, InvalidIndex, InvalidIndex }
+        , m_AddressSlot(InvalidIndex)
+        , m_Unreachable(false)
+    { }
+
+    /**
+     *   Runs every stage of the lowering once the SSA has been
+     * traversed. Returns false if anything can't be lowered.
+     */
+    [[nodiscard]] bool Lower() noexcept
+    {
+        return BuildBlocks()
+            && EliminateTrivialPhis()
+            && ResolveOperands()
+            && MarkLive()
+            && BuildCopies()
+            && CountUses()
+            && Schedule()
+            && AssignSlots()
+            && Emit();
+    }
+
+    [[nodiscard]] Function* BuildFunction() noexcept
+    {
+        DynArray<const TypeInfo*> localTypes(m_SlotSizes.size());
+
+        for(uSys i = 0; i < m_SlotSizes.size(); ++i)
+        {
+            localTypes[i] = SizeClassType(m_SlotSizes[i]);
+        }
+
+        const u8* const address = m_Writer.Buffer();
+        const uSys codeSize = m_Writer.Size();
+
+        return FunctionBuilder()
+            .Address(address)
+            .CodeSize(codeSize)
+            .LocalTypes(::std::move(localTypes))
+            .Arguments(m_Function->Arguments())
+            .Flags(m_Function->Flags())
+            .Name(m_Function->Name())
+            .Attachment<IrWriterFunctionAttachment>(::std::move(m_Writer))
+            .Build();
+    }
+public:
+    bool PreTraversal(const u8* const codePtr, const uSys size, const VarId maxId) noexcept
+    {
+        m_ArgumentBase = maxId + 1;
+        m_Vars.assign(m_ArgumentBase + MaxArgumentRegisters, LowerVar { });
+        m_LabelBlocks.assign(m_ArgumentBase, InvalidIndex);
+
+        // An undefined local, it can be anything, so zero is as good as any value.
+        m_Vars[0].Kind = VarKind::Immediate;
+
+        for(uSys i = 0; i < MaxArgumentRegisters; ++i)
+        {
+            m_Vars[m_ArgumentBase + i].Kind = VarKind::Argument;
+            m_Vars[m_ArgumentBase + i].Size = 8;
+        }
+
+        return true;
+    }
+
+    bool VisitLabel(const VarId label) noexcept
+    {
+        // Every block ends in a branch, falling into a label is made explicit to keep the edges uniform.
+        if(!m_Unreachable && !m_Insts.empty())
+        {
+            LowerInst& branch = NewInst(LowerOp::Branch);
+            branch.Target = label;
+        }
+
+        m_Unreachable = false;
+
+        LowerInst& inst = NewInst(LowerOp::Label);
+        inst.Result = label;
+        return true;
+    }
+
+    bool VisitAssignImmediate(const VarId newVar, const ssa::SsaCustomType type, const void* const value, const uSys size) noexcept
+    {
+        if(size > sizeof(u64) || newVar >= m_ArgumentBase)
+        {
+            return false;
+        }
+
+        LowerVar& var = m_Vars[newVar];
+        var.Kind = VarKind::Immediate;
+        var.Size = static_cast<u32>(size);
+        (void) ::std::memcpy(&var.Immediate, value, size);
+        return true;
+    }
+
+    bool VisitAssignVar(const VarId newVar, const ssa::SsaCustomType type, const VarId var) noexcept
+    {
+        return DefineAlias(newVar, var);
+    }
+
+    bool VisitExpandSX(const VarId newVar, const ssa::SsaCustomType newType, const ssa::SsaCustomType oldType, const VarId var) noexcept
+    {
+        return Resize(LowerOp::Expand, true, newVar, newType, oldType, var);
+    }
+
+    bool VisitExpandZX(const VarId newVar, const ssa::SsaCustomType newType, const ssa::SsaCustomType oldType, const VarId var) noexcept
+    {
+        return Resize(LowerOp::Expand, false, newVar, newType, oldType, var);
+    }
+
+    bool VisitTrunc(const VarId newVar, const ssa::SsaCustomType newType, const ssa::SsaCustomType oldType, const VarId var) noexcept
+    {
+        return Resize(LowerOp::Trunc, false, newVar, newType, oldType, var);
+    }
+
+    bool VisitRCast(const VarId newVar, const ssa::SsaCustomType newType, const ssa::SsaCustomType oldType, const VarId var) noexcept
+    {
+        // The stack is untyped, only casts that keep the size are free.
+        return TypeSize(newType) == TypeSize(oldType) && DefineAlias(newVar, var);
+    }
+
+    bool VisitBCast(const VarId newVar, const ssa::SsaCustomType newType, const ssa::SsaCustomType oldType, const VarId var) noexcept
+    {
+        return TypeSize(newType) == TypeSize(oldType) && DefineAlias(newVar, var);
+    }
+
+    /**
+     *   The IR only loads into a local from an address held in a local, so
+     * neither the address nor the loaded value can stay on the stack.
+     */
+    bool VisitLoad(const VarId newVar, const ssa::SsaCustomType type, const VarId var) noexcept
+    {
+        if(m_Unreachable)
+        {
+            return true;
+        }
+
+        const u32 size = TypeSize(type);
+
+        if(SizeClass(size) == InvalidIndex || newVar >= m_ArgumentBase)
+        {
+            return false;
+        }
+
+        const u32 index = static_cast<u32>(m_Insts.size());
+        LowerInst& inst = NewInst(LowerOp::Load);
+        inst.Size = size;
+        inst.Result = newVar;
+        inst.ResultCount = 1;
+
+        if(!AddOperand(inst, MapVar(var), PointerSize, false))
+        {
+            return false;
+        }
+
+        DefineValue(newVar, size, index);
+        m_Vars[newVar].ForceSlot = true;
+        return true;
+    }
+
+    bool VisitStoreV(const ssa::SsaCustomType type, const VarId destination, const VarId source) noexcept
+    {
+        return Store(type, MapVar(destination), MapVar(source));
+    }
+
+    bool VisitStoreI(const ssa::SsaCustomType type, const VarId destination, const void* const value, const uSys size) noexcept
+    {
+        return Store(type, MapVar(destination), NewImmediate(value, size));
+    }
+
+    bool VisitComputePtr(const VarId newVar, const VarId base, const VarId index, const i8 multiplier, const i16 offset) noexcept
+    {
+        if(m_Unreachable)
+        {
+            return true;
+        }
+
+        if(newVar >= m_ArgumentBase)
+        {
+            return false;
+        }
+
+        const u32 instIndex = static_cast<u32>(m_Insts.size());
+        LowerInst& inst = NewInst(LowerOp::ComputePtr);
+        inst.Size = PointerSize;
+        inst.Result = newVar;
+        inst.ResultCount = 1;
+        inst.Multiplier = multiplier;
+        inst.Offset = offset;
+
+        if(!AddOperand(inst, MapVar(base), PointerSize, true))
+        {
+            return false;
+        }
+
+        // Without a multiplier the index doesn't contribute anything.
+        if(multiplier != 0 && !AddOperand(inst, MapVar(index), PointerSize, true))
+        {
+            return false;
+        }
+
+        DefineValue(newVar, PointerSize, instIndex);
+        return true;
+    }
+
+    bool VisitBinOpVToV(const VarId newVar, const ssa::SsaBinaryOperation operation, const ssa::SsaCustomType type, const VarId a, const VarId b) noexcept
+    {
+        return BinOp(newVar, operation, type, MapVar(a), MapVar(b));
+    }
+
+    bool VisitBinOpVToI(const VarId newVar, const ssa::SsaBinaryOperation operation, const ssa::SsaCustomType type, const void* const a, const uSys aSize, const VarId b) noexcept
+    {
+        return BinOp(newVar, operation, type, NewImmediate(a, aSize), MapVar(b));
+    }
+
+    bool VisitBinOpIToV(const VarId newVar, const ssa::SsaBinaryOperation operation, const ssa::SsaCustomType type, const VarId a, const void* const b, const uSys bSize) noexcept
+    {
+        return BinOp(newVar, operation, type, MapVar(a), NewImmediate(b, bSize));
+    }
+
+    bool VisitSplit(const VarId baseIndex, const ssa::SsaCustomType aType, const VarId a, const uSys splitCount, const ssa::SsaCustomType* const splitTypes) noexcept
+    {
+        if(m_Unreachable)
+        {
+            return true;
+        }
+
+        const u32 size = TypeSize(aType);
+        u32 partsSize = 0;
+
+        for(uSys i = 0; i < splitCount; ++i)
+        {
+            partsSize += TypeSize(splitTypes[i]);
+        }
+
+        if(size == InvalidIndex || partsSize != size || baseIndex + splitCount > m_ArgumentBase)
+        {
+            return false;
+        }
+
+        const u32 index = static_cast<u32>(m_Insts.size());
+        LowerInst& inst = NewInst(LowerOp::Split);
+        inst.Size = size;
+        inst.Result = baseIndex;
+        inst.ResultCount = static_cast<u32>(splitCount);
+
+        if(!AddOperand(inst, MapVar(a), size, true))
+        {
+            return false;
+        }
+
+        for(uSys i = 0; i < splitCount; ++i)
+        {
+            // The parts are popped off the top, so only the highest part could ever be left on the stack.
+            DefineValue(baseIndex + static_cast<VarId>(i), TypeSize(splitTypes[i]), index);
+            m_Vars[baseIndex + i].ForceSlot = true;
+        }
+
+        return true;
+    }
+
+    bool VisitJoin(const VarId newVar, const ssa::SsaCustomType newType, const uSys joinCount, const ssa::SsaCustomType* const joinTypes, const VarId* const joinVars) noexcept
+    {
+        if(m_Unreachable)
+        {
+            return true;
+        }
+
+        const u32 size = TypeSize(newType);
+
+        if(size == InvalidIndex || newVar >= m_ArgumentBase)
+        {
+            return false;
+        }
+
+        const u32 index = static_cast<u32>(m_Insts.size());
+        LowerInst& inst = NewInst(LowerOp::Join);
+        inst.Size = size;
+        inst.Result = newVar;
+        inst.ResultCount = 1;
+
+        u32 partsSize = 0;
+
+        // The parts are ordered from the lowest byte, pushing them in order builds the joined value.
+        for(uSys i = 0; i < joinCount; ++i)
+        {
+            const u32 partSize = TypeSize(joinTypes[i]);
+            partsSize += partSize;
+
+            if(!AddOperand(inst, MapVar(joinVars[i]), partSize, true))
+            {
+                return false;
+            }
+        }
+
+        if(partsSize != size)
+        {
+            return false;
+        }
+
+        DefineValue(newVar, size, index);
+        return true;
+    }
+
+    bool VisitCompVToV(const VarId newVar, const CompareCondition operation, const ssa::SsaCustomType type, const VarId a, const VarId b) noexcept
+    {
+        return Comp(newVar, operation, type, MapVar(a), MapVar(b));
+    }
+
+    bool VisitCompVToI(const VarId newVar, const CompareCondition operation, const ssa::SsaCustomType type, const void* const a, const uSys aSize, const VarId b) noexcept
+    {
+        return Comp(newVar, operation, type, NewImmediate(a, aSize), MapVar(b));
+    }
+
+    bool VisitCompIToV(const VarId newVar, const CompareCondition operation, const ssa::SsaCustomType type, const VarId a, const void* const b, const uSys bSize) noexcept
+    {
+        return Comp(newVar, operation, type, MapVar(a), NewImmediate(b, bSize));
+    }
+
+    bool VisitBranch(const VarId label) noexcept
+    {
+        if(m_Unreachable)
+        {
+            return true;
+        }
+
+        LowerInst& inst = NewInst(LowerOp::Branch);
+        inst.Target = label;
+        m_Unreachable = true;
+        return true;
+    }
+
+    bool VisitBranchCond(const VarId labelTrue, const VarId labelFalse, const VarId conditionVar) noexcept
+    {
+        if(m_Unreachable)
+        {
+            return true;
+        }
+
+        LowerInst& inst = NewInst(LowerOp::BranchCond);
+        inst.Target = labelTrue;
+        inst.FalseTarget = labelFalse;
+        m_Unreachable = true;
+        return AddOperand(inst, MapVar(conditionVar), 1, true);
+    }
+
+    bool VisitCall(const VarId newVar, const u32 functionIndex, const VarId baseIndex, const u32 parameterCount) noexcept
+    {
+        if(functionIndex >= m_Module->Functions().count())
+        {
+            return false;
+        }
+
+        return Call(newVar, CallKind::Call, m_Module->Functions()[functionIndex], functionIndex, 0, baseIndex, parameterCount, 0, 0);
+    }
+
+    bool VisitCallExt(const VarId newVar, const u32 functionIndex, const VarId baseIndex, const u32 parameterCount, const u16 moduleIndex) noexcept
+    {
+        if(moduleIndex >= m_Module->Imports().count())
+        {
+            return false;
+        }
+
+        const Module* const targetModule = m_Module->Imports()[moduleIndex].Module().Get();
+
+        if(functionIndex >= targetModule->Functions().count())
+        {
+            return false;
+        }
+
+        return Call(newVar, CallKind::CallExt, targetModule->Functions()[functionIndex], functionIndex, moduleIndex, baseIndex, parameterCount, 0, 0);
+    }
+
+    bool VisitCallInd(const VarId newVar, const VarId functionPointer, const VarId baseIndex, const u32 parameterCount) noexcept
+    {
+        return Call(newVar, CallKind::CallInd, nullptr, 0, 0, baseIndex, parameterCount, MapVar(functionPointer), 0);
+    }
+
+    bool VisitCallIndExt(const VarId newVar, const VarId functionPointer, const VarId baseIndex, const u32 parameterCount, const VarId modulePointer) noexcept
+    {
+        return Call(newVar, CallKind::CallIndExt, nullptr, 0, 0, baseIndex, parameterCount, MapVar(functionPointer), MapVar(modulePointer));
+    }
+
+    bool VisitRet(const ssa::SsaCustomType returnType, const VarId var) noexcept
+    {
+        if(m_Unreachable)
+        {
+            return true;
+        }
+
+        const u32 size = TypeSize(returnType);
+
+        if(size > sizeof(u64) || SizeClass(size) == InvalidIndex)
+        {
+            return false;
+        }
+
+        LowerInst& inst = NewInst(LowerOp::Ret);
+        inst.Size = size;
+        m_Unreachable = true;
+        return AddOperand(inst, MapVar(var), size, true);
+    }
+
+    bool VisitPhi(const VarId newVar, const ssa::SsaCustomType type, const uSys incomingCount, const VarId* const labels, const VarId* const vars) noexcept
+    {
+        if(m_Unreachable)
+        {
+            return true;
+        }
+
+        const u32 size = TypeSize(type);
+
+        if(size == InvalidIndex || newVar >= m_ArgumentBase)
+        {
+            return false;
+        }
+
+        const u32 index = static_cast<u32>(m_Insts.size());
+        LowerInst& inst = NewInst(LowerOp::Phi);
+        inst.Size = size;
+        inst.Result = newVar;
+        inst.ResultCount = 1;
+        inst.Target = static_cast<u32>(m_PhiLabels.size());
+
+        for(uSys i = 0; i < incomingCount; ++i)
+        {
+            m_PhiLabels.push_back(labels[i]);
+
+            // Incoming values are moved by copies on the edges, never by the phi itself.
+            if(!AddOperand(inst, MapVar(vars[i]), size, false))
+            {
+                return false;
+            }
+        }
+
+        DefineValue(newVar, size, index);
+        m_Vars[newVar].Kind = VarKind::Phi;
+        return true;
+    }
+private:
+    [[nodiscard]] u32 TypeSize(const ssa::SsaCustomType type) const noexcept
+    {
+        if(!ssa::IsPointer(type.Type))
+        {
+            if(type.Type == ssa::SsaType::Bytes)
+            {
+                return type.CustomType;
+            }
+
+            if(type.Type == ssa::SsaType::Custom)
+            {
+                return static_cast<u32>(Registry()[type.CustomType].Size);
+            }
+        }
+
+        const uSys size = ssa::TypeValueSize(type.Type);
+        return size > sizeof(u64) ? InvalidIndex : static_cast<u32>(size);
+    }
+
+    [[nodiscard]] VarId MapVar(const VarId var) const noexcept
+    {
+        if(var & ArgumentVarFlag)
+        {
+            const VarId argument = var & ~ArgumentVarFlag;
+            return argument < MaxArgumentRegisters ? m_ArgumentBase + argument : InvalidVar;
+        }
+
+        return var < m_ArgumentBase ? var : InvalidVar;
+    }
+
+    [[nodiscard]] VarId NewImmediate(const void* const value, const uSys size) noexcept
+    {
+        if(size > sizeof(u64))
+        {
+            return InvalidVar;
+        }
+
+        LowerVar var;
+        var.Kind = VarKind::Immediate;
+        var.Size = static_cast<u32>(size);
+        (void) ::std::memcpy(&var.Immediate, value, size);
+
+        m_Vars.push_back(var);
+        return static_cast<VarId>(m_Vars.size() - 1);
+    }
+
+    [[nodiscard]] VarId Resolve(VarId var) const noexcept
+    {
+        while(m_Vars[var].Kind == VarKind::Alias)
+        {
+            var = m_Vars[var].Alias;
+        }
+
+        return var;
+    }
+
+    [[nodiscard]] bool IsSlotVar(const VarId var) const noexcept
+    {
+        return m_Vars[var].LiveIndex != InvalidIndex;
+    }
+
+    LowerInst& NewInst(const LowerOp op) noexcept
+    {
+        LowerInst inst { };
+        inst.Op = op;
+        inst.Live = true;
+        inst.Result = InvalidVar;
+        inst.OperandBegin = static_cast<u32>(m_Operands.size());
+        inst.Pointer = InvalidVar;
+        inst.ModuleVar = InvalidVar;
+        m_Insts.push_back(inst);
+        return m_Insts.back();
+    }
+
+    /**
+     *   Operands are appended in push order, matchable operands have to
+     * come first.
+     */
+    [[nodiscard]] bool AddOperand(LowerInst& inst, const VarId var, const u32 size, const bool matchable, const u16 argumentRegister = NoRegister) noexcept
+    {
+        if(var == InvalidVar || size == InvalidIndex)
+        {
+            return false;
+        }
+
+        m_Operands.push_back(var);
+        m_OperandSizes.push_back(size);
+        m_OperandRegisters.push_back(argumentRegister);
+        ++inst.OperandCount;
+
+        if(matchable)
+        {
+            ++inst.MatchableCount;
+        }
+
+        return true;
+    }
+
+    void DefineValue(const VarId var, const u32 size, const u32 inst) noexcept
+    {
+        m_Vars[var].Kind = VarKind::Value;
+        m_Vars[var].Size = size;
+        m_Vars[var].Def = inst;
+    }
+
+    [[nodiscard]] bool DefineAlias(const VarId newVar, const VarId var) noexcept
+    {
+        const VarId target = MapVar(var);
+
+        if(target == InvalidVar || newVar >= m_ArgumentBase)
+        {
+            return false;
+        }
+
+        m_Vars[newVar].Kind = VarKind::Alias;
+        m_Vars[newVar].Alias = target;
+        return true;
+    }
+
+    [[nodiscard]] bool Resize(const LowerOp op, const bool isSigned, const VarId newVar, const ssa::SsaCustomType newType, const ssa::SsaCustomType oldType, const VarId var) noexcept
+    {
+        if(m_Unreachable)
+        {
+            return true;
+        }
+
+        const u32 toSize = TypeSize(newType);
+        const u32 fromSize = TypeSize(oldType);
+
+        if(toSize == fromSize)
+        {
+            return DefineAlias(newVar, var);
+        }
+
+        if(SizeClass(toSize) == InvalidIndex || SizeClass(fromSize) == InvalidIndex || newVar >= m_ArgumentBase)
+        {
+            return false;
+        }
+
+        if(op == LowerOp::Expand ? fromSize > toSize : fromSize < toSize)
+        {
+            return false;
+        }
+
+        const u32 index = static_cast<u32>(m_Insts.size());
+        LowerInst& inst = NewInst(op);
+        inst.Signed = isSigned;
+        inst.Size = fromSize;
+        inst.ToSize = toSize;
+        inst.Result = newVar;
+        inst.ResultCount = 1;
+
+        if(!AddOperand(inst, MapVar(var), fromSize, true))
+        {
+            return false;
+        }
+
+        DefineValue(newVar, toSize, index);
+        return true;
+    }
+
+    /**
+     *   Operations on 1 and 2 byte values are widened to 4 bytes, each
+     * operand has to be widened right after it is pushed, so they can't
+     * be taken from the stack.
+     */
+    [[nodiscard]] bool BinOp(const VarId newVar, const ssa::SsaBinaryOperation operation, const ssa::SsaCustomType type, const VarId a, const VarId b) noexcept
+    {
+        if(m_Unreachable)
+        {
+            return true;
+        }
+
+        switch(operation)
+        {
+            case ssa::SsaBinaryOperation::Add:
+            case ssa::SsaBinaryOperation::Sub:
+            case ssa::SsaBinaryOperation::Mul:
+            case ssa::SsaBinaryOperation::Div:
+            case ssa::SsaBinaryOperation::Rem:
+            case ssa::SsaBinaryOperation::BitShiftLeft:
+            case ssa::SsaBinaryOperation::BitShiftRight:
+            case ssa::SsaBinaryOperation::MulHigh:
+                break;
+            default:
+                return false;
+        }
+
+        const u32 size = TypeSize(type);
+
+        if(IsFloatType(type.Type) || SizeClass(size) == InvalidIndex || newVar >= m_ArgumentBase)
+        {
+            return false;
+        }
+
+        // The high half of a widened product isn't the high half of the narrow one.
+        if(operation == ssa::SsaBinaryOperation::MulHigh && size < 4)
+        {
+            return false;
+        }
+
+        const u32 index = static_cast<u32>(m_Insts.size());
+        LowerInst& inst = NewInst(LowerOp::BinOp);
+        inst.Operation = static_cast<u8>(operation);
+        inst.Signed = IsSignedType(type.Type);
+        inst.Size = size;
+        inst.Result = newVar;
+        inst.ResultCount = 1;
+
+        // The left operand is taken from the top of the stack.
+        if(!AddOperand(inst, b, size, size >= 4) || !AddOperand(inst, a, size, size >= 4))
+        {
+            return false;
+        }
+
+        DefineValue(newVar, size, index);
+
+        // The remainder is on top of the quotient, it has to be popped to get rid of the quotient.
+        if(operation == ssa::SsaBinaryOperation::Rem)
+        {
+            m_Vars[newVar].ForceSlot = true;
+        }
+
+        return true;
+    }
+
+    [[nodiscard]] bool Comp(const VarId newVar, const CompareCondition condition, const ssa::SsaCustomType type, const VarId a, const VarId b) noexcept
+    {
+        if(m_Unreachable)
+        {
+            return true;
+        }
+
+        const u32 size = TypeSize(type);
+
+        if(IsFloatType(type.Type) || SizeClass(size) == InvalidIndex || newVar >= m_ArgumentBase)
+        {
+            return false;
+        }
+
+        const u32 index = static_cast<u32>(m_Insts.size());
+        LowerInst& inst = NewInst(LowerOp::Comp);
+        inst.Operation = static_cast<u8>(condition);
+        inst.Signed = IsSignedCondition(condition);
+        inst.Size = size;
+        inst.Result = newVar;
+        inst.ResultCount = 1;
+
+        if(!AddOperand(inst, b, size, size >= 4) || !AddOperand(inst, a, size, size >= 4))
+        {
+            return false;
+        }
+
+        DefineValue(newVar, 1, index);
+        return true;
+    }
+
+    [[nodiscard]] bool Store(const ssa::SsaCustomType type, const VarId destination, const VarId source) noexcept
+    {
+        if(m_Unreachable)
+        {
+            return true;
+        }
+
+        const u32 size = TypeSize(type);
+
+        if(SizeClass(size) == InvalidIndex)
+        {
+            return false;
+        }
+
+        LowerInst& inst = NewInst(LowerOp::Store);
+        inst.Size = size;
+
+        // Both are read from locals by the store.
+        return AddOperand(inst, destination, PointerSize, false) && AddOperand(inst, source, size, false);
+    }
+
+    /**
+     *   The parameters are the vars written just before the call. Stack
+     * parameters are pushed so the first one ends up on top, register
+     * parameters are pushed after them and popped into their registers.
+     */
+    [[nodiscard]] bool Call(const VarId newVar, const CallKind kind, const Function* const callee, const u32 functionIndex, const u16 moduleIndex, const VarId baseIndex, const u32 parameterCount, const VarId pointer, const VarId moduleVar) noexcept
+    {
+        if(m_Unreachable)
+        {
+            return true;
+        }
+
+        // The signature of an indirect callee isn't recorded in the SSA.
+        if((!callee && parameterCount != 0) || (callee && callee->Arguments().count() != parameterCount))
+        {
+            return false;
+        }
+
+        if(newVar >= m_ArgumentBase || baseIndex + parameterCount > m_ArgumentBase)
+        {
+            return false;
+        }
+
+        const u32 index = static_cast<u32>(m_Insts.size());
+        LowerInst& inst = NewInst(LowerOp::Call);
+        inst.Operation = static_cast<u8>(kind);
+        inst.Target = functionIndex;
+        inst.Module = moduleIndex;
+        inst.Result = newVar;
+        inst.ResultCount = 1;
+        inst.Pointer = pointer;
+        inst.ModuleVar = moduleVar;
+
+        if((kind == CallKind::CallInd || kind == CallKind::CallIndExt) && pointer == InvalidVar)
+        {
+            return false;
+        }
+
+        if(kind == CallKind::CallIndExt && moduleVar == InvalidVar)
+        {
+            return false;
+        }
+
+        for(u32 i = parameterCount; i > 0; --i)
+        {
+            if(!callee->Arguments()[i - 1].IsRegister && !AddOperand(inst, baseIndex + i - 1, 8, true))
+            {
+                return false;
+            }
+        }
+
+        for(u32 i = 0; i < parameterCount; ++i)
+        {
+            const FunctionArgument& argument = callee->Arguments()[i];
+
+            if(!argument.IsRegister)
+            {
+                continue;
+            }
+
+            if(argument.RegisterOrStackOffset >= MaxArgumentRegisters || !AddOperand(inst, baseIndex + i, 8, true, static_cast<u16>(argument.RegisterOrStackOffset)))
+            {
+                return false;
+            }
+        }
+
+        DefineValue(newVar, 8, index);
+        return true;
+    }
+
+    [[nodiscard]] bool BuildBlocks() noexcept
+    {
+        m_InstBlocks.resize(m_Insts.size());
+
+        for(u32 i = 0; i < m_Insts.size(); ++i)
+        {
+            if(i == 0 || m_Insts[i].Op == LowerOp::Label)
+            {
+                if(!m_Blocks.empty())
+                {
+                    m_Blocks.back().End = i;
+                }
+
+                LowerBlock block { };
+                block.Begin = i;
+                block.Label = m_Insts[i].Op == LowerOp::Label ? m_Insts[i].Result : 0;
+                m_Blocks.push_back(block);
+
+                if(block.Label != 0)
+                {
+                    if(block.Label >= m_ArgumentBase)
+                    {
+                        return false;
+                    }
+
+                    m_LabelBlocks[block.Label] = static_cast<u32>(m_Blocks.size() - 1);
+                }
+            }
+
+            m_InstBlocks[i] = static_cast<u32>(m_Blocks.size() - 1);
+        }
+
+        if(!m_Blocks.empty())
+        {
+            m_Blocks.back().End = static_cast<u32>(m_Insts.size());
+        }
+
+        for(LowerBlock& block : m_Blocks)
+        {
+            const LowerInst& last = m_Insts[block.End - 1];
+
+            if(last.Op == LowerOp::Branch)
+            {
+                block.Successors[block.SuccessorCount++] = LabelBlock(last.Target);
+            }
+            else if(last.Op == LowerOp::BranchCond)
+            {
+                block.Successors[block.SuccessorCount++] = LabelBlock(last.Target);
+                block.Successors[block.SuccessorCount++] = LabelBlock(last.FalseTarget);
+            }
+
+            for(u32 i = 0; i < block.SuccessorCount; ++i)
+            {
+                if(block.Successors[i] == InvalidIndex)
+                {
+                    return false;
+                }
+            }
+        }
+
+        return true;
+    }
+
+    [[nodiscard]] u32 LabelBlock(const VarId label) const noexcept
+    {
+        return label < m_LabelBlocks.size() ? m_LabelBlocks[label] : InvalidIndex;
+    }
+
+    /**
+     *   A phi that only merges itself and a single other value is a copy
+     * of that value. Removing one can make others trivial, so this runs
+     * until nothing changes.
+     */
+    [[nodiscard]] bool EliminateTrivialPhis() noexcept
+    {
+        bool changed = true;
+
+        while(changed)
+        {
+            changed = false;
+
+            for(const LowerInst& inst : m_Insts)
+            {
+                if(inst.Op != LowerOp::Phi || m_Vars[inst.Result].Kind != VarKind::Phi)
+                {
+                    continue;
+                }
+
+                VarId unique = 0;
+                bool trivial = true;
+
+                for(u32 i = 0; i < inst.OperandCount; ++i)
+                {
+                    const VarId var = Resolve(m_Operands[inst.OperandBegin + i]);
+
+                    if(var == inst.Result || var == 0)
+                    {
+                        continue;
+                    }
+
+                    if(unique == 0)
+                    {
+                        unique = var;
+                    }
+                    else if(var != unique)
+                    {
+                        trivial = false;
+                        break;
+                    }
+                }
+
+                if(trivial)
+                {
+                    m_Vars[inst.Result].Kind = VarKind::Alias;
+                    m_Vars[inst.Result].Alias = unique;
+                    changed = true;
+                }
+            }
+        }
+
+        for(LowerInst& inst : m_Insts)
+        {
+            if(inst.Op == LowerOp::Phi && m_Vars[inst.Result].Kind == VarKind::Alias)
+            {
+                inst.Live = false;
+            }
+        }
+
+        return true;
+    }
+
+    [[nodiscard]] bool CheckOperand(const VarId var, const u32 size) const noexcept
+    {
+        const LowerVar& lowerVar = m_Vars[var];
+
+        switch(lowerVar.Kind)
+        {
+            case VarKind::Immediate:
+                return SizeClass(size) != InvalidIndex || var == 0;
+            case VarKind::Value:
+            case VarKind::Phi:
+            case VarKind::Argument:
+                return lowerVar.Size == size;
+            default:
+                return false;
+        }
+    }
+
+    [[nodiscard]] bool ResolveOperands() noexcept
+    {
+        for(uSys i = 0; i < m_Operands.size(); ++i)
+        {
+            m_Operands[i] = Resolve(m_Operands[i]);
+        }
+
+        for(LowerInst& inst : m_Insts)
+        {
+            if(!inst.Live)
+            {
+                continue;
+            }
+
+            for(u32 i = 0; i < inst.OperandCount; ++i)
+            {
+                if(!CheckOperand(m_Operands[inst.OperandBegin + i], m_OperandSizes[inst.OperandBegin + i]))
+                {
+                    return false;
+                }
+            }
+
+            if(inst.Pointer != InvalidVar)
+            {
+                inst.Pointer = Resolve(inst.Pointer);
+
+                const VarKind kind = m_Vars[inst.Pointer].Kind;
+
+                if(kind != VarKind::Immediate && kind != VarKind::Value && kind != VarKind::Phi && kind != VarKind::Argument)
+                {
+                    return false;
+                }
+            }
+
+            if(inst.ModuleVar != InvalidVar)
+            {
+                inst.ModuleVar = Resolve(inst.ModuleVar);
+
+                if(!CheckOperand(inst.ModuleVar, 2))
+                {
+                    return false;
+                }
+            }
+        }
+
+        return true;
+    }
+
+    /**
+     *   Only instructions that a call, branch or return depend on are
+     * kept. Unlike counting uses this also removes dead cycles through
+     * loop phis.
+     */
+    [[nodiscard]] bool MarkLive() noexcept
+    {
+        ArenaVector<u32> worklist(m_Arena);
+
+        for(u32 i = 0; i < m_Insts.size(); ++i)
+        {
+            LowerInst& inst = m_Insts[i];
+
+            switch(inst.Op)
+            {
+                case LowerOp::Label:
+                    break;
+                case LowerOp::Call:
+                case LowerOp::Store:
+                case LowerOp::Branch:
+                case LowerOp::BranchCond:
+                case LowerOp::Ret:
+                    worklist.push_back(i);
+                    break;
+                default:
+                    inst.Live = false;
+                    break;
+            }
+        }
+
+        const auto markVar = [&](const VarId var)
+        {
+            const LowerVar& lowerVar = m_Vars[var];
+
+            if((lowerVar.Kind == VarKind::Value || lowerVar.Kind == VarKind::Phi) && !m_Insts[lowerVar.Def].Live)
+            {
+                m_Insts[lowerVar.Def].Live = true;
+                worklist.push_back(lowerVar.Def);
+            }
+        };
+
+        while(!worklist.empty())
+        {
+            const LowerInst& inst = m_Insts[worklist.back()];
+            worklist.pop_back();
+
+            for(u32 i = 0; i < inst.OperandCount; ++i)
+            {
+                markVar(m_Operands[inst.OperandBegin + i]);
+            }
+
+            if(inst.Pointer != InvalidVar)
+            {
+                markVar(inst.Pointer);
+            }
+
+            if(inst.ModuleVar != InvalidVar)
+            {
+                markVar(inst.ModuleVar);
+            }
+        }
+
+        return true;
+    }
+
+    /**
+     *   Collects the copies into the phis of each successor. The copies
+     * of an unconditional branch become its operands so values computed
+     * just before the branch can be passed on the stack.
+     */
+    [[nodiscard]] bool BuildCopies() noexcept
+    {
+        for(LowerBlock& block : m_Blocks)
+        {
+            for(u32 edge = 0; edge < block.SuccessorCount; ++edge)
+            {
+                const LowerBlock& successor = m_Blocks[block.Successors[edge]];
+
+                block.CopyBegin[edge] = static_cast<u32>(m_Copies.size());
+
+                for(u32 i = successor.Begin; i < successor.End; ++i)
+                {
+                    const LowerInst& phi = m_Insts[i];
+
+                    if(phi.Op != LowerOp::Phi || !phi.Live)
+                    {
+                        continue;
+                    }
+
+                    u32 incoming = InvalidIndex;
+
+                    for(u32 j = 0; j < phi.OperandCount; ++j)
+                    {
+                        if(block.Label != 0 && m_PhiLabels[phi.Target + j] == block.Label)
+                        {
+                            incoming = j;
+                            break;
+                        }
+                    }
+
+                    if(incoming == InvalidIndex)
+                    {
+                        return false;
+                    }
+
+                    const VarId value = m_Operands[phi.OperandBegin + incoming];
+
+                    // The phi already holds the value, or the value is undefined on this edge.
+                    if(value == phi.Result || value == 0)
+                    {
+                        continue;
+                    }
+
+                    m_Copies.push_back({ phi.Result, value });
+                }
+
+                block.CopyCount[edge] = static_cast<u32>(m_Copies.size()) - block.CopyBegin[edge];
+            }
+
+            LowerInst& last = m_Insts[block.End - 1];
+
+            if(last.Op == LowerOp::Branch)
+            {
+                last.OperandBegin = static_cast<u32>(m_Operands.size());
+
+                for(u32 i = 0; i < block.CopyCount[0]; ++i)
+                {
+                    const PhiCopy& copy = m_Copies[block.CopyBegin[0] + i];
+
+                    if(!AddOperand(last, copy.Value, m_Vars[copy.Phi].Size, true))
+                    {
+                        return false;
+                    }
+                }
+            }
+        }
+
+        return true;
+    }
+
+    void CountUse(const VarId var, const u32 inst, const bool fromStack) noexcept
+    {
+        LowerVar& lowerVar = m_Vars[var];
+
+        if(lowerVar.Kind != VarKind::Value && lowerVar.Kind != VarKind::Phi && lowerVar.Kind != VarKind::Argument)
+        {
+            return;
+        }
+
+        ++lowerVar.Uses;
+        lowerVar.UseInst = inst;
+
+        if(fromStack)
+        {
+            ++lowerVar.StackUses;
+        }
+    }
+
+    [[nodiscard]] bool CountUses() noexcept
+    {
+        for(u32 i = 0; i < m_Insts.size(); ++i)
+        {
+            const LowerInst& inst = m_Insts[i];
+
+            // The incoming values of a phi are used by the copies on the edges.
+            if(!inst.Live || inst.Op == LowerOp::Phi)
+            {
+                continue;
+            }
+
+            for(u32 j = 0; j < inst.OperandCount; ++j)
+            {
+                CountUse(m_Operands[inst.OperandBegin + j], i, j < inst.MatchableCount);
+            }
+
+            if(inst.Pointer != InvalidVar)
+            {
+                CountUse(inst.Pointer, i, false);
+            }
+
+            if(inst.ModuleVar != InvalidVar)
+            {
+                CountUse(inst.ModuleVar, i, false);
+            }
+
+            if(inst.Op == LowerOp::BranchCond)
+            {
+                const LowerBlock& block = m_Blocks[m_InstBlocks[i]];
+
+                for(u32 edge = 0; edge < block.SuccessorCount; ++edge)
+                {
+                    for(u32 j = 0; j < block.CopyCount[edge]; ++j)
+                    {
+                        CountUse(m_Copies[block.CopyBegin[edge] + j].Value, i, false);
+                    }
+                }
+            }
+        }
+
+        return true;
+    }
+
+    /**
+     *   Starts by assuming every value with a single use later in the
+     * same block stays on the stack, then simulates the stack of each
+     * block. A value that isn't on top of the stack, in push order, when
+     * its use comes around is moved to a local and the block is simulated
+     * again. Each round only ever takes values off the stack, so this
+     * settles quickly.
+     */
+    [[nodiscard]] bool Schedule() noexcept
+    {
+        for(LowerVar& var : m_Vars)
+        {
+            var.OnStack = var.Kind == VarKind::Value
+                && !var.ForceSlot
+                && var.Uses == 1
+                && var.StackUses == 1
+                && m_Insts[var.Def].Live
+                && m_InstBlocks[var.Def] == m_InstBlocks[var.UseInst];
+        }
+
+        bool changed = true;
+
+        while(changed)
+        {
+            changed = false;
+
+            for(u32 block = 0; block < m_Blocks.size(); ++block)
+            {
+                if(!ScheduleBlock(block))
+                {
+                    changed = true;
+                }
+            }
+        }
+
+        return true;
+    }
+
+    [[nodiscard]] bool ScheduleBlock(const u32 blockIndex) noexcept
+    {
+        const LowerBlock& block = m_Blocks[blockIndex];
+        bool stable = true;
+
+        const auto spill = [&](const VarId var)
+        {
+            if(m_Vars[var].OnStack)
+            {
+                m_Vars[var].OnStack = false;
+                stable = false;
+            }
+        };
+
+        m_Stack.clear();
+
+        for(u32 i = block.Begin; i < block.End; ++i)
+        {
+            LowerInst& inst = m_Insts[i];
+
+            if(!inst.Live || inst.Op == LowerOp::Label || inst.Op == LowerOp::Phi)
+            {
+                continue;
+            }
+
+            // The longest run of leading operands that is already on top of the stack.
+            u32 matched = minT(inst.MatchableCount, static_cast<u32>(m_Stack.size()));
+
+            for(; matched > 0; --matched)
+            {
+                const uSys base = m_Stack.size() - matched;
+
+                if(::std::equal(m_Stack.begin() + static_cast<iSys>(base), m_Stack.end(), m_Operands.begin() + inst.OperandBegin))
+                {
+                    break;
+                }
+            }
+
+            inst.StackOperands = matched;
+            m_Stack.resize(m_Stack.size() - matched);
+
+            for(u32 j = matched; j < inst.OperandCount; ++j)
+            {
+                spill(m_Operands[inst.OperandBegin + j]);
+            }
+
+            if(inst.Pointer != InvalidVar)
+            {
+                spill(inst.Pointer);
+            }
+
+            if(inst.ModuleVar != InvalidVar)
+            {
+                spill(inst.ModuleVar);
+            }
+
+            if(inst.Op == LowerOp::BranchCond)
+            {
+                for(u32 edge = 0; edge < block.SuccessorCount; ++edge)
+                {
+                    for(u32 j = 0; j < block.CopyCount[edge]; ++j)
+                    {
+                        spill(m_Copies[block.CopyBegin[edge] + j].Value);
+                    }
+                }
+            }
+
+            if(inst.Result != InvalidVar && inst.Op != LowerOp::Split && m_Vars[inst.Result].OnStack)
+            {
+                m_Stack.push_back(inst.Result);
+            }
+        }
+
+        for(const VarId var : m_Stack)
+        {
+            spill(var);
+        }
+
+        return stable;
+    }
+
+    void ExtendInterval(ArenaVector<u32>& starts, ArenaVector<u32>& ends, const VarId var, const u32 position) const noexcept
+    {
+        const u32 liveIndex = m_Vars[var].LiveIndex;
+
+        if(liveIndex == InvalidIndex)
+        {
+            return;
+        }
+
+        starts[liveIndex] = minT(starts[liveIndex], position);
+        ends[liveIndex] = maxT(ends[liveIndex], position);
+    }
+
+    /**
+     *   Computes the live range of every value that needs a local, then
+     * assigns locals with a linear scan, one pool of locals per size.
+     * A live range is the span of instructions from its first to its
+     * last point of liveness, ranges that touch never share a local.
+     */
+    [[nodiscard]] bool AssignSlots() noexcept
+    {
+        ArenaVector<VarId> slotVars(m_Arena);
+
+        for(VarId var = 0; var < m_Vars.size(); ++var)
+        {
+            LowerVar& lowerVar = m_Vars[var];
+            bool needsSlot;
+
+            switch(lowerVar.Kind)
+            {
+                case VarKind::Value:
+                    needsSlot = m_Insts[lowerVar.Def].Live && !lowerVar.OnStack && lowerVar.Uses > 0;
+                    break;
+                case VarKind::Phi:
+                    needsSlot = m_Insts[lowerVar.Def].Live;
+                    break;
+                case VarKind::Argument:
+                    needsSlot = lowerVar.Uses > 0;
+                    break;
+                default:
+                    needsSlot = false;
+                    break;
+            }
+
+            if(needsSlot)
+            {
+                lowerVar.LiveIndex = static_cast<u32>(slotVars.size());
+                slotVars.push_back(var);
+            }
+        }
+
+        const uSys blockCount = m_Blocks.size();
+        const uSys words = (slotVars.size() + 63) / 64;
+
+        ArenaVector<u64> gen(blockCount * words, 0, m_Arena);
+        ArenaVector<u64> kill(blockCount * words, 0, m_Arena);
+        ArenaVector<u64> liveIn(blockCount * words, 0, m_Arena);
+        ArenaVector<u64> liveOut(blockCount * words, 0, m_Arena);
+
+        const auto isSet = [&](const ArenaVector<u64>& set, const uSys block, const u32 index) { return (set[block * words + index / 64] >> (index % 64)) & 1; };
+        const auto set = [&](ArenaVector<u64>& bits, const uSys block, const u32 index) { bits[block * words + index / 64] |= static_cast<u64>(1) << (index % 64); };
+
+        for(uSys b = 0; b < blockCount; ++b)
+        {
+            const LowerBlock& block = m_Blocks[b];
+
+            const auto use = [&](const VarId var)
+            {
+                const u32 index = m_Vars[var].LiveIndex;
+
+                if(index != InvalidIndex && !isSet(kill, b, index))
+                {
+                    set(gen, b, index);
+                }
+            };
+
+            const auto def = [&](const VarId var)
+            {
+                const u32 index = m_Vars[var].LiveIndex;
+
+                if(index != InvalidIndex)
+                {
+                    set(kill, b, index);
+                }
+            };
+
+            for(u32 i = block.Begin; i < block.End; ++i)
+            {
+                const LowerInst& inst = m_Insts[i];
+
+                if(!inst.Live || inst.Op == LowerOp::Label)
+                {
+                    continue;
+                }
+
+                if(inst.Op == LowerOp::Phi)
+                {
+                    def(inst.Result);
+                    continue;
+                }
+
+                ForEachUse(i, use);
+
+                for(u32 j = 0; inst.Result != InvalidVar && j < inst.ResultCount; ++j)
+                {
+                    def(inst.Result + j);
+                }
+            }
+        }
+
+        bool changed = true;
+
+        while(changed)
+        {
+            changed = false;
+
+            for(uSys b = blockCount; b > 0; --b)
+            {
+                const LowerBlock& block = m_Blocks[b - 1];
+
+                for(uSys w = 0; w < words; ++w)
+                {
+                    u64 out = 0;
+
+                    for(u32 s = 0; s < block.SuccessorCount; ++s)
+                    {
+                        out |= liveIn[block.Successors[s] * words + w];
+                    }
+
+                    const u64 in = gen[(b - 1) * words + w] | (out & ~kill[(b - 1) * words + w]);
+
+                    if(out != liveOut[(b - 1) * words + w] || in != liveIn[(b - 1) * words + w])
+                    {
+                        liveOut[(b - 1) * words + w] = out;
+                        liveIn[(b - 1) * words + w] = in;
+                        changed = true;
+                    }
+                }
+            }
+        }
+
+        ArenaVector<u32> starts(slotVars.size(), InvalidIndex, m_Arena);
+        ArenaVector<u32> ends(slotVars.size(), 0, m_Arena);
+
+        for(uSys b = 0; b < blockCount; ++b)
+        {
+            const LowerBlock& block = m_Blocks[b];
+
+            for(u32 index = 0; index < slotVars.size(); ++index)
+            {
+                if(isSet(liveIn, b, index))
+                {
+                    ExtendInterval(starts, ends, slotVars[index], block.Begin);
+                }
+
+                if(isSet(liveOut, b, index))
+                {
+                    ExtendInterval(starts, ends, slotVars[index], block.End - 1);
+                }
+            }
+
+            for(u32 i = block.Begin; i < block.End; ++i)
+            {
+                const LowerInst& inst = m_Insts[i];
+
+                if(!inst.Live || inst.Op == LowerOp::Label)
+                {
+                    continue;
+                }
+
+                if(inst.Op == LowerOp::Phi)
+                {
+                    ExtendInterval(starts, ends, inst.Result, block.Begin);
+                    continue;
+                }
+
+                ForEachUse(i, [&](const VarId var) { ExtendInterval(starts, ends, var, i); });
+
+                for(u32 j = 0; inst.Result != InvalidVar && j < inst.ResultCount; ++j)
+                {
+                    ExtendInterval(starts, ends, inst.Result + j, i);
+                }
+            }
+
+            // The phis of the successors are written at the end of the block.
+            for(u32 edge = 0; edge < block.SuccessorCount; ++edge)
+            {
+                for(u32 j = 0; j < block.CopyCount[edge]; ++j)
+                {
+                    ExtendInterval(starts, ends, m_Copies[block.CopyBegin[edge] + j].Phi, block.End - 1);
+                }
+            }
+        }
+
+        // Arguments are copied into their locals before the first instruction.
+        for(uSys i = 0; i < MaxArgumentRegisters; ++i)
+        {
+            ExtendInterval(starts, ends, m_ArgumentBase + static_cast<VarId>(i), 0);
+        }
+
+        ArenaVector<u32> order(slotVars.size(), 0, m_Arena);
+
+        for(u32 i = 0; i < order.size(); ++i)
+        {
+            order[i] = i;
+        }
+
+        ::std::sort(order.begin(), order.end(), [&](const u32 a, const u32 b) { return starts[a] < starts[b] || (starts[a] == starts[b] && a < b); });
+
+        ArenaVector<ActiveSlot> active[4] = { ArenaVector<ActiveSlot>(m_Arena), ArenaVector<ActiveSlot>(m_Arena), ArenaVector<ActiveSlot>(m_Arena), ArenaVector<ActiveSlot>(m_Arena) };
+        ArenaVector<u32> freeSlots[4] = { ArenaVector<u32>(m_Arena), ArenaVector<u32>(m_Arena), ArenaVector<u32>(m_Arena), ArenaVector<u32>(m_Arena) };
+
+        for(const u32 index : order)
+        {
+            LowerVar& var = m_Vars[slotVars[index]];
+            const u32 sizeClass = SizeClass(var.Size);
+
+            if(sizeClass == InvalidIndex)
+            {
+                return false;
+            }
+
+            ArenaVector<ActiveSlot>& classActive = active[sizeClass];
+
+            for(uSys i = 0; i < classActive.size();)
+            {
+                if(classActive[i].End < starts[index])
+                {
+                    freeSlots[sizeClass].push_back(classActive[i].Slot);
+                    classActive[i] = classActive.back();
+                    classActive.pop_back();
+                }
+                else
+                {
+                    ++i;
+                }
+            }
+
+            if(freeSlots[sizeClass].empty())
+            {
+                var.Slot = NewSlot(var.Size);
+            }
+            else
+            {
+                var.Slot = freeSlots[sizeClass].back();
+                freeSlots[sizeClass].pop_back();
+            }
+
+            classActive.push_back({ ends[index], var.Slot });
+        }
+
+        // Immediates that are read from a local are written to a scratch local first.
+        for(const LowerInst& inst : m_Insts)
+        {
+            if(!inst.Live)
+            {
+                continue;
+            }
+
+            if(inst.Pointer != InvalidVar && m_Vars[inst.Pointer].Kind == VarKind::Immediate)
+            {
+                ReserveScratchSlot(m_ScratchSlots[SizeClass(4)], 4);
+            }
+
+            if((inst.Op == LowerOp::Load || inst.Op == LowerOp::Store) && m_Vars[m_Operands[inst.OperandBegin]].Kind == VarKind::Immediate)
+            {
+                ReserveScratchSlot(m_AddressSlot, PointerSize);
+            }
+
+            if(inst.Op == LowerOp::Store && m_Vars[m_Operands[inst.OperandBegin + 1]].Kind == VarKind::Immediate)
+            {
+                ReserveScratchSlot(m_ScratchSlots[SizeClass(inst.Size)], inst.Size);
+            }
+        }
+
+        return m_SlotSizes.size() <= static_cast<uSys>(NoRegister);
+    }
+
+    template<typename F>
+    void ForEachUse(const u32 index, F&& func) const noexcept
+    {
+        const LowerInst& inst = m_Insts[index];
+
+        for(u32 j = 0; j < inst.OperandCount; ++j)
+        {
+            func(m_Operands[inst.OperandBegin + j]);
+        }
+
+        if(inst.Pointer != InvalidVar)
+        {
+            func(inst.Pointer);
+        }
+
+        if(inst.ModuleVar != InvalidVar)
+        {
+            func(inst.ModuleVar);
+        }
+
+        if(inst.Op == LowerOp::BranchCond)
+        {
+            const LowerBlock& block = m_Blocks[m_InstBlocks[index]];
+
+            for(u32 edge = 0; edge < block.SuccessorCount; ++edge)
+            {
+                for(u32 j = 0; j < block.CopyCount[edge]; ++j)
+                {
+                    func(m_Copies[block.CopyBegin[edge] + j].Value);
+                }
+            }
+        }
+    }
+
+    [[nodiscard]] u32 NewSlot(const u32 size) noexcept
+    {
+        m_SlotSizes.push_back(size);
+        return static_cast<u32>(m_SlotSizes.size() - 1);
+    }
+
+    void ReserveScratchSlot(u32& slot, const u32 size) noexcept
+    {
+        if(slot == InvalidIndex)
+        {
+            slot = NewSlot(size);
+        }
+    }
+
+    [[nodiscard]] bool Emit() noexcept
+    {
+        for(uSys i = 0; i < MaxArgumentRegisters; ++i)
+        {
+            const LowerVar& var = m_Vars[m_ArgumentBase + i];
+
+            if(var.Slot != InvalidIndex)
+            {
+                m_Writer.WritePushArg(static_cast<u16>(i));
+                m_Writer.WritePop(static_cast<u16>(var.Slot));
+            }
+        }
+
+        m_BlockOffsets.resize(m_Blocks.size());
+
+        for(u32 b = 0; b < m_Blocks.size(); ++b)
+        {
+            m_BlockOffsets[b] = m_Writer.Size();
+
+            for(u32 i = m_Blocks[b].Begin; i < m_Blocks[b].End; ++i)
+            {
+                if(m_Insts[i].Live && !EmitInst(b, m_Insts[i]))
+                {
+                    return false;
+                }
+            }
+        }
+
+        for(const JumpPatch& patch : m_JumpPatches)
+        {
+            m_Writer.PatchJump(patch.Offset, static_cast<i32>(static_cast<iSys>(m_BlockOffsets[patch.Block]) - static_cast<iSys>(patch.Offset + JumpInstructionSize)));
+        }
+
+        return true;
+    }
+
+    [[nodiscard]] bool EmitInst(const u32 blockIndex, const LowerInst& inst) noexcept
+    {
+        switch(inst.Op)
+        {
+            case LowerOp::Label:
+            case LowerOp::Phi:
+                return true;
+            case LowerOp::Expand:
+                if(!PushOperands(inst))
+                {
+                    return false;
+                }
+
+                if(inst.Signed)
+                {
+                    m_Writer.WriteExpandSX(inst.Size, inst.ToSize);
+                }
+                else
+                {
+                    m_Writer.WriteExpandZX(inst.Size, inst.ToSize);
+                }
+
+                StoreResult(inst.Result);
+                return true;
+            case LowerOp::Trunc:
+                if(!PushOperands(inst))
+                {
+                    return false;
+                }
+
+                m_Writer.WriteTrunc(inst.Size, inst.ToSize);
+                StoreResult(inst.Result);
+                return true;
+            case LowerOp::BinOp:
+                return EmitBinOp(inst);
+            case LowerOp::Comp:
+                if(!PushWidenedOperands(inst))
+                {
+                    return false;
+                }
+
+                if(inst.Size == 8)
+                {
+                    m_Writer.WriteCompI64(static_cast<CompareCondition>(inst.Operation));
+                }
+                else
+                {
+                    m_Writer.WriteCompI32(static_cast<CompareCondition>(inst.Operation));
+                }
+
+                StoreResult(inst.Result);
+                return true;
+            case LowerOp::Split:
+                if(!PushOperands(inst))
+                {
+                    return false;
+                }
+
+                // The highest part is on top.
+                for(u32 i = inst.ResultCount; i > 0; --i)
+                {
+                    StoreResult(inst.Result + i - 1);
+                }
+                return true;
+            case LowerOp::Join:
+                if(!PushOperands(inst))
+                {
+                    return false;
+                }
+
+                StoreResult(inst.Result);
+                return true;
+            case LowerOp::Call:
+                return EmitCall(inst);
+            case LowerOp::Load:
+            {
+                const u32 pointerSlot = OperandSlot(m_Operands[inst.OperandBegin], PointerSize, m_AddressSlot);
+                const u32 valueSlot = m_Vars[inst.Result].Slot;
+
+                if(pointerSlot == InvalidIndex || valueSlot == InvalidIndex)
+                {
+                    return false;
+                }
+
+                m_Writer.WriteLoad(static_cast<u16>(valueSlot), static_cast<u16>(pointerSlot));
+                return true;
+            }
+            case LowerOp::Store:
+            {
+                const u32 pointerSlot = OperandSlot(m_Operands[inst.OperandBegin], PointerSize, m_AddressSlot);
+                const u32 valueSlot = OperandSlot(m_Operands[inst.OperandBegin + 1], inst.Size, m_ScratchSlots[SizeClass(inst.Size)]);
+
+                if(pointerSlot == InvalidIndex || valueSlot == InvalidIndex)
+                {
+                    return false;
+                }
+
+                m_Writer.WriteStore(static_cast<u16>(pointerSlot), static_cast<u16>(valueSlot));
+                return true;
+            }
+            case LowerOp::ComputePtr:
+                return EmitComputePtr(inst);
+            case LowerOp::Branch:
+            {
+                if(!PushOperands(inst))
+                {
+                    return false;
+                }
+
+                const LowerBlock& block = m_Blocks[blockIndex];
+
+                if(!PopCopies(block, 0))
+                {
+                    return false;
+                }
+
+                if(block.Successors[0] != blockIndex + 1)
+                {
+                    WriteJump(block.Successors[0]);
+                }
+                return true;
+            }
+            case LowerOp::BranchCond:
+                return PushOperands(inst) && EmitBranchCond(blockIndex);
+            case LowerOp::Ret:
+                if(!PushOperands(inst))
+                {
+                    return false;
+                }
+
+                if(inst.Size < sizeof(u64))
+                {
+                    m_Writer.WriteExpandZX(inst.Size, sizeof(u64));
+                }
+
+                m_Writer.WritePopArg(0);
+                m_Writer.WriteRet();
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    [[nodiscard]] bool EmitBinOp(const LowerInst& inst) noexcept
+    {
+        const bool isNarrow = inst.Size < 4;
+        const uSys operationSize = isNarrow ? 4 : inst.Size;
+        const ssa::SsaBinaryOperation operation = static_cast<ssa::SsaBinaryOperation>(inst.Operation);
+
+        if(!PushWidenedOperands(inst))
+        {
+            return false;
+        }
+
+        switch(operation)
+        {
+            case ssa::SsaBinaryOperation::Add:
+                if(operationSize == 8) { m_Writer.WriteAddI64(); } else { m_Writer.WriteAddI32(); }
+                break;
+            case ssa::SsaBinaryOperation::Sub:
+                if(operationSize == 8) { m_Writer.WriteSubI64(); } else { m_Writer.WriteSubI32(); }
+                break;
+            case ssa::SsaBinaryOperation::Mul:
+                if(operationSize == 8) { m_Writer.WriteMulI64(); } else { m_Writer.WriteMulI32(); }
+                break;
+            case ssa::SsaBinaryOperation::Div:
+            case ssa::SsaBinaryOperation::Rem:
+                if(operationSize == 8) { m_Writer.WriteDivI64(); } else { m_Writer.WriteDivI32(); }
+                break;
+            case ssa::SsaBinaryOperation::MulHigh:
+                if(inst.Signed)
+                {
+                    if(operationSize == 8) { m_Writer.WriteMulHighI64(); } else { m_Writer.WriteMulHighI32(); }
+                }
+                else
+                {
+                    if(operationSize == 8) { m_Writer.WriteMulHighU64(); } else { m_Writer.WriteMulHighU32(); }
+                }
+                break;
+            case ssa::SsaBinaryOperation::BitShiftLeft:
+                if(operationSize == 8) { m_Writer.WriteShlI64(); } else { m_Writer.WriteShlI32(); }
+                break;
+            // Narrow operands were widened by their signedness, so a wide shift gives the same low bits.
+            case ssa::SsaBinaryOperation::BitShiftRight:
+                if(inst.Signed)
+                {
+                    if(operationSize == 8) { m_Writer.WriteSarI64(); } else { m_Writer.WriteSarI32(); }
+                }
+                else
+                {
+                    if(operationSize == 8) { m_Writer.WriteShrI64(); } else { m_Writer.WriteShrI32(); }
+                }
+                break;
+            default:
+                return false;
+        }
+
+        // Division leaves the quotient with the remainder on top.
+        if(operation == ssa::SsaBinaryOperation::Div)
+        {
+            m_Writer.WritePopCount(static_cast<u16>(operationSize));
+        }
+
+        if(isNarrow)
+        {
+            m_Writer.WriteTrunc(operationSize, inst.Size);
+        }
+
+        StoreResult(inst.Result);
+
+        if(operation == ssa::SsaBinaryOperation::Rem)
+        {
+            m_Writer.WritePopCount(static_cast<u16>(operationSize));
+        }
+
+        return true;
+    }
+
+    /**
+     *   Pointers are plain 8 byte integers on the stack, the address is
+     * built with integer arithmetic.
+     */
+    [[nodiscard]] bool EmitComputePtr(const LowerInst& inst) noexcept
+    {
+        if(!PushOperands(inst))
+        {
+            return false;
+        }
+
+        if(inst.Multiplier != 0)
+        {
+            if(inst.Multiplier != 1)
+            {
+                (void) PushImmediate(static_cast<u64>(static_cast<i64>(inst.Multiplier)), PointerSize);
+                m_Writer.WriteMulI64();
+            }
+
+            m_Writer.WriteAddI64();
+        }
+
+        if(inst.Offset != 0)
+        {
+            (void) PushImmediate(static_cast<u64>(static_cast<i64>(inst.Offset)), PointerSize);
+            m_Writer.WriteAddI64();
+        }
+
+        StoreResult(inst.Result);
+        return true;
+    }
+
+    [[nodiscard]] bool EmitCall(const LowerInst& inst) noexcept
+    {
+        if(!PushOperands(inst))
+        {
+            return false;
+        }
+
+        // Register parameters are pushed last, so they're popped first.
+        for(u32 i = inst.OperandCount; i > 0; --i)
+        {
+            const u16 argumentRegister = m_OperandRegisters[inst.OperandBegin + i - 1];
+
+            if(argumentRegister != NoRegister)
+            {
+                m_Writer.WritePopArg(argumentRegister);
+            }
+        }
+
+        const CallKind kind = static_cast<CallKind>(inst.Operation);
+
+        switch(kind)
+        {
+            case CallKind::Call:
+                m_Writer.WriteCall(inst.Target);
+                break;
+            case CallKind::CallExt:
+                m_Writer.WriteCallExt(inst.Target, inst.Module);
+                break;
+            case CallKind::CallInd:
+            case CallKind::CallIndExt:
+            {
+                const u32 pointerSlot = OperandSlot(inst.Pointer, 4, m_ScratchSlots[SizeClass(4)]);
+
+                if(pointerSlot == InvalidIndex)
+                {
+                    return false;
+                }
+
+                if(kind == CallKind::CallInd)
+                {
+                    m_Writer.WriteCallInd(static_cast<u16>(pointerSlot));
+                }
+                else
+                {
+                    // The module index is popped by the call.
+                    if(!PushVar(inst.ModuleVar, 2))
+                    {
+                        return false;
+                    }
+
+                    m_Writer.WriteCallIndExt(static_cast<u16>(pointerSlot));
+                }
+                break;
+            }
+            default:
+                return false;
+        }
+
+        // The return value is only moved out of the argument register if it's used.
+        if(m_Vars[inst.Result].Uses > 0)
+        {
+            m_Writer.WritePushArg(0);
+            StoreResult(inst.Result);
+        }
+
+        return true;
+    }
+
+    /**
+     *   The copies of the false edge fall through from the conditional
+     * jump. The copies of the true edge are placed after them, so the
+     * jump only has to skip over the true edge when it has copies.
+     */
+    [[nodiscard]] bool EmitBranchCond(const u32 blockIndex) noexcept
+    {
+        const LowerBlock& block = m_Blocks[blockIndex];
+        const u32 trueBlock = block.Successors[0];
+        const u32 falseBlock = block.Successors[1];
+        const bool hasTrueCopies = block.CopyCount[0] != 0;
+
+        const uSys jumpTrue = m_Writer.Size();
+        m_Writer.WriteJumpTrue(0);
+
+        if(!hasTrueCopies)
+        {
+            m_JumpPatches.push_back({ jumpTrue, trueBlock });
+        }
+
+        if(!PushCopies(block, 1) || !PopCopies(block, 1))
+        {
+            return false;
+        }
+
+        if(hasTrueCopies || falseBlock != blockIndex + 1)
+        {
+            WriteJump(falseBlock);
+        }
+
+        if(hasTrueCopies)
+        {
+            m_Writer.PatchJump(jumpTrue, static_cast<i32>(m_Writer.Size() - (jumpTrue + JumpInstructionSize)));
+
+            if(!PushCopies(block, 0) || !PopCopies(block, 0))
+            {
+                return false;
+            }
+
+            if(trueBlock != blockIndex + 1)
+            {
+                WriteJump(trueBlock);
+            }
+        }
+
+        return true;
+    }
+
+    void WriteJump(const u32 block) noexcept
+    {
+        m_JumpPatches.push_back({ m_Writer.Size(), block });
+        m_Writer.WriteJump(0);
+    }
+
+    /**
+     *   All of the values are pushed before any phi is written, so the
+     * copies behave as if they happen all at once.
+     */
+    [[nodiscard]] bool PushCopies(const LowerBlock& block, const u32 edge) noexcept
+    {
+        for(u32 i = 0; i < block.CopyCount[edge]; ++i)
+        {
+            const PhiCopy& copy = m_Copies[block.CopyBegin[edge] + i];
+
+            if(!PushVar(copy.Value, m_Vars[copy.Phi].Size))
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    [[nodiscard]] bool PopCopies(const LowerBlock& block, const u32 edge) noexcept
+    {
+        for(u32 i = block.CopyCount[edge]; i > 0; --i)
+        {
+            const LowerVar& phi = m_Vars[m_Copies[block.CopyBegin[edge] + i - 1].Phi];
+
+            if(phi.Slot == InvalidIndex)
+            {
+                return false;
+            }
+
+            m_Writer.WritePop(static_cast<u16>(phi.Slot));
+        }
+
+        return true;
+    }
+
+    [[nodiscard]] bool PushOperands(const LowerInst& inst) noexcept
+    {
+        for(u32 i = inst.StackOperands; i < inst.OperandCount; ++i)
+        {
+            if(!PushVar(m_Operands[inst.OperandBegin + i], m_OperandSizes[inst.OperandBegin + i]))
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    /**
+     *   The emulator only operates on 4 and 8 byte integers, narrower
+     * operands are widened as they are pushed.
+     */
+    [[nodiscard]] bool PushWidenedOperands(const LowerInst& inst) noexcept
+    {
+        if(inst.Size >= 4)
+        {
+            return PushOperands(inst);
+        }
+
+        for(u32 i = 0; i < inst.OperandCount; ++i)
+        {
+            if(!PushVar(m_Operands[inst.OperandBegin + i], inst.Size))
+            {
+                return false;
+            }
+
+            if(inst.Signed)
+            {
+                m_Writer.WriteExpandSX(inst.Size, 4);
+            }
+            else
+            {
+                m_Writer.WriteExpandZX(inst.Size, 4);
+            }
+        }
+
+        return true;
+    }
+
+    [[nodiscard]] bool PushVar(const VarId var, const u32 size) noexcept
+    {
+        const LowerVar& lowerVar = m_Vars[var];
+
+        if(lowerVar.Kind == VarKind::Immediate)
+        {
+            return PushImmediate(lowerVar.Immediate, size);
+        }
+
+        // A value left on the stack is only ever consumed in place.
+        if(lowerVar.Slot == InvalidIndex)
+        {
+            return false;
+        }
+
+        m_Writer.WritePush(static_cast<u16>(lowerVar.Slot));
+        return true;
+    }
+
+    /**
+     *   The local that holds the var, an immediate is first written to the
+     * scratch local.
+     */
+    [[nodiscard]] u32 OperandSlot(const VarId var, const u32 size, const u32 scratchSlot) noexcept
+    {
+        const LowerVar& lowerVar = m_Vars[var];
+
+        if(lowerVar.Kind != VarKind::Immediate)
+        {
+            return lowerVar.Slot;
+        }
+
+        if(scratchSlot == InvalidIndex || !PushImmediate(lowerVar.Immediate, size))
+        {
+            return InvalidIndex;
+        }
+
+        m_Writer.WritePop(static_cast<u16>(scratchSlot));
+        return scratchSlot;
+    }
+
+    [[nodiscard]] bool PushImmediate(const u64 value, const u32 size) noexcept
+    {
+        switch(size)
+        {
+            case 8:
+                // The stack is little endian, the low half goes first.
+                m_Writer.WriteConstant(static_cast<u32>(value));
+                m_Writer.WriteConstant(static_cast<u32>(value >> 32));
+                return true;
+            case 4:
+                m_Writer.WriteConstant(static_cast<u32>(value));
+                return true;
+            case 2:
+            case 1:
+                m_Writer.WriteConstant(static_cast<u32>(value));
+                m_Writer.WriteTrunc(4, size);
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    void StoreResult(const VarId var) noexcept
+    {
+        const LowerVar& lowerVar = m_Vars[var];
+
+        if(lowerVar.OnStack)
+        {
+            return;
+        }
+
+        if(lowerVar.Slot != InvalidIndex)
+        {
+            m_Writer.WritePop(static_cast<u16>(lowerVar.Slot));
+        }
+        else
+        {
+            m_Writer.WritePopCount(static_cast<u16>(lowerVar.Size));
+        }
+    }
+private:
+    const Function* m_Function;
+    // Held by reference, the ref count isn't touched.
+    const ModuleRef& m_Module;
+    ArenaVector<LowerVar> m_Vars;
+    ArenaVector<LowerInst> m_Insts;
+    ArenaVector<VarId> m_Operands;
+    ArenaVector<u32> m_OperandSizes;
+    ArenaVector<u16> m_OperandRegisters;
+    ArenaVector<VarId> m_PhiLabels;
+    ArenaVector<LowerBlock> m_Blocks;
+    ArenaVector<u32> m_InstBlocks;
+    // Indexed by label var.
+    ArenaVector<u32> m_LabelBlocks;
+    ArenaVector<PhiCopy> m_Copies;
+    ArenaVector<VarId> m_Stack;
+    ArenaVector<u32> m_SlotSizes;
+    ArenaVector<uSys> m_BlockOffsets;
+    ArenaVector<JumpPatch> m_JumpPatches;
+    ssa::SsaArena* m_Arena;
+    // The first of the vars standing in for the incoming argument registers.
+    VarId m_ArgumentBase;
+    // Holds an immediate that has to be read from a local, one per size class.
+    u32 m_ScratchSlots[4];
+    // Holds an immediate address.
+    u32 m_AddressSlot;
+    bool m_Unreachable;
+    // The code outlives the arena, so the writer uses the heap.
+    IrWriter m_Writer;
+};
+
+Function* SsaToIr::TransformFunction(const Function* const function, const ModuleRef& module, const ssa::SsaCustomTypeRegistry& registry) noexcept
+{
+    ssa::SsaArena arena;
+    return TransformFunction(function, module, registry, arena);
+}
+
+Function* SsaToIr::TransformFunction(const Function* const function, const ModuleRef& module, const ssa::SsaCustomTypeRegistry& registry, ssa::SsaArena& arena) noexcept
+{
+    Function* ret = nullptr;
+
+    {
+        SsaToIrVisitor visitor(function, module, registry, arena);
+
+        if(visitor.Traverse(function) && visitor.Lower())
+        {
+            ret = visitor.BuildFunction();
+        }
+    }
+
+    // The visitor is gone, nothing references the scratch memory anymore.
+    arena.Reset();
+
+    return ret;
+}
+
+ModuleRef SsaToIr::TransformModule(const ModuleRef& module, const ssa::SsaCustomTypeRegistry& registry) noexcept
+{
+    // Native functions have no SSA to lower.
+    if(module->IsNative())
+    {
+        return nullptr;
+    }
+
+    const FunctionList& functions = module->Functions();
+    FunctionList newFunctions(functions.count());
+    bool success = true;
+
+    {
+        ssa::SsaArena arena;
+
+        for(uSys i = 0; i < functions.count(); ++i)
+        {
+            newFunctions[i] = TransformFunction(functions[i], module, registry, arena);
+
+            // The functions keep their indices, so the original IR can stand in for the lowering.
+            if(!newFunctions[i])
+            {
+                newFunctions[i] = CopyFunction(functions[i]);
+            }
+
+            success = success && newFunctions[i];
+        }
+    }
+
+    FunctionList exports(module->Exports().count());
+
+    for(uSys i = 0; success && i < exports.count(); ++i)
+    {
+        const uSys exported = static_cast<uSys>(::std::find(functions.begin(), functions.end(), module->Exports()[i]) - functions.begin());
+
+        if(exported >= functions.count())
+        {
+            success = false;
+            break;
+        }
+
+        exports[i] = newFunctions[exported];
+    }
+
+    if(!success)
+    {
+        for(Function* function : newFunctions)
+        {
+            delete function;
+        }
+
+        return nullptr;
+    }
+
+    ImportModuleList imports(module->Imports().count());
+
+    for(uSys i = 0; i < imports.count(); ++i)
+    {
+        imports[i] = ImportModule(module->Imports()[i].Module(), module->Imports()[i].Functions());
+    }
+
+    return ModuleBuilder()
+        .Functions(::std::move(newFunctions))
+        .Exports(::std::move(exports))
+        .Imports(::std::move(imports))
+        .Emulated()
+        .Name(module->Name())
+        .Build();
+}
+
+}
@@ -13,25 +13,47 @@ constexpr static inline uSys GetOpCodeSize(SsaOpcode opcode) noexcept
 }
 
 SsaWriter::SsaWriter(const uSys initialBufferSize) noexcept
-    : m_Buffer(new(::std::nothrow) u8[maxT(64, initialBufferSize)])
+    : m_Arena(nullptr)
+    , m_Buffer(new(::std::nothrow) u8[maxT(64, initialBufferSize)])
     , m_BufferSize(maxT(64, initialBufferSize))
     , m_WriteIndex(0)
     , m_IdIndex(0)
+    , m_RecordInstructionIndex(false)
+{
+    m_VarTypeMap.emplace_back();
+}
+
+SsaWriter::SsaWriter(SsaArena& arena, const uSys initialBufferSize) noexcept
+    : m_Arena(&arena)
+    , m_Buffer(static_cast<u8*>(arena.Allocate(maxT(64, initialBufferSize), 1)))
+    , m_BufferSize(maxT(64, initialBufferSize))
+    , m_WriteIndex(0)
+    , m_IdIndex(0)
+    , m_VarTypeMap(SsaArenaAllocator<SsaCustomType>(&arena))
+    , m_RecordInstructionIndex(false)
 {
     m_VarTypeMap.emplace_back();
 }
 
 SsaWriter::~SsaWriter() noexcept
 {
-    delete[] m_Buffer;
+    if(!m_Arena)
+    {
+        delete[] m_Buffer;
+    }
 }
 
 SsaWriter::SsaWriter(SsaWriter&& move) noexcept
-    : m_Buffer(move.m_Buffer)
+    : m_Arena(move.m_Arena)
+    , m_Buffer(move.m_Buffer)
     , m_BufferSize(move.m_BufferSize)
     , m_WriteIndex(move.m_WriteIndex)
     , m_IdIndex(move.m_IdIndex)
     , m_VarTypeMap(::std::move(move.m_VarTypeMap))
+    , m_RecordInstructionIndex(move.m_RecordInstructionIndex)
+    , m_InstructionOffsets(::std::move(move.m_InstructionOffsets))
+    , m_InstructionIds(::std::move(move.m_InstructionIds))
+    , m_VarDefinitions(::std::move(move.m_VarDefinitions))
 {
     if(this != &move)
     {
@@ -51,11 +73,21 @@ SsaWriter& SsaWriter::operator=(SsaWriter&& move) noexcept
         return *this;
     }
 
+    if(!m_Arena)
+    {
+        delete[] m_Buffer;
+    }
+
+    m_Arena = move.m_Arena;
     m_Buffer = move.m_Buffer;
     m_BufferSize = move.m_BufferSize;
     m_WriteIndex = move.m_WriteIndex;
     m_IdIndex = move.m_IdIndex;
     m_VarTypeMap = ::std::move(move.m_VarTypeMap);
+    m_RecordInstructionIndex = move.m_RecordInstructionIndex;
+    m_InstructionOffsets = ::std::move(move.m_InstructionOffsets);
+    m_InstructionIds = ::std::move(move.m_InstructionIds);
+    m_VarDefinitions = ::std::move(move.m_VarDefinitions);
 
     move.m_Buffer = nullptr;
 
@@ -70,6 +102,15 @@ void SsaWriter::EnsureSize(const uSys additionalSize) noexcept
     }
 
     const uSys newSize = maxT(m_BufferSize + (m_BufferSize >> 1), m_WriteIndex + additionalSize);
+
+    if(m_Arena)
+    {
+        // Grows in place when the buffer is the most recent allocation, otherwise the old copy is left for the next reset.
+        m_Buffer = static_cast<u8*>(m_Arena->Reallocate(m_Buffer, m_WriteIndex, newSize, 1));
+        m_BufferSize = newSize;
+        return;
+    }
+
     u8* const newBuffer = new(::std::nothrow) u8[newSize];
     (void) ::std::memcpy(newBuffer, m_Buffer, sizeof(newBuffer[0]) * m_WriteIndex);
     m_BufferSize = newSize;
@@ -77,6 +118,65 @@ void SsaWriter::EnsureSize(const uSys additionalSize) noexcept
     m_Buffer = newBuffer;
 }
 
+void SsaWriter::DetachArena() noexcept
+{
+    if(!m_Arena)
+    {
+        return;
+    }
+
+    const uSys size = maxT(m_WriteIndex, static_cast<uSys>(1));
+    u8* const newBuffer = new(::std::nothrow) u8[size];
+    (void) ::std::memcpy(newBuffer, m_Buffer, sizeof(newBuffer[0]) * m_WriteIndex);
+    m_Buffer = newBuffer;
+    m_BufferSize = size;
+
+    VarTypeMapType varTypeMap;
+    varTypeMap.reserve(m_VarTypeMap.size());
+    varTypeMap.insert(varTypeMap.end(), m_VarTypeMap.begin(), m_VarTypeMap.end());
+    m_VarTypeMap = ::std::move(varTypeMap);
+
+    m_Arena = nullptr;
+}
+
+void SsaWriter::Reset(const uSys minimumBufferSize) noexcept
+{
+    m_WriteIndex = 0;
+    m_IdIndex = 0;
+    m_VarTypeMap.clear();
+    m_VarTypeMap.emplace_back();
+    m_InstructionOffsets.clear();
+    m_InstructionIds.clear();
+    m_VarDefinitions.clear();
+
+    // A writer that was moved from has no buffer left.
+    if(!m_Buffer)
+    {
+        const uSys size = maxT(64, minimumBufferSize);
+        m_Buffer = m_Arena ? static_cast<u8*>(m_Arena->Allocate(size, 1)) : new(::std::nothrow) u8[size];
+        m_BufferSize = size;
+        return;
+    }
+
+    EnsureSize(minimumBufferSize);
+}
+
+u32 SsaWriter::VarDefinition(const VarId var) const noexcept
+{
+    if(var == 0 || var > m_IdIndex || (var & 0x80000000) != 0)
+    {
+        return static_cast<u32>(-1);
+    }
+
+    if(var < m_VarDefinitions.size())
+    {
+        return m_VarDefinitions[var];
+    }
+
+    // Defined by the last instruction.
+    return m_InstructionOffsets.empty() ? static_cast<u32>(-1) : InstructionCount() - 1;
+}
+
 void SsaWriter::WriteNop() noexcept
 {
     WriteOpcode(SsaOpcode::Nop);
@@ -321,8 +421,8 @@ void SsaWriter::WriteBranch(const VarId label) noexcept
 
 void SsaWriter::WriteBranchCond(const VarId labelTrue, const VarId labelFalse, const VarId conditionVar) noexcept
 {
-    EnsureSize(GetOpCodeSize(SsaOpcode::Branch) + sizeof(labelTrue) + sizeof(labelFalse) + sizeof(conditionVar));
-    WriteOpcode(SsaOpcode::Branch);
+    EnsureSize(GetOpCodeSize(SsaOpcode::BranchCond) + sizeof(labelTrue) + sizeof(labelFalse) + sizeof(conditionVar));
+    WriteOpcode(SsaOpcode::BranchCond);
     WriteT(labelTrue);
     WriteT(labelFalse);
     WriteT(conditionVar);
@@ -382,6 +482,34 @@ void SsaWriter::WriteRet(const SsaCustomType returnType, const VarId var) noexce
     WriteT(var);
 }
 
+VarId SsaWriter::WritePhi(const SsaCustomType type, const u32 n, const VarId* const labels, const VarId* const vars) noexcept
+{
+    EnsureSize(GetOpCodeSize(SsaOpcode::Phi) + type.Size() + sizeof(n) + n * sizeof(labels[0]) + n * sizeof(vars[0]));
+    WriteOpcode(SsaOpcode::Phi);
+    WriteType(type);
+    WriteT(n);
+    for(uSys i = 0; i < n; ++i)
+    {
+        WriteT(labels[i]);
+    }
+    for(uSys i = 0; i < n; ++i)
+    {
+        WriteT(vars[i]);
+    }
+    m_VarTypeMap.push_back(type);
+    return ++m_IdIndex;
+}
+
+void SsaWriter::PatchVarId(const uSys offset, const VarId var) noexcept
+{
+    if(offset + sizeof(var) > m_WriteIndex)
+    {
+        return;
+    }
+
+    (void) ::std::memcpy(m_Buffer + offset, &var, sizeof(var));
+}
+
 void SsaWriter::WriteRaw(const void* const value, const uSys size) noexcept
 {
     EnsureSize(size);
@@ -391,6 +519,21 @@ void SsaWriter::WriteRaw(const void* const value, const uSys size) noexcept
 
 void SsaWriter::WriteOpcode(const SsaOpcode opcode) noexcept
 {
+    if(m_RecordInstructionIndex)
+    {
+        // Every var since the last instruction was recorded belongs to that instruction.
+        // Before the first instruction this is -1, which also covers var 0.
+        const u32 lastInstruction = InstructionCount() - 1;
+
+        while(m_VarDefinitions.size() <= m_IdIndex)
+        {
+            m_VarDefinitions.push_back(lastInstruction);
+        }
+
+        m_InstructionOffsets.push_back(static_cast<u32>(m_WriteIndex));
+        m_InstructionIds.push_back(m_IdIndex + 1);
+    }
+
     if(static_cast<u16>(opcode) & 0x8000)
     {
         EnsureSize(2);
@@ -414,28 +557,39 @@ void SsaWriter::WriteType(const SsaCustomType type) noexcept
 }
 
 
-SsaFrameTracker::SsaFrameTracker(const uSys localCount) noexcept
-    : m_Locals(new(::std::nothrow) VarId[localCount])
-    , m_Arguments(new(::std::nothrow) VarId[MaxArgumentRegisters])
+SsaFrameTracker::SsaFrameTracker(const uSys localCount, SsaArena* const arena) noexcept
+    : m_Arena(arena)
+    , m_Frame(SsaArenaAllocator<FrameInfo>(arena))
+    , m_Locals(arena ? static_cast<VarId*>(arena->Allocate(sizeof(VarId) * localCount, alignof(VarId))) : new(::std::nothrow) VarId[localCount])
+    , m_Arguments(arena ? static_cast<VarId*>(arena->Allocate(sizeof(VarId) * MaxArgumentRegisters, alignof(VarId))) : new(::std::nothrow) VarId[MaxArgumentRegisters])
 #ifdef _DEBUG
     , m_LocalCount(localCount)
 #endif
 {
+    // Var 0 is never assigned, it marks a local that hasn't been written yet.
+    for(uSys i = 0; i < localCount; ++i)
+    {
+        m_Locals[i] = 0;
+    }
+
     for(u32 i = 0; i < MaxArgumentRegisters; ++i)
     {
         m_Arguments[i] = i | 0x80000000;
     }
-
 }
 
 SsaFrameTracker::~SsaFrameTracker() noexcept
 {
-    delete[] m_Locals;
-    delete[] m_Arguments;
+    if(!m_Arena)
+    {
+        delete[] m_Locals;
+        delete[] m_Arguments;
+    }
 }
 
 SsaFrameTracker::SsaFrameTracker(SsaFrameTracker&& move) noexcept
-    : m_Frame(::std::move(move.m_Frame))
+    : m_Arena(move.m_Arena)
+    , m_Frame(::std::move(move.m_Frame))
     , m_Locals(move.m_Locals)
     , m_Arguments(move.m_Arguments)
 #ifdef _DEBUG
@@ -456,9 +610,13 @@ SsaFrameTracker& SsaFrameTracker::operator=(SsaFrameTracker&& move) noexcept
         return *this;
     }
 
-    delete[] m_Locals;
-    delete[] m_Arguments;
+    if(!m_Arena)
+    {
+        delete[] m_Locals;
+        delete[] m_Arguments;
+    }
 
+    m_Arena = move.m_Arena;
     m_Frame = ::std::move(move.m_Frame);
     m_Locals = move.m_Locals;
     m_Arguments = move.m_Arguments;
@@ -0,0 +1,70 @@
+#include "TauIR/TraceBuffer.hpp"
+#include <TUMaths.hpp>
+#include <atomic>
+#include <chrono>
+
+namespace tau::ir {
+
+static uSys RoundUpPowerOfTwo(const uSys value) noexcept
+{
+    uSys ret = 1;
+
+    while(ret < value)
+    {
+        ret <<= 1;
+    }
+
+    return ret;
+}
+
+static i64 SteadyClockNanoseconds() noexcept
+{
+    return ::std::chrono::duration_cast<::std::chrono::nanoseconds>(::std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+TraceBuffer::TraceBuffer(const uSys capacity) noexcept
+    : m_Events(RoundUpPowerOfTwo(capacity))
+    , m_Mask(m_Events.Count() - 1)
+    , m_Epoch(SteadyClockNanoseconds())
+    , m_WriteIndex(0)
+{
+    m_Events.MemSetAll(0);
+}
+
+u64 TraceBuffer::Now() const noexcept
+{
+    return static_cast<u64>(SteadyClockNanoseconds() - m_Epoch);
+}
+
+::std::vector<TraceEvent> TraceBuffer::Snapshot() const noexcept
+{
+    const u64 capacity = m_Events.Count();
+
+    const u64 endIndex = m_WriteIndex.load(::std::memory_order_acquire);
+    const u64 beginIndex = endIndex > capacity ? endIndex - capacity : 0;
+
+    ::std::vector<TraceEvent> events;
+    events.reserve(static_cast<uSys>(endIndex - beginIndex));
+
+    for(u64 i = beginIndex; i < endIndex; ++i)
+    {
+        events.push_back(m_Events[static_cast<uSys>(i & m_Mask)]);
+    }
+
+    // Keeps the copies above from being reordered past the check below.
+    ::std::atomic_thread_fence(::std::memory_order_acquire);
+
+    // Anything the writer lapped while we were copying may be torn, this
+    // includes the slot of newEndIndex, which is filled before it is published.
+    const u64 newEndIndex = m_WriteIndex.load(::std::memory_order_relaxed);
+
+    if(newEndIndex - beginIndex >= capacity)
+    {
+        const u64 overwritten = minT<u64>(newEndIndex - beginIndex - capacity + 1, events.size());
+        events.erase(events.begin(), events.begin() + static_cast<iSys>(overwritten));
+    }
+
+    return events;
+}
+
+}
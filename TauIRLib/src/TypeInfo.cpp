@@ -8,33 +8,33 @@
 namespace tau::ir {
 
 #if defined(TAU_IR_DEBUG_TYPES)
-const TypeInfo TypeInfo::Void(0, TypeInfoFlags::Void(), u8"void");
-const TypeInfo TypeInfo::Bool(1, TypeInfoFlags::UnsignedInteger(), u8"bool");
-const TypeInfo TypeInfo::I8(1, TypeInfoFlags::SignedInteger(), u8"i8");
-const TypeInfo TypeInfo::I16(2, TypeInfoFlags::SignedInteger(), u8"i16");
-const TypeInfo TypeInfo::I32(4, TypeInfoFlags::SignedInteger(), u8"i32");
-const TypeInfo TypeInfo::I64(8, TypeInfoFlags::SignedInteger(), u8"i64");
-const TypeInfo TypeInfo::U8(1, TypeInfoFlags::UnsignedInteger(), u8"u8");
-const TypeInfo TypeInfo::U16(2, TypeInfoFlags::UnsignedInteger(), u8"u16");
-const TypeInfo TypeInfo::U32(4, TypeInfoFlags::UnsignedInteger(), u8"u32");
-const TypeInfo TypeInfo::U64(8, TypeInfoFlags::UnsignedInteger(), u8"u64");
-const TypeInfo TypeInfo::F32(4, TypeInfoFlags::Float(), u8"f32");
-const TypeInfo TypeInfo::F64(8, TypeInfoFlags::Float(), u8"f64");
-const TypeInfo TypeInfo::Char(1, TypeInfoFlags::Char(), u8"char");
+const TypeInfo TypeInfo::Void(TypeInfoPrimitive::Void, 0, TypeInfoFlags::Void(), u8"void");
+const TypeInfo TypeInfo::Bool(TypeInfoPrimitive::Bool, 1, TypeInfoFlags::UnsignedInteger(), u8"bool");
+const TypeInfo TypeInfo::I8(TypeInfoPrimitive::I8, 1, TypeInfoFlags::SignedInteger(), u8"i8");
+const TypeInfo TypeInfo::I16(TypeInfoPrimitive::I16, 2, TypeInfoFlags::SignedInteger(), u8"i16");
+const TypeInfo TypeInfo::I32(TypeInfoPrimitive::I32, 4, TypeInfoFlags::SignedInteger(), u8"i32");
+const TypeInfo TypeInfo::I64(TypeInfoPrimitive::I64, 8, TypeInfoFlags::SignedInteger(), u8"i64");
+const TypeInfo TypeInfo::U8(TypeInfoPrimitive::U8, 1, TypeInfoFlags::UnsignedInteger(), u8"u8");
+const TypeInfo TypeInfo::U16(TypeInfoPrimitive::U16, 2, TypeInfoFlags::UnsignedInteger(), u8"u16");
+const TypeInfo TypeInfo::U32(TypeInfoPrimitive::U32, 4, TypeInfoFlags::UnsignedInteger(), u8"u32");
+const TypeInfo TypeInfo::U64(TypeInfoPrimitive::U64, 8, TypeInfoFlags::UnsignedInteger(), u8"u64");
+const TypeInfo TypeInfo::F32(TypeInfoPrimitive::F32, 4, TypeInfoFlags::Float(), u8"f32");
+const TypeInfo TypeInfo::F64(TypeInfoPrimitive::F64, 8, TypeInfoFlags::Float(), u8"f64");
+const TypeInfo TypeInfo::Char(TypeInfoPrimitive::Char, 1, TypeInfoFlags::Char(), u8"char");
 #else
-const TypeInfo TypeInfo::Void(0, TypeInfoFlags::Void());
-const TypeInfo TypeInfo::Bool(1, TypeInfoFlags::UnsignedInteger());
-const TypeInfo TypeInfo::I8(1, TypeInfoFlags::SignedInteger());
-const TypeInfo TypeInfo::I16(2, TypeInfoFlags::SignedInteger());
-const TypeInfo TypeInfo::I32(4, TypeInfoFlags::SignedInteger());
-const TypeInfo TypeInfo::I64(8, TypeInfoFlags::SignedInteger());
-const TypeInfo TypeInfo::U8(1, TypeInfoFlags::UnsignedInteger());
-const TypeInfo TypeInfo::U16(2, TypeInfoFlags::UnsignedInteger());
-const TypeInfo TypeInfo::U32(4, TypeInfoFlags::UnsignedInteger());
-const TypeInfo TypeInfo::U64(8, TypeInfoFlags::UnsignedInteger());
-const TypeInfo TypeInfo::F32(4, TypeInfoFlags::Float());
-const TypeInfo TypeInfo::F64(8, TypeInfoFlags::Float());
-const TypeInfo TypeInfo::Char(1, TypeInfoFlags::Char());
+const TypeInfo TypeInfo::Void(TypeInfoPrimitive::Void, 0, TypeInfoFlags::Void());
+const TypeInfo TypeInfo::Bool(TypeInfoPrimitive::Bool, 1, TypeInfoFlags::UnsignedInteger());
+const TypeInfo TypeInfo::I8(TypeInfoPrimitive::I8, 1, TypeInfoFlags::SignedInteger());
+const TypeInfo TypeInfo::I16(TypeInfoPrimitive::I16, 2, TypeInfoFlags::SignedInteger());
+const TypeInfo TypeInfo::I32(TypeInfoPrimitive::I32, 4, TypeInfoFlags::SignedInteger());
+const TypeInfo TypeInfo::I64(TypeInfoPrimitive::I64, 8, TypeInfoFlags::SignedInteger());
+const TypeInfo TypeInfo::U8(TypeInfoPrimitive::U8, 1, TypeInfoFlags::UnsignedInteger());
+const TypeInfo TypeInfo::U16(TypeInfoPrimitive::U16, 2, TypeInfoFlags::UnsignedInteger());
+const TypeInfo TypeInfo::U32(TypeInfoPrimitive::U32, 4, TypeInfoFlags::UnsignedInteger());
+const TypeInfo TypeInfo::U64(TypeInfoPrimitive::U64, 8, TypeInfoFlags::UnsignedInteger());
+const TypeInfo TypeInfo::F32(TypeInfoPrimitive::F32, 4, TypeInfoFlags::Float());
+const TypeInfo TypeInfo::F64(TypeInfoPrimitive::F64, 8, TypeInfoFlags::Float());
+const TypeInfo TypeInfo::Char(TypeInfoPrimitive::Char, 1, TypeInfoFlags::Char());
 #endif
 
 /**
@@ -64,6 +64,12 @@ static FixedBlockAllocator<TAU_IR_ALLOCATION_TRACKING>* g_allocator = ::new(::st
  * release a deadlock.
  */
 static ::std::mutex g_allocatorMutex;
+/**
+ * \brief The number of live blocks in the global allocator.
+ *
+ *   This is guarded by the allocator mutex.
+ */
+static uSys g_allocationCount = 0;
 
 void* TypeInfo::operator new(const ::std::size_t sz) noexcept
 {
@@ -74,7 +80,14 @@ void* TypeInfo::operator new(const ::std::size_t sz) noexcept
 
     ::std::lock_guard lock(g_allocatorMutex);
 
-    return g_allocator->Allocate(sz);
+    void* const ret = g_allocator->Allocate(sz);
+
+    if(ret)
+    {
+        ++g_allocationCount;
+    }
+
+    return ret;
 }
 
 void TypeInfo::operator delete(void* const ptr) noexcept
@@ -87,6 +100,14 @@ void TypeInfo::operator delete(void* const ptr) noexcept
     ::std::lock_guard lock(g_allocatorMutex);
 
     g_allocator->Deallocate(ptr);
+    --g_allocationCount;
+}
+
+FixedBlockAllocatorStats TypeInfo::AllocatorStats() noexcept
+{
+    ::std::lock_guard lock(g_allocatorMutex);
+
+    return { AlignTo<uSys, 8>(sizeof(TypeInfo)), g_allocationCount };
 }
 
 
@@ -3,25 +3,72 @@
 #include "TauIR/Module.hpp"
 #include "TauIR/TypeInfo.hpp"
 #include "TauIR/ByteCodeDumper.hpp"
+#include "TauIR/MemoryReportDumper.hpp"
+#include "TauIR/TraceDumper.hpp"
 #include "TauIR/IrToSsa.hpp"
+#include "TauIR/SsaToIr.hpp"
+#include "TauIR/IrGenerator.hpp"
+#include "TauIR/IntMath.hpp"
+#include "TauIR/MemoryReport.hpp"
+#include "TauIR/ExecutionProfile.hpp"
+#include "TauIR/TraceBuffer.hpp"
 #include "TauIR/FunctionNameMangler.hpp"
 #include "TauIR/file/BinaryObject.hpp"
 
 #include <ConPrinter.hpp>
-
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+#include "TauIR/ssa/SsaFunctionAttachment.hpp"
+#include "TauIR/ssa/SsaCallGraph.hpp"
+#include "TauIR/ssa/SsaGraph.hpp"
+#include "TauIR/ssa/SsaLivenessAnalysis.hpp"
 #include "TauIR/ssa/SsaTypes.hpp"
+#include "TauIR/ssa/SsaVariableAnalysis.hpp"
+#include "TauIR/ssa/opto/CommonSubexpressionElimination.hpp"
 #include "TauIR/ssa/opto/ConstantProp.hpp"
 #include "TauIR/ssa/opto/DeadCodeElimination.hpp"
 #include "TauIR/ssa/opto/Inliner.hpp"
+#include "TauIR/ssa/opto/JoinSplitFolding.hpp"
+#include "TauIR/ssa/opto/LoadStoreElimination.hpp"
+#include "TauIR/ssa/opto/LoopInvariantCodeMotion.hpp"
+#include "TauIR/ssa/opto/PassManager.hpp"
+#include "TauIR/ssa/opto/StrengthReduction.hpp"
 
 static void TestSsa() noexcept;
 static void TestIrToSsa() noexcept;
 static void TestIrToSsaCallInd() noexcept;
+static void TestIrToSsaControlFlow() noexcept;
+static void TestIrToSsaParallel() noexcept;
+static void TestSsaToIr() noexcept;
+static void TestSsaToIrMemory() noexcept;
+static void TestSsaGraph() noexcept;
+static void TestSsaDefUseIndex() noexcept;
+static void TestSsaReverseTraversal() noexcept;
+static void TestCommonSubexpressionElimination() noexcept;
+static void TestLoopInvariantCodeMotion() noexcept;
+static void TestStrengthReduction() noexcept;
+static void TestDivisionMagic() noexcept;
+static void TestJoinSplitFolding() noexcept;
+static void TestSsaVariableAnalysis() noexcept;
+static void TestSsaLivenessAnalysis() noexcept;
+static void TestInliner() noexcept;
+static void TestDeadFunctionElimination() noexcept;
+static void TestFunctionSpecialization() noexcept;
+static void TestLoadStoreElimination() noexcept;
+static void TestPassManager() noexcept;
 static void TestCall() noexcept;
 static void TestCallInd() noexcept;
 static void TestPrint() noexcept;
 static void TestCond() noexcept;
 static void TestWriteFile() noexcept;
+static void TestIrGenerator() noexcept;
+static void TestMemoryReport() noexcept;
+static void TestProfile() noexcept;
+static void TestTrace() noexcept;
 
 int main(int argCount, char* args[])
 {
@@ -30,11 +77,34 @@ int main(int argCount, char* args[])
     TestSsa();
     TestIrToSsa();
     TestIrToSsaCallInd();
+    TestIrToSsaControlFlow();
+    TestIrToSsaParallel();
+    TestSsaToIr();
+    TestSsaToIrMemory();
+    TestSsaGraph();
+    TestSsaDefUseIndex();
+    TestSsaReverseTraversal();
+    TestCommonSubexpressionElimination();
+    TestLoopInvariantCodeMotion();
+    TestStrengthReduction();
+    TestDivisionMagic();
+    TestJoinSplitFolding();
+    TestSsaVariableAnalysis();
+    TestSsaLivenessAnalysis();
+    TestInliner();
+    TestDeadFunctionElimination();
+    TestFunctionSpecialization();
+    TestLoadStoreElimination();
+    TestPassManager();
     TestCall();
     TestCallInd();
     TestPrint();
     TestCond();
     TestWriteFile();
+    TestIrGenerator();
+    TestMemoryReport();
+    TestProfile();
+    TestTrace();
 
     return 0;
 }
@@ -50,7 +120,7 @@ static void TestSsa() noexcept
         0x30, 0x04, 0x04, 0x00, 0x00, 0x00,                                     // i32 %1 = 4
         0x31, 0x04, 0x01, 0x00, 0x00, 0x00,                                     // i32 %2 = %1
         0x52, 0x02, 0x04, 0x02, 0x00, 0x00, 0x00, 0x07, 0x00, 0x00, 0x00,       // i32 %3 = %2 * 7
-        0x3A, 0x00, 0x00, 0x00, 0x80, 0x01, 0x00, 0x00, 0x80, 0x04, 0x00, 0x17, // void* %4 = [%a0 + %a1 * 4 + 23]
+        0x3A, 0x00, 0x00, 0x00, 0x80, 0x01, 0x00, 0x00, 0x80, 0x04, 0x17, 0x00, // void* %4 = [%a0 + %a1 * 4 + 23]
         0x36, 0x84, 0x80, 0x04, 0x00, 0x00, 0x00,                               // i32* %5 = %4
         0x39, 0x04, 0x05, 0x00, 0x00, 0x00, 0x03, 0x00, 0x00, 0x00,             // Store i32 %5, %3
         0x37, 0x08, 0x04, 0x03, 0x00, 0x00, 0x00,                               // u32 %6 = RCast u32 %3
@@ -250,85 +320,1843 @@ static void TestIrToSsa() noexcept
         visitor.Traverse(mainFunc);
         visitor.UpdateAttachment(mainFunc);
 
-        tau::ir::ssa::DumpSsa(mainFunc, 0, registry);
+        tau::ir::ssa::DumpSsa(mainFunc, 0, registry);
+    }
+
+    {
+        tau::ir::ssa::opto::InlinerVisitor visitor(registry, mainModule);
+        visitor.Traverse(squareFunc);
+        visitor.UpdateAttachment(squareFunc);
+
+        tau::ir::ssa::DumpSsa(squareFunc, 1, registry);
+    }
+
+    ConPrinter::PrintLn();
+
+    optoPass();
+}
+
+static void TestIrToSsaCallInd() noexcept
+{
+    ConPrinter::PrintLn();
+    ConPrinter::PrintLn("Test IR to SSA Call Ind:");
+
+    using namespace tau::ir;
+    using namespace tau::ir::ssa;
+
+    const u8 codeSquare[] = {
+        0x30,   // Push.Arg.0
+        0x30,   // Push.Arg.0
+        0x39,   // Mul.i64
+        0x40,   // Pop.Arg.0
+        0x1D    // Ret
+    };
+
+    // Expect 259
+    const u8 codeMain[] = {
+        0x8B, 0x00, 0x10, 0x00, 0x00, 0x00, // Const.N 16
+        0x29,                               // Expand.SX.4.8
+        0x40,                               // Pop.Arg.0
+        0x15,                               // Const.1 <Square>
+        0x20,                               // Pop.0
+        0x80, 0x1D, 0x00, 0x00,             // Call.Ind 0
+        0x17,                               // Const.3
+        0x30,                               // Push.Arg.0
+        0x2A,                               // Trunc.8.4
+        0x34,                               // Add.i32
+        0x29,                               // Expand.SX.4.8
+        0x40,                               // Pop.Arg.0
+        0x1D                                // Ret
+    };
+
+    DynArray<FunctionArgument> squareArgs(1);
+    squareArgs[0] = FunctionArgument(true, 0);
+
+    const C8DynString squareMangledName = MangleFunctionName(squareArgs);
+
+    ConPrinter::PrintLn("Square Mangled Name: {}", squareMangledName);
+
+    DynArray<const TypeInfo*> mainLocalTypes(1);
+    mainLocalTypes[0] = TypeInfo::Builder().Size(4).Flags(TypeInfoFlags::Function()).Name(squareMangledName).Build();
+
+    {
+        // Function types with the same mangled name share one interned signature.
+        const TypeInfo* const otherType = TypeInfo::Builder().Size(4).Flags(TypeInfoFlags::Function()).Name(squareMangledName).Build();
+        const FunctionSignature* const signature = otherType->Signature();
+
+        if(!signature || signature != mainLocalTypes[0]->Signature())
+        {
+            ConPrinter::PrintLn("The function types don't share a signature.");
+        }
+        else if(signature->Arguments().Count() != squareArgs.Count() || !signature->Arguments()[0].IsRegister)
+        {
+            ConPrinter::PrintLn("The signature has {} arguments instead of {}.", signature->Arguments().Count(), squareArgs.Count());
+        }
+
+        delete otherType;
+
+        // There's no mangled name to intern for an unnamed function type.
+        const TypeInfo unnamedType(4, TypeInfoFlags::Function());
+
+        if(unnamedType.Signature())
+        {
+            ConPrinter::PrintLn("The unnamed function type has a signature.");
+        }
+    }
+
+    Function* const mainFunc = FunctionBuilder()
+        .Code(codeMain)
+        .LocalTypes(mainLocalTypes)
+        .Arguments()
+        .Flags(InlineControl::NoInline, CallingConvention::Default, OptimizationControl::Default, false)
+        .Name(u8"Main")
+        .Build();
+    Function* const squareFunc = FunctionBuilder()
+        .Code(codeSquare)
+        .LocalTypes()
+        .Arguments(squareArgs)
+        .Flags()
+        .Name(u8"Square")
+        .Build();
+
+    FunctionList functions(2);
+    functions[0] = mainFunc;
+    functions[1] = squareFunc;
+
+    const ModuleRef mainModule = ModuleBuilder()
+        .Functions(::std::move(functions))
+        .Exports()
+        .Imports()
+        .Emulated()
+        .Name(u8"Main")
+        .Build();
+
+    DumpFunction(mainFunc, 0, mainModule, 0);
+    ConPrinter::PrintLn();
+    DumpFunction(squareFunc, 1, mainModule, 0);
+    ConPrinter::PrintLn();
+
+    const SsaCustomTypeRegistry registry;
+    IrToSsa::TransformFunction(mainFunc, mainModule, 0);
+    IrToSsa::TransformFunction(squareFunc, mainModule, 0);
+
+    DumpSsa(mainFunc, 0, registry);
+    DumpSsa(squareFunc, 1, registry);
+    ConPrinter::PrintLn();
+    const auto optoPass = [&]() {
+        // Constant Prop
+        {
+            tau::ir::ssa::opto::ConstantPropVisitor visitor(registry);
+            visitor.Traverse(mainFunc);
+            visitor.UpdateAttachment(mainFunc);
+
+            tau::ir::ssa::DumpSsa(mainFunc, 0, registry);
+        }
+
+        {
+            tau::ir::ssa::opto::ConstantPropVisitor visitor(registry);
+            visitor.Traverse(squareFunc);
+            visitor.UpdateAttachment(squareFunc);
+
+            tau::ir::ssa::DumpSsa(squareFunc, 1, registry);
+        }
+
+        ConPrinter::PrintLn();
+
+        // Usage Analysis
+        {
+            tau::ir::ssa::opto::UsageAnalyzerVisitor visitor(registry);
+            visitor.Traverse(mainFunc);
+            visitor.UpdateAttachment(mainFunc);
+        }
+
+        {
+            tau::ir::ssa::opto::UsageAnalyzerVisitor visitor(registry);
+            visitor.Traverse(squareFunc);
+            visitor.UpdateAttachment(squareFunc);
+        }
+
+        ConPrinter::PrintLn();
+
+        // Dead Code Elimination
+        {
+            tau::ir::ssa::opto::DeadCodeEliminationVisitor visitor(registry, mainFunc);
+            visitor.Traverse(mainFunc);
+            visitor.UpdateAttachment(mainFunc);
+
+            tau::ir::ssa::DumpSsa(mainFunc, 0, registry);
+        }
+
+        {
+            tau::ir::ssa::opto::DeadCodeEliminationVisitor visitor(registry, squareFunc);
+            visitor.Traverse(squareFunc);
+            visitor.UpdateAttachment(squareFunc);
+
+            tau::ir::ssa::DumpSsa(squareFunc, 1, registry);
+        }
+
+        ConPrinter::PrintLn();
+    };
+
+    optoPass();
+
+    // Inline
+    {
+        tau::ir::ssa::opto::InlinerVisitor visitor(registry, mainModule);
+        visitor.Traverse(mainFunc);
+        visitor.UpdateAttachment(mainFunc);
+
+        tau::ir::ssa::DumpSsa(mainFunc, 0, registry);
+    }
+
+    {
+        tau::ir::ssa::opto::InlinerVisitor visitor(registry, mainModule);
+        visitor.Traverse(squareFunc);
+        visitor.UpdateAttachment(squareFunc);
+
+        tau::ir::ssa::DumpSsa(squareFunc, 1, registry);
+    }
+
+    ConPrinter::PrintLn();
+
+    optoPass();
+}
+
+static void TestIrToSsaControlFlow() noexcept
+{
+    ConPrinter::PrintLn();
+    ConPrinter::PrintLn("Test IR to SSA Control Flow:");
+
+    using namespace tau::ir;
+
+    // Branches and nested loops, every function should translate and survive the passes.
+    ModuleRef module = IrGenerator()
+        .Seed(0xCF5A)
+        .FunctionCount(2)
+        .StatementCount(12)
+        .LocalCount(4)
+        .BranchDensity(40)
+        .LoopNesting(2)
+        .LoopTripCount(3)
+        .Build();
+
+    const ssa::SsaCustomTypeRegistry registry;
+
+    for(uSys i = 0; i < module->Functions().Count(); ++i)
+    {
+        Function* const function = module->Functions()[i];
+
+        if(!IrToSsa::TransformFunction(function, module, 0))
+        {
+            ConPrinter::PrintLn("Failed to transform function {}.", i);
+            continue;
+        }
+
+        ssa::DumpSsa(function, i, registry);
+        ConPrinter::PrintLn();
+
+        {
+            ssa::opto::ConstantPropVisitor visitor(registry);
+            visitor.Traverse(function);
+            visitor.UpdateAttachment(function);
+        }
+
+        {
+            ssa::opto::UsageAnalyzerVisitor visitor(registry);
+            visitor.Traverse(function);
+            visitor.UpdateAttachment(function);
+        }
+
+        {
+            ssa::opto::DeadCodeEliminationVisitor visitor(registry, function);
+            visitor.Traverse(function);
+            visitor.UpdateAttachment(function);
+        }
+
+        ssa::DumpSsa(function, i, registry);
+        ConPrinter::PrintLn();
+    }
+}
+
+static void TestIrToSsaParallel() noexcept
+{
+    ConPrinter::PrintLn();
+    ConPrinter::PrintLn("Test IR to SSA Parallel:");
+
+    using namespace tau::ir;
+
+    const auto buildModule = []()
+    {
+        return IrGenerator()
+            .Seed(0x7A5C)
+            .FunctionCount(24)
+            .StatementCount(32)
+            .CallDepth(3)
+            .BranchDensity(20)
+            .LoopNesting(1)
+            .Build();
+    };
+
+    ModuleRef serialModule = buildModule();
+    ModuleRef parallelModule = buildModule();
+
+    (void) IrToSsa::TransformModule(serialModule, 0, 1);
+    (void) IrToSsa::TransformModule(parallelModule, 0, 4);
+
+    uSys mismatchCount = 0;
+
+    for(uSys i = 0; i < serialModule->Functions().Count(); ++i)
+    {
+        const ssa::SsaWriterFunctionAttachment* const serial = serialModule->Functions()[i]->FindAttachment<ssa::SsaWriterFunctionAttachment>();
+        const ssa::SsaWriterFunctionAttachment* const parallel = parallelModule->Functions()[i]->FindAttachment<ssa::SsaWriterFunctionAttachment>();
+
+        if(!serial || !parallel)
+        {
+            if(serial != parallel)
+            {
+                ++mismatchCount;
+            }
+            continue;
+        }
+
+        if(serial->Writer().Size() != parallel->Writer().Size() || ::std::memcmp(serial->Writer().Buffer(), parallel->Writer().Buffer(), serial->Writer().Size()) != 0)
+        {
+            ++mismatchCount;
+        }
+    }
+
+    ConPrinter::PrintLn("{} of {} functions differ between 1 and 4 threads.", mismatchCount, serialModule->Functions().Count());
+}
+
+static void TestSsaToIr() noexcept
+{
+    ConPrinter::PrintLn();
+    ConPrinter::PrintLn("Test SSA to IR:");
+
+    using namespace tau::ir;
+
+    // The lowered module has to compute the same value as the original.
+    ModuleRef module = IrGenerator()
+        .Seed(0x5510)
+        .FunctionCount(6)
+        .StatementCount(24)
+        .CallDepth(2)
+        .LocalCount(6)
+        .BranchDensity(25)
+        .LoopNesting(2)
+        .LoopTripCount(3)
+        .Build();
+
+    Emulator originalEmulator(module);
+    originalEmulator.Execute();
+    const u64 originalRetVal = originalEmulator.ReturnVal();
+
+    (void) IrToSsa::TransformModule(module, 0, 1);
+
+    const ssa::SsaCustomTypeRegistry registry;
+    ModuleRef lowered = SsaToIr::TransformModule(module, registry);
+
+    if(!lowered)
+    {
+        ConPrinter::PrintLn("Failed to lower the module.");
+        return;
+    }
+
+    ::tau::ir::DumpFunction(lowered->Functions()[0], 0, lowered, 0);
+    ConPrinter::PrintLn();
+
+    Emulator loweredEmulator(lowered);
+    loweredEmulator.Execute();
+    const u64 loweredRetVal = loweredEmulator.ReturnVal();
+
+    ConPrinter::PrintLn("Return Val: {} -> {}", originalRetVal, loweredRetVal);
+    ConPrinter::PrintLn("Code Size: {} -> {}", module->Functions()[0]->CodeSize(), lowered->Functions()[0]->CodeSize());
+
+    if(originalRetVal != loweredRetVal)
+    {
+        ConPrinter::PrintLn("The lowered module returned a different value: {} != {}", loweredRetVal, originalRetVal);
+    }
+}
+
+static void TestSsaToIrMemory() noexcept
+{
+    ConPrinter::PrintLn();
+    ConPrinter::PrintLn("Test SSA to IR Memory (Expect 150):");
+
+    using namespace tau::ir;
+
+    u64 buffer[4] = { 100, 0, 0, 40 };
+    const u64 address = reinterpret_cast<u64>(buffer);
+
+    // Main is only ever run lowered, its IR is a placeholder.
+    IrWriter mainWriter;
+    mainWriter.WriteRet();
+
+    // The SSA of Seven can't be lowered, so its IR has to be kept.
+    IrWriter sevenWriter;
+    sevenWriter.WriteConstant(7);
+    sevenWriter.WriteExpandZX(4, 8);
+    sevenWriter.WritePopArg(0);
+    sevenWriter.WriteRet();
+
+    FunctionList functions(2);
+    functions[0] = FunctionBuilder()
+        .Address(mainWriter.Buffer())
+        .CodeSize(mainWriter.Size())
+        .LocalTypes()
+        .Arguments()
+        .Flags()
+        .Name(u8"Main")
+        .Attachment<IrWriterFunctionAttachment>(::std::move(mainWriter))
+        .Build();
+    functions[1] = FunctionBuilder()
+        .Address(sevenWriter.Buffer())
+        .CodeSize(sevenWriter.Size())
+        .LocalTypes()
+        .Arguments()
+        .Flags()
+        .Name(u8"Seven")
+        .Attachment<IrWriterFunctionAttachment>(::std::move(sevenWriter))
+        .Build();
+
+    ModuleRef module = ModuleBuilder()
+        .Functions(::std::move(functions))
+        .Exports()
+        .Imports()
+        .Emulated()
+        .Name(u8"Memory")
+        .Build();
+
+    {
+        const ssa::SsaCustomType type(ssa::SsaType::U64);
+        const u64 one = 1;
+        const u64 two = 2;
+
+        ssa::SsaWriter writer;
+        const ssa::VarId base = writer.WriteAssignImmediate(type, &address, sizeof(address));
+        const ssa::VarId index = writer.WriteAssignImmediate(type, &one, sizeof(one));
+        const ssa::VarId second = writer.WriteComputePtr(base, index, 8, 0);
+        const ssa::VarId third = writer.WriteComputePtr(base, base, 0, 16);
+        const ssa::VarId fourth = writer.WriteComputePtr(base, base, 0, 24);
+        writer.WriteStoreI(type, second, &two, sizeof(two));
+        writer.WriteStoreV(type, third, index);
+        // 100 + 2 + 1 + the low half of 40, and the 7 from Seven.
+        const ssa::VarId a = writer.WriteLoad(type, base);
+        const ssa::VarId b = writer.WriteLoad(type, second);
+        const ssa::VarId c = writer.WriteLoad(type, third);
+        const ssa::VarId d = writer.WriteExpandZX(type, ssa::SsaType::U32, writer.WriteLoad(ssa::SsaType::U32, fourth));
+        const ssa::VarId e = writer.WriteCall(1, 0, 0);
+        const ssa::VarId ab = writer.WriteBinOpVtoV(ssa::SsaBinaryOperation::Add, type, a, b);
+        const ssa::VarId cd = writer.WriteBinOpVtoV(ssa::SsaBinaryOperation::Add, type, c, d);
+        const ssa::VarId abcd = writer.WriteBinOpVtoV(ssa::SsaBinaryOperation::Add, type, ab, cd);
+        writer.WriteRet(type, writer.WriteBinOpVtoV(ssa::SsaBinaryOperation::Add, type, abcd, e));
+
+        module->Functions()[0]->Attach<ssa::SsaWriterFunctionAttachment>(::std::move(writer));
+    }
+
+    {
+        const ssa::SsaCustomType type(ssa::SsaType::F32);
+        const f32 half = 0.5f;
+        const u64 ninetyNine = 99;
+
+        ssa::SsaWriter writer;
+        const ssa::VarId a = writer.WriteAssignImmediate(type, &half, sizeof(half));
+        (void) writer.WriteBinOpVtoV(ssa::SsaBinaryOperation::Add, type, a, a);
+        writer.WriteRet(ssa::SsaType::U64, writer.WriteAssignImmediate(ssa::SsaType::U64, &ninetyNine, sizeof(ninetyNine)));
+
+        module->Functions()[1]->Attach<ssa::SsaWriterFunctionAttachment>(::std::move(writer));
+    }
+
+    const ssa::SsaCustomTypeRegistry registry;
+    ModuleRef lowered = SsaToIr::TransformModule(module, registry);
+
+    if(!lowered)
+    {
+        ConPrinter::PrintLn("Failed to lower the module.");
+        return;
+    }
+
+    Emulator loweredEmulator(lowered);
+    loweredEmulator.Execute();
+
+    ConPrinter::PrintLn("Return Val: {}", loweredEmulator.ReturnVal());
+
+    if(loweredEmulator.ReturnVal() != 150 || buffer[1] != 2 || buffer[2] != 1)
+    {
+        ConPrinter::PrintLn("The lowered module returned {} and stored {} and {}.", loweredEmulator.ReturnVal(), buffer[1], buffer[2]);
+    }
+
+    // The loads and stores of the lowered code have to survive another round trip.
+    buffer[1] = 0;
+    buffer[2] = 0;
+
+    (void) IrToSsa::TransformModule(lowered, 0, 1);
+    ModuleRef relowered = SsaToIr::TransformModule(lowered, registry);
+
+    if(!relowered)
+    {
+        ConPrinter::PrintLn("Failed to lower the lifted module.");
+        return;
+    }
+
+    Emulator reloweredEmulator(relowered);
+    reloweredEmulator.Execute();
+
+    if(reloweredEmulator.ReturnVal() != 150 || buffer[1] != 2 || buffer[2] != 1)
+    {
+        ConPrinter::PrintLn("The lifted module returned {} and stored {} and {}.", reloweredEmulator.ReturnVal(), buffer[1], buffer[2]);
+    }
+}
+
+static void TestSsaGraph() noexcept
+{
+    ConPrinter::PrintLn();
+    ConPrinter::PrintLn("Test SSA Graph:");
+
+    using namespace tau::ir;
+
+    ModuleRef module = IrGenerator()
+        .Seed(0x6A4F)
+        .FunctionCount(8)
+        .StatementCount(32)
+        .CallDepth(2)
+        .BranchDensity(20)
+        .LoopNesting(2)
+        .Build();
+
+    (void) IrToSsa::TransformModule(module, 0, 1);
+
+    const ssa::SsaCustomTypeRegistry registry;
+    ssa::SsaGraph graph;
+    uSys mismatchCount = 0;
+
+    // Decoding and encoding without any changes has to give back the same bytes.
+    for(uSys i = 0; i < module->Functions().Count(); ++i)
+    {
+        const ssa::SsaWriterFunctionAttachment* const attachment = module->Functions()[i]->FindAttachment<ssa::SsaWriterFunctionAttachment>();
+
+        if(!attachment || !graph.Decode(module->Functions()[i], registry))
+        {
+            ++mismatchCount;
+            continue;
+        }
+
+        ssa::SsaWriter writer;
+
+        if(!graph.Encode(writer) || writer.Size() != attachment->Writer().Size() || ::std::memcmp(writer.Buffer(), attachment->Writer().Buffer(), writer.Size()) != 0)
+        {
+            ++mismatchCount;
+        }
+    }
+
+    ConPrinter::PrintLn("{} of {} functions changed after decoding and encoding.", mismatchCount, module->Functions().Count());
+}
+
+static void TestSsaDefUseIndex() noexcept
+{
+    ConPrinter::PrintLn();
+    ConPrinter::PrintLn("Test SSA Def Use Index:");
+
+    using namespace tau::ir;
+
+    const ssa::SsaCustomType type(ssa::SsaType::U64);
+    const u64 five = 5;
+
+    ssa::SsaWriter writer;
+    const ssa::VarId a = writer.WriteAssignImmediate(type, &five, sizeof(five));
+    const ssa::VarId b = writer.WriteBinOpVtoV(ssa::SsaBinaryOperation::Add, type, a, 0x80000000);
+    const ssa::VarId c = writer.WriteBinOpVtoV(ssa::SsaBinaryOperation::Mul, type, a, b);
+    const ssa::VarId d = writer.WriteBinOpVtoV(ssa::SsaBinaryOperation::Add, type, c, c);
+    const ssa::VarId pointer = writer.WriteComputePtr(d, b, 8, 0);
+    writer.WriteStoreV(type, pointer, a);
+    writer.WriteRet(type, d);
+
+    // The users of each var in the order they appear, as the per var lists of the old usage map held them.
+    // The store and the return use their vars by themselves, the use of the argument is dropped.
+    const ::std::vector<::std::vector<ssa::VarId>> expected {
+        { },
+        { b, c, a },
+        { c, pointer },
+        { d, d },
+        { pointer, d },
+        { pointer }
+    };
+
+    const ssa::SsaCustomTypeRegistry registry;
+    ssa::opto::UsageAnalyzerVisitor analyzer(registry);
+
+    if(!analyzer.Traverse(writer.Buffer(), writer.Size(), writer.IdIndex()))
+    {
+        ConPrinter::PrintLn("Failed to traverse the SSA.");
+        return;
+    }
+
+    const ssa::SsaDefUseIndex& index = analyzer.UsageMap();
+    uSys mismatchCount = 0;
+
+    for(ssa::VarId var = 0; var < expected.size(); ++var)
+    {
+        if(index.UseCount(var) != expected[var].size() || !::std::equal(index.UsersBegin(var), index.UsersEnd(var), expected[var].begin(), expected[var].end()))
+        {
+            ++mismatchCount;
+        }
+    }
+
+    ConPrinter::PrintLn("{} of {} vars have different users, {} uses in total.", mismatchCount, expected.size(), index.UseCount());
+    // The stored var and the returned var are roots, the intermediate ones aren't.
+    ConPrinter::PrintLn("Roots: %{} {}, %{} {}, %{} {}", a, index.IsRoot(a) ? "yes" : "no", d, index.IsRoot(d) ? "yes" : "no", c, index.IsRoot(c) ? "yes" : "no");
+}
+
+namespace {
+
+// Records the var defined by, or the label targeted by, a few kinds of instructions.
+class SsaOrderRecorder final : public tau::ir::ssa::SsaVisitor<SsaOrderRecorder>
+{
+    DEFAULT_DESTRUCT(SsaOrderRecorder);
+    DELETE_CM(SsaOrderRecorder);
+public:
+    SsaOrderRecorder(const tau::ir::ssa::SsaCustomTypeRegistry& registry) noexcept
+        : SsaVisitor(registry)
+    { }
+
+    [[nodiscard]] const ::std::vector<tau::ir::ssa::VarId>& Order() const noexcept { return m_Order; }
+    void Clear() noexcept { m_Order.clear(); }
+public:
+    bool VisitLabel(const tau::ir::ssa::VarId label) noexcept { return Record(label); }
+    bool VisitAssignImmediate(const tau::ir::ssa::VarId newVar, const tau::ir::ssa::SsaCustomType type, const void* const value, const uSys size) noexcept { return Record(newVar); }
+    bool VisitAssignVar(const tau::ir::ssa::VarId newVar, const tau::ir::ssa::SsaCustomType type, const tau::ir::ssa::VarId var) noexcept { return Record(newVar); }
+    bool VisitBinOpVToV(const tau::ir::ssa::VarId newVar, const tau::ir::ssa::SsaBinaryOperation operation, const tau::ir::ssa::SsaCustomType type, const tau::ir::ssa::VarId a, const tau::ir::ssa::VarId b) noexcept { return Record(newVar); }
+    bool VisitBranch(const tau::ir::ssa::VarId label) noexcept { return Record(label); }
+    bool VisitPhi(const tau::ir::ssa::VarId newVar, const tau::ir::ssa::SsaCustomType type, const uSys incomingCount, const tau::ir::ssa::VarId* const labels, const tau::ir::ssa::VarId* const vars) noexcept { return Record(newVar); }
+private:
+    bool Record(const tau::ir::ssa::VarId var) noexcept
+    {
+        m_Order.push_back(var);
+        return true;
+    }
+private:
+    ::std::vector<tau::ir::ssa::VarId> m_Order;
+};
+
+}
+
+static void TestSsaReverseTraversal() noexcept
+{
+    ConPrinter::PrintLn();
+    ConPrinter::PrintLn("Test SSA Reverse Traversal:");
+
+    using namespace tau::ir;
+
+    ModuleRef module = IrGenerator()
+        .Seed(0x2E7A)
+        .FunctionCount(4)
+        .StatementCount(32)
+        .BranchDensity(20)
+        .LoopNesting(1)
+        .Build();
+
+    (void) IrToSsa::TransformModule(module, 0, 1);
+
+    const ssa::SsaCustomTypeRegistry registry;
+    ssa::SsaGraph graph;
+    SsaOrderRecorder recorder(registry);
+    uSys mismatchCount = 0;
+
+    for(uSys i = 0; i < module->Functions().Count(); ++i)
+    {
+        // Re-encoding through an indexed writer gives the same code, with its index.
+        ssa::SsaWriter writer;
+        writer.RecordInstructionIndex();
+
+        if(!graph.Decode(module->Functions()[i], registry) || !graph.Encode(writer))
+        {
+            ++mismatchCount;
+            continue;
+        }
+
+        recorder.Clear();
+        (void) recorder.Traverse(writer.Buffer(), writer.Size(), writer.IdIndex());
+        ::std::vector<ssa::VarId> forward = recorder.Order();
+
+        recorder.Clear();
+        (void) recorder.TraverseReverse(writer);
+
+        if(!::std::equal(forward.rbegin(), forward.rend(), recorder.Order().begin(), recorder.Order().end()))
+        {
+            ++mismatchCount;
+            continue;
+        }
+
+        // Visiting the definition of each recorded var, or branch target, has to record it again.
+        for(const ssa::VarId var : forward)
+        {
+            recorder.Clear();
+
+            if(!recorder.VisitAt(writer, writer.VarDefinition(var)) || recorder.Order().size() != 1 || recorder.Order()[0] != var)
+            {
+                ++mismatchCount;
+                break;
+            }
+        }
+    }
+
+    ConPrinter::PrintLn("{} of {} functions traversed differently in reverse.", mismatchCount, module->Functions().Count());
+}
+
+static void TestCommonSubexpressionElimination() noexcept
+{
+    ConPrinter::PrintLn();
+    ConPrinter::PrintLn("Test Common Subexpression Elimination:");
+
+    using namespace tau::ir;
+
+    ModuleRef module = IrGenerator()
+        .Seed(0xC5E1)
+        .FunctionCount(4)
+        .StatementCount(32)
+        .CallDepth(2)
+        .LocalCount(4)
+        .BranchDensity(20)
+        .LoopNesting(1)
+        .LoopTripCount(3)
+        .Build();
+
+    Emulator originalEmulator(module);
+    originalEmulator.Execute();
+
+    (void) IrToSsa::TransformModule(module, 0, 1);
+
+    const ssa::SsaCustomTypeRegistry registry;
+    uSys eliminatedCount = 0;
+
+    for(Function* function : module->Functions())
+    {
+        ssa::opto::CommonSubexpressionEliminationVisitor visitor(registry);
+
+        if(visitor.Traverse(function))
+        {
+            eliminatedCount += visitor.EliminatedCount();
+            visitor.UpdateAttachment(function);
+        }
+    }
+
+    ConPrinter::PrintLn("Eliminated {} instructions.", eliminatedCount);
+
+    ModuleRef lowered = SsaToIr::TransformModule(module, registry);
+
+    if(!lowered)
+    {
+        ConPrinter::PrintLn("Failed to lower the SSA.");
+        return;
+    }
+
+    Emulator loweredEmulator(lowered);
+    loweredEmulator.Execute();
+
+    ConPrinter::PrintLn("Return Val: {} -> {}", originalEmulator.ReturnVal(), loweredEmulator.ReturnVal());
+}
+
+static void TestLoopInvariantCodeMotion() noexcept
+{
+    ConPrinter::PrintLn();
+    ConPrinter::PrintLn("Test Loop Invariant Code Motion:");
+
+    using namespace tau::ir;
+
+    const ssa::SsaCustomTypeRegistry registry;
+
+    // Squares a local that is set before the loop on each of 3 iterations.
+    {
+        IrWriter writer;
+        writer.WriteConstant(7);
+        writer.WritePop(2);
+        writer.WriteConstant(0);
+        writer.WritePop(1);
+        writer.WriteConstant(3);
+        writer.WritePop(0);
+
+        const uSys loopHead = writer.Size();
+        writer.WritePush(2);
+        writer.WritePush(2);
+        writer.WriteMulI32();
+        writer.WritePush(1);
+        writer.WriteAddI32();
+        writer.WritePop(1);
+
+        writer.WriteConstant(1);
+        writer.WritePush(0);
+        writer.WriteSubI32();
+        writer.WriteDup(4);
+        writer.WritePop(0);
+        writer.WriteConstant(0);
+        writer.WriteCompI32(CompareCondition::NotEqual);
+
+        const uSys jumpHead = writer.Size();
+        writer.WriteJumpTrue(static_cast<i32>(static_cast<iSys>(loopHead) - static_cast<iSys>(jumpHead + 5)));
+
+        writer.WritePush(1);
+        writer.WriteExpandSX(4, 8);
+        writer.WritePopArg(0);
+        writer.WriteRet();
+
+        FunctionList functions(1);
+        {
+            DynArray<const TypeInfo*> localTypes(3);
+            localTypes[0] = &TypeInfo::I32;
+            localTypes[1] = &TypeInfo::I32;
+            localTypes[2] = &TypeInfo::I32;
+
+            functions[0] = FunctionBuilder()
+                .Address(writer.Buffer())
+                .CodeSize(writer.Size())
+                .LocalTypes(::std::move(localTypes))
+                .Arguments()
+                .Flags(InlineControl::NoInline, CallingConvention::Default, OptimizationControl::Default, false)
+                .Name(u8"Main")
+                .Attachment<IrWriterFunctionAttachment>(::std::move(writer))
+                .Build();
+        }
+
+        ModuleRef loopModule = ModuleBuilder()
+            .Functions(::std::move(functions))
+            .Exports()
+            .Imports()
+            .Emulated()
+            .Name(u8"Main")
+            .Build();
+
+        (void) IrToSsa::TransformModule(loopModule, 0, 1);
+
+        Function* const function = loopModule->Functions()[0];
+        ssa::opto::LoopInvariantCodeMotion licm(registry);
+
+        if(!licm.Traverse(function) || licm.HoistedCount() == 0)
+        {
+            ConPrinter::PrintLn("The square wasn't hoisted out of the loop.");
+        }
+        else
+        {
+            licm.UpdateAttachment(function);
+        }
+
+        ModuleRef lowered = SsaToIr::TransformModule(loopModule, registry);
+
+        if(lowered)
+        {
+            Emulator emulator(lowered);
+            emulator.Execute();
+
+            if(emulator.ReturnVal() != 147)
+            {
+                ConPrinter::PrintLn("The hoisted loop returned {} instead of 147.", emulator.ReturnVal());
+            }
+        }
+        else
+        {
+            ConPrinter::PrintLn("Failed to lower the hoisted loop.");
+        }
+    }
+
+    ModuleRef module = IrGenerator()
+        .Seed(0x71C4)
+        .FunctionCount(4)
+        .StatementCount(32)
+        .CallDepth(2)
+        .LocalCount(4)
+        .BranchDensity(20)
+        .LoopNesting(2)
+        .LoopTripCount(3)
+        .Build();
+
+    Emulator originalEmulator(module);
+    originalEmulator.Execute();
+
+    (void) IrToSsa::TransformModule(module, 0, 1);
+
+    uSys hoistedCount = 0;
+
+    for(Function* function : module->Functions())
+    {
+        ssa::opto::LoopInvariantCodeMotion licm(registry);
+
+        if(licm.Traverse(function))
+        {
+            hoistedCount += licm.HoistedCount();
+            licm.UpdateAttachment(function);
+        }
+    }
+
+    ConPrinter::PrintLn("Hoisted {} instructions.", hoistedCount);
+
+    ModuleRef lowered = SsaToIr::TransformModule(module, registry);
+
+    if(!lowered)
+    {
+        ConPrinter::PrintLn("Failed to lower the SSA.");
+        return;
+    }
+
+    Emulator loweredEmulator(lowered);
+    loweredEmulator.Execute();
+
+    ConPrinter::PrintLn("Return Val: {} -> {}", originalEmulator.ReturnVal(), loweredEmulator.ReturnVal());
+    if(originalEmulator.ReturnVal() != loweredEmulator.ReturnVal())
+    {
+        ConPrinter::PrintLn("The optimized module returned a different value: {} != {}", loweredEmulator.ReturnVal(), originalEmulator.ReturnVal());
+    }
+}
+
+static void TestStrengthReduction() noexcept
+{
+    ConPrinter::PrintLn();
+    ConPrinter::PrintLn("Test Strength Reduction:");
+
+    using namespace tau::ir;
+
+    // Divides the argument by constants of both signs, powers of two and not.
+    IrWriter divideWriter;
+    divideWriter.WriteConstant(0);
+
+    for(const i32 divisor : { 7, -7, 8, -8, 2, 641, -1000, 1 })
+    {
+        divideWriter.WriteConstant(static_cast<u32>(divisor));
+        divideWriter.WritePushArg(0);
+        divideWriter.WriteTrunc(8, 4);
+        divideWriter.WriteDivI32();
+        divideWriter.WriteAddI32();
+        divideWriter.WriteAddI32();
+    }
+
+    for(const i32 divisor : { 7, 10, -16, 1000000007 })
+    {
+        divideWriter.WriteConstant(static_cast<u32>(divisor));
+        divideWriter.WriteExpandSX(4, 8);
+        divideWriter.WritePushArg(0);
+        divideWriter.WriteDivI64();
+        divideWriter.WriteAddI64();
+        divideWriter.WriteTrunc(8, 4);
+        divideWriter.WriteAddI32();
+    }
+
+    for(const i32 multiplier : { 10, 8, -3, 15 })
+    {
+        divideWriter.WriteConstant(static_cast<u32>(multiplier));
+        divideWriter.WritePushArg(0);
+        divideWriter.WriteTrunc(8, 4);
+        divideWriter.WriteMulI32();
+        divideWriter.WriteAddI32();
+    }
+
+    divideWriter.WriteExpandSX(4, 8);
+    divideWriter.WritePopArg(0);
+    divideWriter.WriteRet();
+
+    IrWriter mainWriter;
+    mainWriter.WriteConstant(static_cast<u32>(-1234567));
+    mainWriter.WriteExpandSX(4, 8);
+    mainWriter.WritePopArg(0);
+    mainWriter.WriteCall(1);
+    mainWriter.WritePushArg(0);
+    mainWriter.WritePop(0);
+    mainWriter.WriteConstant(98765);
+    mainWriter.WriteExpandSX(4, 8);
+    mainWriter.WritePopArg(0);
+    mainWriter.WriteCall(1);
+    mainWriter.WritePush(0);
+    mainWriter.WritePushArg(0);
+    mainWriter.WriteAddI64();
+    mainWriter.WritePopArg(0);
+    mainWriter.WriteRet();
+
+    FunctionList functions(2);
+    {
+        DynArray<const TypeInfo*> mainLocalTypes(1);
+        mainLocalTypes[0] = &TypeInfo::I64;
+
+        DynArray<FunctionArgument> divideArgs(1);
+        divideArgs[0] = FunctionArgument(true, 0);
+
+        functions[0] = FunctionBuilder()
+            .Address(mainWriter.Buffer())
+            .CodeSize(mainWriter.Size())
+            .LocalTypes(::std::move(mainLocalTypes))
+            .Arguments()
+            .Flags(InlineControl::NoInline, CallingConvention::Default, OptimizationControl::Default, false)
+            .Name(u8"Main")
+            .Attachment<IrWriterFunctionAttachment>(::std::move(mainWriter))
+            .Build();
+        functions[1] = FunctionBuilder()
+            .Address(divideWriter.Buffer())
+            .CodeSize(divideWriter.Size())
+            .LocalTypes()
+            .Arguments(divideArgs)
+            .Flags(InlineControl::NoInline, CallingConvention::Default, OptimizationControl::Default, false)
+            .Name(u8"Divide")
+            .Attachment<IrWriterFunctionAttachment>(::std::move(divideWriter))
+            .Build();
+    }
+
+    ModuleRef module = ModuleBuilder()
+        .Functions(::std::move(functions))
+        .Exports()
+        .Imports()
+        .Emulated()
+        .Name(u8"Main")
+        .Build();
+
+    Emulator originalEmulator(module);
+    originalEmulator.Execute();
+
+    (void) IrToSsa::TransformModule(module, 0, 1);
+
+    const ssa::SsaCustomTypeRegistry registry;
+    ssa::opto::StrengthReductionVisitor strengthReduction(registry);
+
+    // The divisors have to be folded into immediates first.
+    {
+        Function* const divide = module->Functions()[1];
+
+        ssa::opto::ConstantPropVisitor constantProp(registry);
+        if(constantProp.Traverse(divide))
+        {
+            constantProp.UpdateAttachment(divide);
+        }
+
+        if(strengthReduction.Traverse(divide))
+        {
+            strengthReduction.UpdateAttachment(divide);
+        }
+    }
+
+    ConPrinter::PrintLn("Reduced {} instructions.", strengthReduction.ReducedCount());
+
+    ModuleRef lowered = SsaToIr::TransformModule(module, registry);
+
+    if(!lowered)
+    {
+        ConPrinter::PrintLn("Failed to lower the SSA.");
+        return;
+    }
+
+    Emulator loweredEmulator(lowered);
+    loweredEmulator.Execute();
+
+    ConPrinter::PrintLn("Return Val: {} -> {}", static_cast<i64>(originalEmulator.ReturnVal()), static_cast<i64>(loweredEmulator.ReturnVal()));
+    // Each division leaves both the quotient and the remainder, which are summed.
+    const auto divide = [](const i64 x) noexcept -> i64
+    {
+        const i32 x32 = static_cast<i32>(x);
+        u32 sum = 0;
+
+        for(const i32 divisor : { 7, -7, 8, -8, 2, 641, -1000, 1 })
+        {
+            sum += static_cast<u32>(x32 / divisor) + static_cast<u32>(x32 % divisor);
+        }
+
+        for(const i64 divisor : { 7, 10, -16, 1000000007 })
+        {
+            sum += static_cast<u32>(x / divisor + x % divisor);
+        }
+
+        for(const i32 multiplier : { 10, 8, -3, 15 })
+        {
+            sum += static_cast<u32>(multiplier) * static_cast<u32>(x32);
+        }
+
+        return static_cast<i32>(sum);
+    };
+
+    const u64 expected = static_cast<u64>(divide(-1234567) + divide(98765));
+
+    if(originalEmulator.ReturnVal() != expected || loweredEmulator.ReturnVal() != expected)
+    {
+        ConPrinter::PrintLn("The reduced module returned {} instead of {}.", static_cast<i64>(loweredEmulator.ReturnVal()), static_cast<i64>(expected));
+    }
+
+    // Every Div and Rem is rewritten, and every multiply except the one by -3.
+    if(strengthReduction.ReducedCount() != 27)
+    {
+        ConPrinter::PrintLn("Reduced {} of 27 instructions.", strengthReduction.ReducedCount());
+    }
+}
+
+namespace {
+
+/**
+ *   Divides the way the sequence emitted for a signed division does, but
+ * straight from the magic number.
+ */
+template<typename S>
+[[nodiscard]] S MagicDivide(const S dividend, const S divisor) noexcept
+{
+    using U = ::std::make_unsigned_t<S>;
+    constexpr u32 Bits = sizeof(S) * 8;
+
+    const tau::ir::ssa::opto::internal::DivisionMagic<U> magic = tau::ir::ssa::opto::internal::ComputeSignedMagic<U>(static_cast<U>(divisor));
+    const S multiplier = static_cast<S>(magic.Multiplier);
+
+    U quotient = static_cast<U>(tau::ir::MulHigh<S>(dividend, multiplier));
+
+    if(divisor > 0 && multiplier < 0)
+    {
+        quotient += static_cast<U>(dividend);
+    }
+    else if(divisor < 0 && multiplier > 0)
+    {
+        quotient -= static_cast<U>(dividend);
+    }
+
+    const S shifted = static_cast<S>(static_cast<S>(quotient) >> magic.Shift);
+    return static_cast<S>(static_cast<U>(shifted) + (static_cast<U>(shifted) >> (Bits - 1)));
+}
+
+/**
+ *   Divides the way the sequence emitted for an unsigned division does,
+ * but straight from the magic number.
+ */
+template<typename U>
+[[nodiscard]] U MagicDivideUnsigned(const U dividend, const U divisor) noexcept
+{
+    const tau::ir::ssa::opto::internal::DivisionMagic<U> magic = tau::ir::ssa::opto::internal::ComputeUnsignedMagic<U>(divisor);
+    const U high = tau::ir::MulHigh<U>(dividend, magic.Multiplier);
+
+    if(!magic.Add)
+    {
+        return static_cast<U>(high >> magic.Shift);
+    }
+
+    return static_cast<U>((static_cast<U>((dividend - high) >> 1) + high) >> (magic.Shift - 1));
+}
+
+/**
+ *   Builds a function that divides dividend by divisor in SSA, reduces it
+ * and runs the lowered code.
+ *
+ * @return false if the division wasn't reduced or couldn't be run.
+ */
+template<typename T>
+[[nodiscard]] bool RunReducedDivide(const tau::ir::ssa::SsaBinaryOperation operation, const T dividend, const T divisor, T* const result) noexcept
+{
+    using namespace tau::ir;
+
+    const ssa::SsaCustomType type(::std::is_signed_v<T> ?
+        (sizeof(T) == 8 ? ssa::SsaType::I64 : ssa::SsaType::I32) :
+        (sizeof(T) == 8 ? ssa::SsaType::U64 : ssa::SsaType::U32));
+
+    // The IR is only a placeholder, the SSA is what gets reduced and lowered.
+    IrWriter placeholder;
+    placeholder.WriteRet();
+
+    FunctionList functions(1);
+    functions[0] = FunctionBuilder()
+        .Address(placeholder.Buffer())
+        .CodeSize(placeholder.Size())
+        .LocalTypes()
+        .Arguments()
+        .Flags(InlineControl::NoInline, CallingConvention::Default, OptimizationControl::Default, false)
+        .Name(u8"Divide")
+        .Attachment<IrWriterFunctionAttachment>(::std::move(placeholder))
+        .Build();
+
+    ModuleRef module = ModuleBuilder()
+        .Functions(::std::move(functions))
+        .Exports()
+        .Imports()
+        .Emulated()
+        .Name(u8"Divide")
+        .Build();
+
+    Function* const function = module->Functions()[0];
+
+    {
+        ssa::SsaWriter writer;
+        const ssa::VarId a = writer.WriteAssignImmediate(type, &dividend, sizeof(dividend));
+        const ssa::VarId quotient = writer.WriteBinOpItoV(operation, type, a, &divisor, sizeof(divisor));
+        writer.WriteRet(type, quotient);
+
+        function->Attach<ssa::SsaWriterFunctionAttachment>(::std::move(writer));
+    }
+
+    const ssa::SsaCustomTypeRegistry registry;
+    ssa::opto::StrengthReductionVisitor strengthReduction(registry);
+
+    if(!strengthReduction.Traverse(function) || strengthReduction.ReducedCount() == 0)
+    {
+        return false;
+    }
+
+    strengthReduction.UpdateAttachment(function);
+
+    ModuleRef lowered = SsaToIr::TransformModule(module, registry);
+
+    if(!lowered)
+    {
+        return false;
+    }
+
+    Emulator emulator(lowered);
+    emulator.Execute();
+    *result = static_cast<T>(emulator.ReturnVal());
+    return true;
+}
+
+/**
+ * @return The number of divisions that didn't match / and %.
+ */
+template<typename T>
+[[nodiscard]] u32 CheckDivisionMagic() noexcept
+{
+    using S = ::std::make_signed_t<T>;
+    constexpr u32 Bits = sizeof(T) * 8;
+
+    ::std::vector<T> divisors { static_cast<T>(3), static_cast<T>(-3), static_cast<T>(7), static_cast<T>(~T { 0 }), static_cast<T>(::std::numeric_limits<S>::min() + 1) };
+
+    for(const u32 k : { 2u, 5u, Bits - 2 })
+    {
+        const T power = static_cast<T>(T { 1 } << k);
+
+        for(const T divisor : { static_cast<T>(power + 1), static_cast<T>(power - 1) })
+        {
+            divisors.push_back(divisor);
+            divisors.push_back(static_cast<T>(T { 0 } - divisor));
+        }
+    }
+
+    const T dividends[] { 0, 1, static_cast<T>(-1), ::std::numeric_limits<T>::min(), ::std::numeric_limits<T>::max() };
+
+    u32 mismatchCount = 0;
+
+    for(const T divisor : divisors)
+    {
+        // All ones is -1 when signed, that is negated rather than multiplied.
+        const bool hasMagic = !::std::is_signed_v<T> || divisor != static_cast<T>(-1);
+
+        for(const T dividend : dividends)
+        {
+            // The minimum divided by -1 overflows.
+            if(::std::is_signed_v<T> && divisor == static_cast<T>(-1) && dividend == ::std::numeric_limits<T>::min())
+            {
+                continue;
+            }
+
+            const T quotient = static_cast<T>(dividend / divisor);
+            const T remainder = static_cast<T>(dividend % divisor);
+
+            if(hasMagic)
+            {
+                T magicQuotient;
+
+                if constexpr(::std::is_signed_v<T>)
+                {
+                    magicQuotient = MagicDivide<T>(dividend, divisor);
+                }
+                else
+                {
+                    magicQuotient = MagicDivideUnsigned<T>(dividend, divisor);
+                }
+
+                if(magicQuotient != quotient)
+                {
+                    ConPrinter::PrintLn("The magic number for {} / {} gives {}, not {}.", dividend, divisor, magicQuotient, quotient);
+                    ++mismatchCount;
+                }
+            }
+
+            T reducedQuotient;
+            T reducedRemainder;
+
+            if(!RunReducedDivide<T>(tau::ir::ssa::SsaBinaryOperation::Div, dividend, divisor, &reducedQuotient) ||
+               !RunReducedDivide<T>(tau::ir::ssa::SsaBinaryOperation::Rem, dividend, divisor, &reducedRemainder))
+            {
+                ConPrinter::PrintLn("Failed to reduce {} / {}.", dividend, divisor);
+                ++mismatchCount;
+                continue;
+            }
+
+            if(reducedQuotient != quotient || reducedRemainder != remainder)
+            {
+                ConPrinter::PrintLn("The reduced {} / {} gives {} rem {}, not {} rem {}.", dividend, divisor, reducedQuotient, reducedRemainder, quotient, remainder);
+                ++mismatchCount;
+            }
+        }
+    }
+
+    return mismatchCount;
+}
+
+}
+
+static void TestDivisionMagic() noexcept
+{
+    ConPrinter::PrintLn();
+    ConPrinter::PrintLn("Test Division Magic:");
+
+    ConPrinter::PrintLn("I32: {} mismatches.", CheckDivisionMagic<i32>());
+    ConPrinter::PrintLn("U32: {} mismatches.", CheckDivisionMagic<u32>());
+    ConPrinter::PrintLn("I64: {} mismatches.", CheckDivisionMagic<i64>());
+    ConPrinter::PrintLn("U64: {} mismatches.", CheckDivisionMagic<u64>());
+}
+
+static void TestJoinSplitFolding() noexcept
+{
+    ConPrinter::PrintLn();
+    ConPrinter::PrintLn("Test Join/Split Folding:");
+
+    using namespace tau::ir;
+
+    // Splits the argument into two i32 locals and puts it back together, then adds an i64 built from two constants.
+    IrWriter addWriter;
+    addWriter.WritePushArg(0);
+    addWriter.WritePop(0);
+    addWriter.WritePop(1);
+    addWriter.WritePush(1);
+    addWriter.WritePush(0);
+    addWriter.WriteConstant(14);
+    addWriter.WriteConstant(0);
+    addWriter.WriteAddI64();
+    addWriter.WritePopArg(0);
+    addWriter.WriteRet();
+
+    IrWriter mainWriter;
+    mainWriter.WriteConstant(5);
+    mainWriter.WriteConstant(1);
+    mainWriter.WritePopArg(0);
+    mainWriter.WriteCall(1);
+    mainWriter.WriteRet();
+
+    FunctionList functions(2);
+    {
+        DynArray<const TypeInfo*> addLocalTypes(2);
+        addLocalTypes[0] = &TypeInfo::I32;
+        addLocalTypes[1] = &TypeInfo::I32;
+
+        DynArray<FunctionArgument> addArgs(1);
+        addArgs[0] = FunctionArgument(true, 0);
+
+        functions[0] = FunctionBuilder()
+            .Address(mainWriter.Buffer())
+            .CodeSize(mainWriter.Size())
+            .LocalTypes()
+            .Arguments()
+            .Flags(InlineControl::NoInline, CallingConvention::Default, OptimizationControl::Default, false)
+            .Name(u8"Main")
+            .Attachment<IrWriterFunctionAttachment>(::std::move(mainWriter))
+            .Build();
+        functions[1] = FunctionBuilder()
+            .Address(addWriter.Buffer())
+            .CodeSize(addWriter.Size())
+            .LocalTypes(::std::move(addLocalTypes))
+            .Arguments(addArgs)
+            .Flags(InlineControl::NoInline, CallingConvention::Default, OptimizationControl::Default, false)
+            .Name(u8"Add14")
+            .Attachment<IrWriterFunctionAttachment>(::std::move(addWriter))
+            .Build();
+    }
+
+    ModuleRef module = ModuleBuilder()
+        .Functions(::std::move(functions))
+        .Exports()
+        .Imports()
+        .Emulated()
+        .Name(u8"Main")
+        .Build();
+
+    Emulator originalEmulator(module);
+    originalEmulator.Execute();
+
+    (void) IrToSsa::TransformModule(module, 0, 1);
+
+    const ssa::SsaCustomTypeRegistry registry;
+    ssa::opto::JoinSplitFoldingVisitor joinSplitFolding(registry);
+    u32 foldedCount = 0;
+
+    for(uSys i = 0; i < module->Functions().Count(); ++i)
+    {
+        Function* const function = module->Functions()[i];
+
+        if(joinSplitFolding.Traverse(function))
+        {
+            joinSplitFolding.UpdateAttachment(function);
+            foldedCount += joinSplitFolding.FoldedCount();
+        }
+    }
+
+    DumpSsa(module->Functions()[1], 1, registry);
+
+    ConPrinter::PrintLn("Folded {} instructions.", foldedCount);
+
+    ModuleRef lowered = SsaToIr::TransformModule(module, registry);
+
+    if(!lowered)
+    {
+        ConPrinter::PrintLn("Failed to lower the SSA.");
+        return;
+    }
+
+    Emulator loweredEmulator(lowered);
+    loweredEmulator.Execute();
+
+    ConPrinter::PrintLn("Return Val: {} -> {}", originalEmulator.ReturnVal(), loweredEmulator.ReturnVal());
+    // Main passes 5 in the low half and 1 in the high half.
+    const u64 expected = (1ull << 32) + 5 + 14;
+
+    if(originalEmulator.ReturnVal() != expected || loweredEmulator.ReturnVal() != expected)
+    {
+        ConPrinter::PrintLn("The folded module returned {} instead of {}.", loweredEmulator.ReturnVal(), expected);
+    }
+
+    // The three joins in Add14, and the join of the constants Main passes.
+    if(foldedCount != 4)
+    {
+        ConPrinter::PrintLn("Folded {} of 4 instructions.", foldedCount);
+    }
+}
+
+static void TestSsaVariableAnalysis() noexcept
+{
+    ConPrinter::PrintLn();
+    ConPrinter::PrintLn("Test SSA Variable Analysis:");
+
+    using namespace tau::ir;
+
+    // Inlining leaves plenty of short lived temporaries to share slots.
+    ModuleRef module = IrGenerator()
+        .Seed(0x9A55)
+        .FunctionCount(6)
+        .StatementCount(24)
+        .CallDepth(2)
+        .LocalCount(6)
+        .BranchDensity(25)
+        .LoopNesting(1)
+        .LoopTripCount(3)
+        .Build();
+
+    (void) IrToSsa::TransformModule(module, 0, 1);
+
+    const ssa::SsaCustomTypeRegistry registry;
+    ssa::opto::SsaPassManager passManager(registry, module);
+    passManager.SetPipeline(OptimizationControl::Default, ssa::opto::SsaPipeline().Run({ ssa::opto::SsaPass::Inline }));
+    (void) passManager.RunModule();
+
+    ssa::SsaVariableAnalysisVisitor variableAnalysis(registry);
+    uSys uncompactedSize = 0;
+    uSys compactedSize = 0;
+
+    for(uSys i = 0; i < module->Functions().Count(); ++i)
+    {
+        Function* const function = module->Functions()[i];
+
+        if(!variableAnalysis.Traverse(function))
+        {
+            ConPrinter::PrintLn("Failed to analyze function {}.", i);
+            continue;
+        }
+
+        uncompactedSize += variableAnalysis.UncompactedFrameSize();
+        compactedSize += variableAnalysis.FrameSize();
+        variableAnalysis.UpdateAttachment(function);
+    }
+
+    ConPrinter::PrintLn("Frame Size: {} -> {}", uncompactedSize, compactedSize);
+    ConPrinter::PrintLn("Main Frame Size: {}", module->Functions()[0]->FindAttachment<ssa::SsaVariableAnalysisAttachment>()->FrameSize());
+}
+
+static void TestSsaLivenessAnalysis() noexcept
+{
+    ConPrinter::PrintLn();
+    ConPrinter::PrintLn("Test SSA Liveness Analysis:");
+
+    using namespace tau::ir;
+
+    ModuleRef module = IrGenerator()
+        .Seed(0x9A55)
+        .FunctionCount(6)
+        .StatementCount(24)
+        .CallDepth(2)
+        .LocalCount(6)
+        .BranchDensity(25)
+        .LoopNesting(1)
+        .LoopTripCount(3)
+        .Build();
+
+    (void) IrToSsa::TransformModule(module, 0, 1);
+
+    const ssa::SsaCustomTypeRegistry registry;
+    ssa::opto::SsaPassManager passManager(registry, module);
+    passManager.SetPipeline(OptimizationControl::Default, ssa::opto::SsaPipeline().Run({ ssa::opto::SsaPass::Inline }));
+    (void) passManager.RunModule();
+
+    ssa::SsaVariableAnalysisVisitor variableAnalysis(registry);
+    ssa::SsaLivenessAnalysisVisitor livenessAnalysis(registry);
+    uSys blockCount = 0;
+    uSys killCount = 0;
+    uSys slotConflicts = 0;
+
+    for(uSys i = 0; i < module->Functions().Count(); ++i)
+    {
+        Function* const function = module->Functions()[i];
+
+        if(!variableAnalysis.Traverse(function) || !livenessAnalysis.Traverse(function))
+        {
+            ConPrinter::PrintLn("Failed to analyze function {}.", i);
+            continue;
+        }
+
+        variableAnalysis.UpdateAttachment(function);
+        livenessAnalysis.UpdateAttachment(function);
+
+        const ssa::SsaLivenessAnalysisAttachment* const liveness = function->FindAttachment<ssa::SsaLivenessAnalysisAttachment>();
+        const DynArray<ssa::SsaVariableTypeAndOffset>& variables = function->FindAttachment<ssa::SsaVariableAnalysisAttachment>()->Variables();
+
+        blockCount += liveness->BlockCount();
+
+        for(u32 instruction = 0; instruction < liveness->InstructionCount(); ++instruction)
+        {
+            killCount += liveness->KillsEnd(instruction) - liveness->KillsBegin(instruction);
+        }
+
+        const auto valueSize = [](const ssa::SsaCustomType type) -> uSys
+        {
+            if(type.Type == ssa::SsaType::Bytes)
+            {
+                return type.CustomType;
+            }
+
+            return type.Type == ssa::SsaType::Void || type.Type == ssa::SsaType::Label ? 0 : ssa::TypeValueSize(type.Type);
+        };
+
+        // Vars that are live at the same time must never share any bytes of the frame.
+        const auto countConflicts = [&](const u64* const set)
+        {
+            ::std::vector<ssa::VarId> live;
+
+            for(ssa::VarId var = 1; var <= liveness->MaxVarId(); ++var)
+            {
+                if((set[var / 64] & (1ull << (var % 64))) != 0 && valueSize(variables[var - 1].Type) != 0)
+                {
+                    live.push_back(var);
+                }
+            }
+
+            for(uSys a = 0; a < live.size(); ++a)
+            {
+                for(uSys b = a + 1; b < live.size(); ++b)
+                {
+                    const ssa::SsaVariableTypeAndOffset& varA = variables[live[a] - 1];
+                    const ssa::SsaVariableTypeAndOffset& varB = variables[live[b] - 1];
+
+                    if(varA.Offset < varB.Offset + valueSize(varB.Type) && varB.Offset < varA.Offset + valueSize(varA.Type))
+                    {
+                        ++slotConflicts;
+                    }
+                }
+            }
+        };
+
+        for(u32 block = 0; block < liveness->BlockCount(); ++block)
+        {
+            countConflicts(liveness->LiveIn(block));
+            countConflicts(liveness->LiveOut(block));
+        }
+    }
+
+    ConPrinter::PrintLn("Blocks: {}, Kills: {}", blockCount, killCount);
+    ConPrinter::PrintLn("Slot Conflicts: {}", slotConflicts);
+}
+
+static void TestInliner() noexcept
+{
+    ConPrinter::PrintLn();
+    ConPrinter::PrintLn("Test Inliner (Expect 259):");
+
+    using namespace tau::ir;
+
+    const u8 codeSquare[] = {
+        0x30,   // Push.Arg.0
+        0x30,   // Push.Arg.0
+        0x39,   // Mul.i64
+        0x40,   // Pop.Arg.0
+        0x1D    // Ret
+    };
+
+    // Square is called with a constant, once inlined the whole call folds away.
+    const u8 codeMain[] = {
+        0x8B, 0x00, 0x10, 0x00, 0x00, 0x00, // Const.N 16
+        0x29,                               // Expand.SX.4.8
+        0x40,                               // Pop.Arg.0
+        0x1C, 0x01, 0x00, 0x00, 0x00,       // Call <codeSquare>
+        0x17,                               // Const.3
+        0x30,                               // Push.Arg.0
+        0x2A,                               // Trunc.8.4
+        0x34,                               // Add.i32
+        0x29,                               // Expand.SX.4.8
+        0x40,                               // Pop.Arg.0
+        0x1D                                // Ret
+    };
+
+    FunctionList functions(2);
+    {
+        DynArray<FunctionArgument> squareArgs(1);
+        squareArgs[0] = FunctionArgument(true, 0);
+
+        functions[0] = FunctionBuilder()
+            .Code(codeMain)
+            .LocalTypes()
+            .Arguments()
+            .Flags(InlineControl::NoInline, CallingConvention::Default, OptimizationControl::ForceOptimize, false)
+            .Name(u8"Main")
+            .Build();
+        functions[1] = FunctionBuilder()
+            .Code(codeSquare)
+            .LocalTypes()
+            .Arguments(squareArgs)
+            .Flags(InlineControl::Default, CallingConvention::Default, OptimizationControl::ForceOptimize, false)
+            .Name(u8"Square")
+            .Build();
+    }
+
+    ModuleRef module = ModuleBuilder()
+        .Functions(::std::move(functions))
+        .Exports()
+        .Imports()
+        .Emulated()
+        .Name(u8"Main")
+        .Build();
+
+    Emulator originalEmulator(module);
+    originalEmulator.Execute();
+
+    (void) IrToSsa::TransformModule(module, 0, 1);
+
+    const ssa::SsaCustomTypeRegistry registry;
+
+    // Both uses of the argument can fold once a constant is passed.
+    {
+        ssa::opto::internal::InlineCostVisitor cost(registry);
+
+        if(!cost.Traverse(module->Functions()[1]) || cost.HasCalls() || cost.HasControlFlow() || cost.ArgumentUses(0) != 2)
+        {
+            ConPrinter::PrintLn("Square was measured wrong, {} uses of its argument.", cost.ArgumentUses(0));
+        }
+    }
+
+    ssa::opto::SsaPassManager passManager(registry, module);
+    const u32 changedCount = passManager.RunModule();
+
+    const ssa::SsaCallGraph& callGraph = passManager.CallGraph();
+    ConPrinter::PrintLn("Components: {}, First Optimized: {}, Changed: {}", callGraph.ComponentCount(), callGraph.BottomUpOrder()[0], changedCount);
+
+    ssa::DumpSsa(module->Functions()[0], 0, registry);
+
+    if(callGraph.BottomUpOrder()[0] != 1)
+    {
+        ConPrinter::PrintLn("Square has to be optimized before Main.");
+    }
+
+    {
+        ssa::opto::internal::InlineCostVisitor cost(registry);
+
+        if(!cost.Traverse(module->Functions()[0]) || cost.HasCalls())
+        {
+            ConPrinter::PrintLn("The call to Square wasn't inlined.");
+        }
+    }
+
+    ModuleRef lowered = SsaToIr::TransformModule(module, registry);
+
+    if(!lowered)
+    {
+        ConPrinter::PrintLn("Failed to lower the SSA.");
+        return;
+    }
+
+    Emulator loweredEmulator(lowered);
+    loweredEmulator.Execute();
+
+    ConPrinter::PrintLn("Return Val: {} -> {}", originalEmulator.ReturnVal(), loweredEmulator.ReturnVal());
+
+    if(originalEmulator.ReturnVal() != 259 || loweredEmulator.ReturnVal() != 259)
+    {
+        ConPrinter::PrintLn("The inlined module returned {} instead of 259.", loweredEmulator.ReturnVal());
+    }
+}
+
+static void TestDeadFunctionElimination() noexcept
+{
+    ConPrinter::PrintLn();
+    ConPrinter::PrintLn("Test Dead Function Elimination (Expect 259):");
+
+    using namespace tau::ir;
+
+    const u8 codeSquare[] = {
+        0x30,   // Push.Arg.0
+        0x30,   // Push.Arg.0
+        0x39,   // Mul.i64
+        0x40,   // Pop.Arg.0
+        0x1D    // Ret
+    };
+
+    // Nothing calls Unused, removing it moves Square down an index.
+    const u8 codeUnused[] = {
+        0x17,   // Const.3
+        0x29,   // Expand.SX.4.8
+        0x40,   // Pop.Arg.0
+        0x1D    // Ret
+    };
+
+    const u8 codeMain[] = {
+        0x8B, 0x00, 0x10, 0x00, 0x00, 0x00, // Const.N 16
+        0x29,                               // Expand.SX.4.8
+        0x40,                               // Pop.Arg.0
+        0x1C, 0x02, 0x00, 0x00, 0x00,       // Call <codeSquare>
+        0x17,                               // Const.3
+        0x30,                               // Push.Arg.0
+        0x2A,                               // Trunc.8.4
+        0x34,                               // Add.i32
+        0x29,                               // Expand.SX.4.8
+        0x40,                               // Pop.Arg.0
+        0x1D                                // Ret
+    };
+
+    FunctionList functions(3);
+    {
+        DynArray<FunctionArgument> squareArgs(1);
+        squareArgs[0] = FunctionArgument(true, 0);
+
+        functions[0] = FunctionBuilder()
+            .Code(codeMain)
+            .LocalTypes()
+            .Arguments()
+            .Flags(InlineControl::NoInline, CallingConvention::Default, OptimizationControl::NoOptimize, false)
+            .Name(u8"Main")
+            .Build();
+        functions[1] = FunctionBuilder()
+            .Code(codeUnused)
+            .LocalTypes()
+            .Arguments()
+            .Flags(InlineControl::NoInline, CallingConvention::Default, OptimizationControl::NoOptimize, false)
+            .Name(u8"Unused")
+            .Build();
+        functions[2] = FunctionBuilder()
+            .Code(codeSquare)
+            .LocalTypes()
+            .Arguments(squareArgs)
+            .Flags(InlineControl::NoInline, CallingConvention::Default, OptimizationControl::NoOptimize, false)
+            .Name(u8"Square")
+            .Build();
+    }
+
+    ModuleRef module = ModuleBuilder()
+        .Functions(::std::move(functions))
+        .Exports()
+        .Imports()
+        .Emulated()
+        .Name(u8"Main")
+        .Build();
+
+    Emulator originalEmulator(module);
+    originalEmulator.Execute();
+
+    (void) IrToSsa::TransformModule(module, 0, 1);
+
+    const ssa::SsaCustomTypeRegistry registry;
+    ssa::opto::SsaPassManager passManager(registry, module);
+    const Function* const square = module->Functions()[2];
+
+    // An import would still refer to Square by its old index.
+    if(passManager.RemoveDeadFunctions(true) != 0 || module->Functions().Count() != 3)
+    {
+        ConPrinter::PrintLn("An imported module was compacted.");
+    }
+
+    const u32 removedCount = passManager.RemoveDeadFunctions(false);
+
+    ConPrinter::PrintLn("Removed: {}, Functions: {}, Reachable: {}", removedCount, module->Functions().Count(), passManager.CallGraph().ReachableCount());
+
+    if(removedCount != 1 || module->Functions().Count() != 2 || module->Functions()[1] != square)
+    {
+        ConPrinter::PrintLn("Unused wasn't removed, or Square didn't move down.");
     }
 
-    {
-        tau::ir::ssa::opto::InlinerVisitor visitor(registry, mainModule);
-        visitor.Traverse(squareFunc);
-        visitor.UpdateAttachment(squareFunc);
+    ssa::DumpSsa(module->Functions()[0], 0, registry);
 
-        tau::ir::ssa::DumpSsa(squareFunc, 1, registry);
+    ModuleRef lowered = SsaToIr::TransformModule(module, registry);
+
+    if(!lowered)
+    {
+        ConPrinter::PrintLn("Failed to lower the SSA.");
+        return;
     }
 
-    ConPrinter::PrintLn();
+    Emulator loweredEmulator(lowered);
+    loweredEmulator.Execute();
 
-    optoPass();
+    ConPrinter::PrintLn("Return Val: {} -> {}", originalEmulator.ReturnVal(), loweredEmulator.ReturnVal());
+
+    if(originalEmulator.ReturnVal() != 259 || loweredEmulator.ReturnVal() != 259)
+    {
+        ConPrinter::PrintLn("The compacted module returned {} instead of 259.", loweredEmulator.ReturnVal());
+    }
 }
 
-static void TestIrToSsaCallInd() noexcept
+static void TestFunctionSpecialization() noexcept
 {
     ConPrinter::PrintLn();
-    ConPrinter::PrintLn("Test IR to SSA Call Ind:");
+    ConPrinter::PrintLn("Test Function Specialization (Expect 432):");
 
     using namespace tau::ir;
-    using namespace tau::ir::ssa;
 
-    const u8 codeSquare[] = {
-        0x30,   // Push.Arg.0
+    const u8 codeMul[] = {
         0x30,   // Push.Arg.0
+        0x31,   // Push.Arg.1
         0x39,   // Mul.i64
         0x40,   // Pop.Arg.0
         0x1D    // Ret
     };
 
-    // Expect 259
+    // Every call passes 3 as the factor, the last two only differ in the value, so they share a copy.
     const u8 codeMain[] = {
         0x8B, 0x00, 0x10, 0x00, 0x00, 0x00, // Const.N 16
         0x29,                               // Expand.SX.4.8
         0x40,                               // Pop.Arg.0
-        0x15,                               // Const.1 <Square>
-        0x20,                               // Pop.0
-        0x80, 0x1D, 0x00, 0x00,             // Call.Ind 0
         0x17,                               // Const.3
-        0x30,                               // Push.Arg.0
-        0x2A,                               // Trunc.8.4
-        0x34,                               // Add.i32
         0x29,                               // Expand.SX.4.8
-        0x40,                               // Pop.Arg.0
+        0x41,                               // Pop.Arg.1
+        0x1C, 0x01, 0x00, 0x00, 0x00,       // Call <codeMul>
+        0x17,                               // Const.3
+        0x29,                               // Expand.SX.4.8
+        0x41,                               // Pop.Arg.1
+        0x1C, 0x01, 0x00, 0x00, 0x00,       // Call <codeMul>
+        0x17,                               // Const.3
+        0x29,                               // Expand.SX.4.8
+        0x41,                               // Pop.Arg.1
+        0x1C, 0x01, 0x00, 0x00, 0x00,       // Call <codeMul>
         0x1D                                // Ret
     };
 
-    DynArray<FunctionArgument> squareArgs(1);
-    squareArgs[0] = FunctionArgument(true, 0);
-
-    const C8DynString squareMangledName = MangleFunctionName(squareArgs);
-
-    ConPrinter::PrintLn("Square Mangled Name: {}", squareMangledName);
-
-    DynArray<const TypeInfo*> mainLocalTypes(1);
-    mainLocalTypes[0] = TypeInfo::Builder().Size(4).Flags(TypeInfoFlags::Function()).Name(squareMangledName).Build();
-
-    Function* const mainFunc = FunctionBuilder()
-        .Code(codeMain)
-        .LocalTypes(mainLocalTypes)
-        .Arguments()
-        .Flags(InlineControl::NoInline, CallingConvention::Default, OptimizationControl::Default, false)
-        .Name(u8"Main")
-        .Build();
-    Function* const squareFunc = FunctionBuilder()
-        .Code(codeSquare)
-        .LocalTypes()
-        .Arguments(squareArgs)
-        .Flags()
-        .Name(u8"Square")
-        .Build();
-
     FunctionList functions(2);
-    functions[0] = mainFunc;
-    functions[1] = squareFunc;
+    {
+        DynArray<FunctionArgument> mulArgs(2);
+        mulArgs[0] = FunctionArgument(true, 0);
+        mulArgs[1] = FunctionArgument(true, 1);
 
-    const ModuleRef mainModule = ModuleBuilder()
+        functions[0] = FunctionBuilder()
+            .Code(codeMain)
+            .LocalTypes()
+            .Arguments()
+            .Flags(InlineControl::NoInline, CallingConvention::Default, OptimizationControl::ForceOptimize, false)
+            .Name(u8"Main")
+            .Build();
+        functions[1] = FunctionBuilder()
+            .Code(codeMul)
+            .LocalTypes()
+            .Arguments(mulArgs)
+            .Flags(InlineControl::NoInline, CallingConvention::Default, OptimizationControl::ForceOptimize, false)
+            .Name(u8"Mul")
+            .Build();
+    }
+
+    ModuleRef module = ModuleBuilder()
         .Functions(::std::move(functions))
         .Exports()
         .Imports()
@@ -336,95 +2164,159 @@ static void TestIrToSsaCallInd() noexcept
         .Name(u8"Main")
         .Build();
 
-    DumpFunction(mainFunc, 0, mainModule, 0);
-    ConPrinter::PrintLn();
-    DumpFunction(squareFunc, 1, mainModule, 0);
-    ConPrinter::PrintLn();
+    Emulator originalEmulator(module);
+    originalEmulator.Execute();
 
-    const SsaCustomTypeRegistry registry;
-    IrToSsa::TransformFunction(mainFunc, mainModule, 0);
-    IrToSsa::TransformFunction(squareFunc, mainModule, 0);
+    (void) IrToSsa::TransformModule(module, 0, 1);
 
-    DumpSsa(mainFunc, 0, registry);
-    DumpSsa(squareFunc, 1, registry);
-    ConPrinter::PrintLn();
-    const auto optoPass = [&]() {
-        // Constant Prop
-        {
-            tau::ir::ssa::opto::ConstantPropVisitor visitor(registry);
-            visitor.Traverse(mainFunc);
-            visitor.UpdateAttachment(mainFunc);
+    const ssa::SsaCustomTypeRegistry registry;
+    ssa::opto::SsaPassManager passManager(registry, module);
+    (void) passManager.RunModule();
+    const u32 redirectedCount = passManager.SpecializeFunctions();
 
-            tau::ir::ssa::DumpSsa(mainFunc, 0, registry);
-        }
+    ConPrinter::PrintLn("Redirected: {}, Functions: {}", redirectedCount, module->Functions().Count());
 
-        {
-            tau::ir::ssa::opto::ConstantPropVisitor visitor(registry);
-            visitor.Traverse(squareFunc);
-            visitor.UpdateAttachment(squareFunc);
+    ssa::DumpSsa(module->Functions()[3], 3, registry);
 
-            tau::ir::ssa::DumpSsa(squareFunc, 1, registry);
-        }
+    // One copy for the first call, one shared by the other two, and nothing calls Mul anymore.
+    if(redirectedCount != 3 || module->Functions().Count() != 4 || passManager.CallGraph().IsReachable(1))
+    {
+        ConPrinter::PrintLn("Expected 3 calls redirected to 2 copies of Mul.");
+    }
 
-        ConPrinter::PrintLn();
+    ModuleRef lowered = SsaToIr::TransformModule(module, registry);
 
-        // Usage Analysis
-        {
-            tau::ir::ssa::opto::UsageAnalyzerVisitor visitor(registry);
-            visitor.Traverse(mainFunc);
-            visitor.UpdateAttachment(mainFunc);
-        }
+    if(!lowered)
+    {
+        ConPrinter::PrintLn("Failed to lower the SSA.");
+        return;
+    }
 
-        {
-            tau::ir::ssa::opto::UsageAnalyzerVisitor visitor(registry);
-            visitor.Traverse(squareFunc);
-            visitor.UpdateAttachment(squareFunc);
-        }
+    Emulator loweredEmulator(lowered);
+    loweredEmulator.Execute();
 
-        ConPrinter::PrintLn();
+    ConPrinter::PrintLn("Return Val: {} -> {}", originalEmulator.ReturnVal(), loweredEmulator.ReturnVal());
 
-        // Dead Code Elimination
-        {
-            tau::ir::ssa::opto::DeadCodeEliminationVisitor visitor(registry, mainFunc);
-            visitor.Traverse(mainFunc);
-            visitor.UpdateAttachment(mainFunc);
+    if(originalEmulator.ReturnVal() != 432 || loweredEmulator.ReturnVal() != 432)
+    {
+        ConPrinter::PrintLn("The specialized module returned {} instead of 432.", loweredEmulator.ReturnVal());
+    }
+}
 
-            tau::ir::ssa::DumpSsa(mainFunc, 0, registry);
-        }
+static void TestLoadStoreElimination() noexcept
+{
+    ConPrinter::PrintLn();
+    ConPrinter::PrintLn("Test Load Store Elimination (Expect 3 Forwarded, 1 Removed):");
 
-        {
-            tau::ir::ssa::opto::DeadCodeEliminationVisitor visitor(registry, squareFunc);
-            visitor.Traverse(squareFunc);
-            visitor.UpdateAttachment(squareFunc);
+    using namespace tau::ir;
 
-            tau::ir::ssa::DumpSsa(squareFunc, 1, registry);
-        }
+    // The arguments are a base pointer, an index and a value.
+    const ssa::VarId base = 0x80000000;
+    const ssa::VarId index = 0x80000001;
+    const ssa::VarId value = 0x80000002;
+    const ssa::SsaCustomType type(ssa::SsaType::U64);
+    const u64 zero = 0;
+    const u64 one = 1;
+
+    // The SSA is written directly, so the addresses are known.
+    ssa::SsaWriter writer;
+    const ssa::VarId first = writer.WriteComputePtr(base, index, 8, 0);
+    const ssa::VarId second = writer.WriteComputePtr(base, index, 8, 8);
+    // Overwritten before anything reads it.
+    writer.WriteStoreI(type, first, &zero, sizeof(zero));
+    writer.WriteStoreI(type, second, &one, sizeof(one));
+    writer.WriteStoreV(type, first, value);
+    // The ranges don't overlap, so both stored values are still known.
+    const ssa::VarId a = writer.WriteLoad(type, first);
+    const ssa::VarId b = writer.WriteLoad(type, second);
+    // The callee may write anywhere, the load after it is kept but the one after that reuses it.
+    (void) writer.WriteCall(0, 0, 0);
+    const ssa::VarId c = writer.WriteLoad(type, first);
+    const ssa::VarId d = writer.WriteLoad(type, first);
+    const ssa::VarId ab = writer.WriteBinOpVtoV(ssa::SsaBinaryOperation::Add, type, a, b);
+    const ssa::VarId cd = writer.WriteBinOpVtoV(ssa::SsaBinaryOperation::Add, type, c, d);
+    writer.WriteRet(type, writer.WriteBinOpVtoV(ssa::SsaBinaryOperation::Add, type, ab, cd));
+
+    const ssa::SsaCustomTypeRegistry registry;
+    ssa::opto::LoadStoreElimination elimination(registry);
+
+    if(!elimination.Traverse(writer.Buffer(), writer.Size(), writer.IdIndex()))
+    {
+        ConPrinter::PrintLn("Failed to decode the SSA.");
+        return;
+    }
 
-        ConPrinter::PrintLn();
-    };
+    ConPrinter::PrintLn("Forwarded: {}, Removed: {}", elimination.ForwardedCount(), elimination.RemovedStoreCount());
 
-    optoPass();
+    ssa::DumpSsa(elimination.Writer().Buffer(), elimination.Writer().Size(), 0, registry);
+}
 
-    // Inline
-    {
-        tau::ir::ssa::opto::InlinerVisitor visitor(registry, mainModule);
-        visitor.Traverse(mainFunc);
-        visitor.UpdateAttachment(mainFunc);
+static void TestPassManager() noexcept
+{
+    ConPrinter::PrintLn();
+    ConPrinter::PrintLn("Test Pass Manager:");
 
-        tau::ir::ssa::DumpSsa(mainFunc, 0, registry);
+    using namespace tau::ir;
+
+    // The optimized module has to compute the same value as the original.
+    ModuleRef module = IrGenerator()
+        .Seed(0x9A55)
+        .FunctionCount(6)
+        .StatementCount(24)
+        .CallDepth(2)
+        .LocalCount(6)
+        .BranchDensity(25)
+        .LoopNesting(1)
+        .LoopTripCount(3)
+        .Build();
+
+    Emulator originalEmulator(module);
+    originalEmulator.Execute();
+    const u64 originalRetVal = originalEmulator.ReturnVal();
+
+    (void) IrToSsa::TransformModule(module, 0, 1);
+
+    const ssa::SsaCustomTypeRegistry registry;
+    uSys originalSize = 0;
+
+    for(const Function* function : module->Functions())
+    {
+        originalSize += function->FindAttachment<ssa::SsaWriterFunctionAttachment>()->Writer().Size();
     }
 
+    ssa::opto::SsaPassManager passManager(registry, module);
+    // Debug builds don't optimize Default functions.
+    passManager.SetPipeline(OptimizationControl::Default, ssa::opto::SsaPassManager::DefaultPipeline(OptimizationControl::ForceOptimize));
+
+    const u32 changedCount = passManager.RunModule();
+
+    uSys optimizedSize = 0;
+
+    for(const Function* function : module->Functions())
     {
-        tau::ir::ssa::opto::InlinerVisitor visitor(registry, mainModule);
-        visitor.Traverse(squareFunc);
-        visitor.UpdateAttachment(squareFunc);
+        optimizedSize += function->FindAttachment<ssa::SsaWriterFunctionAttachment>()->Writer().Size();
+    }
 
-        tau::ir::ssa::DumpSsa(squareFunc, 1, registry);
+    ConPrinter::PrintLn("{} of {} functions changed, SSA Size: {} -> {}", changedCount, module->Functions().Count(), originalSize, optimizedSize);
+
+    ModuleRef lowered = SsaToIr::TransformModule(module, registry);
+
+    if(!lowered)
+    {
+        ConPrinter::PrintLn("Failed to lower the optimized module.");
+        return;
     }
 
-    ConPrinter::PrintLn();
+    Emulator loweredEmulator(lowered);
+    loweredEmulator.Execute();
+    const u64 loweredRetVal = loweredEmulator.ReturnVal();
 
-    optoPass();
+    ConPrinter::PrintLn("Return Val: {} -> {}", originalRetVal, loweredRetVal);
+
+    if(originalRetVal != loweredRetVal)
+    {
+        ConPrinter::PrintLn("The optimized module returned a different value: {} != {}", loweredRetVal, originalRetVal);
+    }
 }
 
 static void TestCall() noexcept
@@ -882,3 +2774,181 @@ static void TestWriteFile() noexcept
 
     (void) fclose(file);
 }
+
+static void TestIrGenerator() noexcept
+{
+    ConPrinter::PrintLn();
+    ConPrinter::PrintLn("Test IR Generator:");
+
+    using namespace tau::ir;
+
+    IrGenerator generator;
+    generator
+        .Seed(0x7A57)
+        .FunctionCount(8)
+        .StatementCount(24)
+        .CallDepth(3)
+        .LocalCount(6)
+        .BranchDensity(20)
+        .LoopNesting(2)
+        .LoopTripCount(3);
+
+    ModuleRef module0 = generator.Build();
+    ModuleRef module1 = generator.Build();
+
+    ::tau::ir::DumpFunction(module0->Functions()[0], 0, module0, 0);
+    ConPrinter::PrintLn();
+
+    tau::ir::Emulator emulator0(module0);
+    emulator0.Execute();
+
+    tau::ir::Emulator emulator1(module1);
+    emulator1.Execute();
+
+    const u64 retVal0 = emulator0.ReturnVal();
+    const u64 retVal1 = emulator1.ReturnVal();
+    ConPrinter::PrintLn("Return Val: {} ({}) [0x{X}]", retVal0, static_cast<i64>(retVal0), retVal0);
+
+    if(retVal0 != retVal1)
+    {
+        ConPrinter::PrintLn("Generated modules with the same seed returned different values: {} != {}", retVal0, retVal1);
+    }
+
+    ConPrinter::PrintLn();
+}
+
+static void TestMemoryReport() noexcept
+{
+    ConPrinter::PrintLn();
+    ConPrinter::PrintLn("Test Memory Report:");
+
+    using namespace tau::ir;
+
+    ModuleRef module = IrGenerator()
+        .Seed(0x3E3)
+        .FunctionCount(4)
+        .StatementCount(16)
+        .BranchDensity(0)
+        .Build();
+
+    if(!IrToSsa::TransformModule(module, 0))
+    {
+        ConPrinter::PrintLn("Failed to transform the module.");
+    }
+
+    DumpMemoryReport(MemoryReport::Build(module));
+
+    // Arrays are counted in bytes, not elements.
+    {
+        const u8 code[] = {
+            0x30,   // Push.Arg.0
+            0x40,   // Pop.Arg.0
+            0x1D    // Ret
+        };
+
+        DynArray<const TypeInfo*> localTypes(2);
+        localTypes[0] = &TypeInfo::I32;
+        localTypes[1] = &TypeInfo::I64;
+
+        DynArray<FunctionArgument> arguments(1);
+        arguments[0] = FunctionArgument(true, 0);
+
+        FunctionList functions(1);
+        functions[0] = FunctionBuilder()
+            .Code(code)
+            .LocalTypes(::std::move(localTypes))
+            .Arguments(arguments)
+            .Flags(InlineControl::NoInline, CallingConvention::Default, OptimizationControl::NoOptimize, false)
+            .Name(u8"Main")
+            .Build();
+
+        FunctionList exports(1);
+        exports[0] = functions[0];
+
+        ModuleRef knownModule = ModuleBuilder()
+            .Functions(::std::move(functions))
+            .Exports(::std::move(exports))
+            .Imports()
+            .Emulated()
+            .Name(u8"Main")
+            .Build();
+
+        const MemoryReport report = MemoryReport::Build(knownModule);
+        const FunctionMemoryReport& function = report.Functions()[0];
+
+        // The function and its export.
+        const uSys moduleBytes = sizeof(Module) + 2 * sizeof(Function*) + knownModule->Name().Length();
+
+        if(report.ModuleBytes() != moduleBytes)
+        {
+            ConPrinter::PrintLn("The module was counted as {} bytes instead of {}.", report.ModuleBytes(), moduleBytes);
+        }
+
+        // The first local is always at offset 0, only the offsets of the others are stored.
+        if(function.Code != sizeof(code) || function.LocalTypes != 2 * sizeof(const TypeInfo*) || function.LocalOffsets != sizeof(uSys) || function.Arguments != sizeof(FunctionArgument))
+        {
+            ConPrinter::PrintLn("The function was counted as [Code: {}, Local Types: {}, Local Offsets: {}, Arguments: {}].", function.Code, function.LocalTypes, function.LocalOffsets, function.Arguments);
+        }
+    }
+
+    ConPrinter::PrintLn();
+}
+
+static void TestProfile() noexcept
+{
+    ConPrinter::PrintLn();
+    ConPrinter::PrintLn("Test Profile:");
+
+    using namespace tau::ir;
+
+    ModuleRef module = IrGenerator()
+        .Seed(0x960F)
+        .FunctionCount(3)
+        .StatementCount(12)
+        .CallDepth(2)
+        .BranchDensity(25)
+        .LoopNesting(2)
+        .LoopTripCount(5)
+        .Build();
+
+    ExecutionProfile profile;
+
+    Emulator emulator(module);
+    emulator.Profile(&profile);
+    emulator.Execute();
+
+    for(uSys i = 0; i < module->Functions().Count(); ++i)
+    {
+        DumpFunction(module->Functions()[i], i, module, 0, profile);
+        ConPrinter::PrintLn();
+    }
+}
+
+static void TestTrace() noexcept
+{
+    ConPrinter::PrintLn();
+    ConPrinter::PrintLn("Test Trace:");
+
+    using namespace tau::ir;
+
+    ModuleRef module = IrGenerator()
+        .Seed(0x7EACE)
+        .FunctionCount(4)
+        .StatementCount(12)
+        .CallDepth(3)
+        .BranchDensity(25)
+        .LoopNesting(1)
+        .LoopTripCount(3)
+        .Build();
+
+    // Small enough that the buffer wraps.
+    TraceBuffer trace(16);
+
+    Emulator emulator(module);
+    emulator.Trace(&trace);
+    emulator.Execute();
+
+    DumpTrace(trace);
+
+    ConPrinter::PrintLn();
+}
@@ -116,3 +116,35 @@ workspace "TauIR"
             "TauIRDebug.lib"
         }
 
+    project "TauIRBench"
+        kind "ConsoleApp"
+        language "C++"
+        toolset "clang"
+        location "TauIRBench"
+
+        files { 
+            "%{prj.location}/**.h", 
+            "%{prj.location}/**.hpp", 
+            "%{prj.location}/src/**.c", 
+            "%{prj.location}/src/**.cpp" 
+        }
+
+        includedirs {
+            "%{prj.location}/include",
+            "%{wks.location}/libs/TauUtils/TauUtilsDynmaic/include",
+            "%{wks.location}/TauIRLib/include",
+            "%{wks.location}/TauIRDebug/include"
+        }
+
+        libdirs {
+            "%{cfg.outdir}",
+            "%{wks.location}/libs/TauUtils/build/TauUtilsStatic/%{cfg.longname}",
+            "%{wks.location}/libs/TauUtils/build/TauUtilsDynamic/%{cfg.longname}"
+        }
+
+        links {
+            "TauUtilsDynamicStatic.lib",
+            "TauUtilsStatic.lib",
+            "TauIRLib.lib",
+            "TauIRDebug.lib"
+        }